@@ -0,0 +1,150 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       arena.c
+*
+*   DESCRIPTION:
+*       Implementation of the bump allocator. An
+*       allocation is a pointer bump within the
+*       newest chunk; a chunk is only malloc()'d
+*       when the newest one runs out, and all of
+*       them are freed together.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdlib.h>
+
+#include "arena.h"
+#include "stats.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A chunk, with its memory right after
+the header
+-------------------------------------*/
+struct __arena_chunk_type
+{
+    struct __arena_chunk_type
+                       *next;           /* older chunk              */
+    size_t              pad;            /* keeps data aligned       */
+    char                data[];         /* memory handed out        */
+};
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_arena - "Initialize Arena"
+*
+*   DESCRIPTION:
+*       Makes an empty arena. No memory is
+*       taken until the first allocation.
+*
+**************************************************/
+void init_arena
+(
+    struct arena_type      *a       /* arena to initialize      */
+)
+{
+    a->chunks = NULL;
+    a->used   = 0;
+    a->size   = 0;
+    a->bytes  = 0;
+
+}   /* init_arena() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       arena_alloc - "Arena Allocate"
+*
+*   DESCRIPTION:
+*       Hands out memory aligned to ARENA_ALIGN.
+*       Allocations bigger than a chunk get a
+*       chunk of their own.
+*
+*   RETURNS:
+*       Returns the memory, or NULL if a chunk
+*       couldn't be allocated.
+*
+**************************************************/
+void *arena_alloc
+(
+    struct arena_type      *a,      /* arena                    */
+    size_t                  size    /* bytes wanted             */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __arena_chunk_type
+               *chunk;          /* new chunk                */
+    size_t      chunk_size;     /* its size                 */
+    void       *ret;            /* memory handed out        */
+
+    size = ( size + ARENA_ALIGN - 1 ) & ~(size_t)( ARENA_ALIGN - 1 );
+    if( size > a->size - a->used )
+    {
+        chunk_size = ( size > ARENA_CHUNK_SIZE ) ? size : ARENA_CHUNK_SIZE;
+        chunk      = (struct __arena_chunk_type *)stats_malloc( sizeof( *chunk ) + chunk_size );
+        if( NULL == chunk )
+        {
+            return( NULL );
+        }
+
+        chunk->next = a->chunks;
+        a->chunks   = chunk;
+        a->used     = 0;
+        a->size     = chunk_size;
+    }
+
+    ret       = &a->chunks->data[ a->used ];
+    a->used  += size;
+    a->bytes += size;
+    return( ret );
+
+}   /* arena_alloc() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_arena - "Free Arena"
+*
+*   DESCRIPTION:
+*       Frees every chunk, and with them
+*       everything allocated from the arena.
+*
+**************************************************/
+void free_arena
+(
+    struct arena_type      *a       /* arena to free            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __arena_chunk_type
+               *chunk;          /* chunk to free            */
+
+    while( NULL != a->chunks )
+    {
+        chunk     = a->chunks;
+        a->chunks = chunk->next;
+        free( chunk );
+    }
+    init_arena( a );
+
+}   /* free_arena() */
@@ -0,0 +1,70 @@
+/**************************************************
+*
+*   NAME:
+*       arena.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for the
+*       bump allocator that holds a compilation's
+*       small, long-lived allocations
+*
+**************************************************/
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stddef.h>
+
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define ARENA_CHUNK_SIZE    16384   /* bytes per chunk                  */
+#define ARENA_ALIGN         8       /* alignment of every allocation    */
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+Chunks of memory handed out front to
+back. Nothing is freed on its own;
+the whole arena goes at once. An arena
+belongs to one compilation, so it is
+never shared between threads.
+-------------------------------------*/
+struct arena_type
+{
+    struct __arena_chunk_type
+                       *chunks;         /* newest chunk first       */
+    size_t              used;           /* bytes used of the newest */
+    size_t              size;           /* bytes in the newest      */
+    uint64              bytes;          /* bytes handed out         */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+void init_arena
+(
+    struct arena_type      *a       /* arena to initialize      */
+);
+
+void *arena_alloc
+(
+    struct arena_type      *a,      /* arena                    */
+    size_t                  size    /* bytes wanted             */
+);
+
+void free_arena
+(
+    struct arena_type      *a       /* arena to free            */
+);
+
+#endif /* __ARENA_H__ */
@@ -0,0 +1,249 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       ast.c
+*
+*   DESCRIPTION:
+*       Implementation of the flat abstract
+*       syntax tree. Nodes are allocated from a
+*       single array that grows geometrically,
+*       so building a tree never allocates per
+*       node and freeing it is one release.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "stats.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __MIN_CAPACITY      1024    /* smallest node array          */
+#define __BYTES_PER_NODE    4       /* source bytes per node used   */
+                                    /*  to size the first array     */
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_ast - "Initialize AST"
+*
+*   DESCRIPTION:
+*       Allocates the node array and adds the
+*       root. Unless a capacity is given, the
+*       array is sized from the length of the
+*       source.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * AST_NO_MEMORY if the node array
+*         couldn't be allocated.
+*
+**************************************************/
+ast_error_t8 init_ast
+(
+    struct ast_type    *ast,    /* tree to initialize           */
+    const char         *src,    /* source buffer                */
+    uint                src_len,/* length of the source         */
+    uint                cap     /* initial nodes, 0 to size     */
+                                /*  from the source length      */
+)
+{
+    ast->src       = src;
+    ast->src_len   = src_len;
+    ast->num_nodes = 0;
+    ast->capacity  = ( 0 != cap ) ? cap : src_len / __BYTES_PER_NODE;
+    if( ast->capacity < __MIN_CAPACITY )
+    {
+        ast->capacity = __MIN_CAPACITY;
+    }
+
+    ast->nodes = (struct ast_node_type *)stats_malloc( (size_t)ast->capacity * sizeof( *ast->nodes ) );
+    if( NULL == ast->nodes )
+    {
+        ast->capacity = 0;
+        return( AST_NO_MEMORY );
+    }
+
+    reset_ast( ast );
+
+    return( AST_NO_ERROR );
+
+}   /* init_ast() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       reset_ast - "Reset AST"
+*
+*   DESCRIPTION:
+*       Empties a tree down to its root, keeping
+*       the node array for reuse.
+*
+**************************************************/
+void reset_ast
+(
+    struct ast_type    *ast     /* tree to empty                */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct ast_node_type   *root;   /* root node        */
+
+    root = &ast->nodes[ AST_ROOT ];
+    memset( root, 0, sizeof( *root ) );
+    root->token_class = TOK_LIST_TYPE;
+    root->subclass    = TOK_LIST_BEGIN;
+    ast->num_nodes    = 1;
+
+}   /* reset_ast() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       reserve_ast - "Reserve AST"
+*
+*   DESCRIPTION:
+*       Makes room for at least the given number
+*       of nodes, doubling the node array until
+*       it fits.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * AST_NO_MEMORY if the array couldn't be
+*         grown. The tree is unchanged.
+*
+**************************************************/
+ast_error_t8 reserve_ast
+(
+    struct ast_type    *ast,    /* tree to grow                 */
+    uint                need    /* nodes needed                 */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct ast_node_type   *nodes;      /* grown node array */
+    uint                    new_cap;    /* grown capacity   */
+
+    new_cap = ast->capacity;
+    while( new_cap < need )
+    {
+        if( new_cap << 1 <= new_cap )
+        {
+            return( AST_NO_MEMORY );
+        }
+        new_cap <<= 1;
+    }
+
+    if( new_cap == ast->capacity )
+    {
+        return( AST_NO_ERROR );
+    }
+
+    nodes = (struct ast_node_type *)stats_realloc( ast->nodes, (size_t)new_cap * sizeof( *nodes ) );
+    if( NULL == nodes )
+    {
+        return( AST_NO_MEMORY );
+    }
+
+    ast->nodes    = nodes;
+    ast->capacity = new_cap;
+
+    return( AST_NO_ERROR );
+
+}   /* reserve_ast() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       add_ast_node - "Add AST Node"
+*
+*   DESCRIPTION:
+*       Appends an unlinked node made from a
+*       token.
+*
+*   RETURNS:
+*       Returns the index of the new node.
+*
+*   ERRORS:
+*       * Returns AST_NO_NODE if the node array
+*         couldn't be grown.
+*
+*   NOTES:
+*       * Adding a node may move the array, so
+*         hold on to indices, not pointers.
+*
+**************************************************/
+uint add_ast_node
+(
+    struct ast_type    *ast,    /* tree to add to               */
+    const struct scan_token_type
+                       *tok     /* token the node is made from  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct ast_node_type   *node;   /* new node         */
+
+    if( ( ast->num_nodes == ast->capacity )
+     && ( AST_NO_ERROR != reserve_ast( ast, ast->num_nodes + 1 ) ) )
+    {
+        return( AST_NO_NODE );
+    }
+
+    node = &ast->nodes[ ast->num_nodes ];
+    node->token_class  = tok->token_class;
+    node->subclass     = tok->subclass;
+    node->len          = tok->len;
+    node->offset       = tok->offset;
+    node->first_child  = AST_NO_NODE;
+    node->next_sibling = AST_NO_NODE;
+    node->val          = tok->val;
+
+    return( ast->num_nodes++ );
+
+}   /* add_ast_node() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_ast - "Free AST"
+*
+*   DESCRIPTION:
+*       Frees the whole tree.
+*
+**************************************************/
+void free_ast
+(
+    struct ast_type    *ast     /* tree to free                 */
+)
+{
+    free( ast->nodes );
+    ast->nodes     = NULL;
+    ast->num_nodes = 0;
+    ast->capacity  = 0;
+
+}   /* free_ast() */
@@ -0,0 +1,117 @@
+/**************************************************
+*
+*   NAME:
+*       ast.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for the
+*       flat, index-based abstract syntax tree
+*
+**************************************************/
+
+#ifndef __AST_H__
+#define __AST_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "scanner.h"
+#include "tokens.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define AST_ROOT        0   /* index of the root node               */
+#define AST_NO_NODE     0   /* "no child"/"no sibling"; the root    */
+                            /*  is never anyone's child or sibling  */
+
+/*-------------------------------------
+Error types
+-------------------------------------*/
+typedef sint8 ast_error_t8;
+enum
+{
+    AST_NO_ERROR  =  0,     /* no error                 */
+    AST_NO_MEMORY = -1      /* out of memory            */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+AST node. A list node ("[ ... ]") has
+class TOK_LIST_TYPE and its elements
+as children; every other node is a
+leaf made from one token. Links are
+32-bit indices into the node array.
+-------------------------------------*/
+struct ast_node_type
+{
+    token_class_t8  token_class;    /* token class                      */
+    uint8           subclass;       /* class within the token class     */
+    uint16          len;            /* length of the lexeme             */
+    uint            offset;         /* byte offset of the lexeme        */
+    uint            first_child;    /* first child or AST_NO_NODE       */
+    uint            next_sibling;   /* next sibling or AST_NO_NODE      */
+    union literal_value_type
+                    val;            /* value of a numeric literal       */
+};
+
+/*-------------------------------------
+The tree. All nodes live in one
+array: the root is node 0 and its
+children are the top-level forms.
+Nodes are appended in source order,
+so every subtree is a contiguous
+range that starts at its root.
+-------------------------------------*/
+struct ast_type
+{
+    struct ast_node_type
+               *nodes;      /* node array                       */
+    uint        num_nodes;  /* nodes in use                     */
+    uint        capacity;   /* nodes allocated                  */
+    const char *src;        /* source the lexemes point into    */
+    uint        src_len;    /* length of the source             */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+ast_error_t8 init_ast
+(
+    struct ast_type    *ast,    /* tree to initialize           */
+    const char         *src,    /* source buffer                */
+    uint                src_len,/* length of the source         */
+    uint                cap     /* initial nodes, 0 to size     */
+                                /*  from the source length      */
+);
+
+void reset_ast
+(
+    struct ast_type    *ast     /* tree to empty                */
+);
+
+ast_error_t8 reserve_ast
+(
+    struct ast_type    *ast,    /* tree to grow                 */
+    uint                need    /* nodes needed                 */
+);
+
+uint add_ast_node
+(
+    struct ast_type    *ast,    /* tree to add to               */
+    const struct scan_token_type
+                       *tok     /* token the node is made from  */
+);
+
+void free_ast
+(
+    struct ast_type    *ast     /* tree to free                 */
+);
+
+#endif /* __AST_H__ */
@@ -0,0 +1,738 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       batch.c
+*
+*   DESCRIPTION:
+*       Compiles many source files at once on a
+*       work-stealing thread pool.
+*
+*       The jobs are split into one contiguous
+*       run per worker, held as a Chase-Lev
+*       deque whose items are the job indices
+*       between top and bottom. A worker takes
+*       jobs from the bottom of its own run;
+*       once that is empty it steals single
+*       jobs from the top of the others' runs.
+*       No job is ever added after the start,
+*       so a worker that finds every run empty
+*       is done. Taking and stealing are a few
+*       atomic operations on the run's two
+*       counters, with no lock anywhere.
+*
+*       Each job is an independent compilation:
+*       its type checker has its own bindings
+*       and arena, and only the keyword table,
+*       which nothing writes after
+*       init_symbol_table(), is shared. A job's
+*       output is therefore the same as a
+*       serial run's, whichever worker runs it.
+*
+*       A job writes a temporary file next to
+*       its output and renames it over the
+*       output only if the compilation
+*       succeeded. A failed job removes both,
+*       so it leaves no partial or stale
+*       output behind for a build to take as
+*       up to date.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "cache.h"
+#include "compiler.h"
+#include "incremental.h"
+#include "srcloc.h"
+#include "trace.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __CACHE_LINE        64      /* keeps the counters apart         */
+
+#define __TEMP_LEN          32      /* room for ".<pid>.<n>"            */
+
+#define __EMPTY             ( -1 )  /* run had no job                   */
+#define __LOST_RACE         ( -2 )  /* another thread took the job      */
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A worker and its run of jobs. bottom
+is only written by the owner; top is
+only moved by a compare-and-swap, by
+the owner taking the last job or by a
+thief.
+-------------------------------------*/
+struct __worker_type
+{
+    _Alignas( __CACHE_LINE )
+    atomic_int          top;            /* next job to steal        */
+    _Alignas( __CACHE_LINE )
+    atomic_int          bottom;         /* one past the owner's     */
+                                        /*  next job                */
+    struct __batch_type
+                       *batch;          /* pool it belongs to       */
+    uint                index;          /* its place in the pool    */
+    uint64              steals;         /* jobs it stole            */
+    pthread_t           thread;         /* its thread               */
+    boolean             started;        /* thread was created?      */
+};
+
+/*-------------------------------------
+The pool
+-------------------------------------*/
+struct __batch_type
+{
+    struct batch_job_type
+                       *jobs;           /* files to compile         */
+    const struct compile_options_type
+                       *opts;           /* options for every file   */
+    struct cache_type  *cache;          /* output cache, or NULL    */
+    struct __worker_type
+                       *workers;        /* one per thread           */
+    uint                num_workers;    /* workers in the pool      */
+};
+
+/*-------------------------------------------------
+                VARIABLE CONSTANTS
+-------------------------------------------------*/
+
+/*-------------------------------------
+Sets temporary output files of this
+process apart
+-------------------------------------*/
+static atomic_uint __next_temp;
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static int __take
+(
+    struct __worker_type   *w       /* owner                    */
+);
+
+static int __steal
+(
+    struct __worker_type   *w       /* worker to steal from     */
+);
+
+static void __run_job
+(
+    struct __batch_type    *b,      /* pool                     */
+    struct batch_job_type  *job     /* job to run               */
+);
+
+static void *__work
+(
+    void                   *arg     /* worker                   */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __take - "Take"
+*
+*   DESCRIPTION:
+*       Takes the job at the bottom of a
+*       worker's own run. Only the owner may
+*       call this.
+*
+*   RETURNS:
+*       Returns the job's index, or __EMPTY.
+*
+*   NOTES:
+*       * bottom is lowered before top is read,
+*         with a full fence between, so a thief
+*         can't take the same job unseen. Only
+*         the last job can be contended, and
+*         the compare-and-swap on top settles
+*         who gets it.
+*
+**************************************************/
+static int __take
+(
+    struct __worker_type   *w       /* owner                    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    int         top;            /* thieves' end             */
+    int         bottom;         /* owner's end              */
+    int         job;            /* job taken                */
+
+    bottom = atomic_load_explicit( &w->bottom, memory_order_relaxed ) - 1;
+    atomic_store_explicit( &w->bottom, bottom, memory_order_relaxed );
+    atomic_thread_fence( memory_order_seq_cst );
+    top = atomic_load_explicit( &w->top, memory_order_relaxed );
+
+    if( top > bottom )
+    {
+        atomic_store_explicit( &w->bottom, bottom + 1, memory_order_relaxed );
+        return( __EMPTY );
+    }
+
+    job = bottom;
+    if( top == bottom )
+    {
+        if( !atomic_compare_exchange_strong_explicit( &w->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed ) )
+        {
+            job = __EMPTY;
+        }
+        atomic_store_explicit( &w->bottom, bottom + 1, memory_order_relaxed );
+    }
+
+    return( job );
+
+}   /* __take() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __steal - "Steal"
+*
+*   DESCRIPTION:
+*       Takes the job at the top of another
+*       worker's run.
+*
+*   RETURNS:
+*       Returns the job's index, __EMPTY if the
+*       run is empty, or __LOST_RACE if another
+*       thread took the job first.
+*
+**************************************************/
+static int __steal
+(
+    struct __worker_type   *w       /* worker to steal from     */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    int         top;            /* job to steal             */
+    int         bottom;         /* owner's end              */
+
+    top = atomic_load_explicit( &w->top, memory_order_acquire );
+    atomic_thread_fence( memory_order_seq_cst );
+    bottom = atomic_load_explicit( &w->bottom, memory_order_acquire );
+
+    if( top >= bottom )
+    {
+        return( __EMPTY );
+    }
+
+    if( !atomic_compare_exchange_strong_explicit( &w->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed ) )
+    {
+        return( __LOST_RACE );
+    }
+
+    return( top );
+
+}   /* __steal() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __run_job - "Run Job"
+*
+*   DESCRIPTION:
+*       Compiles one file, or copies its output
+*       from the cache, and writes what a serial
+*       run would print on stderr into the job's
+*       report.
+*
+**************************************************/
+static void __run_job
+(
+    struct __batch_type    *b,      /* pool                     */
+    struct batch_job_type  *job     /* job to run               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct line_table_type  lt;         /* source lines         */
+    char                   *src;        /* source               */
+    uint                    len;        /* source length        */
+    int                     fd;         /* output               */
+    char                   *temp;       /* its temporary name   */
+    FILE                   *fp;         /* report               */
+    size_t                  report_len; /* report's length      */
+
+    job->status    = BATCH_JOB_FAILED;
+    job->report    = NULL;
+    job->cache_hit = FALSE;
+    memset( &job->result, 0, sizeof( job->result ) );
+
+    fp = open_memstream( &job->report, &report_len );
+    if( NULL == fp )
+    {
+        return;
+    }
+
+    src = read_source_file( job->in, &len );
+    if( NULL == src )
+    {
+        fprintf( fp, "unable to read %s\n", job->in );
+        fclose( fp );
+        return;
+    }
+
+    fd = open_output_file( job->out, &temp );
+    if( fd < 0 )
+    {
+        fprintf( fp, "unable to write %s\n", job->out );
+        fclose( fp );
+        free( src );
+        return;
+    }
+
+    if( NULL != b->cache )
+    {
+        job->cache_hit = cache_compile( b->cache, src, len, fd, b->opts, job->state, &job->result );
+    }
+    else
+    {
+        compile_incremental( src, len, fd, b->opts, job->state, &job->result );
+    }
+    if( !close_output_file( fd, job->out, temp, COMPILE_NO_ERROR == job->result.error )
+     && ( COMPILE_NO_ERROR == job->result.error ) )
+    {
+        job->result.error   = COMPILE_WRITE_ERROR;
+        job->result.message = compile_error_str( COMPILE_WRITE_ERROR );
+    }
+
+    if( ( COMPILE_PARSE_ERROR == job->result.error )
+     || ( COMPILE_TYPE_ERROR == job->result.error ) )
+    {
+        init_line_table( &lt, src, len );
+        report_diagnostic( &lt, fp, job->in, job->result.error_offset, job->result.message );
+        free_line_table( &lt );
+        job->status = BATCH_JOB_SOURCE_ERROR;
+    }
+    else if( COMPILE_NO_ERROR != job->result.error )
+    {
+        fprintf( fp, "%s: %s\n", job->in, job->result.message );
+    }
+    else
+    {
+        job->status = BATCH_JOB_OK;
+    }
+
+    fclose( fp );
+    if( 0 == report_len )
+    {
+        free( job->report );
+        job->report = NULL;
+    }
+    free( src );
+
+}   /* __run_job() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __work - "Work"
+*
+*   DESCRIPTION:
+*       A worker's thread. Runs the worker's
+*       own jobs, then steals from the others,
+*       starting with its neighbour, until
+*       every run is empty. Each job is a span
+*       on the trace.
+*
+**************************************************/
+static void *__work
+(
+    void                   *arg     /* worker                   */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __worker_type   *w;      /* this worker              */
+    struct __batch_type    *b;      /* pool                     */
+    int                     job;    /* job to run               */
+    uint                    i;      /* workers tried            */
+
+    w = (struct __worker_type *)arg;
+    b = w->batch;
+    trace_thread( "worker %u", w->index );
+    for( ;; )
+    {
+        while( __EMPTY != ( job = __take( w ) ) )
+        {
+            trace_begin( "batch", "job", "%s", b->jobs[ job ].in );
+            __run_job( b, &b->jobs[ job ] );
+            trace_end( "batch", "job", NULL );
+        }
+
+        job = __EMPTY;
+        for( i = 1; ( i < b->num_workers ) && ( job < 0 ); ++i )
+        {
+            do
+            {
+                job = __steal( &b->workers[ ( w->index + i ) % b->num_workers ] );
+            } while( __LOST_RACE == job );
+        }
+
+        if( job < 0 )
+        {
+            break;
+        }
+        ++w->steals;
+        trace_begin( "batch", "stolen job", "%s", b->jobs[ job ].in );
+        __run_job( b, &b->jobs[ job ] );
+        trace_end( "batch", "stolen job", NULL );
+    }
+
+    return( NULL );
+
+}   /* __work() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       read_source_file - "Read Source File"
+*
+*   DESCRIPTION:
+*       Reads a whole file into memory.
+*
+*   RETURNS:
+*       Returns the contents, to be freed by the
+*       caller, or NULL if the file couldn't be
+*       read.
+*
+**************************************************/
+char *read_source_file
+(
+    const char             *name,   /* file to read             */
+    uint                   *len     /* its length               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct stat st;             /* file status              */
+    char       *buf;            /* contents                 */
+    ssize_t     n;              /* bytes read by a call     */
+    uint        total;          /* bytes read so far        */
+    int         fd;             /* file                     */
+
+    fd = open( name, O_RDONLY );
+    if( fd < 0 )
+    {
+        return( NULL );
+    }
+
+    if( ( 0 != fstat( fd, &st ) )
+     || ( (uint64)st.st_size >= 0xFFFFFFFFull )
+     || ( NULL == ( buf = (char *)malloc( (size_t)st.st_size + 1 ) ) ) )
+    {
+        close( fd );
+        return( NULL );
+    }
+
+    total = 0;
+    while( total < (uint)st.st_size )
+    {
+        n = read( fd, &buf[ total ], (size_t)st.st_size - total );
+        if( n <= 0 )
+        {
+            break;
+        }
+        total += (uint)n;
+    }
+    close( fd );
+
+    buf[ total ] = '\0';
+    *len         = total;
+    return( buf );
+
+}   /* read_source_file() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       open_output_file - "Open Output File"
+*
+*   DESCRIPTION:
+*       Creates a temporary file next to an
+*       output file, to be put in its place by
+*       close_output_file().
+*
+*   RETURNS:
+*       Returns the temporary file, and its
+*       name in temp, or -1 if it couldn't be
+*       created.
+*
+**************************************************/
+int open_output_file
+(
+    const char             *path,   /* output file              */
+    char                  **temp    /* temporary file's name    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    int         fd;             /* temporary file           */
+
+    *temp = (char *)malloc( strlen( path ) + __TEMP_LEN );
+    if( NULL == *temp )
+    {
+        return( -1 );
+    }
+    sprintf( *temp, "%s.%d.%u", path, (int)getpid(), atomic_fetch_add( &__next_temp, 1 ) );
+
+    fd = open( *temp, O_WRONLY | O_CREAT | O_EXCL, 0644 );
+    if( fd < 0 )
+    {
+        free( *temp );
+        *temp = NULL;
+    }
+
+    return( fd );
+
+}   /* open_output_file() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       close_output_file - "Close Output File"
+*
+*   DESCRIPTION:
+*       Closes a file opened by
+*       open_output_file() and renames it over
+*       the output file if it is to be kept.
+*       Otherwise removes it and any old output
+*       file, so a failed compilation leaves no
+*       output at all. Frees temp.
+*
+*   RETURNS:
+*       Returns FALSE if output to be kept
+*       couldn't be closed or renamed.
+*
+**************************************************/
+boolean close_output_file
+(
+    int                     fd,     /* temporary file           */
+    const char             *path,   /* output file              */
+    char                   *temp,   /* temporary file's name    */
+    boolean                 keep    /* put it in place?         */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    boolean     ok;             /* closed and renamed?      */
+
+    ok = ( 0 == close( fd ) );
+    ok = ok && keep && ( 0 == rename( temp, path ) );
+    if( !ok )
+    {
+        unlink( temp );
+        unlink( path );
+    }
+    free( temp );
+
+    return( ok || !keep );
+
+}   /* close_output_file() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       run_batch - "Run Batch"
+*
+*   DESCRIPTION:
+*       Compiles every job's file, on up to
+*       num_threads threads including the
+*       caller's. The symbol table must be
+*       initialized.
+*
+*   RETURNS:
+*       Returns an error code. How each job
+*       went is in the job.
+*
+*   ERRORS:
+*       * BATCH_NO_MEMORY if the pool couldn't
+*         be allocated. No job is run.
+*
+*   NOTES:
+*       * A worker whose thread can't be
+*         started still has its run of jobs,
+*         and the other workers steal them all,
+*         so every job runs as long as the
+*         caller's thread does.
+*
+**************************************************/
+batch_error_t8 run_batch
+(
+    struct batch_job_type  *jobs,   /* files to compile         */
+    uint                    num_jobs,
+                                    /* number of files          */
+    uint                    num_threads,
+                                    /* workers to run them on   */
+    const struct compile_options_type
+                           *opts,   /* options for every file   */
+    struct cache_type      *cache,  /* output cache, or NULL    */
+    uint64                 *num_steals
+                                    /* jobs taken by idle       */
+                                    /*  workers                 */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __batch_type     b;      /* pool                     */
+    struct __worker_type   *w;      /* worker                   */
+    uint                    i;      /* worker index             */
+
+    *num_steals = 0;
+    if( 0 == num_jobs )
+    {
+        return( BATCH_NO_ERROR );
+    }
+
+    if( num_threads > BATCH_MAX_THREADS )
+    {
+        num_threads = BATCH_MAX_THREADS;
+    }
+    if( num_threads > num_jobs )
+    {
+        num_threads = num_jobs;
+    }
+    if( 0 == num_threads )
+    {
+        num_threads = 1;
+    }
+
+    b.jobs        = jobs;
+    b.opts        = opts;
+    b.cache       = cache;
+    b.num_workers = num_threads;
+    b.workers     = (struct __worker_type *)aligned_alloc( __CACHE_LINE, num_threads * sizeof( *b.workers ) );
+    if( NULL == b.workers )
+    {
+        return( BATCH_NO_MEMORY );
+    }
+
+    /*---------------------------------
+    Split the jobs into runs
+    ---------------------------------*/
+    for( i = 0; i < num_threads; ++i )
+    {
+        w = &b.workers[ i ];
+        atomic_init( &w->top,    (int)( (uint64)num_jobs * i / num_threads ) );
+        atomic_init( &w->bottom, (int)( (uint64)num_jobs * ( i + 1 ) / num_threads ) );
+        w->batch   = &b;
+        w->index   = i;
+        w->steals  = 0;
+        w->started = FALSE;
+    }
+
+    /*---------------------------------
+    Worker 0 runs on this thread
+    ---------------------------------*/
+    for( i = 1; i < num_threads; ++i )
+    {
+        w          = &b.workers[ i ];
+        w->started = ( 0 == pthread_create( &w->thread, NULL, __work, w ) );
+    }
+    __work( &b.workers[ 0 ] );
+
+    for( i = 0; i < num_threads; ++i )
+    {
+        w = &b.workers[ i ];
+        if( w->started )
+        {
+            pthread_join( w->thread, NULL );
+        }
+        *num_steals += w->steals;
+    }
+
+    free( b.workers );
+    return( BATCH_NO_ERROR );
+
+}   /* run_batch() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_batch_job - "Free Batch Job"
+*
+*   DESCRIPTION:
+*       Frees a job's report. The file names
+*       belong to the caller.
+*
+**************************************************/
+void free_batch_job
+(
+    struct batch_job_type  *job     /* job to free              */
+)
+{
+    free( job->report );
+    job->report = NULL;
+
+}   /* free_batch_job() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       batch_error_str - "Batch Error String"
+*
+*   DESCRIPTION:
+*       Describes an error code.
+*
+**************************************************/
+const char *batch_error_str
+(
+    batch_error_t8          error   /* error code               */
+)
+{
+    switch( error )
+    {
+        case BATCH_NO_ERROR:
+            return( "no error" );
+
+        case BATCH_NO_MEMORY:
+            return( "out of memory" );
+
+        default:
+            return( "unknown error" );
+    }
+
+}   /* batch_error_str() */
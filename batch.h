@@ -0,0 +1,122 @@
+/**************************************************
+*
+*   NAME:
+*       batch.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       compiling many source files at once on a
+*       work-stealing thread pool
+*
+**************************************************/
+
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "cache.h"
+#include "compiler.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define BATCH_MAX_THREADS   256     /* most workers in a pool           */
+
+/*-------------------------------------
+Error types
+-------------------------------------*/
+typedef sint8 batch_error_t8;
+enum
+{
+    BATCH_NO_ERROR        =  0,     /* no error                         */
+    BATCH_NO_MEMORY       = -1      /* out of memory                    */
+};
+
+/*-------------------------------------
+How a job went, as ibtlc's exit status
+-------------------------------------*/
+typedef uint8 batch_status_t8;
+enum
+{
+    BATCH_JOB_OK          = 0,      /* compiled                         */
+    BATCH_JOB_SOURCE_ERROR,         /* the program has an error         */
+    BATCH_JOB_FAILED                /* couldn't compile for any other   */
+                                    /*  reason                          */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+One file to compile. The report holds
+what a serial run would have printed
+on stderr, so reports can be printed
+in job order once the batch is done.
+-------------------------------------*/
+struct batch_job_type
+{
+    const char         *in;             /* source file              */
+    const char         *out;            /* output file              */
+    const char         *state;          /* form state file, or NULL */
+    batch_status_t8     status;         /* how it went              */
+    char               *report;         /* diagnostics, or NULL     */
+    boolean             cache_hit;      /* copied from the cache?   */
+    struct compile_result_type
+                        result;         /* compiler's outcome       */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+char *read_source_file
+(
+    const char             *name,   /* file to read             */
+    uint                   *len     /* its length               */
+);
+
+int open_output_file
+(
+    const char             *path,   /* output file              */
+    char                  **temp    /* temporary file's name    */
+);
+
+boolean close_output_file
+(
+    int                     fd,     /* temporary file           */
+    const char             *path,   /* output file              */
+    char                   *temp,   /* temporary file's name    */
+    boolean                 keep    /* put it in place?         */
+);
+
+batch_error_t8 run_batch
+(
+    struct batch_job_type  *jobs,   /* files to compile         */
+    uint                    num_jobs,
+                                    /* number of files          */
+    uint                    num_threads,
+                                    /* workers to run them on   */
+    const struct compile_options_type
+                           *opts,   /* options for every file   */
+    struct cache_type      *cache,  /* output cache, or NULL    */
+    uint64                 *num_steals
+                                    /* jobs taken by idle       */
+                                    /*  workers                 */
+);
+
+void free_batch_job
+(
+    struct batch_job_type  *job     /* job to free              */
+);
+
+const char *batch_error_str
+(
+    batch_error_t8          error   /* error code               */
+);
+
+#endif /* __BATCH_H__ */
@@ -0,0 +1,280 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       bench_scanner.c
+*
+*   DESCRIPTION:
+*       Scanner throughput benchmark. Generates
+*       a synthetic program, scans it repeatedly
+*       and reports MB/s, tokens/s and
+*       allocations per token.
+*
+*   USAGE:
+*       bench_scanner [-s bytes] [-d depth]
+*                     [-n idents] [-r reuse%]
+*                     [-p opp%] [-S seed]
+*                     [-i iterations] [-o file]
+*
+*       -o writes the generated program to a
+*       file, so the same input can be used as
+*       a corpus for other tests.
+*
+*   BUILD:
+*       cc -O2 -o bench_scanner bench_scanner.c
+*          gen_program.c scanner.c number.c
+*          symbol_table.c hashmap.c stats.c trace.c
+*          -lm -lpthread
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gen_program.h"
+#include "scanner.h"
+#include "stats.h"
+#include "symbol_table.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __DEFAULT_ITERATIONS    20      /* passes over the program  */
+#define __BYTES_PER_MB          ( 1024.0 * 1024.0 )
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static double __now
+(
+    void
+);
+
+static boolean __parse_args
+(
+    int                      argc,  /* number of arguments  */
+    char                   **argv,  /* arguments            */
+    struct gen_options_type *opts,  /* generator options    */
+    uint                    *iters, /* passes to make       */
+    const char             **out    /* corpus file or NULL  */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __now - "Now"
+*
+*   DESCRIPTION:
+*       Returns the monotonic clock in seconds.
+*
+**************************************************/
+static double __now
+(
+    void
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct timespec ts;     /* current time     */
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9 );
+
+}   /* __now() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __parse_args - "Parse Arguments"
+*
+*   DESCRIPTION:
+*       Parses the command line into generator
+*       options.
+*
+*   RETURNS:
+*       Returns FALSE on an unknown option.
+*
+**************************************************/
+static boolean __parse_args
+(
+    int                      argc,  /* number of arguments  */
+    char                   **argv,  /* arguments            */
+    struct gen_options_type *opts,  /* generator options    */
+    uint                    *iters, /* passes to make       */
+    const char             **out    /* corpus file or NULL  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    int     i;      /* for-loop iterator    */
+    uint64  val;    /* option's value       */
+
+    for( i = 1; i + 1 < argc; i += 2 )
+    {
+        val = strtoull( argv[ i + 1 ], NULL, 0 );
+        if( 0 == strcmp( argv[ i ], "-s" ) )
+        {
+            opts->target_bytes = (uint32)val;
+        }
+        else if( 0 == strcmp( argv[ i ], "-d" ) )
+        {
+            opts->max_depth = (uint)val;
+        }
+        else if( 0 == strcmp( argv[ i ], "-n" ) )
+        {
+            opts->num_idents = (uint)val;
+        }
+        else if( 0 == strcmp( argv[ i ], "-r" ) )
+        {
+            opts->ident_reuse = (uint)val;
+        }
+        else if( 0 == strcmp( argv[ i ], "-p" ) )
+        {
+            opts->opp_density = (uint)val;
+        }
+        else if( 0 == strcmp( argv[ i ], "-S" ) )
+        {
+            opts->seed = val;
+        }
+        else if( 0 == strcmp( argv[ i ], "-i" ) )
+        {
+            *iters = (uint)val;
+        }
+        else if( 0 == strcmp( argv[ i ], "-o" ) )
+        {
+            *out = argv[ i + 1 ];
+        }
+        else
+        {
+            return( FALSE );
+        }
+    }
+
+    return( i == argc );
+
+}   /* __parse_args() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       main - "Main"
+*
+*   DESCRIPTION:
+*       Runs the benchmark.
+*
+**************************************************/
+int main
+(
+    int         argc,   /* number of arguments  */
+    char      **argv    /* arguments            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct gen_options_type opts;                       /* generator options    */
+    struct scanner_type     s;                          /* scanner              */
+    struct scan_token_type  toks[ SCAN_BATCH_SIZE ];    /* token batch          */
+    const char             *out;                        /* corpus file          */
+    char                   *src;                        /* generated program    */
+    FILE                   *fp;                         /* corpus file handle   */
+    uint32                  len;                        /* program length       */
+    uint64                  num_tokens;                 /* tokens scanned       */
+    uint64                  num_allocs;                 /* allocations made     */
+    struct stats_type       stats;                      /* allocations counted  */
+    struct stats_clock_type clock;                      /* scanning's clock     */
+    uint                    iters;                      /* passes to make       */
+    uint                    i;                          /* for-loop iterator    */
+    uint                    n;                          /* tokens in a batch    */
+    double                  start;                      /* start time           */
+    double                  secs;                       /* elapsed time         */
+
+    init_gen_options( &opts );
+    iters = __DEFAULT_ITERATIONS;
+    out   = NULL;
+    if( !__parse_args( argc, argv, &opts, &iters, &out ) )
+    {
+        fprintf( stderr, "usage: %s [-s bytes] [-d depth] [-n idents] [-r reuse%%] "
+                         "[-p opp%%] [-S seed] [-i iterations] [-o file]\n", argv[ 0 ] );
+        return( 1 );
+    }
+
+    if( SYM_NO_ERROR != init_symbol_table() )
+    {
+        fprintf( stderr, "unable to initialize the symbol table\n" );
+        return( 1 );
+    }
+
+    src = gen_program( &opts, &len );
+    if( NULL == src )
+    {
+        fprintf( stderr, "unable to generate a program\n" );
+        return( 1 );
+    }
+
+    if( NULL != out )
+    {
+        fp = fopen( out, "wb" );
+        if( ( NULL == fp )
+         || ( len != fwrite( src, 1, len, fp ) ) )
+        {
+            fprintf( stderr, "unable to write %s\n", out );
+            return( 1 );
+        }
+        fclose( fp );
+    }
+
+    /*---------------------------------
+    Scan the program repeatedly
+    ---------------------------------*/
+    init_stats( &stats );
+    count_allocs();
+    num_tokens = 0;
+    start      = __now();
+    stats_start( &stats, STATS_SCAN, &clock );
+    for( i = 0; i < iters; ++i )
+    {
+        init_scanner( &s, src, len );
+        while( 0 != ( n = scan_batch( &s, toks, SCAN_BATCH_SIZE ) ) )
+        {
+            num_tokens += n;
+        }
+
+        if( SCAN_NO_ERROR != s.error )
+        {
+            fprintf( stderr, "scan error %d at offset %u\n", s.error, s.error_offset );
+            return( 1 );
+        }
+    }
+    stats_stop( &stats, STATS_SCAN, &clock );
+    secs       = __now() - start;
+    num_allocs = stats.phases[ STATS_SCAN ].allocs;
+
+    printf( "program:      %lu bytes, %llu tokens\n", len, num_tokens / ( iters ? iters : 1 ) );
+    printf( "throughput:   %.1f MB/s\n", (double)len * iters / __BYTES_PER_MB / secs );
+    printf( "token rate:   %.1f Mtokens/s\n", (double)num_tokens / secs * 1e-6 );
+    printf( "allocations:  %.4f per token\n", num_tokens ? (double)num_allocs / num_tokens : 0.0 );
+
+    free( src );
+    unload_tables();
+    return( 0 );
+
+}   /* main() */
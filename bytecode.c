@@ -0,0 +1,1879 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       bytecode.c
+*
+*   DESCRIPTION:
+*       Lowers checked (and possibly folded)
+*       trees to bytecode for the interpreter
+*       in vm.c. The code is the word stream
+*       emit.c writes, with the same operand
+*       conversions and drops, but operators
+*       are opcodes, constants and variables
+*       are indices, and if and while are
+*       resolved to branches:
+*
+*           c if t else e then
+*               c ZBRANCH L1 t BRANCH L2
+*               L1: e L2:
+*
+*           begin c while body repeat
+*               L1: c ZBRANCH L2 body
+*               BRANCH L1 L2:
+*
+*       A let lowers to nothing. Its variables
+*       are zeroed when the program starts, as
+*       the declarations of the Gforth code
+*       zero them before the first form runs.
+*
+*       Once the program is ended, pairs of
+*       opcodes that run together often are
+*       fused into superinstructions, so each
+*       pair is one dispatch. The pairs were
+*       chosen from the opcodes our corpus and
+*       its while loops run most: constant
+*       operands, variables added to, strings
+*       joined, and the test of an if or a
+*       while.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "bytecode.h"
+#include "hash.h"
+#include "stats.h"
+#include "tokens.h"
+#include "typecheck.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __INITIAL_CODE      4096    /* first size of the code           */
+#define __INITIAL_STACK     64      /* first size of the stack          */
+#define __INITIAL_SLOTS     64      /* first size of the string pool    */
+#define __MAX_UNROLL        4       /* highest int power multiplied out */
+#define __MAX_SHIFT         62      /* highest power of 2 shifted by    */
+#define __NO_SHIFT          ( -1 )  /* operand isn't a power of 2       */
+#define __NO_OP             BC_NUM_OPS
+                                    /* operator the type lacks          */
+#define __NUM_FUSIONS       ( sizeof( __fusions ) / sizeof( __fusions[ 0 ] ) )
+                                    /* superinstructions                */
+
+/*-------------------------------------
+What has to follow the code of an
+element
+-------------------------------------*/
+typedef uint8 __after_t8;
+enum
+{
+    __AFTER_NONE = 0,               /* the value is used as it is       */
+    __AFTER_TO_REAL,                /* an int is used as a real         */
+    __AFTER_DROP                    /* the value isn't used             */
+};
+
+/*-------------------------------------
+What an open list is
+-------------------------------------*/
+typedef uint8 __list_kind_t8;
+enum
+{
+    __LIST_SEQUENCE = 0,            /* [[...] ...]                      */
+    __LIST_BINARY,                  /* [opp a b]                        */
+    __LIST_UNARY,                   /* [opp a]                          */
+    __LIST_ASSIGN,                  /* [:= x v]                         */
+    __LIST_IF,                      /* [if c t e?]                      */
+    __LIST_WHILE,                   /* [while c body...]                */
+    __LIST_STDOUT                   /* [stdout e]                       */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A list whose code is being lowered.
+patch is the operand of the branch
+still waiting for its target; an if
+keeps the stack depths its branches
+start from.
+-------------------------------------*/
+struct __bc_frame_type
+{
+    uint                list;       /* list node                */
+    uint                next;       /* next element to lower    */
+    __list_kind_t8      kind;       /* kind of list             */
+    uint8               step;       /* how far it has got       */
+    __after_t8          after;      /* what follows its code    */
+    uint                patch;      /* branch operand to patch  */
+    uint                begin;      /* start of a while         */
+    uint                depth;      /* data depth of a branch   */
+    uint                fdepth;     /* real depth of a branch   */
+    uint                prof;       /* its profiled list, or    */
+                                    /*  BC_NO_PROF              */
+};
+
+/*-------------------------------------
+How an opcode changes the depth of
+each stack
+-------------------------------------*/
+struct __effect_type
+{
+    sint8               depth;      /* data stack               */
+    sint8               fdepth;     /* real stack               */
+    uint8               operands;   /* words after the opcode   */
+};
+
+/*-------------------------------------
+A pair of opcodes and the
+superinstruction that fuses them
+-------------------------------------*/
+struct __fusion_type
+{
+    bc_op_t8            first;      /* first of the pair        */
+    bc_op_t8            second;     /* opcode after it          */
+    bc_op_t8            fused;      /* superinstruction         */
+};
+
+/*-------------------------------------------------
+                VARIABLE CONSTANTS
+-------------------------------------------------*/
+
+static const struct __effect_type __effects[ BC_NUM_OPS ] =
+{
+    {  0,  0, 0 },  /* BC_HALT      */
+    {  1,  0, 1 },  /* BC_LIT       */
+    {  0,  1, 1 },  /* BC_FLIT      */
+    {  2,  0, 1 },  /* BC_SLIT      */
+    {  1,  0, 1 },  /* BC_FETCH     */
+    {  0,  1, 1 },  /* BC_FFETCH    */
+    {  2,  0, 1 },  /* BC_SFETCH    */
+    { -1,  0, 1 },  /* BC_STORE     */
+    {  0, -1, 1 },  /* BC_FSTORE    */
+    { -2,  0, 1 },  /* BC_SSTORE    */
+    { -1,  0, 0 },  /* BC_ADD       */
+    { -1,  0, 0 },  /* BC_SUB       */
+    { -1,  0, 0 },  /* BC_MUL       */
+    { -1,  0, 0 },  /* BC_DIV       */
+    { -1,  0, 0 },  /* BC_MOD       */
+    { -1,  0, 0 },  /* BC_AND       */
+    { -1,  0, 0 },  /* BC_OR        */
+    { -1,  0, 0 },  /* BC_LSHIFT    */
+    { -1,  0, 0 },  /* BC_ARSHIFT   */
+    { -1,  0, 0 },  /* BC_POW       */
+    { -1,  0, 0 },  /* BC_EQ        */
+    { -1,  0, 0 },  /* BC_LT        */
+    { -1,  0, 0 },  /* BC_GT        */
+    { -1,  0, 0 },  /* BC_LE        */
+    { -1,  0, 0 },  /* BC_GE        */
+    { -1,  0, 0 },  /* BC_NE        */
+    {  0, -1, 0 },  /* BC_FADD      */
+    {  0, -1, 0 },  /* BC_FSUB      */
+    {  0, -1, 0 },  /* BC_FMUL      */
+    {  0, -1, 0 },  /* BC_FDIV      */
+    {  0, -1, 0 },  /* BC_FPOW      */
+    {  1, -2, 0 },  /* BC_FEQ       */
+    {  1, -2, 0 },  /* BC_FLT       */
+    {  1, -2, 0 },  /* BC_FGT       */
+    {  1, -2, 0 },  /* BC_FLE       */
+    {  1, -2, 0 },  /* BC_FGE       */
+    {  1, -2, 0 },  /* BC_FNE       */
+    { -2,  0, 0 },  /* BC_SCAT      */
+    { -3,  0, 0 },  /* BC_SEQ       */
+    { -3,  0, 0 },  /* BC_SLT       */
+    { -3,  0, 0 },  /* BC_SGT       */
+    { -3,  0, 0 },  /* BC_SLE       */
+    { -3,  0, 0 },  /* BC_SGE       */
+    { -3,  0, 0 },  /* BC_SNE       */
+    {  0,  0, 0 },  /* BC_NOT       */
+    {  0,  0, 0 },  /* BC_NEGATE    */
+    {  0,  0, 0 },  /* BC_FNEGATE   */
+    {  0,  0, 0 },  /* BC_FSIN      */
+    {  0,  0, 0 },  /* BC_FCOS      */
+    {  0,  0, 0 },  /* BC_FTAN      */
+    { -1,  1, 0 },  /* BC_TO_REAL   */
+    { -1,  0, 0 },  /* BC_DROP      */
+    {  0, -1, 0 },  /* BC_FDROP     */
+    { -2,  0, 0 },  /* BC_SDROP     */
+    {  1,  0, 0 },  /* BC_DUP       */
+    {  0,  1, 0 },  /* BC_FDUP      */
+    { -1,  0, 0 },  /* BC_PRINT     */
+    {  0, -1, 0 },  /* BC_FPRINT    */
+    { -2,  0, 0 },  /* BC_SPRINT    */
+    { -1,  0, 0 },  /* BC_BPRINT    */
+    {  0,  0, 1 },  /* BC_PROF_ENTER */
+    {  0,  0, 1 },  /* BC_PROF_EXIT */
+    {  0,  0, 1 },  /* BC_BRANCH    */
+    { -1,  0, 1 },  /* BC_ZBRANCH   */
+    {  0,  0, 2 },  /* BC_LIT_ADD   */
+    {  0,  0, 2 },  /* BC_LIT_SUB   */
+    {  0,  0, 2 },  /* BC_LIT_MUL   */
+    {  0,  0, 2 },  /* BC_LIT_DIV   */
+    {  0,  0, 2 },  /* BC_LIT_MOD   */
+    {  0,  0, 2 },  /* BC_LIT_AND   */
+    {  0,  0, 2 },  /* BC_LIT_LSHIFT */
+    {  0,  0, 2 },  /* BC_LIT_ARSHIFT */
+    {  0,  0, 2 },  /* BC_LIT_EQ    */
+    {  0,  0, 2 },  /* BC_LIT_LT    */
+    {  0,  0, 2 },  /* BC_LIT_GT    */
+    {  0,  0, 2 },  /* BC_LIT_LE    */
+    {  0,  0, 2 },  /* BC_LIT_GE    */
+    {  0,  0, 2 },  /* BC_LIT_NE    */
+    {  0,  0, 2 },  /* BC_FETCH_ADD */
+    {  0,  0, 2 },  /* BC_FETCH_SUB */
+    {  0,  0, 2 },  /* BC_FETCH_MUL */
+    {  2,  0, 3 },  /* BC_FETCH_LIT */
+    { -2,  0, 2 },  /* BC_ADD_STORE */
+    { -2,  0, 2 },  /* BC_SUB_STORE */
+    { -2,  0, 2 },  /* BC_EQ_ZBRANCH */
+    { -2,  0, 2 },  /* BC_LT_ZBRANCH */
+    { -2,  0, 2 },  /* BC_GT_ZBRANCH */
+    { -2,  0, 2 },  /* BC_LE_ZBRANCH */
+    { -2,  0, 2 },  /* BC_GE_ZBRANCH */
+    { -2,  0, 2 },  /* BC_NE_ZBRANCH */
+    {  0,  0, 2 },  /* BC_SLIT_SCAT */
+    {  0,  0, 2 }   /* BC_SFETCH_SCAT */
+};
+
+/*-------------------------------------
+Superinstructions, in the order they
+are fused. A test and its branch come
+first, as they run on every trip round
+a loop.
+-------------------------------------*/
+static const struct __fusion_type __fusions[] =
+{
+    { BC_EQ,        BC_ZBRANCH, BC_EQ_ZBRANCH   },
+    { BC_LT,        BC_ZBRANCH, BC_LT_ZBRANCH   },
+    { BC_GT,        BC_ZBRANCH, BC_GT_ZBRANCH   },
+    { BC_LE,        BC_ZBRANCH, BC_LE_ZBRANCH   },
+    { BC_GE,        BC_ZBRANCH, BC_GE_ZBRANCH   },
+    { BC_NE,        BC_ZBRANCH, BC_NE_ZBRANCH   },
+    { BC_LIT,       BC_ADD,     BC_LIT_ADD      },
+    { BC_LIT,       BC_SUB,     BC_LIT_SUB      },
+    { BC_LIT,       BC_MUL,     BC_LIT_MUL      },
+    { BC_LIT,       BC_DIV,     BC_LIT_DIV      },
+    { BC_LIT,       BC_MOD,     BC_LIT_MOD      },
+    { BC_LIT,       BC_AND,     BC_LIT_AND      },
+    { BC_LIT,       BC_LSHIFT,  BC_LIT_LSHIFT   },
+    { BC_LIT,       BC_ARSHIFT, BC_LIT_ARSHIFT  },
+    { BC_LIT,       BC_EQ,      BC_LIT_EQ       },
+    { BC_LIT,       BC_LT,      BC_LIT_LT       },
+    { BC_LIT,       BC_GT,      BC_LIT_GT       },
+    { BC_LIT,       BC_LE,      BC_LIT_LE       },
+    { BC_LIT,       BC_GE,      BC_LIT_GE       },
+    { BC_LIT,       BC_NE,      BC_LIT_NE       },
+    { BC_FETCH,     BC_ADD,     BC_FETCH_ADD    },
+    { BC_FETCH,     BC_SUB,     BC_FETCH_SUB    },
+    { BC_FETCH,     BC_MUL,     BC_FETCH_MUL    },
+    { BC_ADD,       BC_STORE,   BC_ADD_STORE    },
+    { BC_SUB,       BC_STORE,   BC_SUB_STORE    },
+    { BC_SLIT,      BC_SCAT,    BC_SLIT_SCAT    },
+    { BC_SFETCH,    BC_SCAT,    BC_SFETCH_SCAT  },
+    { BC_FETCH,     BC_LIT,     BC_FETCH_LIT    }
+};
+
+/*-------------------------------------
+Binary operators by operator, for
+ints and bools, reals and strings.
+__NO_OP where the type has no such
+operator.
+-------------------------------------*/
+static const bc_op_t8 __int_ops[ TOK_NUM_BIN_OPPS ] =
+{
+    BC_ADD,     /* TOK_ADD_OPP  */
+    BC_SUB,     /* TOK_SUB_OPP  */
+    BC_MUL,     /* TOK_MUL_OPP  */
+    BC_DIV,     /* TOK_DIV_OPP  */
+    BC_MOD,     /* TOK_MOD_OPP  */
+    BC_AND,     /* TOK_AND_OPP  */
+    BC_OR,      /* TOK_OR_OPP   */
+    BC_POW,     /* TOK_EXP_OPP  */
+    BC_EQ,      /* TOK_EQ_OPP   */
+    BC_LT,      /* TOK_LT_OPP   */
+    BC_GT,      /* TOK_GT_OPP   */
+    BC_LE,      /* TOK_LE_OPP   */
+    BC_GE,      /* TOK_GE_OPP   */
+    BC_NE,      /* TOK_NE_OPP   */
+    __NO_OP     /* TOK_ASSN_OPP */
+};
+
+static const bc_op_t8 __real_ops[ TOK_NUM_BIN_OPPS ] =
+{
+    BC_FADD,    /* TOK_ADD_OPP  */
+    BC_FSUB,    /* TOK_SUB_OPP  */
+    BC_FMUL,    /* TOK_MUL_OPP  */
+    BC_FDIV,    /* TOK_DIV_OPP  */
+    __NO_OP,    /* TOK_MOD_OPP  */
+    __NO_OP,    /* TOK_AND_OPP  */
+    __NO_OP,    /* TOK_OR_OPP   */
+    BC_FPOW,    /* TOK_EXP_OPP  */
+    BC_FEQ,     /* TOK_EQ_OPP   */
+    BC_FLT,     /* TOK_LT_OPP   */
+    BC_FGT,     /* TOK_GT_OPP   */
+    BC_FLE,     /* TOK_LE_OPP   */
+    BC_FGE,     /* TOK_GE_OPP   */
+    BC_FNE,     /* TOK_NE_OPP   */
+    __NO_OP     /* TOK_ASSN_OPP */
+};
+
+static const bc_op_t8 __string_ops[ TOK_NUM_BIN_OPPS ] =
+{
+    BC_SCAT,    /* TOK_ADD_OPP  */
+    __NO_OP,    /* TOK_SUB_OPP  */
+    __NO_OP,    /* TOK_MUL_OPP  */
+    __NO_OP,    /* TOK_DIV_OPP  */
+    __NO_OP,    /* TOK_MOD_OPP  */
+    __NO_OP,    /* TOK_AND_OPP  */
+    __NO_OP,    /* TOK_OR_OPP   */
+    __NO_OP,    /* TOK_EXP_OPP  */
+    BC_SEQ,     /* TOK_EQ_OPP   */
+    BC_SLT,     /* TOK_LT_OPP   */
+    BC_SGT,     /* TOK_GT_OPP   */
+    BC_SLE,     /* TOK_LE_OPP   */
+    BC_SGE,     /* TOK_GE_OPP   */
+    BC_SNE,     /* TOK_NE_OPP   */
+    __NO_OP     /* TOK_ASSN_OPP */
+};
+
+/*-------------------------------------
+Unary operators on ints or bools, and
+on reals
+-------------------------------------*/
+static const bc_op_t8 __unary_ops[ TOK_NUM_UNARY_OPPS ] =
+{
+    BC_NOT,     /* TOK_NOT_OPP  */
+    BC_NEGATE,  /* TOK_NEG_OPP  */
+    __NO_OP,    /* TOK_POS_OPP  */
+    BC_FSIN,    /* TOK_SIN_OPP  */
+    BC_FCOS,    /* TOK_COS_OPP  */
+    BC_FTAN     /* TOK_TAN_OPP  */
+};
+
+static const bc_op_t8 __real_unary_ops[ TOK_NUM_UNARY_OPPS ] =
+{
+    __NO_OP,    /* TOK_NOT_OPP  */
+    BC_FNEGATE, /* TOK_NEG_OPP  */
+    __NO_OP,    /* TOK_POS_OPP  */
+    BC_FSIN,    /* TOK_SIN_OPP  */
+    BC_FCOS,    /* TOK_COS_OPP  */
+    BC_FTAN     /* TOK_TAN_OPP  */
+};
+
+/*-------------------------------------
+Opcodes that depend only on the type
+of a value, by type class
+-------------------------------------*/
+static const bc_op_t8 __fetch_ops[ TOK_NUM_TYPES ] =
+    { BC_FETCH, BC_FFETCH, BC_SFETCH, BC_FETCH };
+
+static const bc_op_t8 __store_ops[ TOK_NUM_TYPES ] =
+    { BC_STORE, BC_FSTORE, BC_SSTORE, BC_STORE };
+
+static const bc_op_t8 __drop_ops[ TOK_NUM_TYPES ] =
+    { BC_DROP, BC_FDROP, BC_SDROP, BC_DROP };
+
+static const bc_op_t8 __print_ops[ TOK_NUM_TYPES ] =
+    { BC_PRINT, BC_FPRINT, BC_SPRINT, BC_BPRINT };
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static boolean __grow
+(
+    struct bc_program_type *prog,   /* program                  */
+    void                  **array,  /* array to grow            */
+    uint                   *cap,    /* its capacity             */
+    uint                    need,   /* elements needed          */
+    size_t                  size    /* size of an element       */
+);
+
+static void __put_op
+(
+    struct bc_program_type *prog,   /* program                  */
+    bc_op_t8                op      /* opcode                   */
+);
+
+static void __put_op_k
+(
+    struct bc_program_type *prog,   /* program                  */
+    bc_op_t8                op,     /* opcode                   */
+    uint                    k       /* its operand              */
+);
+
+static void __put_site
+(
+    struct bc_program_type *prog,   /* program                  */
+    uint                    offset  /* source offset            */
+);
+
+static void __put_prof
+(
+    struct bc_program_type *prog,   /* program                  */
+    uint                    depth,  /* open lists               */
+    uint                    offset  /* source offset            */
+);
+
+static void __put_int
+(
+    struct bc_program_type *prog,   /* program                  */
+    sint64                  val     /* int or flag              */
+);
+
+static void __put_real
+(
+    struct bc_program_type *prog,   /* program                  */
+    double                  val     /* real                     */
+);
+
+static uint *__string_slot
+(
+    const struct bc_program_type
+                           *prog,   /* program                  */
+    const char             *str,    /* text                     */
+    uint                    len     /* its length               */
+);
+
+static void __put_string
+(
+    struct bc_program_type *prog,   /* program                  */
+    const char             *str,    /* text                     */
+    uint                    len     /* its length               */
+);
+
+static uint __small_power
+(
+    const struct ast_node_type
+                           *node,   /* exponent                 */
+    type_class_t8           type    /* type of the power        */
+);
+
+static sint __shift_of
+(
+    const struct ast_node_type
+                           *node,   /* int operand              */
+    boolean                 mask    /* for a mask, 1 included?  */
+);
+
+static void __put_power
+(
+    struct bc_program_type *prog,   /* program                  */
+    uint                    n,      /* exponent                 */
+    boolean                 real    /* of a real?               */
+);
+
+static void __lower_leaf
+(
+    struct bc_program_type *prog,   /* program                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct type_info_type
+                           *ti,     /* its types                */
+    uint                    node    /* leaf                     */
+);
+
+static void __lower_after
+(
+    struct bc_program_type *prog,   /* program                  */
+    type_class_t8           type,   /* type of the element      */
+    __after_t8              after   /* what follows it          */
+);
+
+static void __lower_element
+(
+    struct bc_program_type *prog,   /* program                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct type_info_type
+                           *ti,     /* its types                */
+    uint                   *depth,  /* open lists               */
+    uint                    node,   /* element                  */
+    __after_t8              after   /* what follows it          */
+);
+
+static void __lower_form
+(
+    struct bc_program_type *prog,   /* program                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct type_info_type
+                           *ti,     /* its types                */
+    uint                    form    /* top-level form           */
+);
+
+static void __fuse
+(
+    struct bc_program_type *prog    /* ended program            */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __grow - "Grow"
+*
+*   DESCRIPTION:
+*       Makes room for need elements in one of
+*       the program's arrays, doubling it as
+*       often as it takes.
+*
+*   RETURNS:
+*       Returns FALSE, and sets BC_NO_MEMORY,
+*       if it couldn't be grown.
+*
+**************************************************/
+static boolean __grow
+(
+    struct bc_program_type *prog,   /* program                  */
+    void                  **array,  /* array to grow            */
+    uint                   *cap,    /* its capacity             */
+    uint                    need,   /* elements needed          */
+    size_t                  size    /* size of an element       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    void       *grown;          /* reallocated array        */
+    uint        new_cap;        /* new capacity             */
+
+    if( need <= *cap )
+    {
+        return( TRUE );
+    }
+
+    new_cap = ( 0 == *cap ) ? 16 : *cap;
+    while( new_cap < need )
+    {
+        new_cap *= 2;
+    }
+
+    grown = stats_realloc( *array, new_cap * size );
+    if( NULL == grown )
+    {
+        prog->error = BC_NO_MEMORY;
+        return( FALSE );
+    }
+    *array = grown;
+    *cap   = new_cap;
+
+    return( TRUE );
+
+}   /* __grow() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_op - "Put Opcode"
+*
+*   DESCRIPTION:
+*       Appends an opcode with no operand and
+*       applies its stack effect.
+*
+**************************************************/
+static void __put_op
+(
+    struct bc_program_type *prog,   /* program                  */
+    bc_op_t8                op      /* opcode                   */
+)
+{
+    if( ( __NO_OP == op )
+     || !__grow( prog, (void **)&prog->code, &prog->cap, prog->len + 1, sizeof( *prog->code ) ) )
+    {
+        return;
+    }
+
+    prog->code[ prog->len++ ] = op;
+    prog->depth  += (uint)(sint)__effects[ op ].depth;
+    prog->fdepth += (uint)(sint)__effects[ op ].fdepth;
+    if( prog->depth > prog->max_depth )
+    {
+        prog->max_depth = prog->depth;
+    }
+    if( prog->fdepth > prog->max_fdepth )
+    {
+        prog->max_fdepth = prog->fdepth;
+    }
+
+}   /* __put_op() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_op_k - "Put Opcode and Operand"
+*
+*   DESCRIPTION:
+*       Appends an opcode and its operand.
+*
+**************************************************/
+static void __put_op_k
+(
+    struct bc_program_type *prog,   /* program                  */
+    bc_op_t8                op,     /* opcode                   */
+    uint                    k       /* its operand              */
+)
+{
+    __put_op( prog, op );
+    if( __grow( prog, (void **)&prog->code, &prog->cap, prog->len + 1, sizeof( *prog->code ) ) )
+    {
+        prog->code[ prog->len++ ] = k;
+    }
+
+}   /* __put_op_k() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_site - "Put Site"
+*
+*   DESCRIPTION:
+*       Notes that the next opcode can fail,
+*       and which list it came from. Sites are
+*       put in code order.
+*
+**************************************************/
+static void __put_site
+(
+    struct bc_program_type *prog,   /* program                  */
+    uint                    offset  /* source offset            */
+)
+{
+    if( __grow( prog, (void **)&prog->sites, &prog->site_cap, prog->num_sites + 1, sizeof( *prog->sites ) ) )
+    {
+        prog->sites[ prog->num_sites ].pc     = prog->len;
+        prog->sites[ prog->num_sites ].offset = offset;
+        ++prog->num_sites;
+    }
+
+}   /* __put_site() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_prof - "Put Profiled List"
+*
+*   DESCRIPTION:
+*       Makes the innermost open list a
+*       profiled list, inside the nearest open
+*       list that is one, and appends the
+*       opcode that starts it. Its frame ends
+*       it.
+*
+**************************************************/
+static void __put_prof
+(
+    struct bc_program_type *prog,   /* program                  */
+    uint                    depth,  /* open lists               */
+    uint                    offset  /* source offset            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct bc_prof_type    *p;      /* new profiled list        */
+    uint                    i;      /* frame index              */
+
+    if( !__grow( prog, (void **)&prog->profs, &prog->prof_cap, prog->num_profs + 1, sizeof( *prog->profs ) ) )
+    {
+        return;
+    }
+
+    p         = &prog->profs[ prog->num_profs ];
+    p->offset = offset;
+    p->parent = BC_NO_PROF;
+    p->count  = 0;
+    p->ns     = 0;
+    for( i = depth - 1; ( i > 0 ) && ( BC_NO_PROF == p->parent ); --i )
+    {
+        p->parent = prog->stack[ i - 1 ].prof;
+    }
+
+    prog->stack[ depth - 1 ].prof = prog->num_profs;
+    __put_op_k( prog, BC_PROF_ENTER, prog->num_profs++ );
+
+}   /* __put_prof() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_int - "Put Int"
+*
+*   DESCRIPTION:
+*       Appends the code that pushes an int or
+*       a flag.
+*
+**************************************************/
+static void __put_int
+(
+    struct bc_program_type *prog,   /* program                  */
+    sint64                  val     /* int or flag              */
+)
+{
+    if( __grow( prog, (void **)&prog->ints, &prog->int_cap, prog->num_ints + 1, sizeof( *prog->ints ) ) )
+    {
+        prog->ints[ prog->num_ints ] = val;
+        __put_op_k( prog, BC_LIT, prog->num_ints++ );
+    }
+
+}   /* __put_int() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_real - "Put Real"
+*
+*   DESCRIPTION:
+*       Appends the code that pushes a real.
+*
+**************************************************/
+static void __put_real
+(
+    struct bc_program_type *prog,   /* program                  */
+    double                  val     /* real                     */
+)
+{
+    if( __grow( prog, (void **)&prog->reals, &prog->real_cap, prog->num_reals + 1, sizeof( *prog->reals ) ) )
+    {
+        prog->reals[ prog->num_reals ] = val;
+        __put_op_k( prog, BC_FLIT, prog->num_reals++ );
+    }
+
+}   /* __put_real() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __string_slot - "String Slot"
+*
+*   DESCRIPTION:
+*       Finds the pool slot for a string's
+*       text: the slot of the constant with
+*       the same text, or the empty slot where
+*       it goes.
+*
+**************************************************/
+static uint *__string_slot
+(
+    const struct bc_program_type
+                           *prog,   /* program                  */
+    const char             *str,    /* text                     */
+    uint                    len     /* its length               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct bc_string_type *other; /* constant in a slot   */
+    uint64                      h[ 2 ]; /* hash of the text     */
+    uint                        i;      /* slot index           */
+
+    hash_bytes( str, len, 0, h );
+    for( i = (uint)h[ 0 ] & ( prog->slot_cap - 1 ); 0 != prog->string_slots[ i ]; i = ( i + 1 ) & ( prog->slot_cap - 1 ) )
+    {
+        other = &prog->strings[ prog->string_slots[ i ] - 1 ];
+        if( ( other->len == len )
+         && ( 0 == memcmp( other->str, str, len ) ) )
+        {
+            break;
+        }
+    }
+
+    return( &prog->string_slots[ i ] );
+
+}   /* __string_slot() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_string - "Put String"
+*
+*   DESCRIPTION:
+*       Appends the code that pushes a string
+*       constant. Constants are pooled by text,
+*       so a text used many times is kept once.
+*       The pool is kept at most half full.
+*
+**************************************************/
+static void __put_string
+(
+    struct bc_program_type *prog,   /* program                  */
+    const char             *str,    /* text                     */
+    uint                    len     /* its length               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint       *old;            /* pool before it grew      */
+    uint       *slot;           /* text's slot              */
+    uint        old_cap;        /* its size                 */
+    uint        k;              /* string constant          */
+
+    if( 2 * ( prog->num_strings + 1 ) > prog->slot_cap )
+    {
+        old     = prog->string_slots;
+        old_cap = prog->slot_cap;
+        prog->slot_cap     = ( 0 == old_cap ) ? __INITIAL_SLOTS : 2 * old_cap;
+        prog->string_slots = (uint *)stats_calloc( prog->slot_cap, sizeof( *prog->string_slots ) );
+        if( NULL == prog->string_slots )
+        {
+            prog->string_slots = old;
+            prog->slot_cap     = old_cap;
+            prog->error        = BC_NO_MEMORY;
+            return;
+        }
+
+        for( k = 0; k < prog->num_strings; ++k )
+        {
+            *__string_slot( prog, prog->strings[ k ].str, prog->strings[ k ].len ) = k + 1;
+        }
+        free( old );
+    }
+
+    slot = __string_slot( prog, str, len );
+    if( 0 == *slot )
+    {
+        if( !__grow( prog, (void **)&prog->strings, &prog->string_cap, prog->num_strings + 1, sizeof( *prog->strings ) ) )
+        {
+            return;
+        }
+        prog->strings[ prog->num_strings ].str = str;
+        prog->strings[ prog->num_strings ].len = len;
+        *slot = ++prog->num_strings;
+    }
+
+    __put_op_k( prog, BC_SLIT, *slot - 1 );
+
+}   /* __put_string() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __small_power - "Small Power"
+*
+*   DESCRIPTION:
+*       Tells whether an exponent is a literal
+*       the power can be multiplied out for,
+*       as emit.c does: ints up to
+*       __MAX_UNROLL, and reals only squared,
+*       the one real power f** and repeated
+*       f* round alike.
+*
+*   RETURNS:
+*       Returns the exponent, or 0 if the power
+*       is left to BC_POW or BC_FPOW.
+*
+**************************************************/
+static uint __small_power
+(
+    const struct ast_node_type
+                           *node,   /* exponent                 */
+    type_class_t8           type    /* type of the power        */
+)
+{
+    if( TOK_LITERAL != node->token_class )
+    {
+        return( 0 );
+    }
+
+    if( TOK_REAL_TYPE == type )
+    {
+        return( ( ( ( TOK_INT_TYPE == node->subclass ) && ( 2 == node->val.int_val ) )
+               || ( ( TOK_REAL_TYPE == node->subclass ) && ( 2.0 == node->val.real_val ) ) ) ? 2 : 0 );
+    }
+
+    return( ( ( TOK_INT_TYPE == type )
+           && ( TOK_INT_TYPE == node->subclass )
+           && ( node->val.int_val >= 2 )
+           && ( node->val.int_val <= __MAX_UNROLL ) ) ? (uint)node->val.int_val : 0 );
+
+}   /* __small_power() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __shift_of - "Shift Of"
+*
+*   DESCRIPTION:
+*       Tells whether an int operand is a
+*       literal 2^k, for k from 1 to
+*       __MAX_SHIFT, or from 0 for the
+*       divisor of a "%".
+*
+*   RETURNS:
+*       Returns k, or __NO_SHIFT.
+*
+**************************************************/
+static sint __shift_of
+(
+    const struct ast_node_type
+                           *node,   /* int operand              */
+    boolean                 mask    /* for a mask, 1 included?  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    sint        shift;          /* log 2 of the literal     */
+
+    if( ( TOK_LITERAL != node->token_class )
+     || ( TOK_INT_TYPE != node->subclass )
+     || ( node->val.int_val < ( mask ? 1 : 2 ) )
+     || ( 0 != ( node->val.int_val & ( node->val.int_val - 1 ) ) ) )
+    {
+        return( __NO_SHIFT );
+    }
+
+    for( shift = 0; ( (sint64)1 << shift ) != node->val.int_val; ++shift );
+
+    return( ( shift <= __MAX_SHIFT ) ? shift : __NO_SHIFT );
+
+}   /* __shift_of() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_power - "Put Power"
+*
+*   DESCRIPTION:
+*       Appends the code that multiplies out a
+*       small power of the value on the stack,
+*       squaring a power of 2 again and again.
+*
+**************************************************/
+static void __put_power
+(
+    struct bc_program_type *prog,   /* program                  */
+    uint                    n,      /* exponent                 */
+    boolean                 real    /* of a real?               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        i;              /* multiplication           */
+
+    if( 0 == ( n & ( n - 1 ) ) )
+    {
+        for( ; n > 1; n /= 2 )
+        {
+            __put_op( prog, real ? BC_FDUP : BC_DUP );
+            __put_op( prog, real ? BC_FMUL : BC_MUL );
+        }
+        return;
+    }
+
+    for( i = 1; i < n; ++i )
+    {
+        __put_op( prog, real ? BC_FDUP : BC_DUP );
+    }
+
+    for( i = 1; i < n; ++i )
+    {
+        __put_op( prog, real ? BC_FMUL : BC_MUL );
+    }
+
+}   /* __put_power() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __lower_leaf - "Lower Leaf"
+*
+*   DESCRIPTION:
+*       Lowers a literal, a boolean constant or
+*       a variable's value. A string literal's
+*       text is exactly what Gforth's s" would
+*       push, so the constant points into the
+*       source.
+*
+**************************************************/
+static void __lower_leaf
+(
+    struct bc_program_type *prog,   /* program                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct type_info_type
+                           *ti,     /* its types                */
+    uint                    node    /* leaf                     */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *leaf;   /* leaf                 */
+    const struct binding_type  *b;      /* variable's binding   */
+
+    leaf = &ast->nodes[ node ];
+    switch( leaf->token_class )
+    {
+        case TOK_LITERAL:
+            if( TOK_STRING_TYPE == leaf->subclass )
+            {
+                __put_string( prog, &ast->src[ leaf->offset + 1 ], leaf->len - 2u );
+            }
+            else if( TOK_REAL_TYPE == leaf->subclass )
+            {
+                __put_real( prog, leaf->val.real_val );
+            }
+            else
+            {
+                __put_int( prog, leaf->val.int_val );
+            }
+            break;
+
+        case TOK_RESERVED_WORD:
+            if( ( TOK_TRUE == leaf->subclass )
+             || ( TOK_FALSE == leaf->subclass ) )
+            {
+                __put_int( prog, ( TOK_TRUE == leaf->subclass ) ? -1 : 0 );
+            }
+            break;
+
+        case TOK_IDENT:
+            b = &ti->bindings[ ti->syms[ node ] ];
+            __put_op_k( prog, __fetch_ops[ b->type ], ti->syms[ node ] );
+            break;
+
+        default:
+            break;
+    }
+
+}   /* __lower_leaf() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __lower_after - "Lower After"
+*
+*   DESCRIPTION:
+*       Converts an element's int value to a
+*       real, or drops a value that isn't used.
+*
+**************************************************/
+static void __lower_after
+(
+    struct bc_program_type *prog,   /* program                  */
+    type_class_t8           type,   /* type of the element      */
+    __after_t8              after   /* what follows it          */
+)
+{
+    if( type >= TOK_NUM_TYPES )
+    {
+        return;
+    }
+
+    if( ( __AFTER_TO_REAL == after )
+     && ( TOK_INT_TYPE == type ) )
+    {
+        __put_op( prog, BC_TO_REAL );
+    }
+    else if( __AFTER_DROP == after )
+    {
+        __put_op( prog, __drop_ops[ type ] );
+    }
+
+}   /* __lower_after() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __lower_element - "Lower Element"
+*
+*   DESCRIPTION:
+*       Lowers a leaf at once, or opens a list:
+*       its code is lowered by __lower_form()
+*       as the list's frame is worked through.
+*       Lets and empty lists lower to nothing.
+*       An int literal used as a real is
+*       lowered to a real literal. In a
+*       profiled program, a list that is a
+*       statement is a profiled list.
+*
+*   ERRORS:
+*       * Sets BC_NO_MEMORY if the stack
+*         couldn't be grown.
+*
+**************************************************/
+static void __lower_element
+(
+    struct bc_program_type *prog,   /* program                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct type_info_type
+                           *ti,     /* its types                */
+    uint                   *depth,  /* open lists               */
+    uint                    node,   /* element                  */
+    __after_t8              after   /* what follows it          */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *nodes;  /* node array           */
+    const struct ast_node_type *head;   /* list's first element */
+    struct __bc_frame_type     *frame;  /* new frame            */
+    __list_kind_t8              kind;   /* kind of list         */
+
+    nodes = ast->nodes;
+    if( ( TOK_LITERAL == nodes[ node ].token_class )
+     && ( TOK_INT_TYPE == nodes[ node ].subclass )
+     && ( __AFTER_TO_REAL == after ) )
+    {
+        __put_real( prog, (double)nodes[ node ].val.int_val );
+        return;
+    }
+
+    if( TOK_LIST_TYPE != nodes[ node ].token_class )
+    {
+        __lower_leaf( prog, ast, ti, node );
+        __lower_after( prog, ti->types[ node ], after );
+        return;
+    }
+
+    if( AST_NO_NODE == nodes[ node ].first_child )
+    {
+        return;
+    }
+
+    head = &nodes[ nodes[ node ].first_child ];
+    switch( head->token_class )
+    {
+        case TOK_LIST_TYPE:
+            kind = __LIST_SEQUENCE;
+            break;
+
+        case TOK_BINARY_OPP:
+            kind = ( TOK_ASSN_OPP == head->subclass ) ? __LIST_ASSIGN : __LIST_BINARY;
+            break;
+
+        case TOK_UNARY_OPP:
+            kind = __LIST_UNARY;
+            break;
+
+        case TOK_RESERVED_WORD:
+            if( TOK_IF == head->subclass )
+            {
+                kind = __LIST_IF;
+            }
+            else if( TOK_WHILE == head->subclass )
+            {
+                kind = __LIST_WHILE;
+            }
+            else if( TOK_STDOUT == head->subclass )
+            {
+                kind = __LIST_STDOUT;
+            }
+            else
+            {
+                return;
+            }
+            break;
+
+        default:
+            return;
+    }
+
+    if( !__grow( prog, (void **)&prog->stack, &prog->stack_cap, *depth + 1, sizeof( *prog->stack ) ) )
+    {
+        return;
+    }
+
+    frame        = &prog->stack[ ( *depth )++ ];
+    frame->list  = node;
+    frame->next  = ( __LIST_SEQUENCE == kind ) ? nodes[ node ].first_child : head->next_sibling;
+    frame->kind  = kind;
+    frame->step  = 0;
+    frame->after = after;
+    frame->prof  = BC_NO_PROF;
+    if( prog->profile
+     && ( __AFTER_DROP == after ) )
+    {
+        __put_prof( prog, *depth, nodes[ node ].offset );
+    }
+
+}   /* __lower_element() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __lower_form - "Lower Form"
+*
+*   DESCRIPTION:
+*       Lowers a top-level form, working
+*       through its lists on an explicit stack
+*       as emit.c does, so nesting depth is
+*       limited only by memory. Small literal
+*       powers and int *, / and % by a literal
+*       power of 2 are strength-reduced as
+*       emit.c reduces them. A branch is put
+*       with a target of 0 and patched once its
+*       target is known.
+*
+**************************************************/
+static void __lower_form
+(
+    struct bc_program_type *prog,   /* program                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct type_info_type
+                           *ti,     /* its types                */
+    uint                    form    /* top-level form           */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *nodes;      /* node array           */
+    const type_class_t8        *types;      /* node types           */
+    struct __bc_frame_type     *frame;      /* innermost open list  */
+    const struct binding_type  *b;          /* assigned variable    */
+    bc_op_t8                    op;         /* operator's opcode    */
+    type_class_t8               type;       /* operands' type       */
+    uint                        depth;      /* open lists           */
+    uint                        a;          /* first operand        */
+    uint                        c;          /* second operand       */
+    uint8                       opp;        /* operator             */
+    uint                        kept;       /* operand a power or   */
+                                            /*  shift applies to    */
+    uint                        power;      /* small power, or 0    */
+    sint                        shift;      /* log 2 of a power of  */
+                                            /*  2 operand, or       */
+                                            /*  __NO_SHIFT          */
+
+    nodes = ast->nodes;
+    types = ti->types;
+    depth = 0;
+    __lower_element( prog, ast, ti, &depth, form, __AFTER_DROP );
+
+    while( ( depth > 0 )
+        && ( BC_NO_ERROR == prog->error ) )
+    {
+        frame = &prog->stack[ depth - 1 ];
+        a     = frame->next;
+        opp   = nodes[ nodes[ frame->list ].first_child ].subclass;
+        switch( frame->kind )
+        {
+            /*-------------------------
+            Every element is a statement
+            -------------------------*/
+            case __LIST_SEQUENCE:
+                if( AST_NO_NODE != a )
+                {
+                    frame->next = nodes[ a ].next_sibling;
+                    __lower_element( prog, ast, ti, &depth, a, __AFTER_DROP );
+                    continue;
+                }
+                break;
+
+            /*-------------------------
+            a b opp
+            -------------------------*/
+            case __LIST_BINARY:
+                c     = nodes[ a ].next_sibling;
+                type  = ( ( TOK_REAL_TYPE == types[ a ] ) || ( TOK_REAL_TYPE == types[ c ] ) ) ? TOK_REAL_TYPE : types[ a ];
+                power = ( TOK_EXP_OPP == opp ) ? __small_power( &nodes[ c ], type ) : 0;
+                shift = __NO_SHIFT;
+                kept  = a;
+                if( ( TOK_INT_TYPE == type )
+                 && ( ( TOK_MUL_OPP == opp ) || ( TOK_DIV_OPP == opp ) || ( TOK_MOD_OPP == opp ) ) )
+                {
+                    shift = __shift_of( &nodes[ c ], TOK_MOD_OPP == opp );
+                    if( ( __NO_SHIFT == shift )
+                     && ( TOK_MUL_OPP == opp ) )
+                    {
+                        /*-------------
+                        * commutes, so
+                        a power of 2 on
+                        the left does
+                        as well
+                        -------------*/
+                        shift = __shift_of( &nodes[ a ], FALSE );
+                        kept  = ( __NO_SHIFT == shift ) ? a : c;
+                    }
+                }
+                if( frame->step < ( ( ( 0 != power ) || ( __NO_SHIFT != shift ) ) ? 1 : 2 ) )
+                {
+                    ++frame->step;
+                    __lower_element( prog, ast, ti, &depth, ( 1 == frame->step ) ? kept : c,
+                                     ( TOK_REAL_TYPE == type ) ? __AFTER_TO_REAL : __AFTER_NONE );
+                    continue;
+                }
+
+                if( 0 != power )
+                {
+                    __put_power( prog, power, TOK_REAL_TYPE == type );
+                    break;
+                }
+
+                if( __NO_SHIFT != shift )
+                {
+                    if( TOK_MOD_OPP == opp )
+                    {
+                        __put_int( prog, ( (sint64)1 << shift ) - 1 );
+                        __put_op( prog, BC_AND );
+                    }
+                    else
+                    {
+                        __put_int( prog, (sint64)shift );
+                        __put_op( prog, ( TOK_MUL_OPP == opp ) ? BC_LSHIFT : BC_ARSHIFT );
+                    }
+                    break;
+                }
+
+                if( TOK_REAL_TYPE == type )
+                {
+                    op = __real_ops[ opp ];
+                }
+                else if( TOK_STRING_TYPE == type )
+                {
+                    op = __string_ops[ opp ];
+                }
+                else
+                {
+                    op = __int_ops[ opp ];
+                }
+
+                if( ( BC_DIV == op )
+                 || ( BC_MOD == op ) )
+                {
+                    __put_site( prog, nodes[ frame->list ].offset );
+                }
+                __put_op( prog, op );
+                break;
+
+            /*-------------------------
+            a opp
+            -------------------------*/
+            case __LIST_UNARY:
+                if( 0 == frame->step++ )
+                {
+                    __lower_element( prog, ast, ti, &depth, a,
+                                     ( TOK_REAL_TYPE == types[ frame->list ] ) ? __AFTER_TO_REAL : __AFTER_NONE );
+                    continue;
+                }
+
+                __put_op( prog, ( TOK_REAL_TYPE == types[ frame->list ] ) ? __real_unary_ops[ opp ] : __unary_ops[ opp ] );
+                break;
+
+            /*-------------------------
+            v STORE x
+            -------------------------*/
+            case __LIST_ASSIGN:
+                b = &ti->bindings[ ti->syms[ a ] ];
+                if( 0 == frame->step++ )
+                {
+                    __lower_element( prog, ast, ti, &depth, nodes[ a ].next_sibling,
+                                     ( TOK_REAL_TYPE == b->type ) ? __AFTER_TO_REAL : __AFTER_NONE );
+                    continue;
+                }
+
+                __put_op_k( prog, __store_ops[ b->type ], ti->syms[ a ] );
+                break;
+
+            /*-------------------------
+            c ZBRANCH t BRANCH e. The
+            branches give the if's
+            value, so they get what
+            follows it, and both start
+            from the same depths.
+            -------------------------*/
+            case __LIST_IF:
+                c = nodes[ a ].next_sibling;
+                switch( frame->step++ )
+                {
+                    case 0:
+                        __lower_element( prog, ast, ti, &depth, a, __AFTER_NONE );
+                        continue;
+
+                    case 1:
+                        __put_op_k( prog, BC_ZBRANCH, 0 );
+                        frame->patch  = prog->len - 1;
+                        frame->depth  = prog->depth;
+                        frame->fdepth = prog->fdepth;
+                        __lower_element( prog, ast, ti, &depth, c, frame->after );
+                        continue;
+
+                    case 2:
+                        if( AST_NO_NODE != nodes[ c ].next_sibling )
+                        {
+                            __put_op_k( prog, BC_BRANCH, 0 );
+                            if( BC_NO_ERROR == prog->error )
+                            {
+                                prog->code[ frame->patch ] = prog->len;
+                            }
+                            frame->patch  = prog->len - 1;
+                            prog->depth   = frame->depth;
+                            prog->fdepth  = frame->fdepth;
+                            __lower_element( prog, ast, ti, &depth, nodes[ c ].next_sibling, frame->after );
+                            continue;
+                        }
+                        /* fall through */
+
+                    default:
+                        if( BC_NO_ERROR == prog->error )
+                        {
+                            prog->code[ frame->patch ] = prog->len;
+                        }
+                        if( BC_NO_PROF != frame->prof )
+                        {
+                            __put_op_k( prog, BC_PROF_EXIT, frame->prof );
+                        }
+                        --depth;
+                        continue;
+                }
+
+            /*-------------------------
+            c ZBRANCH body BRANCH
+            -------------------------*/
+            case __LIST_WHILE:
+                if( 0 == frame->step )
+                {
+                    frame->step  = 1;
+                    frame->begin = prog->len;
+                    __lower_element( prog, ast, ti, &depth, a, __AFTER_NONE );
+                    continue;
+                }
+
+                if( 1 == frame->step )
+                {
+                    frame->step  = 2;
+                    frame->next  = nodes[ a ].next_sibling;
+                    __put_op_k( prog, BC_ZBRANCH, 0 );
+                    frame->patch = prog->len - 1;
+                    continue;
+                }
+
+                if( AST_NO_NODE != a )
+                {
+                    frame->next = nodes[ a ].next_sibling;
+                    __lower_element( prog, ast, ti, &depth, a, __AFTER_DROP );
+                    continue;
+                }
+
+                __put_op_k( prog, BC_BRANCH, frame->begin );
+                if( BC_NO_ERROR == prog->error )
+                {
+                    prog->code[ frame->patch ] = prog->len;
+                }
+                break;
+
+            /*-------------------------
+            e PRINT
+            -------------------------*/
+            case __LIST_STDOUT:
+                if( 0 == frame->step++ )
+                {
+                    __lower_element( prog, ast, ti, &depth, a, __AFTER_NONE );
+                    continue;
+                }
+
+                __put_op( prog, __print_ops[ types[ a ] ] );
+                break;
+
+            default:
+                break;
+        }
+
+        /*-----------------------------
+        The list is done
+        -----------------------------*/
+        --depth;
+        __lower_after( prog, types[ frame->list ], frame->after );
+        if( BC_NO_PROF != frame->prof )
+        {
+            __put_op_k( prog, BC_PROF_EXIT, frame->prof );
+        }
+    }
+
+}   /* __lower_form() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __fuse - "Fuse"
+*
+*   DESCRIPTION:
+*       Fuses pairs of opcodes into
+*       superinstructions, a pass for each in
+*       __fusions order, so an opcode that
+*       could be fused with the one before or
+*       after goes with the one fused first. A
+*       pair whose second opcode is a branch
+*       target is left alone, as a branch has
+*       to land on it. So is a division by a
+*       constant that can fail, so the
+*       superinstruction never has to check.
+*
+*   ERRORS:
+*       * Sets BC_NO_MEMORY if the targets
+*         couldn't be marked.
+*
+**************************************************/
+static void __fuse
+(
+    struct bc_program_type *prog    /* ended program            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint8      *targets;        /* code indices branched to */
+    uint       *code;           /* opcodes and operands     */
+    uint        prev;           /* opcode before, or len    */
+    uint        pc;             /* opcode                   */
+    uint        i;              /* fusion index             */
+
+    code    = prog->code;
+    targets = (uint8 *)stats_calloc( prog->len + 1, sizeof( *targets ) );
+    if( NULL == targets )
+    {
+        prog->error = BC_NO_MEMORY;
+        return;
+    }
+
+    for( pc = 0; pc < prog->len; pc += bc_op_length( (bc_op_t8)code[ pc ] ) )
+    {
+        if( ( BC_BRANCH == code[ pc ] )
+         || ( BC_ZBRANCH == code[ pc ] ) )
+        {
+            targets[ code[ pc + 1 ] ] = TRUE;
+        }
+    }
+
+    /*---------------------------------
+    A superinstruction is as long as
+    its pair, so later passes still
+    find every opcode
+    ---------------------------------*/
+    for( i = 0; i < __NUM_FUSIONS; ++i )
+    {
+        prev = prog->len;
+        for( pc = 0; pc < prog->len; pc += bc_op_length( (bc_op_t8)code[ pc ] ) )
+        {
+            if( ( prog->len != prev )
+             && ( !targets[ pc ] )
+             && ( __fusions[ i ].first == code[ prev ] )
+             && ( __fusions[ i ].second == code[ pc ] )
+             && ( ( ( BC_DIV != code[ pc ] ) && ( BC_MOD != code[ pc ] ) )
+               || ( ( 0 != prog->ints[ code[ prev + 1 ] ] ) && ( -1 != prog->ints[ code[ prev + 1 ] ] ) ) ) )
+            {
+                code[ prev ] = __fusions[ i ].fused;
+                ++prog->num_fused;
+                prev = prog->len;
+            }
+            else
+            {
+                prev = pc;
+            }
+        }
+    }
+
+    free( targets );
+
+}   /* __fuse() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_program - "Initialize Program"
+*
+*   DESCRIPTION:
+*       Prepares an empty program.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * BC_NO_MEMORY if the code couldn't be
+*         allocated.
+*
+**************************************************/
+bc_error_t8 init_program
+(
+    struct bc_program_type *prog    /* program to initialize    */
+)
+{
+    memset( prog, 0, sizeof( *prog ) );
+    prog->num_vars = 1;
+    __grow( prog, (void **)&prog->code, &prog->cap, __INITIAL_CODE, sizeof( *prog->code ) );
+    __grow( prog, (void **)&prog->stack, &prog->stack_cap, __INITIAL_STACK, sizeof( *prog->stack ) );
+    if( BC_NO_ERROR != prog->error )
+    {
+        free_program( prog );
+        return( BC_NO_MEMORY );
+    }
+
+    return( BC_NO_ERROR );
+
+}   /* init_program() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       lower_forms - "Lower Forms"
+*
+*   DESCRIPTION:
+*       Appends the code of a batch of checked
+*       top-level forms. Batches must be
+*       lowered in the order they were checked,
+*       with the same type info.
+*
+*   RETURNS:
+*       Returns the program's error code
+*
+*   ERRORS:
+*       * BC_NO_MEMORY if the program couldn't
+*         be grown.
+*
+**************************************************/
+bc_error_t8 lower_forms
+(
+    struct bc_program_type *prog,   /* program                  */
+    const struct ast_type  *ast,    /* checked forms            */
+    const struct type_info_type
+                           *ti      /* their types              */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *nodes;  /* node array           */
+    uint                        form;   /* top-level form       */
+
+    nodes = ast->nodes;
+    for( form = nodes[ AST_ROOT ].first_child; ( AST_NO_NODE != form ) && ( BC_NO_ERROR == prog->error ); form = nodes[ form ].next_sibling )
+    {
+        __lower_form( prog, ast, ti, form );
+    }
+    prog->num_vars = ti->num_bindings;
+
+    return( prog->error );
+
+}   /* lower_forms() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       end_program - "End Program"
+*
+*   DESCRIPTION:
+*       Ends the code once every form is
+*       lowered, and fuses superinstructions
+*       if asked to.
+*
+*   RETURNS:
+*       Returns the program's error code
+*
+*   ERRORS:
+*       * BC_NO_MEMORY if the code couldn't be
+*         grown or fused.
+*
+**************************************************/
+bc_error_t8 end_program
+(
+    struct bc_program_type *prog,   /* program                  */
+    boolean                 fuse    /* use superinstructions?   */
+)
+{
+    __put_op( prog, BC_HALT );
+    if( fuse
+     && ( BC_NO_ERROR == prog->error ) )
+    {
+        __fuse( prog );
+    }
+
+    return( prog->error );
+
+}   /* end_program() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       bc_op_length - "Bytecode Opcode Length"
+*
+*   DESCRIPTION:
+*       Gives the words an opcode takes,
+*       operand included.
+*
+**************************************************/
+uint bc_op_length
+(
+    bc_op_t8                op      /* opcode                   */
+)
+{
+    return( 1u + __effects[ op ].operands );
+
+}   /* bc_op_length() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       bc_first_op - "Bytecode First Opcode"
+*
+*   DESCRIPTION:
+*       Gives the first opcode of the pair a
+*       superinstruction does the work of, or
+*       the opcode itself if it isn't one. The
+*       second of the pair is still in the code
+*       after the first's operands.
+*
+**************************************************/
+bc_op_t8 bc_first_op
+(
+    bc_op_t8                op      /* opcode                   */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint                    i;      /* fusion index             */
+
+    for( i = 0; i < __NUM_FUSIONS; ++i )
+    {
+        if( op == __fusions[ i ].fused )
+        {
+            return( __fusions[ i ].first );
+        }
+    }
+
+    return( op );
+
+}   /* bc_first_op() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       bc_find_site - "Bytecode Find Site"
+*
+*   DESCRIPTION:
+*       Finds the list an instruction that can
+*       fail came from.
+*
+*   RETURNS:
+*       Returns its source offset, or 0 if the
+*       instruction isn't a site.
+*
+**************************************************/
+uint bc_find_site
+(
+    const struct bc_program_type
+                           *prog,   /* program                  */
+    uint                    pc      /* code index of an opcode  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        lo;             /* first candidate          */
+    uint        hi;             /* past the last candidate  */
+    uint        mid;            /* candidate                */
+
+    lo = 0;
+    hi = prog->num_sites;
+    while( lo < hi )
+    {
+        mid = lo + ( hi - lo ) / 2;
+        if( prog->sites[ mid ].pc < pc )
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    if( ( lo < prog->num_sites )
+     && ( prog->sites[ lo ].pc == pc ) )
+    {
+        return( prog->sites[ lo ].offset );
+    }
+
+    return( 0 );
+
+}   /* bc_find_site() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_program - "Free Program"
+*
+*   DESCRIPTION:
+*       Frees a program's code and constants.
+*
+**************************************************/
+void free_program
+(
+    struct bc_program_type *prog    /* program to free          */
+)
+{
+    free( prog->code );
+    free( prog->ints );
+    free( prog->reals );
+    free( prog->strings );
+    free( prog->string_slots );
+    free( prog->sites );
+    free( prog->profs );
+    free( prog->stack );
+    memset( prog, 0, sizeof( *prog ) );
+
+}   /* free_program() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       bc_error_str - "Bytecode Error String"
+*
+*   DESCRIPTION:
+*       Describes a lowering error code.
+*
+**************************************************/
+const char *bc_error_str
+(
+    bc_error_t8             error   /* error code               */
+)
+{
+    switch( error )
+    {
+        case BC_NO_ERROR:
+            return( "no error" );
+
+        case BC_NO_MEMORY:
+            return( "out of memory" );
+
+        default:
+            return( "unknown error" );
+    }
+
+}   /* bc_error_str() */
@@ -0,0 +1,321 @@
+/**************************************************
+*
+*   NAME:
+*       bytecode.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       lowering checked trees to bytecode for
+*       the in-process interpreter
+*
+**************************************************/
+
+#ifndef __BYTECODE_H__
+#define __BYTECODE_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "ast.h"
+#include "tokens.h"
+#include "typecheck.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define BC_NO_PROF          ( (uint)-1 )
+                                    /* no profiled list                 */
+
+/*-------------------------------------
+Error types
+-------------------------------------*/
+typedef sint8 bc_error_t8;
+enum
+{
+    BC_NO_ERROR           =  0,     /* no error                         */
+    BC_NO_MEMORY          = -1      /* out of memory                    */
+};
+
+/*-------------------------------------
+Opcodes. Each is one of the Gforth
+words the emitter would write, with
+the same stack effect, so a program
+does exactly what its Gforth does.
+Ints, bools and strings are cells on
+the data stack, a string being an
+address and a length; reals are on a
+stack of their own. Opcodes marked
+"k" are followed by an operand: a
+constant, a binding or a code index.
+
+The superinstructions after
+BC_ZBRANCH each do the work of a pair
+of opcodes that often run one after
+the other. One takes the place of the
+first of the pair, and the second's
+words stay where they were, so no code
+index changes; the second's opcode
+word is skipped.
+-------------------------------------*/
+typedef uint8 bc_op_t8;
+enum
+{
+    BC_HALT = 0,                    /* end of the program               */
+    BC_LIT,                         /* k: push int constant             */
+    BC_FLIT,                        /* k: push real constant            */
+    BC_SLIT,                        /* k: push string constant          */
+    BC_FETCH,                       /* k: @ of an int or bool variable  */
+    BC_FFETCH,                      /* k: f@ of a real variable         */
+    BC_SFETCH,                      /* k: 2@ of a string variable       */
+    BC_STORE,                       /* k: ! to an int or bool variable  */
+    BC_FSTORE,                      /* k: f! to a real variable         */
+    BC_SSTORE,                      /* k: 2! to a string variable       */
+    BC_ADD,                         /* +                                */
+    BC_SUB,                         /* -                                */
+    BC_MUL,                         /* *                                */
+    BC_DIV,                         /* i/                               */
+    BC_MOD,                         /* imod                             */
+    BC_AND,                         /* and                              */
+    BC_OR,                          /* or                               */
+    BC_LSHIFT,                      /* lshift                           */
+    BC_ARSHIFT,                     /* arshift                          */
+    BC_POW,                         /* i**                              */
+    BC_EQ,                          /* =                                */
+    BC_LT,                          /* <                                */
+    BC_GT,                          /* >                                */
+    BC_LE,                          /* i<=                              */
+    BC_GE,                          /* i>=                              */
+    BC_NE,                          /* <>                               */
+    BC_FADD,                        /* f+                               */
+    BC_FSUB,                        /* f-                               */
+    BC_FMUL,                        /* f*                               */
+    BC_FDIV,                        /* f/                               */
+    BC_FPOW,                        /* f**                              */
+    BC_FEQ,                         /* f=                               */
+    BC_FLT,                         /* f<                               */
+    BC_FGT,                         /* f>                               */
+    BC_FLE,                         /* f<=                              */
+    BC_FGE,                         /* f>=                              */
+    BC_FNE,                         /* f<>                              */
+    BC_SCAT,                        /* s+                               */
+    BC_SEQ,                         /* str=                             */
+    BC_SLT,                         /* str<                             */
+    BC_SGT,                         /* str>                             */
+    BC_SLE,                         /* str<=                            */
+    BC_SGE,                         /* str>=                            */
+    BC_SNE,                         /* str<>                            */
+    BC_NOT,                         /* 0=                               */
+    BC_NEGATE,                      /* negate                           */
+    BC_FNEGATE,                     /* fnegate                          */
+    BC_FSIN,                        /* fsin                             */
+    BC_FCOS,                        /* fcos                             */
+    BC_FTAN,                        /* ftan                             */
+    BC_TO_REAL,                     /* s>f                              */
+    BC_DROP,                        /* drop                             */
+    BC_FDROP,                       /* fdrop                            */
+    BC_SDROP,                       /* 2drop                            */
+    BC_DUP,                         /* dup                              */
+    BC_FDUP,                        /* fdup                             */
+    BC_PRINT,                       /* . cr                             */
+    BC_FPRINT,                      /* f. cr                            */
+    BC_SPRINT,                      /* type cr                          */
+    BC_BPRINT,                      /* .bool cr                         */
+    BC_PROF_ENTER,                  /* k: profiled list k starts        */
+    BC_PROF_EXIT,                   /* k: profiled list k ends          */
+    BC_BRANCH,                      /* k: else or repeat, to code k     */
+    BC_ZBRANCH,                     /* k: if or while, to code k if the */
+                                    /*  flag is false                   */
+    BC_LIT_ADD,                     /* BC_LIT k  BC_ADD                 */
+    BC_LIT_SUB,                     /* BC_LIT k  BC_SUB                 */
+    BC_LIT_MUL,                     /* BC_LIT k  BC_MUL                 */
+    BC_LIT_DIV,                     /* BC_LIT k  BC_DIV, k not 0 or -1  */
+    BC_LIT_MOD,                     /* BC_LIT k  BC_MOD, k not 0 or -1  */
+    BC_LIT_AND,                     /* BC_LIT k  BC_AND                 */
+    BC_LIT_LSHIFT,                  /* BC_LIT k  BC_LSHIFT              */
+    BC_LIT_ARSHIFT,                 /* BC_LIT k  BC_ARSHIFT             */
+    BC_LIT_EQ,                      /* BC_LIT k  BC_EQ                  */
+    BC_LIT_LT,                      /* BC_LIT k  BC_LT                  */
+    BC_LIT_GT,                      /* BC_LIT k  BC_GT                  */
+    BC_LIT_LE,                      /* BC_LIT k  BC_LE                  */
+    BC_LIT_GE,                      /* BC_LIT k  BC_GE                  */
+    BC_LIT_NE,                      /* BC_LIT k  BC_NE                  */
+    BC_FETCH_ADD,                   /* BC_FETCH k  BC_ADD               */
+    BC_FETCH_SUB,                   /* BC_FETCH k  BC_SUB               */
+    BC_FETCH_MUL,                   /* BC_FETCH k  BC_MUL               */
+    BC_FETCH_LIT,                   /* BC_FETCH k  BC_LIT k             */
+    BC_ADD_STORE,                   /* BC_ADD  BC_STORE k               */
+    BC_SUB_STORE,                   /* BC_SUB  BC_STORE k               */
+    BC_EQ_ZBRANCH,                  /* BC_EQ  BC_ZBRANCH k              */
+    BC_LT_ZBRANCH,                  /* BC_LT  BC_ZBRANCH k              */
+    BC_GT_ZBRANCH,                  /* BC_GT  BC_ZBRANCH k              */
+    BC_LE_ZBRANCH,                  /* BC_LE  BC_ZBRANCH k              */
+    BC_GE_ZBRANCH,                  /* BC_GE  BC_ZBRANCH k              */
+    BC_NE_ZBRANCH,                  /* BC_NE  BC_ZBRANCH k              */
+    BC_SLIT_SCAT,                   /* BC_SLIT k  BC_SCAT               */
+    BC_SFETCH_SCAT,                 /* BC_SFETCH k  BC_SCAT             */
+    BC_NUM_OPS                      /* number of opcodes                */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A string constant. It points into the
+source, which must outlive the
+program.
+-------------------------------------*/
+struct bc_string_type
+{
+    const char         *str;        /* text, without quotes             */
+    uint                len;        /* its length                       */
+};
+
+/*-------------------------------------
+An instruction that can fail at run
+time, and the list it came from, so
+the failure can be reported against
+the source
+-------------------------------------*/
+struct bc_site_type
+{
+    uint                pc;         /* code index of the opcode         */
+    uint                offset;     /* source offset of its list        */
+};
+
+/*-------------------------------------
+A list profiled as it runs: a
+statement, that is a top-level form or
+an element of a sequence or of a while
+body. Its time includes that of the
+profiled lists run inside it.
+-------------------------------------*/
+struct bc_prof_type
+{
+    uint                offset;     /* source offset of the list        */
+    uint                parent;     /* profiled list it is in, or       */
+                                    /*  BC_NO_PROF                      */
+    uint64              count;      /* times it ran                     */
+    uint64              ns;         /* nanoseconds it took              */
+};
+
+/*-------------------------------------
+A variable, as Gforth's variable,
+fvariable or 2variable holds it. All
+zero bits is 0, 0e and the empty
+string.
+-------------------------------------*/
+union bc_var_type
+{
+    sint64              cell;       /* int or flag                      */
+    double              real;       /* real                             */
+    sint64              str[ 2 ];   /* address, length                  */
+};
+
+/*-------------------------------------
+A lowered program. Code is a stream
+of 32-bit words, each an opcode or an
+operand. Every form leaves both stacks
+as it found them, and their greatest
+depths are known once the program is
+lowered, so the interpreter never
+checks them. Variables are named by
+binding, so there are num_vars of
+them, the first unused. A program
+lowered with profile set brackets each
+statement with BC_PROF_ENTER and
+BC_PROF_EXIT; otherwise it has none.
+-------------------------------------*/
+struct bc_program_type
+{
+    uint               *code;           /* opcodes and operands     */
+    uint                len;            /* words in use             */
+    uint                cap;            /* words allocated          */
+    sint64             *ints;           /* int constants            */
+    uint                num_ints;       /* in use                   */
+    uint                int_cap;        /* allocated                */
+    double             *reals;          /* real constants           */
+    uint                num_reals;      /* in use                   */
+    uint                real_cap;       /* allocated                */
+    struct bc_string_type
+                       *strings;        /* string constants         */
+    uint                num_strings;    /* in use                   */
+    uint                string_cap;     /* allocated                */
+    uint               *string_slots;   /* string constants by text,*/
+                                        /*  index + 1, or 0 if free */
+    uint                slot_cap;       /* slots, a power of two    */
+    struct bc_site_type
+                       *sites;          /* instructions that can    */
+                                        /*  fail, by pc             */
+    uint                num_sites;      /* in use                   */
+    uint                site_cap;       /* allocated                */
+    boolean             profile;        /* profile statements?      */
+    struct bc_prof_type
+                       *profs;          /* profiled lists           */
+    uint                num_profs;      /* in use                   */
+    uint                prof_cap;       /* allocated                */
+    uint                num_vars;       /* bindings + 1             */
+    uint                num_fused;      /* superinstructions        */
+    uint                depth;          /* data stack depth now     */
+    uint                fdepth;         /* real stack depth now     */
+    uint                max_depth;      /* deepest data stack       */
+    uint                max_fdepth;     /* deepest real stack       */
+    struct __bc_frame_type
+                       *stack;          /* open lists               */
+    uint                stack_cap;      /* frames allocated         */
+    bc_error_t8         error;          /* first error              */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+bc_error_t8 init_program
+(
+    struct bc_program_type *prog    /* program to initialize    */
+);
+
+bc_error_t8 lower_forms
+(
+    struct bc_program_type *prog,   /* program                  */
+    const struct ast_type  *ast,    /* checked forms            */
+    const struct type_info_type
+                           *ti      /* their types              */
+);
+
+bc_error_t8 end_program
+(
+    struct bc_program_type *prog,   /* program                  */
+    boolean                 fuse    /* use superinstructions?   */
+);
+
+uint bc_op_length
+(
+    bc_op_t8                op      /* opcode                   */
+);
+
+bc_op_t8 bc_first_op
+(
+    bc_op_t8                op      /* opcode                   */
+);
+
+uint bc_find_site
+(
+    const struct bc_program_type
+                           *prog,   /* program                  */
+    uint                    pc      /* code index of an opcode  */
+);
+
+void free_program
+(
+    struct bc_program_type *prog    /* program to free          */
+);
+
+const char *bc_error_str
+(
+    bc_error_t8             error   /* error code               */
+);
+
+#endif /* __BYTECODE_H__ */
@@ -0,0 +1,624 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       cache.c
+*
+*   DESCRIPTION:
+*       Content-addressed cache of compiled
+*       output. A source's key is a 128-bit hash
+*       of the source, seeded with the compiler
+*       version, the build and the options that
+*       change the output. On a hit the cached
+*       file is copied to the output, and the
+*       source isn't scanned at all.
+*
+*       On a miss the source is compiled into a
+*       temporary file in the cache directory,
+*       which is copied to the output and then
+*       renamed to its key if the compilation
+*       succeeded. rename() replaces atomically,
+*       so readers, including other processes,
+*       only ever see whole entries. A hit
+*       touches its entry, and trim_cache()
+*       removes the least recently used entries
+*       once the cache grows past its limit.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "compiler.h"
+#include "hash.h"
+#include "incremental.h"
+#include "trace.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __ENTRY_EXT         ".fs"       /* extension of an entry            */
+#define __TEMP_PREFIX       "tmp."      /* prefix of a temporary file       */
+#define __TEMP_MAX_AGE      3600        /* seconds before a temporary file  */
+                                        /*  is taken as abandoned           */
+#define __COPY_SIZE         65536       /* bytes per read() when copying    */
+#define __MAX_PATH          4096        /* longest entry path               */
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A file found by trim_cache()
+-------------------------------------*/
+struct __entry_type
+{
+    struct dirent      *ent;            /* file's directory entry   */
+    time_t              used;           /* last modified            */
+    uint64              size;           /* bytes                    */
+};
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static void __make_key
+(
+    const char             *src,    /* source buffer            */
+    uint                    len,    /* length of the source     */
+    const struct compile_options_type
+                           *opts,   /* options                  */
+    char                   *key     /* CACHE_KEY_LEN + 1 chars  */
+);
+
+static sint64 __copy_file
+(
+    int                     in,     /* file to copy             */
+    int                     out     /* where to copy it         */
+);
+
+static int __is_cache_file
+(
+    const struct dirent    *ent     /* directory entry          */
+);
+
+static int __compare_entries
+(
+    const void             *a,      /* entry                    */
+    const void             *b       /* entry                    */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __make_key - "Make Key"
+*
+*   DESCRIPTION:
+*       Makes a source's key: the hash of the
+*       source, seeded with a hash of the build
+*       and the options, in hex.
+*
+**************************************************/
+static void __make_key
+(
+    const char             *src,    /* source buffer            */
+    uint                    len,    /* length of the source     */
+    const struct compile_options_type
+                           *opts,   /* options                  */
+    char                   *key     /* CACHE_KEY_LEN + 1 chars  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint64              h[ 2 ];     /* hash of the source       */
+
+    hash_bytes( src, len, compile_stamp( opts ), h );
+    sprintf( key, "%016llx%016llx", (unsigned long long)h[ 0 ], (unsigned long long)h[ 1 ] );
+
+}   /* __make_key() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __copy_file - "Copy File"
+*
+*   DESCRIPTION:
+*       Copies the rest of a file to a file or
+*       pipe.
+*
+*   RETURNS:
+*       Returns the bytes copied, or -1 if
+*       either side failed.
+*
+**************************************************/
+static sint64 __copy_file
+(
+    int                     in,     /* file to copy             */
+    int                     out     /* where to copy it         */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char        buf[ __COPY_SIZE ]; /* bytes in flight          */
+    ssize_t     n;                  /* bytes read               */
+    ssize_t     written;            /* bytes written by a call  */
+    ssize_t     done;               /* bytes of buf written     */
+    sint64      total;              /* bytes copied             */
+
+    total = 0;
+    for( ;; )
+    {
+        n = read( in, buf, sizeof( buf ) );
+        if( ( n < 0 )
+         && ( EINTR == errno ) )
+        {
+            continue;
+        }
+        if( n <= 0 )
+        {
+            return( ( 0 == n ) ? total : -1 );
+        }
+
+        for( done = 0; done < n; done += written )
+        {
+            written = write( out, &buf[ done ], (size_t)( n - done ) );
+            if( written < 0 )
+            {
+                if( EINTR == errno )
+                {
+                    written = 0;
+                    continue;
+                }
+                return( -1 );
+            }
+        }
+        total += n;
+    }
+
+}   /* __copy_file() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __is_cache_file - "Is Cache File"
+*
+*   DESCRIPTION:
+*       scandir() filter for the entries and
+*       temporary files of a cache.
+*
+**************************************************/
+static int __is_cache_file
+(
+    const struct dirent    *ent     /* directory entry          */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    size_t      len;            /* length of the name       */
+
+    len = strlen( ent->d_name );
+    return( ( ( CACHE_KEY_LEN + sizeof( __ENTRY_EXT ) - 1 == len )
+           && ( 0 == strcmp( &ent->d_name[ CACHE_KEY_LEN ], __ENTRY_EXT ) ) )
+         || ( 0 == strncmp( ent->d_name, __TEMP_PREFIX, sizeof( __TEMP_PREFIX ) - 1 ) ) );
+
+}   /* __is_cache_file() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __compare_entries - "Compare Entries"
+*
+*   DESCRIPTION:
+*       qsort() comparison putting the least
+*       recently used entry first.
+*
+**************************************************/
+static int __compare_entries
+(
+    const void             *a,      /* entry                    */
+    const void             *b       /* entry                    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct __entry_type  *ea; /* first entry              */
+    const struct __entry_type  *eb; /* second entry             */
+
+    ea = (const struct __entry_type *)a;
+    eb = (const struct __entry_type *)b;
+    if( ea->used != eb->used )
+    {
+        return( ( ea->used < eb->used ) ? -1 : 1 );
+    }
+    return( strcmp( ea->ent->d_name, eb->ent->d_name ) );
+
+}   /* __compare_entries() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_cache - "Initialize Cache"
+*
+*   DESCRIPTION:
+*       Opens a cache directory, creating it if
+*       it doesn't exist.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * CACHE_NO_DIRECTORY if the directory
+*         doesn't exist and couldn't be made.
+*       * CACHE_NO_MEMORY if out of memory.
+*
+**************************************************/
+cache_error_t8 init_cache
+(
+    struct cache_type      *c,      /* cache to initialize      */
+    const char             *dir,    /* its directory            */
+    uint64                  limit   /* bytes to keep            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct stat st;             /* directory's status       */
+
+    memset( c, 0, sizeof( *c ) );
+    atomic_init( &c->hits,         0 );
+    atomic_init( &c->misses,       0 );
+    atomic_init( &c->stores,       0 );
+    atomic_init( &c->evictions,    0 );
+    atomic_init( &c->bytes_copied, 0 );
+    atomic_init( &c->next_temp,    0 );
+    c->limit = limit;
+
+    if( ( 0 != mkdir( dir, 0755 ) )
+     && ( ( EEXIST != errno )
+       || ( 0 != stat( dir, &st ) )
+       || ( !S_ISDIR( st.st_mode ) ) ) )
+    {
+        return( CACHE_NO_DIRECTORY );
+    }
+
+    c->dir = strdup( dir );
+    if( NULL == c->dir )
+    {
+        return( CACHE_NO_MEMORY );
+    }
+
+    return( CACHE_NO_ERROR );
+
+}   /* init_cache() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       cache_compile - "Cache Compile"
+*
+*   DESCRIPTION:
+*       Writes a source's compiled output, from
+*       the cache if it is there, and otherwise
+*       by compiling it, incrementally if state
+*       is given, and adding the output to the
+*       cache. Safe to call from several
+*       threads, and from several processes
+*       sharing the directory. The lookup,
+*       until the entry is found or missed, is
+*       a span on the trace.
+*
+*   RETURNS:
+*       Returns TRUE on a hit. The result of a
+*       hit only has bytes_out set, and error
+*       if the entry couldn't be copied.
+*
+*   NOTES:
+*       * Only compilations that succeed are
+*         cached, so a program with an error
+*         is compiled, and reported, every
+*         time.
+*       * Nothing that goes wrong with the
+*         cache itself fails a compilation; the
+*         source is then just compiled straight
+*         to the output.
+*
+**************************************************/
+boolean cache_compile
+(
+    struct cache_type      *c,      /* cache                    */
+    const char             *src,    /* source buffer            */
+    uint                    len,    /* length of the source     */
+    int                     fd,     /* file or pipe to write    */
+    const struct compile_options_type
+                           *opts,   /* options                  */
+    const char             *state,  /* form state, or NULL      */
+    struct compile_result_type
+                           *result  /* outcome                  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char        key[ CACHE_KEY_LEN + 1 ];   /* source's key             */
+    char        path[ __MAX_PATH ];         /* entry                    */
+    char        temp[ __MAX_PATH ];         /* entry being written      */
+    struct stat st;                         /* entry's status           */
+    sint64      copied;                     /* bytes copied             */
+    int         in;                         /* entry or temporary file  */
+
+    trace_begin( "cache", "lookup", NULL );
+    __make_key( src, len, opts, key );
+    if( ( snprintf( path, sizeof( path ), "%s/%s%s", c->dir, key, __ENTRY_EXT ) >= (int)sizeof( path ) )
+     || ( snprintf( temp, sizeof( temp ), "%s/" __TEMP_PREFIX "%d.%u", c->dir, (int)getpid(), atomic_fetch_add( &c->next_temp, 1 ) ) >= (int)sizeof( temp ) ) )
+    {
+        trace_end( "cache", "lookup", "miss" );
+        atomic_fetch_add( &c->misses, 1 );
+        compile_incremental( src, len, fd, opts, state, result );
+        return( FALSE );
+    }
+
+    /*---------------------------------
+    Hit: copy the entry and mark it as
+    used. Every output has the prelude,
+    so an empty entry, which a crash
+    between write and rename can leave,
+    is a miss.
+    ---------------------------------*/
+    in = open( path, O_RDONLY );
+    if( in >= 0 )
+    {
+        if( ( 0 == fstat( in, &st ) )
+         && ( st.st_size > 0 ) )
+        {
+            trace_end( "cache", "lookup", "hit" );
+            memset( result, 0, sizeof( *result ) );
+            copied = __copy_file( in, fd );
+            if( copied == (sint64)st.st_size )
+            {
+                futimens( in, NULL );
+                close( in );
+                result->bytes_out = (uint64)copied;
+                atomic_fetch_add( &c->hits, 1 );
+                atomic_fetch_add( &c->bytes_copied, (uint64)copied );
+                return( TRUE );
+            }
+
+            close( in );
+            result->error   = COMPILE_WRITE_ERROR;
+            result->message = compile_error_str( COMPILE_WRITE_ERROR );
+            return( TRUE );
+        }
+        close( in );
+        unlink( path );
+    }
+
+    /*---------------------------------
+    Miss: compile to a temporary file,
+    copy it out, and keep it if the
+    compilation succeeded
+    ---------------------------------*/
+    trace_end( "cache", "lookup", "miss" );
+    atomic_fetch_add( &c->misses, 1 );
+    in = open( temp, O_RDWR | O_CREAT | O_EXCL, 0644 );
+    if( in < 0 )
+    {
+        compile_incremental( src, len, fd, opts, state, result );
+        return( FALSE );
+    }
+
+    compile_incremental( src, len, in, opts, state, result );
+    if( COMPILE_WRITE_ERROR == result->error )
+    {
+        close( in );
+        unlink( temp );
+        compile_incremental( src, len, fd, opts, state, result );
+        return( FALSE );
+    }
+
+    if( ( (off_t)-1 == lseek( in, 0, SEEK_SET ) )
+     || ( __copy_file( in, fd ) != (sint64)result->bytes_out ) )
+    {
+        if( COMPILE_NO_ERROR == result->error )
+        {
+            result->error   = COMPILE_WRITE_ERROR;
+            result->message = compile_error_str( COMPILE_WRITE_ERROR );
+        }
+    }
+
+    if( ( 0 == close( in ) )
+     && ( COMPILE_NO_ERROR == result->error )
+     && ( 0 == rename( temp, path ) ) )
+    {
+        atomic_fetch_add( &c->stores, 1 );
+    }
+    else
+    {
+        unlink( temp );
+    }
+
+    return( FALSE );
+
+}   /* cache_compile() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       trim_cache - "Trim Cache"
+*
+*   DESCRIPTION:
+*       Removes the least recently used entries
+*       until the cache is within its limit,
+*       along with temporary files old enough
+*       to have been abandoned.
+*
+*   RETURNS:
+*       Returns the bytes left in the cache.
+*
+**************************************************/
+uint64 trim_cache
+(
+    struct cache_type      *c       /* cache                    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct dirent     **names;      /* files in the cache       */
+    struct __entry_type
+                       *entries;    /* entries found            */
+    struct stat         st;         /* file's status            */
+    char                path[ __MAX_PATH ];
+                                    /* file's path              */
+    uint64              total;      /* bytes in entries         */
+    time_t              now;        /* time of the trim         */
+    int                 num_names;  /* files found              */
+    int                 num_entries;/* entries found            */
+    int                 i;          /* for-loop iterator        */
+
+    num_names = scandir( c->dir, &names, __is_cache_file, NULL );
+    if( num_names < 0 )
+    {
+        return( 0 );
+    }
+
+    entries     = (struct __entry_type *)malloc( ( (size_t)num_names + 1 ) * sizeof( *entries ) );
+    num_entries = 0;
+    total       = 0;
+    now         = time( NULL );
+    for( i = 0; i < num_names; ++i )
+    {
+        snprintf( path, sizeof( path ), "%s/%s", c->dir, names[ i ]->d_name );
+        if( 0 != stat( path, &st ) )
+        {
+            free( names[ i ] );
+        }
+        else if( 0 == strncmp( names[ i ]->d_name, __TEMP_PREFIX, sizeof( __TEMP_PREFIX ) - 1 ) )
+        {
+            if( now - st.st_mtime > __TEMP_MAX_AGE )
+            {
+                unlink( path );
+            }
+            free( names[ i ] );
+        }
+        else if( NULL == entries )
+        {
+            total += (uint64)st.st_size;
+            free( names[ i ] );
+        }
+        else
+        {
+            entries[ num_entries ].ent  = names[ i ];
+            entries[ num_entries ].used = st.st_mtime;
+            entries[ num_entries ].size = (uint64)st.st_size;
+            ++num_entries;
+            total += (uint64)st.st_size;
+        }
+    }
+
+    /*---------------------------------
+    Evict, oldest first
+    ---------------------------------*/
+    if( NULL != entries )
+    {
+        qsort( entries, (size_t)num_entries, sizeof( *entries ), __compare_entries );
+        for( i = 0; i < num_entries; ++i )
+        {
+            if( total > c->limit )
+            {
+                snprintf( path, sizeof( path ), "%s/%s", c->dir, entries[ i ].ent->d_name );
+                if( 0 == unlink( path ) )
+                {
+                    total -= entries[ i ].size;
+                    atomic_fetch_add( &c->evictions, 1 );
+                }
+            }
+            free( entries[ i ].ent );
+        }
+        free( entries );
+    }
+    free( names );
+
+    return( total );
+
+}   /* trim_cache() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_cache - "Free Cache"
+*
+*   DESCRIPTION:
+*       Frees a cache. The directory is left
+*       as it is.
+*
+**************************************************/
+void free_cache
+(
+    struct cache_type      *c       /* cache to free            */
+)
+{
+    free( c->dir );
+    c->dir = NULL;
+
+}   /* free_cache() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       cache_error_str - "Cache Error String"
+*
+*   DESCRIPTION:
+*       Describes an error code.
+*
+**************************************************/
+const char *cache_error_str
+(
+    cache_error_t8          error   /* error code               */
+)
+{
+    switch( error )
+    {
+        case CACHE_NO_ERROR:
+            return( "no error" );
+
+        case CACHE_NO_DIRECTORY:
+            return( "unable to make the cache directory" );
+
+        case CACHE_NO_MEMORY:
+            return( "out of memory" );
+
+        default:
+            return( "unknown error" );
+    }
+
+}   /* cache_error_str() */
@@ -0,0 +1,106 @@
+/**************************************************
+*
+*   NAME:
+*       cache.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for the
+*       content-addressed cache of compiled
+*       output
+*
+**************************************************/
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdatomic.h>
+
+#include "compiler.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define CACHE_DEFAULT_LIMIT ( 256ull << 20 )    /* bytes kept by default    */
+#define CACHE_KEY_LEN       32                  /* hex digits in a key      */
+
+/*-------------------------------------
+Error types
+-------------------------------------*/
+typedef sint8 cache_error_t8;
+enum
+{
+    CACHE_NO_ERROR        =  0,     /* no error                         */
+    CACHE_NO_DIRECTORY    = -1,     /* the directory couldn't be made   */
+    CACHE_NO_MEMORY       = -2      /* out of memory                    */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A cache directory. Entries are named
+by the hash of the compiler version,
+the options that change the output and
+the source, and hold the output of a
+compilation that succeeded. The
+counters are atomic so the threads of
+a batch can share one cache.
+-------------------------------------*/
+struct cache_type
+{
+    char               *dir;            /* cache directory          */
+    uint64              limit;          /* bytes kept after a trim  */
+    atomic_ullong       hits;           /* outputs copied           */
+    atomic_ullong       misses;         /* sources compiled         */
+    atomic_ullong       stores;         /* outputs added            */
+    atomic_ullong       evictions;      /* entries removed          */
+    atomic_ullong       bytes_copied;   /* bytes copied on hits     */
+    atomic_uint         next_temp;      /* names temporary files    */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+cache_error_t8 init_cache
+(
+    struct cache_type      *c,      /* cache to initialize      */
+    const char             *dir,    /* its directory            */
+    uint64                  limit   /* bytes to keep            */
+);
+
+boolean cache_compile
+(
+    struct cache_type      *c,      /* cache                    */
+    const char             *src,    /* source buffer            */
+    uint                    len,    /* length of the source     */
+    int                     fd,     /* file or pipe to write    */
+    const struct compile_options_type
+                           *opts,   /* options                  */
+    const char             *state,  /* form state, or NULL      */
+    struct compile_result_type
+                           *result  /* outcome                  */
+);
+
+uint64 trim_cache
+(
+    struct cache_type      *c       /* cache                    */
+);
+
+void free_cache
+(
+    struct cache_type      *c       /* cache to free            */
+);
+
+const char *cache_error_str
+(
+    cache_error_t8          error   /* error code               */
+);
+
+#endif /* __CACHE_H__ */
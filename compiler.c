@@ -0,0 +1,358 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       compiler.c
+*
+*   DESCRIPTION:
+*       Compiles a source buffer to Gforth. The
+*       pipelined front end hands over batches
+*       of top-level forms, and each batch is
+*       checked, folded and emitted before the
+*       next is parsed, so memory use doesn't
+*       grow with the size of the program.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <string.h>
+
+#include "ast.h"
+#include "compiler.h"
+#include "emit.h"
+#include "fold.h"
+#include "jit.h"
+#include "parser.h"
+#include "pipeline.h"
+#include "stats.h"
+#include "typecheck.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __FNV_BASIS         14695981039346656037ull
+                                        /* FNV-1a 64-bit offset basis       */
+#define __FNV_PRIME         1099511628211ull
+                                        /* FNV-1a 64-bit prime              */
+
+/*-------------------------------------
+What a build stamps into everything it
+saves, so a rebuilt compiler never
+reuses the output of an older one
+-------------------------------------*/
+#define __BUILD_ID          COMPILER_VERSION " " __DATE__ " " __TIME__
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+State of one compilation, shared by
+the batches of forms
+-------------------------------------*/
+struct __compiler_type
+{
+    const struct compile_options_type
+                           *opts;       /* options                  */
+    struct type_info_type   ti;         /* types and bindings       */
+    struct emit_type        emitter;    /* code emitter             */
+    uint                    num_folded; /* lists folded             */
+};
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static boolean __compile_batch
+(
+    void                   *user,   /* compiler                 */
+    struct ast_type        *forms   /* batch of forms           */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __compile_batch - "Compile Batch"
+*
+*   DESCRIPTION:
+*       The pipeline's sink: checks, folds and
+*       emits a batch of forms.
+*
+*   RETURNS:
+*       Returns FALSE to stop at the first
+*       error.
+*
+**************************************************/
+static boolean __compile_batch
+(
+    void                   *user,   /* compiler                 */
+    struct ast_type        *forms   /* batch of forms           */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __compiler_type *c;      /* compiler                 */
+    struct stats_clock_type clock;  /* times a phase            */
+    boolean                 ok;     /* checked?                 */
+
+    c = (struct __compiler_type *)user;
+    stats_start( c->opts->stats, STATS_CHECK, &clock );
+    ok = ( TYPE_NO_ERROR == check_types( &c->ti, forms ) );
+    stats_stop( c->opts->stats, STATS_CHECK, &clock );
+    if( !ok )
+    {
+        return( FALSE );
+    }
+
+    if( c->opts->fold )
+    {
+        stats_start( c->opts->stats, STATS_OPTIMIZE, &clock );
+        c->num_folded += fold_constants( forms, &c->ti );
+        stats_stop( c->opts->stats, STATS_OPTIMIZE, &clock );
+    }
+
+    stats_start( c->opts->stats, STATS_EMIT, &clock );
+    ok = ( EMIT_NO_ERROR == emit_forms( &c->emitter, forms, &c->ti ) );
+    stats_stop( c->opts->stats, STATS_EMIT, &clock );
+
+    return( ok );
+
+}   /* __compile_batch() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_compile_options - "Initialize
+*                               Compile Options"
+*
+*   DESCRIPTION:
+*       Sets the default options: a single
+*       thread, with constants folded and
+*       the peephole optimizer on. Loops run
+*       in-process are compiled once hot, and
+*       runs aren't profiled. No statistics
+*       are kept.
+*
+**************************************************/
+void init_compile_options
+(
+    struct compile_options_type
+                           *opts    /* options to default       */
+)
+{
+    memset( opts, 0, sizeof( *opts ) );
+    opts->threaded  = FALSE;
+    opts->fold      = TRUE;
+    opts->peephole  = TRUE;
+    opts->jit_trips = JIT_TRIPS;
+    opts->profile   = NULL;
+    opts->stats     = NULL;
+
+}   /* init_compile_options() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       compile_buffer - "Compile Buffer"
+*
+*   DESCRIPTION:
+*       Compiles a program to Gforth, written
+*       to a file or pipe as it is generated.
+*       The symbol table must be initialized.
+*
+*   ERRORS:
+*       * Sets COMPILE_PARSE_ERROR or
+*         COMPILE_TYPE_ERROR, with the error's
+*         source offset, if the program is
+*         wrong. Code for the forms before the
+*         error may already have been written.
+*       * Sets COMPILE_NO_MEMORY,
+*         COMPILE_NO_THREAD or
+*         COMPILE_WRITE_ERROR otherwise.
+*
+*   NOTES:
+*       * Each phase is timed if there are
+*         statistics to add to.
+*
+**************************************************/
+void compile_buffer
+(
+    const char             *src,    /* source buffer            */
+    uint                    len,    /* length of the source     */
+    int                     fd,     /* file or pipe to write    */
+    const struct compile_options_type
+                           *opts,   /* options                  */
+    struct compile_result_type
+                           *result  /* outcome                  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __compiler_type  c;      /* compiler                 */
+    struct pipe_result_type pr;     /* front end's outcome      */
+    struct stats_clock_type clock;  /* times the emitter        */
+
+    memset( result, 0, sizeof( *result ) );
+    memset( &c, 0, sizeof( c ) );
+    c.opts = opts;
+    if( ( TYPE_NO_ERROR != init_type_info( &c.ti ) )
+     || ( EMIT_NO_ERROR != init_emitter( &c.emitter, fd, opts->peephole ) ) )
+    {
+        free_type_info( &c.ti );
+        result->error   = COMPILE_NO_MEMORY;
+        result->message = compile_error_str( COMPILE_NO_MEMORY );
+        return;
+    }
+
+    stats_start( opts->stats, STATS_EMIT, &clock );
+    emit_prelude( &c.emitter );
+    stats_stop( opts->stats, STATS_EMIT, &clock );
+    run_pipeline( src, len, __compile_batch, &c, opts->threaded, opts->stats, &pr );
+    stats_start( opts->stats, STATS_EMIT, &clock );
+    flush_emitter( &c.emitter );
+    stats_stop( opts->stats, STATS_EMIT, &clock );
+
+    /*---------------------------------
+    Report the first failure
+    ---------------------------------*/
+    if( PIPE_PARSE_ERROR == pr.error )
+    {
+        result->error        = COMPILE_PARSE_ERROR;
+        result->message      = parse_error_str( pr.parse_error );
+        result->error_offset = pr.error_offset;
+    }
+    else if( PIPE_NO_MEMORY == pr.error )
+    {
+        result->error = COMPILE_NO_MEMORY;
+    }
+    else if( PIPE_NO_THREAD == pr.error )
+    {
+        result->error = COMPILE_NO_THREAD;
+    }
+    else if( TYPE_NO_MEMORY == c.ti.error )
+    {
+        result->error = COMPILE_NO_MEMORY;
+    }
+    else if( TYPE_NO_ERROR != c.ti.error )
+    {
+        result->error        = COMPILE_TYPE_ERROR;
+        result->message      = type_error_str( c.ti.error );
+        result->error_offset = c.ti.error_offset;
+    }
+    else if( EMIT_NO_MEMORY == c.emitter.error )
+    {
+        result->error = COMPILE_NO_MEMORY;
+    }
+    else if( EMIT_NO_ERROR != c.emitter.error )
+    {
+        result->error = COMPILE_WRITE_ERROR;
+    }
+
+    if( NULL == result->message )
+    {
+        result->message = compile_error_str( result->error );
+    }
+    result->num_forms  = pr.num_forms;
+    result->num_folded = c.num_folded;
+    result->bytes_out  = c.emitter.bytes_out;
+    memcpy( result->peep_counts, c.emitter.peep.counts, sizeof( result->peep_counts ) );
+
+    free_emitter( &c.emitter );
+    free_type_info( &c.ti );
+
+}   /* compile_buffer() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       compile_stamp - "Compile Stamp"
+*
+*   DESCRIPTION:
+*       Hashes the build and the options that
+*       change the generated code. Output saved
+*       under one stamp is only reused under
+*       the same stamp.
+*
+**************************************************/
+uint64 compile_stamp
+(
+    const struct compile_options_type
+                           *opts    /* options                  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    static const char   build[] = __BUILD_ID;
+                                    /* build stamp              */
+    uint64              stamp;      /* hash so far              */
+    uint                i;          /* for-loop iterator        */
+
+    stamp = __FNV_BASIS;
+    for( i = 0; i < sizeof( build ); ++i )
+    {
+        stamp = ( stamp ^ (uint8)build[ i ] ) * __FNV_PRIME;
+    }
+    stamp = ( stamp ^ opts->fold )     * __FNV_PRIME;
+    stamp = ( stamp ^ opts->peephole ) * __FNV_PRIME;
+
+    return( stamp );
+
+}   /* compile_stamp() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       compile_error_str - "Compile Error String"
+*
+*   DESCRIPTION:
+*       Describes a compiler error code.
+*
+**************************************************/
+const char *compile_error_str
+(
+    compile_error_t8        error   /* error code               */
+)
+{
+    switch( error )
+    {
+        case COMPILE_NO_ERROR:
+            return( "no error" );
+
+        case COMPILE_NO_MEMORY:
+            return( "out of memory" );
+
+        case COMPILE_NO_THREAD:
+            return( "unable to start a thread" );
+
+        case COMPILE_PARSE_ERROR:
+            return( "syntax error" );
+
+        case COMPILE_TYPE_ERROR:
+            return( "type error" );
+
+        case COMPILE_WRITE_ERROR:
+            return( "unable to write the output" );
+
+        case COMPILE_RUN_ERROR:
+            return( "run-time error" );
+
+        default:
+            return( "unknown error" );
+    }
+
+}   /* compile_error_str() */
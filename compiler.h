@@ -0,0 +1,119 @@
+/**************************************************
+*
+*   NAME:
+*       compiler.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       compiling a source buffer to Gforth
+*
+**************************************************/
+
+#ifndef __COMPILER_H__
+#define __COMPILER_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "peephole.h"
+#include "stats.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define COMPILER_VERSION    "1.1"   /* bumped when the generated code   */
+                                    /*  changes                         */
+
+/*-------------------------------------
+Error types
+-------------------------------------*/
+typedef sint8 compile_error_t8;
+enum
+{
+    COMPILE_NO_ERROR      =  0,     /* no error                         */
+    COMPILE_NO_MEMORY     = -1,     /* out of memory                    */
+    COMPILE_NO_THREAD     = -2,     /* a stage thread couldn't start    */
+    COMPILE_PARSE_ERROR   = -3,     /* the source didn't parse          */
+    COMPILE_TYPE_ERROR    = -4,     /* the source didn't type check     */
+    COMPILE_WRITE_ERROR   = -5,     /* the output couldn't be written   */
+    COMPILE_RUN_ERROR     = -6      /* a program run in-process failed  */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+Compiler options. An option that
+changes the generated code must also
+go into compile_stamp(), which keys
+cached output and saved forms.
+-------------------------------------*/
+struct compile_options_type
+{
+    boolean             threaded;       /* a thread per front stage?    */
+    boolean             fold;           /* fold constants?              */
+    boolean             peephole;       /* rewrite the emitted words?   */
+    uint                jit_trips;      /* trips before a loop run      */
+                                        /*  in-process is compiled,     */
+                                        /*  0 for never                 */
+    const char         *profile;        /* file a run in-process writes */
+                                        /*  its profile to, or NULL     */
+    struct stats_type  *stats;          /* phase statistics to add to,  */
+                                        /*  or NULL                     */
+};
+
+/*-------------------------------------
+Outcome of a compilation
+-------------------------------------*/
+struct compile_result_type
+{
+    compile_error_t8    error;          /* error code                   */
+    const char         *message;        /* what went wrong              */
+    uint                error_offset;   /* offset of a source error     */
+    uint                num_forms;      /* top-level forms compiled     */
+    uint                num_reused;     /* forms whose earlier output   */
+                                        /*  was reused                  */
+    uint                num_folded;     /* lists folded                 */
+    uint64              bytes_out;      /* bytes of Gforth written      */
+    uint64              dispatches;     /* opcodes run in-process       */
+    uint                jit_loops;      /* loops compiled in-process    */
+    uint64              peep_counts[ PEEP_NUM_RULES ];
+                                        /* peephole rewrites by rule    */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+void init_compile_options
+(
+    struct compile_options_type
+                           *opts    /* options to default       */
+);
+
+void compile_buffer
+(
+    const char             *src,    /* source buffer            */
+    uint                    len,    /* length of the source     */
+    int                     fd,     /* file or pipe to write    */
+    const struct compile_options_type
+                           *opts,   /* options                  */
+    struct compile_result_type
+                           *result  /* outcome                  */
+);
+
+uint64 compile_stamp
+(
+    const struct compile_options_type
+                           *opts    /* options                  */
+);
+
+const char *compile_error_str
+(
+    compile_error_t8        error   /* error code               */
+);
+
+#endif /* __COMPILER_H__ */
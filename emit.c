@@ -0,0 +1,2121 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       emit.c
+*
+*   DESCRIPTION:
+*       Generates Gforth source from checked
+*       (and possibly folded) trees. Operators
+*       are spelled by the out_str fields of the
+*       keyword table for ints, and by the
+*       tables below for reals and strings.
+*
+*       Every top-level form is compiled as an
+*       anonymous word and run at once, since
+*       if and while only work inside a
+*       definition:
+*
+*           :noname <postfix code> ; execute
+*
+*       Variables are declared before the first
+*       form of the batch that binds them, or,
+*       when forms are emitted one at a time,
+*       right before the form that binds them.
+*       A string literal whose text is used
+*       more than once in a form is made a
+*       2constant, declared right before the
+*       form, and pushed by name. The pool is
+*       per form, so a form's output still
+*       depends only on the form.
+*
+*       Words can be passed through the
+*       peephole optimizer in peephole.c on
+*       their way out.
+*
+*       Nothing is formatted per token: words,
+*       names and lexemes are appended as
+*       (pointer, length) slices and flushed
+*       with writev(). The only numbers that
+*       have to be formatted are folded
+*       constants, which have no lexeme.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "ast.h"
+#include "emit.h"
+#include "hash.h"
+#include "peephole.h"
+#include "stats.h"
+#include "symbol_table.h"
+#include "tokens.h"
+#include "typecheck.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __INITIAL_STACK     64      /* first size of the stack          */
+#define __MAX_NUMBER_LEN    32      /* longest formatted constant       */
+#define __MIN_POOL          64      /* fewest slots in the string pool  */
+#define __MAX_UNROLL        4       /* highest int power multiplied out */
+#define __MAX_SHIFT         62      /* highest power of 2 shifted by    */
+#define __NO_SHIFT          ( -1 )  /* operand isn't a power of 2       */
+
+/*-------------------------------------
+What has to follow the code of an
+element
+-------------------------------------*/
+typedef uint8 __after_t8;
+enum
+{
+    __AFTER_NONE = 0,               /* the value is used as it is       */
+    __AFTER_TO_REAL,                /* an int is used as a real         */
+    __AFTER_DROP                    /* the value isn't used             */
+};
+
+/*-------------------------------------
+What an open list is
+-------------------------------------*/
+typedef uint8 __list_kind_t8;
+enum
+{
+    __LIST_SEQUENCE = 0,            /* [[...] ...]                      */
+    __LIST_BINARY,                  /* [opp a b]                        */
+    __LIST_UNARY,                   /* [opp a]                          */
+    __LIST_ASSIGN,                  /* [:= x v]                         */
+    __LIST_IF,                      /* [if c t e?]                      */
+    __LIST_WHILE,                   /* [while c body...]                */
+    __LIST_STDOUT                   /* [stdout e]                       */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A slot of the string pool: the text of
+the form's string literals, and how
+often each is used
+-------------------------------------*/
+struct __emit_pool_type
+{
+    uint                node;       /* first literal with the text, */
+                                    /*  or AST_NO_NODE              */
+    uint                uses;       /* literals with the text       */
+    uint                id;         /* number of its constant, or 0 */
+};
+
+/*-------------------------------------
+A list whose code is being emitted
+-------------------------------------*/
+struct __emit_frame_type
+{
+    uint                list;       /* list node                */
+    uint                next;       /* next element to emit     */
+    __list_kind_t8      kind;       /* kind of list             */
+    uint8               step;       /* how far it has got       */
+    __after_t8          after;      /* what follows its code    */
+};
+
+/*-------------------------------------------------
+                VARIABLE CONSTANTS
+-------------------------------------------------*/
+
+/*-------------------------------------
+Definitions the generated code relies
+on. Integer "/" and "%" floor, as
+eval.c does, whatever Gforth's own
+"/" and "mod" do, and i** squares its
+way up as eval.c does, in time
+logarithmic in the exponent. The last
+string made by s+ has room after it,
+and a join onto its end fills that room
+instead of copying the string, so a
+string built piece by piece takes
+linear time and memory. No string
+points past its own end, so nothing
+else sees the room.
+-------------------------------------*/
+static const char __prelude[] =
+    "\\ generated by the IBTL compiler\n"
+    "warnings off\n"
+    ": i/ ( n1 n2 -- n ) >r s>d r> fm/mod nip ;\n"
+    ": imod ( n1 n2 -- n ) >r s>d r> fm/mod drop ;\n"
+    ": i** { b e -- n } 1 begin e 0> while e 1 and if b * then b b * to b e 1 rshift to e repeat ;\n"
+    ": i<= ( n1 n2 -- f ) > 0= ;\n"
+    ": i>= ( n1 n2 -- f ) < 0= ;\n"
+    ": .bool ( f -- ) if .\" true \" else .\" false \" then ;\n"
+    "variable s-end 0 s-end !\n"
+    "variable s-room 0 s-room !\n"
+    ": s-room? ( a1 u1 u2 -- f ) >r + s-end @ = r> s-room @ <= and ;\n"
+    ": s-copy { a1 u1 u2 -- a u1 } u1 u2 + 2* 16 max { n } n allocate throw { a }\n"
+    "    a1 a u1 move a u1 + s-end ! n u1 - s-room ! a u1 ;\n"
+    ": s+ { a1 u1 a2 u2 -- a u } a1 u1 u2 s-room? if a1 u1 else a1 u1 u2 s-copy then\n"
+    "    a2 s-end @ u2 move u2 s-end +! u2 negate s-room +! u2 + ;\n"
+    ": str= ( a1 u1 a2 u2 -- f ) compare 0= ;\n"
+    ": str<> ( a1 u1 a2 u2 -- f ) compare 0<> ;\n"
+    ": str< ( a1 u1 a2 u2 -- f ) compare 0< ;\n"
+    ": str> ( a1 u1 a2 u2 -- f ) compare 0> ;\n"
+    ": str<= ( a1 u1 a2 u2 -- f ) compare 1 < ;\n"
+    ": str>= ( a1 u1 a2 u2 -- f ) compare -1 > ;\n";
+
+/*-------------------------------------
+Binary operators on reals and on
+strings, by operator. NULL where the
+type has no such operator.
+-------------------------------------*/
+static const char * const __real_words[ TOK_NUM_BIN_OPPS ] =
+{
+    "f+",       /* TOK_ADD_OPP  */
+    "f-",       /* TOK_SUB_OPP  */
+    "f*",       /* TOK_MUL_OPP  */
+    "f/",       /* TOK_DIV_OPP  */
+    NULL,       /* TOK_MOD_OPP  */
+    NULL,       /* TOK_AND_OPP  */
+    NULL,       /* TOK_OR_OPP   */
+    "f**",      /* TOK_EXP_OPP  */
+    "f=",       /* TOK_EQ_OPP   */
+    "f<",       /* TOK_LT_OPP   */
+    "f>",       /* TOK_GT_OPP   */
+    "f<=",      /* TOK_LE_OPP   */
+    "f>=",      /* TOK_GE_OPP   */
+    "f<>",      /* TOK_NE_OPP   */
+    "f!"        /* TOK_ASSN_OPP */
+};
+
+static const char * const __string_words[ TOK_NUM_BIN_OPPS ] =
+{
+    "s+",       /* TOK_ADD_OPP  */
+    NULL,       /* TOK_SUB_OPP  */
+    NULL,       /* TOK_MUL_OPP  */
+    NULL,       /* TOK_DIV_OPP  */
+    NULL,       /* TOK_MOD_OPP  */
+    NULL,       /* TOK_AND_OPP  */
+    NULL,       /* TOK_OR_OPP   */
+    NULL,       /* TOK_EXP_OPP  */
+    "str=",     /* TOK_EQ_OPP   */
+    "str<",     /* TOK_LT_OPP   */
+    "str>",     /* TOK_GT_OPP   */
+    "str<=",    /* TOK_LE_OPP   */
+    "str>=",    /* TOK_GE_OPP   */
+    "str<>",    /* TOK_NE_OPP   */
+    "2!"        /* TOK_ASSN_OPP */
+};
+
+/*-------------------------------------
+Words that depend only on the type of
+a value, by type class
+-------------------------------------*/
+static const char * const __declare_words[ TOK_NUM_TYPES ] =
+    { "variable", "fvariable", "2variable", "variable" };
+
+static const char * const __zero_words[ TOK_NUM_TYPES ] =
+    { "0", "0e", "0 0", "0" };
+
+static const char * const __fetch_words[ TOK_NUM_TYPES ] =
+    { "@", "f@", "2@", "@" };
+
+static const char * const __store_words[ TOK_NUM_TYPES ] =
+    { "!", "f!", "2!", "!" };
+
+static const char * const __drop_words[ TOK_NUM_TYPES ] =
+    { "drop", "fdrop", "2drop", "drop" };
+
+static const char * const __print_words[ TOK_NUM_TYPES ] =
+    { NULL, "f.", "type", ".bool" };
+
+static const peep_class_t8 __literal_classes[ TOK_NUM_TYPES ] =
+    { PEEP_CONST, PEEP_REAL, PEEP_STRING, PEEP_CONST };
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static void __put
+(
+    struct emit_type       *e,      /* emitter                  */
+    const char             *str,    /* text                     */
+    uint                    len     /* its length               */
+);
+
+static void __separate
+(
+    struct emit_type       *e,      /* emitter                  */
+    uint                    len     /* length of the next word  */
+);
+
+static void __write_word
+(
+    struct emit_type       *e,      /* emitter                  */
+    const char             *str,    /* word                     */
+    uint                    len,    /* its length               */
+    peep_class_t8           cls     /* what it is               */
+);
+
+static void __put_word
+(
+    struct emit_type       *e,      /* emitter                  */
+    const char             *str,    /* word                     */
+    uint                    len,    /* its length               */
+    peep_class_t8           cls     /* what it is               */
+);
+
+static void __put_cstr
+(
+    struct emit_type       *e,      /* emitter                  */
+    const char             *str     /* word                     */
+);
+
+static void __break_line
+(
+    struct emit_type       *e       /* emitter                  */
+);
+
+static void __newline
+(
+    struct emit_type       *e       /* emitter                  */
+);
+
+static void __word_of
+(
+    struct emit_word_type  *word,   /* word to set              */
+    token_class_t8          token_class,
+                                    /* keyword's token class    */
+    uint8                   subclass/* keyword's subclass       */
+);
+
+static void __emit_real
+(
+    struct emit_type       *e,      /* emitter                  */
+    double                  val     /* real                     */
+);
+
+static void __emit_int
+(
+    struct emit_type       *e,      /* emitter                  */
+    sint64                  val     /* int                      */
+);
+
+static void __emit_constant
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_node_type
+                           *leaf    /* folded constant          */
+);
+
+static uint __small_power
+(
+    const struct ast_node_type
+                           *node,   /* exponent                 */
+    type_class_t8           type    /* type of the power        */
+);
+
+static sint __shift_of
+(
+    const struct ast_node_type
+                           *node,   /* int operand              */
+    boolean                 mask    /* for a mask, 1 included?  */
+);
+
+static void __emit_power
+(
+    struct emit_type       *e,      /* emitter                  */
+    uint                    n,      /* exponent                 */
+    boolean                 real    /* of a real?               */
+);
+
+static void __emit_shift
+(
+    struct emit_type       *e,      /* emitter                  */
+    uint8                   opp,    /* *, / or %                */
+    sint                    shift   /* log 2 of the operand     */
+);
+
+static void __write_string
+(
+    struct emit_type       *e,      /* emitter                  */
+    const char             *lexeme, /* literal, with quotes     */
+    uint                    len     /* length of the lexeme     */
+);
+
+static struct __emit_pool_type *__find_string
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* tree                     */
+    uint                    node    /* string literal           */
+);
+
+static void __pool_strings
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* tree                     */
+    uint                    form    /* top-level form           */
+);
+
+static void __emit_leaf
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct type_info_type
+                           *ti,     /* its types                */
+    uint                    node    /* leaf                     */
+);
+
+static void __emit_after
+(
+    struct emit_type       *e,      /* emitter                  */
+    type_class_t8           type,   /* type of the element      */
+    __after_t8              after   /* what follows it          */
+);
+
+static void __emit_element
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct type_info_type
+                           *ti,     /* its types                */
+    uint                   *depth,  /* open lists               */
+    uint                    node,   /* element                  */
+    __after_t8              after   /* what follows it          */
+);
+
+static void __emit_form
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct type_info_type
+                           *ti,     /* its types                */
+    uint                    form    /* top-level form           */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put - "Put"
+*
+*   DESCRIPTION:
+*       Appends text to the output. A short
+*       slice is copied into scratch and joins
+*       the slice before it if that is in
+*       scratch too; a long one is pointed to.
+*       Flushes first if either buffer is full.
+*
+**************************************************/
+static void __put
+(
+    struct emit_type       *e,      /* emitter                  */
+    const char             *str,    /* text                     */
+    uint                    len     /* its length               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct iovec   *slice;          /* slice being added to     */
+
+    if( 0 == len )
+    {
+        return;
+    }
+
+    e->bytes_put += len;
+    if( len <= EMIT_COPY_MAX )
+    {
+        if( ( e->scratch_len + len > EMIT_SCRATCH_SIZE )
+         || ( ( EMIT_MAX_SLICES == e->num_slices ) && !e->last_copied ) )
+        {
+            flush_emitter( e );
+        }
+
+        memcpy( &e->scratch[ e->scratch_len ], str, len );
+        if( e->last_copied )
+        {
+            e->slices[ e->num_slices - 1 ].iov_len += len;
+        }
+        else
+        {
+            slice           = &e->slices[ e->num_slices++ ];
+            slice->iov_base = &e->scratch[ e->scratch_len ];
+            slice->iov_len  = len;
+            e->last_copied  = TRUE;
+        }
+        e->scratch_len += len;
+        return;
+    }
+
+    if( EMIT_MAX_SLICES == e->num_slices )
+    {
+        flush_emitter( e );
+    }
+
+    slice           = &e->slices[ e->num_slices++ ];
+    slice->iov_base = (void *)str;
+    slice->iov_len  = len;
+    e->last_copied  = FALSE;
+
+}   /* __put() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __separate - "Separate"
+*
+*   DESCRIPTION:
+*       Puts a space before the next word, or
+*       breaks the line if the word would run
+*       past EMIT_LINE_WIDTH.
+*
+**************************************************/
+static void __separate
+(
+    struct emit_type       *e,      /* emitter                  */
+    uint                    len     /* length of the next word  */
+)
+{
+    if( 0 == e->col )
+    {
+        return;
+    }
+
+    if( e->col + 1 + len > EMIT_LINE_WIDTH )
+    {
+        __break_line( e );
+    }
+    else
+    {
+        __put( e, " ", 1 );
+        ++e->col;
+    }
+
+}   /* __separate() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __write_word - "Write Word"
+*
+*   DESCRIPTION:
+*       Appends a word to the output, separated
+*       from the one before it. A string
+*       literal is written as Gforth code, and
+*       a real literal gets the exponent Gforth
+*       needs if its lexeme has none.
+*
+**************************************************/
+static void __write_word
+(
+    struct emit_type       *e,      /* emitter                  */
+    const char             *str,    /* word                     */
+    uint                    len,    /* its length               */
+    peep_class_t8           cls     /* what it is               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const char *suffix;         /* exponent a real lacks    */
+    uint        suffix_len;     /* its length               */
+
+    if( PEEP_STRING == cls )
+    {
+        __write_string( e, str, len );
+        return;
+    }
+
+    suffix     = "";
+    suffix_len = 0;
+    if( ( PEEP_REAL == cls )
+     && ( NULL == memchr( str, 'e', len ) )
+     && ( NULL == memchr( str, 'E', len ) ) )
+    {
+        suffix     = ( '.' == str[ len - 1 ] ) ? "0e" : "e";
+        suffix_len = (uint)strlen( suffix );
+    }
+
+    __separate( e, len + suffix_len );
+    __put( e, str, len );
+    __put( e, suffix, suffix_len );
+    e->col += len + suffix_len;
+
+}   /* __write_word() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_word - "Put Word"
+*
+*   DESCRIPTION:
+*       Emits a word. With the peephole
+*       optimizer on, it goes through the
+*       optimizer's window, and is written once
+*       PEEP_WINDOW newer words have followed
+*       it. Empty words are skipped.
+*
+**************************************************/
+static void __put_word
+(
+    struct emit_type       *e,      /* emitter                  */
+    const char             *str,    /* word                     */
+    uint                    len,    /* its length               */
+    peep_class_t8           cls     /* what it is               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct peep_word_type
+               *oldest;         /* word leaving the window  */
+
+    if( 0 == len )
+    {
+        return;
+    }
+
+    if( !e->peephole )
+    {
+        __write_word( e, str, len, cls );
+        return;
+    }
+
+    if( PEEP_WINDOW == e->peep.count )
+    {
+        oldest = peep_oldest( &e->peep );
+        __write_word( e, oldest->str, oldest->len, oldest->cls );
+        peep_pop_oldest( &e->peep );
+    }
+    peep_push( &e->peep, str, len, cls );
+
+}   /* __put_word() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_cstr - "Put C String"
+*
+*   DESCRIPTION:
+*       Appends a word from one of the word
+*       tables.
+*
+**************************************************/
+static void __put_cstr
+(
+    struct emit_type       *e,      /* emitter                  */
+    const char             *str     /* word                     */
+)
+{
+    __put_word( e, str, (uint)strlen( str ), PEEP_PLAIN );
+
+}   /* __put_cstr() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __break_line - "Break Line"
+*
+*   DESCRIPTION:
+*       Ends the current line of output.
+*
+**************************************************/
+static void __break_line
+(
+    struct emit_type       *e       /* emitter                  */
+)
+{
+    __put( e, "\n", 1 );
+    e->col = 0;
+
+}   /* __break_line() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __newline - "Newline"
+*
+*   DESCRIPTION:
+*       Ends a declaration or a form. No rule
+*       applies across the end, so the words
+*       the optimizer holds back are written
+*       first.
+*
+**************************************************/
+static void __newline
+(
+    struct emit_type       *e       /* emitter                  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct peep_word_type
+               *oldest;         /* word leaving the window  */
+
+    while( e->peep.count > 0 )
+    {
+        oldest = peep_oldest( &e->peep );
+        __write_word( e, oldest->str, oldest->len, oldest->cls );
+        peep_pop_oldest( &e->peep );
+    }
+
+    __break_line( e );
+
+}   /* __newline() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __word_of - "Word Of"
+*
+*   DESCRIPTION:
+*       Takes a word from the out_str of a
+*       keyword.
+*
+**************************************************/
+static void __word_of
+(
+    struct emit_word_type  *word,   /* word to set              */
+    token_class_t8          token_class,
+                                    /* keyword's token class    */
+    uint8                   subclass/* keyword's subclass       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct token_type    *tok;    /* keyword              */
+
+    word->str = "";
+    tok = get_keyword_class_data( token_class, subclass );
+    if( NULL != tok )
+    {
+        word->str = ( TOK_RESERVED_WORD == token_class ) ? tok->res_word.out_str : tok->opp.out_str;
+    }
+    word->len = (uint)strlen( word->str );
+
+}   /* __word_of() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __emit_real - "Emit Real"
+*
+*   DESCRIPTION:
+*       Emits a real literal with the shortest
+*       of 15 or 17 digits that reads back
+*       exactly, and always an exponent, which
+*       is how Gforth tells a float from a
+*       double-cell integer.
+*
+**************************************************/
+static void __emit_real
+(
+    struct emit_type       *e,      /* emitter                  */
+    double                  val     /* real                     */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char        buf[ __MAX_NUMBER_LEN ];    /* formatted value      */
+    int         len;                        /* its length           */
+
+    len = snprintf( buf, sizeof( buf ), "%.15g", val );
+    if( strtod( buf, NULL ) != val )
+    {
+        len = snprintf( buf, sizeof( buf ), "%.17g", val );
+    }
+
+    if( NULL == memchr( buf, 'e', len ) )
+    {
+        buf[ len++ ] = 'e';
+    }
+    __put_word( e, buf, (uint)len, PEEP_REAL );
+
+}   /* __emit_real() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __emit_int - "Emit Int"
+*
+*   DESCRIPTION:
+*       Emits an int literal, formatted
+*       backwards from the end of the buffer.
+*
+**************************************************/
+static void __emit_int
+(
+    struct emit_type       *e,      /* emitter                  */
+    sint64                  val     /* int                      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char        buf[ __MAX_NUMBER_LEN ];    /* formatted value      */
+    char       *p;                          /* digit being written  */
+    uint64      mag;                        /* magnitude            */
+
+    mag = ( val < 0 ) ? 0 - (uint64)val : (uint64)val;
+    p   = &buf[ sizeof( buf ) ];
+    do
+    {
+        *--p = (char)( '0' + mag % 10 );
+        mag /= 10;
+    } while( 0 != mag );
+
+    if( val < 0 )
+    {
+        *--p = '-';
+    }
+    __put_word( e, p, (uint)( &buf[ sizeof( buf ) ] - p ), PEEP_CONST );
+
+}   /* __emit_int() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __emit_constant - "Emit Constant"
+*
+*   DESCRIPTION:
+*       Emits a folded numeric constant.
+*
+**************************************************/
+static void __emit_constant
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_node_type
+                           *leaf    /* folded constant          */
+)
+{
+    if( TOK_REAL_TYPE == leaf->subclass )
+    {
+        __emit_real( e, leaf->val.real_val );
+    }
+    else
+    {
+        __emit_int( e, leaf->val.int_val );
+    }
+
+}   /* __emit_constant() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __small_power - "Small Power"
+*
+*   DESCRIPTION:
+*       Tells whether an exponent is a literal
+*       small enough to multiply the power
+*       out. An int's power is exact however
+*       it is multiplied, so ints go up to
+*       __MAX_UNROLL. Only the square of a real
+*       is rounded as f** rounds it, so reals
+*       go up to 2.
+*
+*   RETURNS:
+*       Returns the exponent, or 0 if the power
+*       is left to i** or f**.
+*
+**************************************************/
+static uint __small_power
+(
+    const struct ast_node_type
+                           *node,   /* exponent                 */
+    type_class_t8           type    /* type of the power        */
+)
+{
+    if( TOK_LITERAL != node->token_class )
+    {
+        return( 0 );
+    }
+
+    if( TOK_REAL_TYPE == type )
+    {
+        return( ( ( ( TOK_INT_TYPE == node->subclass ) && ( 2 == node->val.int_val ) )
+               || ( ( TOK_REAL_TYPE == node->subclass ) && ( 2.0 == node->val.real_val ) ) ) ? 2 : 0 );
+    }
+
+    return( ( ( TOK_INT_TYPE == type )
+           && ( TOK_INT_TYPE == node->subclass )
+           && ( node->val.int_val >= 2 )
+           && ( node->val.int_val <= __MAX_UNROLL ) ) ? (uint)node->val.int_val : 0 );
+
+}   /* __small_power() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __shift_of - "Shift Of"
+*
+*   DESCRIPTION:
+*       Tells whether an int operand is a
+*       literal power of 2, from 2 up to
+*       2^__MAX_SHIFT, or from 1 for the
+*       divisor of a "%", whose mask of 0
+*       is still worth making.
+*
+*   RETURNS:
+*       Returns its log 2, or __NO_SHIFT if it
+*       isn't one.
+*
+**************************************************/
+static sint __shift_of
+(
+    const struct ast_node_type
+                           *node,   /* int operand              */
+    boolean                 mask    /* for a mask, 1 included?  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    sint        shift;          /* log 2 of the literal     */
+
+    if( ( TOK_LITERAL != node->token_class )
+     || ( TOK_INT_TYPE != node->subclass )
+     || ( node->val.int_val < ( mask ? 1 : 2 ) )
+     || ( 0 != ( node->val.int_val & ( node->val.int_val - 1 ) ) ) )
+    {
+        return( __NO_SHIFT );
+    }
+
+    for( shift = 0; ( (sint64)1 << shift ) != node->val.int_val; ++shift );
+
+    return( ( shift <= __MAX_SHIFT ) ? shift : __NO_SHIFT );
+
+}   /* __shift_of() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __emit_power - "Emit Power"
+*
+*   DESCRIPTION:
+*       Multiplies out a small power of the
+*       value on the stack: a power of 2 by
+*       squaring it again and again, any other
+*       by multiplying copies of it.
+*
+**************************************************/
+static void __emit_power
+(
+    struct emit_type       *e,      /* emitter                  */
+    uint                    n,      /* exponent                 */
+    boolean                 real    /* of a real?               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        i;              /* multiplication           */
+
+    if( 0 == ( n & ( n - 1 ) ) )
+    {
+        for( ; n > 1; n /= 2 )
+        {
+            __put_cstr( e, real ? "fdup" : "dup" );
+            __put_cstr( e, real ? "f*" : "*" );
+        }
+        return;
+    }
+
+    for( i = 1; i < n; ++i )
+    {
+        __put_cstr( e, real ? "fdup" : "dup" );
+    }
+
+    for( i = 1; i < n; ++i )
+    {
+        __put_cstr( e, real ? "f*" : "*" );
+    }
+
+}   /* __emit_power() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __emit_shift - "Emit Shift"
+*
+*   DESCRIPTION:
+*       Emits an int *, / or % by a power of 2
+*       as a shift or a mask. "/" and "%"
+*       floor, and so do an arithmetic shift
+*       and a mask in two's complement.
+*
+**************************************************/
+static void __emit_shift
+(
+    struct emit_type       *e,      /* emitter                  */
+    uint8                   opp,    /* *, / or %                */
+    sint                    shift   /* log 2 of the operand     */
+)
+{
+    if( TOK_MOD_OPP == opp )
+    {
+        __emit_int( e, ( (sint64)1 << shift ) - 1 );
+        __put_cstr( e, "and" );
+    }
+    else
+    {
+        __emit_int( e, (sint64)shift );
+        __put_cstr( e, ( TOK_MUL_OPP == opp ) ? "lshift" : "arshift" );
+    }
+
+}   /* __emit_shift() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __write_string - "Write String"
+*
+*   DESCRIPTION:
+*       Writes a string literal. The text after
+*       the opening quote, closing quote
+*       included, is exactly what Gforth's s"
+*       parses, so it is pointed to rather than
+*       copied. s" can't span lines, so a
+*       literal with a line break is escaped
+*       and emitted with s\" instead.
+*
+**************************************************/
+static void __write_string
+(
+    struct emit_type       *e,      /* emitter                  */
+    const char             *lexeme, /* literal, with quotes     */
+    uint                    len     /* length of the lexeme     */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        i;              /* character of the text    */
+    uint        run;            /* start of unescaped text  */
+
+    if( ( NULL == memchr( lexeme, '\n', len ) )
+     && ( NULL == memchr( lexeme, '\r', len ) ) )
+    {
+        __separate( e, len + 2 );
+        __put( e, "s\" ", 3 );
+        __put( e, &lexeme[ 1 ], len - 1 );
+        e->col += len + 2;
+        return;
+    }
+
+    __separate( e, len + 3 );
+    __put( e, "s\\\" ", 4 );
+    run = 1;
+    for( i = 1; i < len - 1; ++i )
+    {
+        if( ( '\n' != lexeme[ i ] )
+         && ( '\r' != lexeme[ i ] )
+         && ( '\\' != lexeme[ i ] ) )
+        {
+            continue;
+        }
+
+        __put( e, &lexeme[ run ], i - run );
+        __put( e, ( '\n' == lexeme[ i ] ) ? "\\n" : ( '\r' == lexeme[ i ] ) ? "\\r" : "\\\\", 2 );
+        run = i + 1;
+    }
+    __put( e, &lexeme[ run ], len - run );
+    e->col += len + 3;
+
+}   /* __write_string() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __find_string - "Find String"
+*
+*   DESCRIPTION:
+*       Finds the pool slot for a string
+*       literal's text: the slot holding the
+*       first literal with the same lexeme, or
+*       the empty slot where it goes.
+*
+**************************************************/
+static struct __emit_pool_type *__find_string
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* tree                     */
+    uint                    node    /* string literal           */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *lit;    /* literal              */
+    const struct ast_node_type *other;  /* literal in a slot    */
+    struct __emit_pool_type    *slot;   /* slot probed          */
+    uint64                      h[ 2 ]; /* hash of the lexeme   */
+    uint                        i;      /* slot index           */
+
+    lit = &ast->nodes[ node ];
+    hash_bytes( &ast->src[ lit->offset ], lit->len, 0, h );
+    for( i = (uint)h[ 0 ] & ( e->pool_cap - 1 ); ; i = ( i + 1 ) & ( e->pool_cap - 1 ) )
+    {
+        slot = &e->pool[ i ];
+        if( AST_NO_NODE == slot->node )
+        {
+            return( slot );
+        }
+
+        other = &ast->nodes[ slot->node ];
+        if( ( other->len == lit->len )
+         && ( 0 == memcmp( &ast->src[ other->offset ], &ast->src[ lit->offset ], lit->len ) ) )
+        {
+            return( slot );
+        }
+    }
+
+}   /* __find_string() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __pool_strings - "Pool Strings"
+*
+*   DESCRIPTION:
+*       Gathers the string literals of a
+*       top-level form by text, and declares a
+*       2constant for each text used more than
+*       once, numbered in order of first use.
+*       Gforth keeps a string s" makes outside
+*       a definition, so the constant's text
+*       lives as long as the program.
+*
+*   ERRORS:
+*       * Sets EMIT_NO_MEMORY if the pool
+*         couldn't be grown.
+*
+**************************************************/
+static void __pool_strings
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* tree                     */
+    uint                    form    /* top-level form           */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *nodes;  /* node array           */
+    struct __emit_pool_type    *slot;   /* literal's slot       */
+    struct __emit_pool_type    *grown;  /* bigger pool          */
+    char        name[ __MAX_NUMBER_LEN ];
+                                        /* constant's name      */
+    uint        end;                    /* node after the form  */
+    uint        num;                    /* string literals      */
+    uint        cap;                    /* slots needed         */
+    uint        node;                   /* node of the form     */
+    int         len;                    /* length of the name   */
+
+    nodes = ast->nodes;
+    end   = ( AST_NO_NODE != nodes[ form ].next_sibling ) ? nodes[ form ].next_sibling : ast->num_nodes;
+    e->num_pooled = 0;
+
+    num = 0;
+    for( node = form; node < end; ++node )
+    {
+        if( ( TOK_LITERAL == nodes[ node ].token_class )
+         && ( TOK_STRING_TYPE == nodes[ node ].subclass ) )
+        {
+            ++num;
+        }
+    }
+
+    if( num < 2 )
+    {
+        return;
+    }
+
+    /*---------------------------------
+    Keep the pool at most half full
+    ---------------------------------*/
+    for( cap = __MIN_POOL; cap < 2 * num; cap *= 2 );
+    if( cap > e->pool_cap )
+    {
+        grown = (struct __emit_pool_type *)stats_realloc( e->pool, cap * sizeof( *e->pool ) );
+        if( NULL == grown )
+        {
+            e->error = EMIT_NO_MEMORY;
+            return;
+        }
+        e->pool     = grown;
+        e->pool_cap = cap;
+    }
+
+    for( node = 0; node < e->pool_cap; ++node )
+    {
+        e->pool[ node ].node = AST_NO_NODE;
+    }
+
+    for( node = form; node < end; ++node )
+    {
+        if( ( TOK_LITERAL != nodes[ node ].token_class )
+         || ( TOK_STRING_TYPE != nodes[ node ].subclass ) )
+        {
+            continue;
+        }
+
+        slot = __find_string( e, ast, node );
+        if( AST_NO_NODE == slot->node )
+        {
+            slot->node = node;
+            slot->uses = 0;
+            slot->id   = 0;
+        }
+        ++slot->uses;
+    }
+
+    /*---------------------------------
+    Declare the texts used again
+    ---------------------------------*/
+    for( node = form; node < end; ++node )
+    {
+        if( ( TOK_LITERAL != nodes[ node ].token_class )
+         || ( TOK_STRING_TYPE != nodes[ node ].subclass ) )
+        {
+            continue;
+        }
+
+        slot = __find_string( e, ast, node );
+        if( ( slot->uses < 2 )
+         || ( 0 != slot->id ) )
+        {
+            continue;
+        }
+
+        slot->id = ++e->num_pooled;
+        len      = snprintf( name, sizeof( name ), "str%u", slot->id );
+        __put_word( e, &ast->src[ nodes[ node ].offset ], nodes[ node ].len, PEEP_STRING );
+        __put_word( e, "2constant", 9, PEEP_PLAIN );
+        __put_word( e, name, (uint)len, PEEP_NAME );
+        __newline( e );
+    }
+
+}   /* __pool_strings() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __emit_leaf - "Emit Leaf"
+*
+*   DESCRIPTION:
+*       Emits the code that pushes a literal, a
+*       boolean constant or a variable's value.
+*       A pooled string is pushed by its
+*       constant.
+*
+**************************************************/
+static void __emit_leaf
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct type_info_type
+                           *ti,     /* its types                */
+    uint                    node    /* leaf                     */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *leaf;   /* leaf                 */
+    const struct binding_type  *b;      /* variable's binding   */
+    const char                 *lexeme; /* leaf's source text   */
+    struct __emit_pool_type    *slot;   /* pooled string        */
+    char        name[ __MAX_NUMBER_LEN ];
+                                        /* its constant's name  */
+    int         len;                    /* length of the name   */
+
+    leaf   = &ast->nodes[ node ];
+    lexeme = &ast->src[ leaf->offset ];
+    switch( leaf->token_class )
+    {
+        case TOK_LITERAL:
+            if( 0 == leaf->len )
+            {
+                __emit_constant( e, leaf );
+            }
+            else
+            {
+                slot = ( ( TOK_STRING_TYPE == leaf->subclass ) && ( e->num_pooled > 0 ) ) ? __find_string( e, ast, node ) : NULL;
+                if( ( NULL != slot )
+                 && ( 0 != slot->id ) )
+                {
+                    len = snprintf( name, sizeof( name ), "str%u", slot->id );
+                    __put_word( e, name, (uint)len, PEEP_NAME );
+                }
+                else
+                {
+                    __put_word( e, lexeme, leaf->len, __literal_classes[ leaf->subclass ] );
+                }
+            }
+            break;
+
+        case TOK_RESERVED_WORD:
+            if( TOK_TRUE == leaf->subclass )
+            {
+                __put_word( e, e->true_word.str, e->true_word.len, PEEP_CONST );
+            }
+            else if( TOK_FALSE == leaf->subclass )
+            {
+                __put_word( e, e->false_word.str, e->false_word.len, PEEP_CONST );
+            }
+            break;
+
+        case TOK_IDENT:
+            b = &ti->bindings[ ti->syms[ node ] ];
+            __put_word( e, b->out_name, b->out_len, PEEP_NAME );
+            __put_cstr( e, __fetch_words[ b->type ] );
+            break;
+
+        default:
+            break;
+    }
+
+}   /* __emit_leaf() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __emit_after - "Emit After"
+*
+*   DESCRIPTION:
+*       Converts an element's int value to a
+*       real, or drops a value that isn't used.
+*
+**************************************************/
+static void __emit_after
+(
+    struct emit_type       *e,      /* emitter                  */
+    type_class_t8           type,   /* type of the element      */
+    __after_t8              after   /* what follows it          */
+)
+{
+    if( type >= TOK_NUM_TYPES )
+    {
+        return;
+    }
+
+    if( ( __AFTER_TO_REAL == after )
+     && ( TOK_INT_TYPE == type ) )
+    {
+        __put_word( e, "s>f", 3, PEEP_PLAIN );
+    }
+    else if( __AFTER_DROP == after )
+    {
+        __put_cstr( e, __drop_words[ type ] );
+    }
+
+}   /* __emit_after() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __emit_element - "Emit Element"
+*
+*   DESCRIPTION:
+*       Emits a leaf at once, or opens a list:
+*       its code is emitted by __emit_form()
+*       as the list's frame is worked through.
+*       Lets and empty lists emit nothing. An
+*       int literal used as a real is emitted
+*       as a real literal, needing no s>f.
+*
+*   ERRORS:
+*       * Sets EMIT_NO_MEMORY if the stack
+*         couldn't be grown.
+*
+**************************************************/
+static void __emit_element
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct type_info_type
+                           *ti,     /* its types                */
+    uint                   *depth,  /* open lists               */
+    uint                    node,   /* element                  */
+    __after_t8              after   /* what follows it          */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *nodes;  /* node array           */
+    const struct ast_node_type *head;   /* list's first element */
+    struct __emit_frame_type   *frame;  /* new frame            */
+    struct __emit_frame_type   *stack;  /* grown stack          */
+    __list_kind_t8              kind;   /* kind of list         */
+
+    nodes = ast->nodes;
+    if( ( TOK_LITERAL == nodes[ node ].token_class )
+     && ( TOK_INT_TYPE == nodes[ node ].subclass )
+     && ( __AFTER_TO_REAL == after ) )
+    {
+        __emit_real( e, (double)nodes[ node ].val.int_val );
+        return;
+    }
+
+    if( TOK_LIST_TYPE != nodes[ node ].token_class )
+    {
+        __emit_leaf( e, ast, ti, node );
+        __emit_after( e, ti->types[ node ], after );
+        return;
+    }
+
+    if( AST_NO_NODE == nodes[ node ].first_child )
+    {
+        return;
+    }
+
+    head = &nodes[ nodes[ node ].first_child ];
+    switch( head->token_class )
+    {
+        case TOK_LIST_TYPE:
+            kind = __LIST_SEQUENCE;
+            break;
+
+        case TOK_BINARY_OPP:
+            kind = ( TOK_ASSN_OPP == head->subclass ) ? __LIST_ASSIGN : __LIST_BINARY;
+            break;
+
+        case TOK_UNARY_OPP:
+            kind = __LIST_UNARY;
+            break;
+
+        case TOK_RESERVED_WORD:
+            if( TOK_IF == head->subclass )
+            {
+                kind = __LIST_IF;
+            }
+            else if( TOK_WHILE == head->subclass )
+            {
+                kind = __LIST_WHILE;
+            }
+            else if( TOK_STDOUT == head->subclass )
+            {
+                kind = __LIST_STDOUT;
+            }
+            else
+            {
+                return;
+            }
+            break;
+
+        default:
+            return;
+    }
+
+    if( *depth == e->stack_cap )
+    {
+        stack = (struct __emit_frame_type *)stats_realloc( e->stack, 2 * e->stack_cap * sizeof( *stack ) );
+        if( NULL == stack )
+        {
+            e->error = EMIT_NO_MEMORY;
+            return;
+        }
+        e->stack      = stack;
+        e->stack_cap *= 2;
+    }
+
+    frame        = &e->stack[ ( *depth )++ ];
+    frame->list  = node;
+    frame->next  = ( __LIST_SEQUENCE == kind ) ? nodes[ node ].first_child : head->next_sibling;
+    frame->kind  = kind;
+    frame->step  = 0;
+    frame->after = after;
+
+}   /* __emit_element() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __emit_form - "Emit Form"
+*
+*   DESCRIPTION:
+*       Emits the postfix code of a top-level
+*       form. Lists are worked through on an
+*       explicit stack, a step at a time: each
+*       step emits a word or opens an element,
+*       and a list is closed once its last step
+*       is done. Nesting depth is limited only
+*       by memory.
+*
+*       Each operator gets the word for its
+*       operands' type. Operands of a real
+*       operation that are ints are converted
+*       where they are pushed, and only those.
+*       A small literal power is multiplied
+*       out rather than handed to i** or f**,
+*       and an int *, / or % by a literal power
+*       of 2 is made a shift or a mask, with
+*       the power on either side of a "*". An
+*       element whose value isn't used, such
+*       as a statement in a sequence or loop
+*       body, is dropped.
+*
+**************************************************/
+static void __emit_form
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct type_info_type
+                           *ti,     /* its types                */
+    uint                    form    /* top-level form           */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *nodes;      /* node array           */
+    const type_class_t8        *types;      /* node types           */
+    struct __emit_frame_type   *frame;      /* innermost open list  */
+    const struct binding_type  *b;          /* assigned variable    */
+    const char                 *word;       /* operator's word      */
+    type_class_t8               type;       /* operands' type       */
+    uint                        depth;      /* open lists           */
+    uint                        a;          /* first operand        */
+    uint                        c;          /* second operand       */
+    uint8                       opp;        /* operator             */
+    uint                        kept;       /* operand a power or   */
+                                            /*  shift applies to    */
+    uint                        power;      /* small power, or 0    */
+    sint                        shift;      /* log 2 of a power of  */
+                                            /*  2 operand, or       */
+                                            /*  __NO_SHIFT          */
+
+    nodes = ast->nodes;
+    types = ti->types;
+    depth = 0;
+    __emit_element( e, ast, ti, &depth, form, __AFTER_DROP );
+
+    while( ( depth > 0 )
+        && ( EMIT_NO_ERROR == e->error ) )
+    {
+        frame = &e->stack[ depth - 1 ];
+        a     = frame->next;
+        opp   = nodes[ nodes[ frame->list ].first_child ].subclass;
+        switch( frame->kind )
+        {
+            /*-------------------------
+            Every element is a statement
+            -------------------------*/
+            case __LIST_SEQUENCE:
+                if( AST_NO_NODE != a )
+                {
+                    frame->next = nodes[ a ].next_sibling;
+                    __emit_element( e, ast, ti, &depth, a, __AFTER_DROP );
+                    continue;
+                }
+                break;
+
+            /*-------------------------
+            a b opp
+            -------------------------*/
+            case __LIST_BINARY:
+                c     = nodes[ a ].next_sibling;
+                type  = ( ( TOK_REAL_TYPE == types[ a ] ) || ( TOK_REAL_TYPE == types[ c ] ) ) ? TOK_REAL_TYPE : types[ a ];
+                power = ( TOK_EXP_OPP == opp ) ? __small_power( &nodes[ c ], type ) : 0;
+                shift = __NO_SHIFT;
+                kept  = a;
+                if( ( TOK_INT_TYPE == type )
+                 && ( ( TOK_MUL_OPP == opp ) || ( TOK_DIV_OPP == opp ) || ( TOK_MOD_OPP == opp ) ) )
+                {
+                    shift = __shift_of( &nodes[ c ], TOK_MOD_OPP == opp );
+                    if( ( __NO_SHIFT == shift )
+                     && ( TOK_MUL_OPP == opp ) )
+                    {
+                        /*-------------
+                        * commutes, so
+                        a power of 2 on
+                        the left does
+                        as well
+                        -------------*/
+                        shift = __shift_of( &nodes[ a ], FALSE );
+                        kept  = ( __NO_SHIFT == shift ) ? a : c;
+                    }
+                }
+                if( frame->step < ( ( ( 0 != power ) || ( __NO_SHIFT != shift ) ) ? 1 : 2 ) )
+                {
+                    ++frame->step;
+                    __emit_element( e, ast, ti, &depth, ( 1 == frame->step ) ? kept : c,
+                                    ( TOK_REAL_TYPE == type ) ? __AFTER_TO_REAL : __AFTER_NONE );
+                    continue;
+                }
+
+                if( 0 != power )
+                {
+                    __emit_power( e, power, TOK_REAL_TYPE == type );
+                    break;
+                }
+
+                if( __NO_SHIFT != shift )
+                {
+                    __emit_shift( e, opp, shift );
+                    break;
+                }
+
+                if( TOK_REAL_TYPE == type )
+                {
+                    word = __real_words[ opp ];
+                }
+                else if( TOK_STRING_TYPE == type )
+                {
+                    word = __string_words[ opp ];
+                }
+                else
+                {
+                    word = e->bin_words[ opp ].str;
+                }
+                __put_cstr( e, ( NULL != word ) ? word : "" );
+                break;
+
+            /*-------------------------
+            a opp
+            -------------------------*/
+            case __LIST_UNARY:
+                if( 0 == frame->step++ )
+                {
+                    __emit_element( e, ast, ti, &depth, a,
+                                    ( TOK_REAL_TYPE == types[ frame->list ] ) ? __AFTER_TO_REAL : __AFTER_NONE );
+                    continue;
+                }
+
+                if( ( TOK_NEG_OPP == opp )
+                 && ( TOK_REAL_TYPE == types[ frame->list ] ) )
+                {
+                    __put_word( e, "fnegate", 7, PEEP_PLAIN );
+                }
+                else
+                {
+                    __put_word( e, e->un_words[ opp ].str, e->un_words[ opp ].len, PEEP_PLAIN );
+                }
+                break;
+
+            /*-------------------------
+            v x !
+            -------------------------*/
+            case __LIST_ASSIGN:
+                b = &ti->bindings[ ti->syms[ a ] ];
+                if( 0 == frame->step++ )
+                {
+                    __emit_element( e, ast, ti, &depth, nodes[ a ].next_sibling,
+                                    ( TOK_REAL_TYPE == b->type ) ? __AFTER_TO_REAL : __AFTER_NONE );
+                    continue;
+                }
+
+                __put_word( e, b->out_name, b->out_len, PEEP_NAME );
+                __put_cstr( e, __store_words[ b->type ] );
+                break;
+
+            /*-------------------------
+            c if t else e then. The
+            branches give the if's
+            value, so they get what
+            follows it.
+            -------------------------*/
+            case __LIST_IF:
+                c = nodes[ a ].next_sibling;
+                switch( frame->step++ )
+                {
+                    case 0:
+                        __emit_element( e, ast, ti, &depth, a, __AFTER_NONE );
+                        continue;
+
+                    case 1:
+                        __put_word( e, "if", 2, PEEP_PLAIN );
+                        __emit_element( e, ast, ti, &depth, c, frame->after );
+                        continue;
+
+                    case 2:
+                        if( AST_NO_NODE != nodes[ c ].next_sibling )
+                        {
+                            __put_word( e, "else", 4, PEEP_PLAIN );
+                            __emit_element( e, ast, ti, &depth, nodes[ c ].next_sibling, frame->after );
+                            continue;
+                        }
+                        /* fall through */
+
+                    default:
+                        __put_word( e, "then", 4, PEEP_PLAIN );
+                        --depth;
+                        continue;
+                }
+
+            /*-------------------------
+            begin c while body repeat
+            -------------------------*/
+            case __LIST_WHILE:
+                if( 0 == frame->step )
+                {
+                    frame->step = 1;
+                    __put_word( e, "begin", 5, PEEP_PLAIN );
+                    __emit_element( e, ast, ti, &depth, a, __AFTER_NONE );
+                    continue;
+                }
+
+                if( 1 == frame->step )
+                {
+                    frame->step = 2;
+                    frame->next = nodes[ a ].next_sibling;
+                    __put_word( e, "while", 5, PEEP_PLAIN );
+                    continue;
+                }
+
+                if( AST_NO_NODE != a )
+                {
+                    frame->next = nodes[ a ].next_sibling;
+                    __emit_element( e, ast, ti, &depth, a, __AFTER_DROP );
+                    continue;
+                }
+
+                __put_word( e, "repeat", 6, PEEP_PLAIN );
+                break;
+
+            /*-------------------------
+            e print cr
+            -------------------------*/
+            case __LIST_STDOUT:
+                if( 0 == frame->step++ )
+                {
+                    __emit_element( e, ast, ti, &depth, a, __AFTER_NONE );
+                    continue;
+                }
+
+                if( TOK_INT_TYPE == types[ a ] )
+                {
+                    __put_word( e, e->print_word.str, e->print_word.len, PEEP_PLAIN );
+                }
+                else
+                {
+                    __put_cstr( e, __print_words[ types[ a ] ] );
+                }
+                __put_word( e, "cr", 2, PEEP_PLAIN );
+                break;
+
+            default:
+                break;
+        }
+
+        /*-----------------------------
+        The list is done
+        -----------------------------*/
+        --depth;
+        __emit_after( e, types[ frame->list ], frame->after );
+    }
+
+}   /* __emit_form() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_emitter - "Initialize Emitter"
+*
+*   DESCRIPTION:
+*       Prepares to emit code to a file or
+*       pipe, optionally through the peephole
+*       optimizer, and takes the operator words
+*       from the keyword table. The symbol
+*       table must be initialized.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * EMIT_NO_MEMORY if the buffers
+*         couldn't be allocated.
+*
+**************************************************/
+emit_error_t8 init_emitter
+(
+    struct emit_type       *e,      /* emitter to initialize    */
+    int                     fd,     /* file or pipe to write    */
+    boolean                 peephole/* optimize the words?      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        i;              /* operator                 */
+
+    memset( e, 0, sizeof( *e ) );
+    e->fd        = fd;
+    e->peephole  = peephole;
+    init_peephole( &e->peep );
+    e->slices    = (struct iovec *)stats_malloc( EMIT_MAX_SLICES * sizeof( *e->slices ) );
+    e->scratch   = (char *)stats_malloc( EMIT_SCRATCH_SIZE );
+    e->stack     = (struct __emit_frame_type *)stats_malloc( __INITIAL_STACK * sizeof( *e->stack ) );
+    e->stack_cap = __INITIAL_STACK;
+    if( ( NULL == e->slices )
+     || ( NULL == e->scratch )
+     || ( NULL == e->stack ) )
+    {
+        free_emitter( e );
+        return( EMIT_NO_MEMORY );
+    }
+
+    for( i = 0; i < TOK_NUM_BIN_OPPS; ++i )
+    {
+        __word_of( &e->bin_words[ i ], TOK_BINARY_OPP, (uint8)i );
+    }
+
+    for( i = 0; i < TOK_NUM_UNARY_OPPS; ++i )
+    {
+        __word_of( &e->un_words[ i ], TOK_UNARY_OPP, (uint8)i );
+    }
+
+    __word_of( &e->print_word, TOK_RESERVED_WORD, TOK_STDOUT );
+    __word_of( &e->true_word,  TOK_RESERVED_WORD, TOK_TRUE );
+    __word_of( &e->false_word, TOK_RESERVED_WORD, TOK_FALSE );
+
+    return( EMIT_NO_ERROR );
+
+}   /* init_emitter() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       emit_prelude - "Emit Prelude"
+*
+*   DESCRIPTION:
+*       Emits the definitions the generated
+*       code relies on. Must come first.
+*
+*   RETURNS:
+*       Returns the emitter's error code
+*
+**************************************************/
+emit_error_t8 emit_prelude
+(
+    struct emit_type       *e       /* emitter                  */
+)
+{
+    __put( e, __prelude, sizeof( __prelude ) - 1 );
+    e->col = 0;
+
+    return( e->error );
+
+}   /* emit_prelude() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       emit_declarations - "Emit Declarations"
+*
+*   DESCRIPTION:
+*       Declares and zeroes the variables bound
+*       since the last declarations, up to but
+*       not including binding num_bindings.
+*
+*   RETURNS:
+*       Returns the emitter's error code
+*
+**************************************************/
+emit_error_t8 emit_declarations
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct type_info_type
+                           *ti,     /* bindings                 */
+    uint                    num_bindings
+                                    /* first not to declare     */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct binding_type  *b;      /* new binding          */
+
+    for( ; e->num_declared + 1 < num_bindings; ++e->num_declared )
+    {
+        b = &ti->bindings[ e->num_declared + 1 ];
+        __put_cstr( e, __declare_words[ b->type ] );
+        __put_word( e, b->out_name, b->out_len, PEEP_NAME );
+        __put_cstr( e, __zero_words[ b->type ] );
+        __put_word( e, b->out_name, b->out_len, PEEP_NAME );
+        __put_cstr( e, __store_words[ b->type ] );
+        __newline( e );
+    }
+
+    return( e->error );
+
+}   /* emit_declarations() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       emit_form - "Emit Form"
+*
+*   DESCRIPTION:
+*       Emits a word for a checked top-level
+*       form, on lines of its own, and runs it,
+*       after the constants of its string pool.
+*       A let or an empty list does nothing, so
+*       it gets no word; the variables a let
+*       binds are declared by
+*       emit_declarations().
+*
+*   RETURNS:
+*       Returns the emitter's error code
+*
+*   ERRORS:
+*       * EMIT_NO_MEMORY if the stack couldn't
+*         be grown.
+*       * EMIT_WRITE_ERROR if a flush along the
+*         way failed.
+*
+**************************************************/
+emit_error_t8 emit_form
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* checked forms            */
+    const struct type_info_type
+                           *ti,     /* their types              */
+    uint                    form    /* top-level form           */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *nodes;  /* node array           */
+    uint                        head;   /* form's first element */
+
+    nodes = ast->nodes;
+    head  = nodes[ form ].first_child;
+    if( ( AST_NO_NODE == head )
+     || ( ( TOK_RESERVED_WORD == nodes[ head ].token_class )
+       && ( TOK_LET == nodes[ head ].subclass ) ) )
+    {
+        return( e->error );
+    }
+
+    __pool_strings( e, ast, form );
+    __put_word( e, ":noname", 7, PEEP_PLAIN );
+    __emit_form( e, ast, ti, form );
+    __put_word( e, ";", 1, PEEP_PLAIN );
+    __put_word( e, "execute", 7, PEEP_PLAIN );
+    __newline( e );
+
+    return( e->error );
+
+}   /* emit_form() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       emit_forms - "Emit Forms"
+*
+*   DESCRIPTION:
+*       Emits a batch of checked top-level
+*       forms: first the variables bound since
+*       the last batch, then a word for each
+*       form that does anything. Batches must
+*       be emitted in the order they were
+*       checked, with the same type info.
+*
+*   RETURNS:
+*       Returns the emitter's error code
+*
+*   ERRORS:
+*       * See emit_form().
+*
+**************************************************/
+emit_error_t8 emit_forms
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* checked forms            */
+    const struct type_info_type
+                           *ti      /* their types              */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *nodes;  /* node array           */
+    uint                        form;   /* top-level form       */
+
+    emit_declarations( e, ti, ti->num_bindings );
+
+    nodes = ast->nodes;
+    for( form = nodes[ AST_ROOT ].first_child; ( AST_NO_NODE != form ) && ( EMIT_NO_ERROR == e->error ); form = nodes[ form ].next_sibling )
+    {
+        emit_form( e, ast, ti, form );
+    }
+
+    return( e->error );
+
+}   /* emit_forms() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       flush_emitter - "Flush Emitter"
+*
+*   DESCRIPTION:
+*       Writes out everything gathered so far,
+*       with as few writev() calls as the
+*       output takes. Partial writes and
+*       interrupted calls are retried.
+*
+*   RETURNS:
+*       Returns the emitter's error code
+*
+*   ERRORS:
+*       * EMIT_WRITE_ERROR if the output
+*         couldn't be written. Nothing more is
+*         written once that happens.
+*
+**************************************************/
+emit_error_t8 flush_emitter
+(
+    struct emit_type       *e       /* emitter                  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct iovec   *slice;          /* first unwritten slice    */
+    uint            n;              /* unwritten slices         */
+    ssize_t         written;        /* bytes written by a call  */
+
+    slice = e->slices;
+    n     = e->num_slices;
+    while( ( n > 0 )
+        && ( EMIT_WRITE_ERROR != e->error ) )
+    {
+        written = writev( e->fd, slice, (int)n );
+        if( written < 0 )
+        {
+            if( EINTR != errno )
+            {
+                e->error = EMIT_WRITE_ERROR;
+            }
+            continue;
+        }
+
+        e->bytes_out += (uint64)written;
+        while( ( n > 0 )
+            && ( (size_t)written >= slice->iov_len ) )
+        {
+            written -= (ssize_t)slice->iov_len;
+            ++slice;
+            --n;
+        }
+
+        if( n > 0 )
+        {
+            slice->iov_base = (char *)slice->iov_base + written;
+            slice->iov_len -= (size_t)written;
+        }
+    }
+
+    e->num_slices  = 0;
+    e->scratch_len = 0;
+    e->last_copied = FALSE;
+
+    return( e->error );
+
+}   /* flush_emitter() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_emitter - "Free Emitter"
+*
+*   DESCRIPTION:
+*       Frees an emitter's buffers. Anything
+*       not flushed is lost, and the file
+*       descriptor isn't closed.
+*
+**************************************************/
+void free_emitter
+(
+    struct emit_type       *e       /* emitter to free          */
+)
+{
+    free( e->slices );
+    free( e->scratch );
+    free( e->stack );
+    free( e->pool );
+    e->slices  = NULL;
+    e->scratch = NULL;
+    e->stack   = NULL;
+    e->pool    = NULL;
+
+}   /* free_emitter() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       emit_error_str - "Emit Error String"
+*
+*   DESCRIPTION:
+*       Describes an emitter error code.
+*
+**************************************************/
+const char *emit_error_str
+(
+    emit_error_t8           error   /* error code               */
+)
+{
+    switch( error )
+    {
+        case EMIT_NO_ERROR:
+            return( "no error" );
+
+        case EMIT_NO_MEMORY:
+            return( "out of memory" );
+
+        case EMIT_WRITE_ERROR:
+            return( "unable to write the output" );
+
+        default:
+            return( "unknown error" );
+    }
+
+}   /* emit_error_str() */
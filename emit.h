@@ -0,0 +1,172 @@
+/**************************************************
+*
+*   NAME:
+*       emit.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for the
+*       Gforth code emitter
+*
+**************************************************/
+
+#ifndef __EMIT_H__
+#define __EMIT_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include <sys/uio.h>
+
+#include "ast.h"
+#include "peephole.h"
+#include "tokens.h"
+#include "typecheck.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define EMIT_MAX_SLICES     1024    /* slices per writev(), IOV_MAX     */
+#define EMIT_SCRATCH_SIZE   65536   /* bytes of copied text per flush   */
+#define EMIT_COPY_MAX       64      /* longest slice that is copied     */
+                                    /*  rather than pointed to          */
+#define EMIT_LINE_WIDTH     100     /* lines are broken between words   */
+                                    /*  past this column                */
+
+/*-------------------------------------
+Error types
+-------------------------------------*/
+typedef sint8 emit_error_t8;
+enum
+{
+    EMIT_NO_ERROR         =  0,     /* no error                         */
+    EMIT_NO_MEMORY        = -1,     /* out of memory                    */
+    EMIT_WRITE_ERROR      = -2      /* the output couldn't be written   */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A Gforth word, taken once from the
+out_str tables
+-------------------------------------*/
+struct emit_word_type
+{
+    const char         *str;        /* spelling                         */
+    uint                len;        /* its length                       */
+};
+
+/*-------------------------------------
+Emitter state. Output is gathered as
+(pointer, length) slices and written
+with one writev() per flush. Short
+slices are copied into the scratch
+buffer, next to the slice before
+them; long ones, like most string
+literals, point into the source and
+are never copied, so the source must
+outlive the next flush. With the
+peephole optimizer on, words pass
+through its window on the way.
+-------------------------------------*/
+struct emit_type
+{
+    int                 fd;             /* file or pipe written to  */
+    struct iovec       *slices;         /* gathered output          */
+    uint                num_slices;     /* slices in use            */
+    boolean             last_copied;    /* last slice in scratch?   */
+    char               *scratch;        /* copied text              */
+    uint                scratch_len;    /* bytes of scratch in use  */
+    uint                col;            /* column of the output     */
+    uint64              bytes_out;      /* bytes written so far     */
+    uint64              bytes_put;      /* bytes gathered so far,   */
+                                        /*  written or not          */
+    uint                num_declared;   /* bindings declared so far */
+    boolean             peephole;       /* optimizer on?            */
+    struct peephole_type
+                        peep;           /* peephole optimizer       */
+    struct emit_word_type
+                        bin_words[ TOK_NUM_BIN_OPPS ];
+                                        /* int binary operators     */
+    struct emit_word_type
+                        un_words[ TOK_NUM_UNARY_OPPS ];
+                                        /* unary operators          */
+    struct emit_word_type
+                        print_word;     /* stdout of an int         */
+    struct emit_word_type
+                        true_word;      /* true                     */
+    struct emit_word_type
+                        false_word;     /* false                    */
+    struct __emit_frame_type
+                       *stack;          /* open lists               */
+    uint                stack_cap;      /* frames allocated         */
+    struct __emit_pool_type
+                       *pool;           /* string literals of the   */
+                                        /*  form, by text           */
+    uint                pool_cap;       /* slots, a power of two    */
+    uint                num_pooled;     /* constants declared for   */
+                                        /*  the form                */
+    emit_error_t8       error;          /* first error              */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+emit_error_t8 init_emitter
+(
+    struct emit_type       *e,      /* emitter to initialize    */
+    int                     fd,     /* file or pipe to write    */
+    boolean                 peephole/* optimize the words?      */
+);
+
+emit_error_t8 emit_prelude
+(
+    struct emit_type       *e       /* emitter                  */
+);
+
+emit_error_t8 emit_declarations
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct type_info_type
+                           *ti,     /* bindings                 */
+    uint                    num_bindings
+                                    /* first not to declare     */
+);
+
+emit_error_t8 emit_form
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* checked forms            */
+    const struct type_info_type
+                           *ti,     /* their types              */
+    uint                    form    /* top-level form           */
+);
+
+emit_error_t8 emit_forms
+(
+    struct emit_type       *e,      /* emitter                  */
+    const struct ast_type  *ast,    /* checked forms            */
+    const struct type_info_type
+                           *ti      /* their types              */
+);
+
+emit_error_t8 flush_emitter
+(
+    struct emit_type       *e       /* emitter                  */
+);
+
+void free_emitter
+(
+    struct emit_type       *e       /* emitter to free          */
+);
+
+const char *emit_error_str
+(
+    emit_error_t8           error   /* error code               */
+);
+
+#endif /* __EMIT_H__ */
@@ -0,0 +1,370 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       eval.c
+*
+*   DESCRIPTION:
+*       Evaluates operators on constant values
+*       with exactly the semantics of the code
+*       the compiler generates, so anything
+*       computed at compile time gives the same
+*       answer it would have at run time:
+*
+*         * Integers are 64-bit cells and wrap
+*           around on overflow.
+*         * "/" and "%" are floored, as Forth's
+*           fm/mod is: the quotient rounds
+*           toward negative infinity and the
+*           remainder takes the divisor's sign.
+*         * An integer "^" multiplies the base
+*           in exp times, so any exponent below
+*           1 gives 1.
+*         * Reals are IEEE doubles and use the C
+*           library's pow, sin, cos and tan, as
+*           Gforth's f**, fsin, fcos and ftan do.
+*         * Booleans and comparisons are Forth
+*           flags: EVAL_TRUE or EVAL_FALSE in
+*           int_val.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <math.h>
+
+#include "eval.h"
+#include "tokens.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __INT_MIN   ( (sint64)( (uint64)1 << 63 ) )
+                                /* most negative cell           */
+
+/*-------------------------------------------------
+                        MACROS
+-------------------------------------------------*/
+
+/**************************************************
+*
+*   FUNCTION:
+*       __flag - "Flag"
+*
+*   DESCRIPTION:
+*       Turns a C condition into a Forth flag.
+*
+**************************************************/
+#define __flag( c ) ( (c) ? EVAL_TRUE : EVAL_FALSE )
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       eval_int_pow - "Evaluate Integer Power"
+*
+*   DESCRIPTION:
+*       Raises an integer to an integer power,
+*       wrapping around on overflow. Exponents
+*       below 1 give 1.
+*
+**************************************************/
+sint64 eval_int_pow
+(
+    sint64                  base,   /* base                     */
+    sint64                  exp     /* exponent                 */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint64      result;         /* running product          */
+    uint64      square;         /* base^(2^i)               */
+
+    result = 1;
+    square = (uint64)base;
+    while( exp > 0 )
+    {
+        if( exp & 1 )
+        {
+            result *= square;
+        }
+        square *= square;
+        exp   >>= 1;
+    }
+
+    return( (sint64)result );
+
+}   /* eval_int_pow() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       eval_binary - "Evaluate Binary"
+*
+*   DESCRIPTION:
+*       Applies a binary operator to two
+*       operands of the same type. Operands of
+*       mixed int and real must be converted to
+*       real first.
+*
+*   RETURNS:
+*       Returns TRUE and the value if the
+*       operation is defined.
+*
+*   ERRORS:
+*       * Returns FALSE for an integer division
+*         or remainder by zero, the one
+*         quotient that doesn't fit in a cell,
+*         assignment, or an operator the type
+*         doesn't support. Those are left for
+*         run time.
+*
+**************************************************/
+boolean eval_binary
+(
+    bin_opp_class_t8        opp,    /* operator                 */
+    type_class_t8           type,   /* type of both operands    */
+    union literal_value_type
+                            a,      /* left operand             */
+    union literal_value_type
+                            b,      /* right operand            */
+    union literal_value_type
+                           *result  /* value of the operation   */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    sint64      x;              /* left integer operand     */
+    sint64      y;              /* right integer operand    */
+    sint64      q;              /* integer quotient         */
+    sint64      r;              /* integer remainder        */
+
+    /*---------------------------------
+    Reals
+    ---------------------------------*/
+    if( TOK_REAL_TYPE == type )
+    {
+        switch( opp )
+        {
+            case TOK_ADD_OPP:
+                result->real_val = a.real_val + b.real_val;
+                return( TRUE );
+
+            case TOK_SUB_OPP:
+                result->real_val = a.real_val - b.real_val;
+                return( TRUE );
+
+            case TOK_MUL_OPP:
+                result->real_val = a.real_val * b.real_val;
+                return( TRUE );
+
+            case TOK_DIV_OPP:
+                result->real_val = a.real_val / b.real_val;
+                return( TRUE );
+
+            case TOK_EXP_OPP:
+                result->real_val = pow( a.real_val, b.real_val );
+                return( TRUE );
+
+            case TOK_EQ_OPP:
+                result->int_val = __flag( a.real_val == b.real_val );
+                return( TRUE );
+
+            case TOK_NE_OPP:
+                result->int_val = __flag( a.real_val != b.real_val );
+                return( TRUE );
+
+            case TOK_LT_OPP:
+                result->int_val = __flag( a.real_val < b.real_val );
+                return( TRUE );
+
+            case TOK_GT_OPP:
+                result->int_val = __flag( a.real_val > b.real_val );
+                return( TRUE );
+
+            case TOK_LE_OPP:
+                result->int_val = __flag( a.real_val <= b.real_val );
+                return( TRUE );
+
+            case TOK_GE_OPP:
+                result->int_val = __flag( a.real_val >= b.real_val );
+                return( TRUE );
+
+            default:
+                return( FALSE );
+        }
+    }
+
+    if( ( TOK_INT_TYPE != type )
+     && ( TOK_BOOL_TYPE != type ) )
+    {
+        return( FALSE );
+    }
+
+    /*---------------------------------
+    Integers and flags
+    ---------------------------------*/
+    x = a.int_val;
+    y = b.int_val;
+    switch( opp )
+    {
+        case TOK_ADD_OPP:
+            result->int_val = (sint64)( (uint64)x + (uint64)y );
+            return( TRUE );
+
+        case TOK_SUB_OPP:
+            result->int_val = (sint64)( (uint64)x - (uint64)y );
+            return( TRUE );
+
+        case TOK_MUL_OPP:
+            result->int_val = (sint64)( (uint64)x * (uint64)y );
+            return( TRUE );
+
+        case TOK_DIV_OPP:
+        case TOK_MOD_OPP:
+            if( ( 0 == y )
+             || ( ( __INT_MIN == x ) && ( -1 == y ) ) )
+            {
+                return( FALSE );
+            }
+
+            q = x / y;
+            r = x % y;
+            if( ( 0 != r )
+             && ( ( r < 0 ) != ( y < 0 ) ) )
+            {
+                q -= 1;
+                r += y;
+            }
+            result->int_val = ( TOK_DIV_OPP == opp ) ? q : r;
+            return( TRUE );
+
+        case TOK_EXP_OPP:
+            result->int_val = eval_int_pow( x, y );
+            return( TRUE );
+
+        case TOK_AND_OPP:
+            result->int_val = x & y;
+            return( TRUE );
+
+        case TOK_OR_OPP:
+            result->int_val = x | y;
+            return( TRUE );
+
+        case TOK_EQ_OPP:
+            result->int_val = __flag( x == y );
+            return( TRUE );
+
+        case TOK_NE_OPP:
+            result->int_val = __flag( x != y );
+            return( TRUE );
+
+        case TOK_LT_OPP:
+            result->int_val = __flag( x < y );
+            return( TRUE );
+
+        case TOK_GT_OPP:
+            result->int_val = __flag( x > y );
+            return( TRUE );
+
+        case TOK_LE_OPP:
+            result->int_val = __flag( x <= y );
+            return( TRUE );
+
+        case TOK_GE_OPP:
+            result->int_val = __flag( x >= y );
+            return( TRUE );
+
+        default:
+            return( FALSE );
+    }
+
+}   /* eval_binary() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       eval_unary - "Evaluate Unary"
+*
+*   DESCRIPTION:
+*       Applies a unary operator. An integer
+*       operand of sin, cos or tan must be
+*       converted to real first.
+*
+*   RETURNS:
+*       Returns TRUE and the value if the
+*       operation is defined, FALSE otherwise.
+*
+**************************************************/
+boolean eval_unary
+(
+    unary_opp_class_t8      opp,    /* operator                 */
+    type_class_t8           type,   /* type of the operand      */
+    union literal_value_type
+                            a,      /* operand                  */
+    union literal_value_type
+                           *result  /* value of the operation   */
+)
+{
+    switch( opp )
+    {
+        case TOK_NOT_OPP:
+            if( TOK_BOOL_TYPE != type )
+            {
+                return( FALSE );
+            }
+            result->int_val = ~a.int_val;
+            return( TRUE );
+
+        case TOK_NEG_OPP:
+            if( TOK_REAL_TYPE == type )
+            {
+                result->real_val = -a.real_val;
+            }
+            else
+            {
+                result->int_val = (sint64)( 0 - (uint64)a.int_val );
+            }
+            return( TRUE );
+
+        case TOK_POS_OPP:
+            *result = a;
+            return( TRUE );
+
+        case TOK_SIN_OPP:
+        case TOK_COS_OPP:
+        case TOK_TAN_OPP:
+            if( TOK_REAL_TYPE != type )
+            {
+                return( FALSE );
+            }
+
+            if( TOK_SIN_OPP == opp )
+            {
+                result->real_val = sin( a.real_val );
+            }
+            else if( TOK_COS_OPP == opp )
+            {
+                result->real_val = cos( a.real_val );
+            }
+            else
+            {
+                result->real_val = tan( a.real_val );
+            }
+            return( TRUE );
+
+        default:
+            return( FALSE );
+    }
+
+}   /* eval_unary() */
@@ -0,0 +1,60 @@
+/**************************************************
+*
+*   NAME:
+*       eval.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       evaluating operators on constant values
+*
+**************************************************/
+
+#ifndef __EVAL_H__
+#define __EVAL_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "tokens.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define EVAL_TRUE       ( -1 )  /* Forth's true flag, in int_val    */
+#define EVAL_FALSE      0       /* Forth's false flag, in int_val   */
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+boolean eval_binary
+(
+    bin_opp_class_t8        opp,    /* operator                 */
+    type_class_t8           type,   /* type of both operands    */
+    union literal_value_type
+                            a,      /* left operand             */
+    union literal_value_type
+                            b,      /* right operand            */
+    union literal_value_type
+                           *result  /* value of the operation   */
+);
+
+boolean eval_unary
+(
+    unary_opp_class_t8      opp,    /* operator                 */
+    type_class_t8           type,   /* type of the operand      */
+    union literal_value_type
+                            a,      /* operand                  */
+    union literal_value_type
+                           *result  /* value of the operation   */
+);
+
+sint64 eval_int_pow
+(
+    sint64                  base,   /* base                     */
+    sint64                  exp     /* exponent                 */
+);
+
+#endif /* __EVAL_H__ */
@@ -0,0 +1,403 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       fold.c
+*
+*   DESCRIPTION:
+*       Folds operations on constants into
+*       constants, and removes an if or a while
+*       whose condition is a constant, before
+*       any code is generated. Values are
+*       computed by eval.c, which follows the
+*       run-time semantics exactly.
+*
+*       Nodes are rewritten in place. A folded
+*       constant is a literal, or true/false,
+*       with a lexeme length of 0: it has no
+*       text in the source, and its value is in
+*       val. The nodes under a rewritten list
+*       stay in the array but are no longer
+*       linked, so later passes must follow the
+*       links rather than sweep the array.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <math.h>
+
+#include "ast.h"
+#include "eval.h"
+#include "fold.h"
+#include "tokens.h"
+#include "typecheck.h"
+#include "types.h"
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static boolean __get_constant
+(
+    const struct ast_node_type
+                           *node,   /* node to read             */
+    type_class_t8          *type,   /* its type                 */
+    union literal_value_type
+                           *val     /* its value                */
+);
+
+static void __make_constant
+(
+    struct ast_node_type   *node,   /* list to rewrite          */
+    type_class_t8           type,   /* type of the value        */
+    union literal_value_type
+                            val     /* value                    */
+);
+
+static void __replace_node
+(
+    struct ast_type        *ast,    /* tree                     */
+    struct type_info_type  *ti,     /* its types                */
+    uint                    node,   /* node to replace          */
+    uint                    with    /* node to replace it by    */
+);
+
+static boolean __fold_list
+(
+    struct ast_type        *ast,    /* tree                     */
+    struct type_info_type  *ti,     /* its types                */
+    uint                    list    /* list to fold             */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __get_constant - "Get Constant"
+*
+*   DESCRIPTION:
+*       Reads a numeric literal or a boolean
+*       constant.
+*
+*   RETURNS:
+*       Returns TRUE if the node is one.
+*
+**************************************************/
+static boolean __get_constant
+(
+    const struct ast_node_type
+                           *node,   /* node to read             */
+    type_class_t8          *type,   /* its type                 */
+    union literal_value_type
+                           *val     /* its value                */
+)
+{
+    if( TOK_LITERAL == node->token_class )
+    {
+        if( TOK_STRING_TYPE == node->subclass )
+        {
+            return( FALSE );
+        }
+
+        *type = node->subclass;
+        *val  = node->val;
+        return( TRUE );
+    }
+
+    if( ( TOK_RESERVED_WORD == node->token_class )
+     && ( ( TOK_TRUE == node->subclass ) || ( TOK_FALSE == node->subclass ) ) )
+    {
+        *type        = TOK_BOOL_TYPE;
+        val->int_val = ( TOK_TRUE == node->subclass ) ? EVAL_TRUE : EVAL_FALSE;
+        return( TRUE );
+    }
+
+    return( FALSE );
+
+}   /* __get_constant() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __make_constant - "Make Constant"
+*
+*   DESCRIPTION:
+*       Rewrites a list as a constant leaf. The
+*       list's offset is kept for diagnostics.
+*
+**************************************************/
+static void __make_constant
+(
+    struct ast_node_type   *node,   /* list to rewrite          */
+    type_class_t8           type,   /* type of the value        */
+    union literal_value_type
+                            val     /* value                    */
+)
+{
+    if( TOK_BOOL_TYPE == type )
+    {
+        node->token_class = TOK_RESERVED_WORD;
+        node->subclass    = ( EVAL_FALSE != val.int_val ) ? TOK_TRUE : TOK_FALSE;
+        node->val.int_val = 0;
+    }
+    else
+    {
+        node->token_class = TOK_LITERAL;
+        node->subclass    = type;
+        node->val         = val;
+    }
+
+    node->len         = 0;
+    node->first_child = AST_NO_NODE;
+
+}   /* __make_constant() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __replace_node - "Replace Node"
+*
+*   DESCRIPTION:
+*       Puts a copy of one node, with its
+*       children and type, in place of another.
+*       The replaced node keeps its place among
+*       its siblings.
+*
+**************************************************/
+static void __replace_node
+(
+    struct ast_type        *ast,    /* tree                     */
+    struct type_info_type  *ti,     /* its types                */
+    uint                    node,   /* node to replace          */
+    uint                    with    /* node to replace it by    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        next;           /* replaced node's sibling  */
+
+    next                            = ast->nodes[ node ].next_sibling;
+    ast->nodes[ node ]              = ast->nodes[ with ];
+    ast->nodes[ node ].next_sibling = next;
+    ti->types[ node ]               = ti->types[ with ];
+    ti->syms[ node ]                = ti->syms[ with ];
+
+}   /* __replace_node() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __fold_list - "Fold List"
+*
+*   DESCRIPTION:
+*       Folds one list whose elements have
+*       already been folded:
+*
+*           [opp c1 c2] / [opp c1] - constant
+*           [if true t e?]         - t
+*           [if false t e]         - e
+*           [if false t]           - []
+*           [while false ...]      - []
+*
+*       Mixed int and real operands are
+*       converted to real, as the generated
+*       code does. Operations eval.c leaves for
+*       run time, and real results that aren't
+*       finite, aren't folded.
+*
+*   RETURNS:
+*       Returns TRUE if the list was folded.
+*
+**************************************************/
+static boolean __fold_list
+(
+    struct ast_type        *ast,    /* tree                     */
+    struct type_info_type  *ti,     /* its types                */
+    uint                    list    /* list to fold             */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct ast_node_type       *nodes;      /* node array           */
+    const struct ast_node_type *head;       /* first element        */
+    union literal_value_type    a;          /* first operand        */
+    union literal_value_type    b;          /* second operand       */
+    union literal_value_type    val;        /* folded value         */
+    type_class_t8               a_type;     /* first operand's type */
+    type_class_t8               b_type;     /* second's type        */
+    type_class_t8               type;       /* operands' type       */
+    uint                        first;      /* first operand node   */
+    uint                        second;     /* second operand node  */
+
+    nodes = ast->nodes;
+    if( AST_NO_NODE == nodes[ list ].first_child )
+    {
+        return( FALSE );
+    }
+
+    head   = &nodes[ nodes[ list ].first_child ];
+    first  = head->next_sibling;
+    if( AST_NO_NODE == first )
+    {
+        return( FALSE );
+    }
+    second = nodes[ first ].next_sibling;
+
+    switch( head->token_class )
+    {
+        /*-----------------------------
+        Operations on constants
+        -----------------------------*/
+        case TOK_BINARY_OPP:
+            if( ( AST_NO_NODE == second )
+             || !__get_constant( &nodes[ first ], &a_type, &a )
+             || !__get_constant( &nodes[ second ], &b_type, &b ) )
+            {
+                return( FALSE );
+            }
+
+            type = a_type;
+            if( a_type != b_type )
+            {
+                if( TOK_INT_TYPE == a_type )
+                {
+                    a.real_val = (double)a.int_val;
+                }
+                else
+                {
+                    b.real_val = (double)b.int_val;
+                }
+                type = TOK_REAL_TYPE;
+            }
+
+            if( !eval_binary( head->subclass, type, a, b, &val ) )
+            {
+                return( FALSE );
+            }
+            break;
+
+        case TOK_UNARY_OPP:
+            if( !__get_constant( &nodes[ first ], &type, &a ) )
+            {
+                return( FALSE );
+            }
+
+            if( ( TOK_INT_TYPE == type )
+             && ( TOK_REAL_TYPE == ti->types[ list ] ) )
+            {
+                a.real_val = (double)a.int_val;
+                type       = TOK_REAL_TYPE;
+            }
+
+            if( !eval_unary( head->subclass, type, a, &val ) )
+            {
+                return( FALSE );
+            }
+            break;
+
+        /*-----------------------------
+        Constant conditions
+        -----------------------------*/
+        case TOK_RESERVED_WORD:
+            if( ( ( TOK_IF != head->subclass ) && ( TOK_WHILE != head->subclass ) )
+             || !__get_constant( &nodes[ first ], &type, &a ) )
+            {
+                return( FALSE );
+            }
+
+            if( ( TOK_IF == head->subclass )
+             && ( EVAL_FALSE != a.int_val ) )
+            {
+                __replace_node( ast, ti, list, second );
+            }
+            else if( ( TOK_IF == head->subclass )
+                  && ( AST_NO_NODE != nodes[ second ].next_sibling ) )
+            {
+                __replace_node( ast, ti, list, nodes[ second ].next_sibling );
+            }
+            else if( EVAL_FALSE == a.int_val )
+            {
+                nodes[ list ].first_child = AST_NO_NODE;
+                ti->types[ list ]         = TYPE_NONE;
+            }
+            else
+            {
+                return( FALSE );
+            }
+            return( TRUE );
+
+        default:
+            return( FALSE );
+    }
+
+    if( ( TOK_REAL_TYPE == ti->types[ list ] )
+     && !isfinite( val.real_val ) )
+    {
+        return( FALSE );
+    }
+
+    __make_constant( &nodes[ list ], ti->types[ list ], val );
+
+    return( TRUE );
+
+}   /* __fold_list() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       fold_constants - "Fold Constants"
+*
+*   DESCRIPTION:
+*       Folds every foldable list of a checked
+*       tree. The nodes are swept once, from the
+*       last to the first: in pre-order every
+*       node comes before its descendants, so
+*       this visits the elements of a list, and
+*       folds them, before the list itself, and
+*       needs no stack however deep the tree is.
+*
+*   RETURNS:
+*       Returns the number of lists folded.
+*
+*   NOTES:
+*       * The tree must have been checked by
+*         check_types() into ti; types and
+*         bindings are kept up to date.
+*
+**************************************************/
+uint fold_constants
+(
+    struct ast_type        *ast,    /* checked tree to fold     */
+    struct type_info_type  *ti      /* its types                */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        node;           /* node being visited       */
+    uint        num_folded;     /* lists folded             */
+
+    num_folded = 0;
+    for( node = ast->num_nodes - 1; node > AST_ROOT; --node )
+    {
+        if( ( TOK_LIST_TYPE == ast->nodes[ node ].token_class )
+         && __fold_list( ast, ti, node ) )
+        {
+            ++num_folded;
+        }
+    }
+
+    return( num_folded );
+
+}   /* fold_constants() */
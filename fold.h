@@ -0,0 +1,32 @@
+/**************************************************
+*
+*   NAME:
+*       fold.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       compile-time constant folding
+*
+**************************************************/
+
+#ifndef __FOLD_H__
+#define __FOLD_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "ast.h"
+#include "typecheck.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+uint fold_constants
+(
+    struct ast_type        *ast,    /* checked tree to fold     */
+    struct type_info_type  *ti      /* its types                */
+);
+
+#endif /* __FOLD_H__ */
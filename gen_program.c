@@ -0,0 +1,853 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       gen_program.c
+*
+*   DESCRIPTION:
+*       Generates valid, well-typed synthetic
+*       programs of a configurable size and
+*       shape. Every keyword, operator and
+*       literal type of the language is used,
+*       every variable is declared and assigned
+*       before it is read, and every loop is
+*       bounded, so the output can be scanned,
+*       compiled and run. Operators and
+*       reserved words are spelled as the
+*       symbol table's keyword table spells
+*       them.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gen_program.h"
+#include "symbol_table.h"
+#include "tokens.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __INITIAL_CAPACITY  4096    /* initial output buffer size       */
+#define __MAX_LOOP_COUNT    4       /* most iterations of a loop        */
+#define __MAX_SEQ_LEN       4       /* most statements in a sequence    */
+#define __NUM_BUF_LEN       32      /* characters in a formatted number */
+
+/*-------------------------------------------------
+                      TYPES
+-------------------------------------------------*/
+
+struct __gen_state
+{
+    const struct gen_options_type
+               *opts;       /* shape of the program         */
+    uint64      rng;        /* random number generator      */
+    char       *buf;        /* generated source             */
+    uint32      len;        /* characters in buf            */
+    uint32      cap;        /* capacity of buf              */
+    boolean     oom;        /* ran out of memory?           */
+    boolean     no_vars;    /* only generate literal leaves?*/
+    uint        loop_depth; /* loop counters in use         */
+    const char *bin_opps[ TOK_NUM_BIN_OPPS ];
+                            /* binary operator spellings    */
+    const char *un_opps[ TOK_NUM_UNARY_OPPS ];
+                            /* unary operator spellings     */
+    const char *words[ TOK_NUM_RESERVED_WORDS ];
+                            /* reserved word spellings      */
+};
+
+/*-------------------------------------------------
+                VARIABLE CONSTANTS
+-------------------------------------------------*/
+
+/*-------------------------------------
+Reserved word naming each type
+-------------------------------------*/
+static const res_word_class_t8 __type_word[ TOK_NUM_TYPES ] =
+{
+    TOK_INT, TOK_REAL, TOK_STRING, TOK_BOOL
+};
+
+static const char __var_prefix[ TOK_NUM_TYPES ] =
+{
+    'i', 'r', 's', 'b'
+};
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static void __gen_expr
+(
+    struct __gen_state *st,     /* generator state      */
+    type_class_t8       type,   /* type of expression   */
+    uint                depth   /* current nesting      */
+);
+
+static void __gen_leaf
+(
+    struct __gen_state *st,     /* generator state      */
+    type_class_t8       type    /* type of the leaf     */
+);
+
+static void __gen_stmt
+(
+    struct __gen_state *st,     /* generator state      */
+    uint                depth   /* current nesting      */
+);
+
+static type_class_t8 __pick_type
+(
+    struct __gen_state *st      /* generator state      */
+);
+
+static void __open
+(
+    struct __gen_state *st,     /* generator state      */
+    const char         *word    /* word the form starts */
+);
+
+static void __put
+(
+    struct __gen_state *st,     /* generator state      */
+    const char         *str     /* string to append     */
+);
+
+static void __put_var
+(
+    struct __gen_state *st,     /* generator state      */
+    char                prefix, /* variable prefix      */
+    uint                idx     /* variable index       */
+);
+
+static uint __rand
+(
+    struct __gen_state *st,     /* generator state      */
+    uint                n       /* exclusive upper bound*/
+);
+
+static boolean __spell
+(
+    struct __gen_state *st      /* generator state      */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __rand - "Random"
+*
+*   DESCRIPTION:
+*       Returns a pseudo-random number in
+*       [0, n) using xorshift64*.
+*
+**************************************************/
+static uint __rand
+(
+    struct __gen_state *st,     /* generator state      */
+    uint                n       /* exclusive upper bound*/
+)
+{
+    st->rng ^= st->rng >> 12;
+    st->rng ^= st->rng << 25;
+    st->rng ^= st->rng >> 27;
+
+    if( 0 == n )
+    {
+        return( 0 );
+    }
+    return( (uint)( ( st->rng * 2685821657736338717ULL ) >> 33 ) % n );
+
+}   /* __rand() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __spell - "Spell"
+*
+*   DESCRIPTION:
+*       Looks up how each operator and reserved
+*       word is spelled in the keyword table.
+*
+*   RETURNS:
+*       Returns FALSE if one isn't there.
+*
+**************************************************/
+static boolean __spell
+(
+    struct __gen_state *st      /* generator state      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct token_type
+               *tok;    /* keyword              */
+    uint8       i;      /* for-loop iterator    */
+
+    for( i = 0; i < TOK_NUM_BIN_OPPS; ++i )
+    {
+        tok = get_keyword_class_data( TOK_BINARY_OPP, i );
+        if( NULL == tok )
+        {
+            return( FALSE );
+        }
+        st->bin_opps[ i ] = tok->opp.in_str;
+    }
+
+    for( i = 0; i < TOK_NUM_UNARY_OPPS; ++i )
+    {
+        tok = get_keyword_class_data( TOK_UNARY_OPP, i );
+        if( NULL == tok )
+        {
+            return( FALSE );
+        }
+        st->un_opps[ i ] = tok->opp.in_str;
+    }
+
+    for( i = 0; i < TOK_NUM_RESERVED_WORDS; ++i )
+    {
+        tok = get_keyword_class_data( TOK_RESERVED_WORD, i );
+        if( NULL == tok )
+        {
+            return( FALSE );
+        }
+        st->words[ i ] = tok->res_word.in_str;
+    }
+
+    return( TRUE );
+
+}   /* __spell() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __open - "Open"
+*
+*   DESCRIPTION:
+*       Starts a form with a keyword: "[",
+*       the keyword and a space.
+*
+**************************************************/
+static void __open
+(
+    struct __gen_state *st,     /* generator state      */
+    const char         *word    /* word the form starts */
+)
+{
+    __put( st, "[" );
+    __put( st, word );
+    __put( st, " " );
+
+}   /* __open() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put - "Put"
+*
+*   DESCRIPTION:
+*       Appends a string to the program,
+*       growing the buffer as needed.
+*
+**************************************************/
+static void __put
+(
+    struct __gen_state *st,     /* generator state      */
+    const char         *str     /* string to append     */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint32  n;          /* length of str        */
+    uint32  new_cap;    /* grown capacity       */
+    char   *new_buf;    /* grown buffer         */
+
+    n = (uint32)strlen( str );
+    if( st->oom )
+    {
+        return;
+    }
+
+    if( st->len + n + 1 > st->cap )
+    {
+        new_cap = st->cap << 1;
+        while( st->len + n + 1 > new_cap )
+        {
+            new_cap <<= 1;
+        }
+
+        new_buf = (char *)realloc( st->buf, new_cap );
+        if( NULL == new_buf )
+        {
+            st->oom = TRUE;
+            return;
+        }
+        st->buf = new_buf;
+        st->cap = new_cap;
+    }
+
+    memcpy( &st->buf[ st->len ], str, n + 1 );
+    st->len += n;
+
+}   /* __put() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_var - "Put Variable"
+*
+*   DESCRIPTION:
+*       Appends a variable name.
+*
+**************************************************/
+static void __put_var
+(
+    struct __gen_state *st,     /* generator state      */
+    char                prefix, /* variable prefix      */
+    uint                idx     /* variable index       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char    name[ __NUM_BUF_LEN ];  /* formatted name   */
+
+    snprintf( name, sizeof( name ), "%c%u", prefix, idx );
+    __put( st, name );
+
+}   /* __put_var() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __pick_type - "Pick Type"
+*
+*   DESCRIPTION:
+*       Picks an expression type according to
+*       the literal mix weights.
+*
+**************************************************/
+static type_class_t8 __pick_type
+(
+    struct __gen_state *st      /* generator state      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint    total;  /* sum of the weights   */
+    uint    r;      /* random pick          */
+
+    total = st->opts->int_weight
+          + st->opts->real_weight
+          + st->opts->string_weight
+          + st->opts->bool_weight;
+    if( 0 == total )
+    {
+        return( TOK_INT_TYPE );
+    }
+
+    r = __rand( st, total );
+    if( r < st->opts->int_weight )
+    {
+        return( TOK_INT_TYPE );
+    }
+    r -= st->opts->int_weight;
+
+    if( r < st->opts->real_weight )
+    {
+        return( TOK_REAL_TYPE );
+    }
+    r -= st->opts->real_weight;
+
+    if( r < st->opts->string_weight )
+    {
+        return( TOK_STRING_TYPE );
+    }
+    return( TOK_BOOL_TYPE );
+
+}   /* __pick_type() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __gen_leaf - "Generate Leaf"
+*
+*   DESCRIPTION:
+*       Generates a variable or a literal of the
+*       given type.
+*
+**************************************************/
+static void __gen_leaf
+(
+    struct __gen_state *st,     /* generator state      */
+    type_class_t8       type    /* type of the leaf     */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char    lit[ __NUM_BUF_LEN ];   /* formatted literal    */
+
+    if( ( !st->no_vars )
+     && ( st->opts->num_idents > 0 )
+     && ( __rand( st, 100 ) < st->opts->ident_reuse ) )
+    {
+        __put_var( st, __var_prefix[ type ], __rand( st, st->opts->num_idents ) );
+        return;
+    }
+
+    switch( type )
+    {
+        case TOK_INT_TYPE:
+            snprintf( lit, sizeof( lit ), "%u", __rand( st, 1000000 ) );
+            break;
+
+        case TOK_REAL_TYPE:
+            if( 0 == __rand( st, 4 ) )
+            {
+                snprintf( lit, sizeof( lit ), "%u.%ue%u", __rand( st, 10 ), __rand( st, 1000 ), __rand( st, 6 ) );
+            }
+            else
+            {
+                snprintf( lit, sizeof( lit ), "%u.%u", __rand( st, 1000 ), __rand( st, 1000 ) );
+            }
+            break;
+
+        case TOK_STRING_TYPE:
+            snprintf( lit, sizeof( lit ), "\"str %u\"", __rand( st, 1000 ) );
+            break;
+
+        default:
+            snprintf( lit, sizeof( lit ), "%s", st->words[ __rand( st, 2 ) ? TOK_TRUE : TOK_FALSE ] );
+            break;
+    }
+
+    __put( st, lit );
+
+}   /* __gen_leaf() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __gen_expr - "Generate Expression"
+*
+*   DESCRIPTION:
+*       Generates an expression of the given
+*       type. Divisors and exponents are
+*       always literals so the program can't
+*       divide by zero or overflow a real.
+*
+**************************************************/
+static void __gen_expr
+(
+    struct __gen_state *st,     /* generator state      */
+    type_class_t8       type,   /* type of expression   */
+    uint                depth   /* current nesting      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char    lit[ __NUM_BUF_LEN ];   /* formatted literal    */
+    uint    r;                      /* random pick          */
+
+    if( ( depth >= st->opts->max_depth )
+     || ( __rand( st, 100 ) >= st->opts->opp_density ) )
+    {
+        __gen_leaf( st, type );
+        return;
+    }
+
+    __put( st, "[" );
+    switch( type )
+    {
+        case TOK_INT_TYPE:
+            r = __rand( st, 7 );
+            if( r < 3 )
+            {
+                /*---------------------
+                + - *
+                ---------------------*/
+                __put( st, st->bin_opps[ TOK_ADD_OPP + r ] );
+                __put( st, " " );
+                __gen_expr( st, TOK_INT_TYPE, depth + 1 );
+                __put( st, " " );
+                __gen_expr( st, TOK_INT_TYPE, depth + 1 );
+            }
+            else if( r < 5 )
+            {
+                /*---------------------
+                / %
+                ---------------------*/
+                __put( st, st->bin_opps[ ( 3 == r ) ? TOK_DIV_OPP : TOK_MOD_OPP ] );
+                __put( st, " " );
+                __gen_expr( st, TOK_INT_TYPE, depth + 1 );
+                snprintf( lit, sizeof( lit ), " %u", 1 + __rand( st, 100 ) );
+                __put( st, lit );
+            }
+            else
+            {
+                __put( st, st->un_opps[ ( 5 == r ) ? TOK_NEG_OPP : TOK_POS_OPP ] );
+                __put( st, " " );
+                __gen_expr( st, TOK_INT_TYPE, depth + 1 );
+            }
+            break;
+
+        case TOK_REAL_TYPE:
+            r = __rand( st, 8 );
+            if( r < 3 )
+            {
+                /*---------------------
+                + - * with a mix of
+                int and real operands
+                ---------------------*/
+                __put( st, st->bin_opps[ TOK_ADD_OPP + r ] );
+                __put( st, " " );
+                __gen_expr( st, TOK_REAL_TYPE, depth + 1 );
+                __put( st, " " );
+                __gen_expr( st, __rand( st, 4 ) ? TOK_REAL_TYPE : TOK_INT_TYPE, depth + 1 );
+            }
+            else if( 3 == r )
+            {
+                __put( st, st->bin_opps[ TOK_DIV_OPP ] );
+                __put( st, " " );
+                __gen_expr( st, TOK_REAL_TYPE, depth + 1 );
+                snprintf( lit, sizeof( lit ), " %u.5", __rand( st, 100 ) );
+                __put( st, lit );
+            }
+            else if( 4 == r )
+            {
+                __put( st, st->bin_opps[ TOK_EXP_OPP ] );
+                __put( st, " " );
+                __gen_expr( st, TOK_REAL_TYPE, depth + 1 );
+                snprintf( lit, sizeof( lit ), " %u", __rand( st, 5 ) );
+                __put( st, lit );
+            }
+            else if( 5 == r )
+            {
+                __put( st, st->un_opps[ TOK_NEG_OPP ] );
+                __put( st, " " );
+                __gen_expr( st, TOK_REAL_TYPE, depth + 1 );
+            }
+            else
+            {
+                /*---------------------
+                sin cos tan
+                ---------------------*/
+                __put( st, st->un_opps[ TOK_SIN_OPP + r - 6 + __rand( st, 2 ) ] );
+                __put( st, " " );
+                __gen_expr( st, TOK_REAL_TYPE, depth + 1 );
+            }
+            break;
+
+        case TOK_STRING_TYPE:
+            __put( st, st->bin_opps[ TOK_ADD_OPP ] );
+            __put( st, " " );
+            __gen_expr( st, TOK_STRING_TYPE, depth + 1 );
+            __put( st, " " );
+            __gen_expr( st, TOK_STRING_TYPE, depth + 1 );
+            break;
+
+        default:
+            r = __rand( st, 4 );
+            if( r < 2 )
+            {
+                __put( st, st->bin_opps[ r ? TOK_OR_OPP : TOK_AND_OPP ] );
+                __put( st, " " );
+                __gen_expr( st, TOK_BOOL_TYPE, depth + 1 );
+                __put( st, " " );
+                __gen_expr( st, TOK_BOOL_TYPE, depth + 1 );
+            }
+            else if( 2 == r )
+            {
+                __put( st, st->un_opps[ TOK_NOT_OPP ] );
+                __put( st, " " );
+                __gen_expr( st, TOK_BOOL_TYPE, depth + 1 );
+            }
+            else
+            {
+                /*---------------------
+                = < > <= >= !=
+                ---------------------*/
+                __put( st, st->bin_opps[ TOK_EQ_OPP + __rand( st, 6 ) ] );
+                __put( st, " " );
+                __gen_expr( st, __rand( st, 2 ) ? TOK_REAL_TYPE : TOK_INT_TYPE, depth + 1 );
+                __put( st, " " );
+                __gen_expr( st, __rand( st, 2 ) ? TOK_REAL_TYPE : TOK_INT_TYPE, depth + 1 );
+            }
+            break;
+    }
+    __put( st, "]" );
+
+}   /* __gen_expr() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __gen_stmt - "Generate Statement"
+*
+*   DESCRIPTION:
+*       Generates an assignment, a print, an
+*       if, a bounded while loop or a sequence
+*       of statements.
+*
+**************************************************/
+static void __gen_stmt
+(
+    struct __gen_state *st,     /* generator state      */
+    uint                depth   /* current nesting      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char            lit[ __NUM_BUF_LEN ];   /* formatted literal    */
+    uint            r;                      /* random pick          */
+    uint            i;                      /* for-loop iterator    */
+    uint            n;                      /* statements to make   */
+    uint            ctr;                    /* loop counter index   */
+    type_class_t8   type;                   /* expression type      */
+
+    r = ( depth >= st->opts->max_depth ) ? __rand( st, 65 ) : __rand( st, 100 );
+    if( ( r < 40 ) && ( st->opts->num_idents > 0 ) )
+    {
+        type = __pick_type( st );
+        __open( st, st->bin_opps[ TOK_ASSN_OPP ] );
+        __put_var( st, __var_prefix[ type ], __rand( st, st->opts->num_idents ) );
+        __put( st, " " );
+        __gen_expr( st, type, depth + 1 );
+        __put( st, "]" );
+    }
+    else if( r < 65 )
+    {
+        __open( st, st->words[ TOK_STDOUT ] );
+        __gen_expr( st, __pick_type( st ), depth + 1 );
+        __put( st, "]" );
+    }
+    else if( r < 80 )
+    {
+        __open( st, st->words[ TOK_IF ] );
+        __gen_expr( st, TOK_BOOL_TYPE, depth + 1 );
+        __put( st, " " );
+        __gen_stmt( st, depth + 1 );
+        if( __rand( st, 2 ) )
+        {
+            __put( st, " " );
+            __gen_stmt( st, depth + 1 );
+        }
+        __put( st, "]" );
+    }
+    else if( r < 90 )
+    {
+        /*-----------------------------
+        [[:= cN 0]
+         [while [< cN n]
+             stmt
+             [:= cN [+ cN 1]]]]
+        -----------------------------*/
+        ctr = st->loop_depth++;
+        __put( st, "[" );
+        __open( st, st->bin_opps[ TOK_ASSN_OPP ] );
+        __put_var( st, 'c', ctr );
+        __put( st, " 0] " );
+        __open( st, st->words[ TOK_WHILE ] );
+        __open( st, st->bin_opps[ TOK_LT_OPP ] );
+        __put_var( st, 'c', ctr );
+        snprintf( lit, sizeof( lit ), " %u] ", 1 + __rand( st, __MAX_LOOP_COUNT ) );
+        __put( st, lit );
+        __gen_stmt( st, depth + 1 );
+        __put( st, " " );
+        __open( st, st->bin_opps[ TOK_ASSN_OPP ] );
+        __put_var( st, 'c', ctr );
+        __put( st, " " );
+        __open( st, st->bin_opps[ TOK_ADD_OPP ] );
+        __put_var( st, 'c', ctr );
+        __put( st, " 1]]]]" );
+        --st->loop_depth;
+    }
+    else
+    {
+        n = 1 + __rand( st, __MAX_SEQ_LEN );
+        __put( st, "[" );
+        for( i = 0; i < n; ++i )
+        {
+            if( i > 0 )
+            {
+                __put( st, " " );
+            }
+            __gen_stmt( st, depth + 1 );
+        }
+        __put( st, "]" );
+    }
+
+}   /* __gen_stmt() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_gen_options - "Initialize Generator
+*                           Options"
+*
+*   DESCRIPTION:
+*       Sets the generator options to a
+*       moderately nested program with an even
+*       literal mix.
+*
+**************************************************/
+void init_gen_options
+(
+    struct gen_options_type *opts   /* options to set to defaults   */
+)
+{
+    opts->seed          = 0x2545F4914F6CDD1DULL;
+    opts->target_bytes  = 1 << 20;
+    opts->max_depth     = 6;
+    opts->num_idents    = 8;
+    opts->ident_reuse   = 50;
+    opts->opp_density   = 60;
+    opts->int_weight    = 4;
+    opts->real_weight   = 3;
+    opts->string_weight = 1;
+    opts->bool_weight   = 2;
+
+}   /* init_gen_options() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       gen_program - "Generate Program"
+*
+*   DESCRIPTION:
+*       Generates a program of at least
+*       target_bytes characters. It starts by
+*       declaring and initializing every
+*       variable, followed by one top-level
+*       statement per line.
+*
+*   RETURNS:
+*       Returns a NUL-terminated buffer that the
+*       caller must free().
+*
+*   ERRORS:
+*       * Returns NULL if the program couldn't
+*         be allocated, or an operator or
+*         reserved word isn't in the keyword
+*         table.
+*
+**************************************************/
+char *gen_program
+(
+    const struct gen_options_type
+               *opts,   /* shape of the program     */
+    uint32     *len     /* length of the program    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __gen_state  st;     /* generator state      */
+    uint                i;      /* for-loop iterator    */
+    type_class_t8       type;   /* variable type        */
+
+    memset( &st, 0, sizeof( st ) );
+    st.opts = opts;
+    st.rng  = ( 0 == opts->seed ) ? 1 : opts->seed;
+    st.cap  = __INITIAL_CAPACITY;
+    st.buf  = (char *)malloc( st.cap );
+    if( NULL == st.buf )
+    {
+        return( NULL );
+    }
+    if( !__spell( &st ) )
+    {
+        free( st.buf );
+        return( NULL );
+    }
+    st.buf[ 0 ] = '\0';
+
+    /*---------------------------------
+    Declare the variables and the loop
+    counters
+    ---------------------------------*/
+    __open( &st, st.words[ TOK_LET ] );
+    __put( &st, "[" );
+    for( type = 0; type < TOK_NUM_TYPES; ++type )
+    {
+        for( i = 0; i < opts->num_idents; ++i )
+        {
+            __put( &st, "[" );
+            __put_var( &st, __var_prefix[ type ], i );
+            __put( &st, " " );
+            __put( &st, st.words[ __type_word[ type ] ] );
+            __put( &st, "] " );
+        }
+    }
+    for( i = 0; i <= opts->max_depth; ++i )
+    {
+        __put( &st, "[" );
+        __put_var( &st, 'c', i );
+        __put( &st, " " );
+        __put( &st, st.words[ __type_word[ TOK_INT_TYPE ] ] );
+        __put( &st, "] " );
+    }
+    __put( &st, "]]\n" );
+
+    /*---------------------------------
+    Give every variable a value
+    ---------------------------------*/
+    st.no_vars = TRUE;
+    for( type = 0; type < TOK_NUM_TYPES; ++type )
+    {
+        for( i = 0; i < opts->num_idents; ++i )
+        {
+            __open( &st, st.bin_opps[ TOK_ASSN_OPP ] );
+            __put_var( &st, __var_prefix[ type ], i );
+            __put( &st, " " );
+            __gen_leaf( &st, type );
+            __put( &st, "]\n" );
+        }
+    }
+    st.no_vars = FALSE;
+
+    /*---------------------------------
+    Statements
+    ---------------------------------*/
+    while( ( !st.oom ) && ( st.len < opts->target_bytes ) )
+    {
+        __gen_stmt( &st, 0 );
+        __put( &st, "\n" );
+    }
+
+    if( st.oom )
+    {
+        free( st.buf );
+        return( NULL );
+    }
+
+    *len = st.len;
+    return( st.buf );
+
+}   /* gen_program() */
@@ -0,0 +1,59 @@
+/**************************************************
+*
+*   NAME:
+*       gen_program.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for the
+*       synthetic program generator
+*
+**************************************************/
+
+#ifndef __GEN_PROGRAM_H__
+#define __GEN_PROGRAM_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "types.h"
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+Shape of a generated program. The
+literal weights are relative; the
+percentages are 0 - 100.
+-------------------------------------*/
+struct gen_options_type
+{
+    uint64      seed;           /* random seed                          */
+    uint32      target_bytes;   /* stop after this much source          */
+    uint        max_depth;      /* deepest expression/statement nesting */
+    uint        num_idents;     /* variables declared per type          */
+    uint        ident_reuse;    /* % of leaves that are variables       */
+    uint        opp_density;    /* % of expressions that are operators  */
+    uint        int_weight;     /* weight of int expressions            */
+    uint        real_weight;    /* weight of real expressions           */
+    uint        string_weight;  /* weight of string expressions         */
+    uint        bool_weight;    /* weight of bool expressions           */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+void init_gen_options
+(
+    struct gen_options_type *opts   /* options to set to defaults   */
+);
+
+char *gen_program
+(
+    const struct gen_options_type
+               *opts,   /* shape of the program     */
+    uint32     *len     /* length of the program    */
+);
+
+#endif /* __GEN_PROGRAM_H__ */
@@ -0,0 +1,172 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       hash.c
+*
+*   DESCRIPTION:
+*       MurmurHash3's x64 128-bit function. It
+*       is fast on long buffers and spreads
+*       short ones well, so the same hash keys
+*       whole sources in the cache and single
+*       forms in incremental compilation.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <string.h>
+
+#include "hash.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __MIX_C1            0x87c37b91114253d5ull
+                                        /* MurmurHash3 x64 constants        */
+#define __MIX_C2            0x4cf5ad432745937full
+
+/*-------------------------------------------------
+                        MACROS
+-------------------------------------------------*/
+
+#define __rotl( x, r )  ( ( (x) << (r) ) | ( (x) >> ( 64 - (r) ) ) )
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static uint64 __fmix
+(
+    uint64                  k       /* value to mix             */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __fmix - "Final Mix"
+*
+*   DESCRIPTION:
+*       MurmurHash3's finalizer, which makes
+*       every bit of the result depend on every
+*       bit of the value.
+*
+**************************************************/
+static uint64 __fmix
+(
+    uint64                  k       /* value to mix             */
+)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ull;
+    k ^= k >> 33;
+    return( k );
+
+}   /* __fmix() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       hash_bytes - "Hash Bytes"
+*
+*   DESCRIPTION:
+*       Hashes a buffer with MurmurHash3's x64
+*       128-bit function, 16 bytes at a time.
+*
+**************************************************/
+void hash_bytes
+(
+    const char             *buf,    /* bytes to hash            */
+    uint                    len,    /* how many                 */
+    uint64                  seed,   /* seed                     */
+    uint64                 *h       /* two words of hash        */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const uint8    *tail;           /* bytes after the blocks   */
+    uint64          h1;             /* first word of hash       */
+    uint64          h2;             /* second word of hash      */
+    uint64          k1;             /* first word of a block    */
+    uint64          k2;             /* second word of a block   */
+    uint            i;              /* block or byte index      */
+    uint            rem;            /* bytes after the blocks   */
+
+    h1 = seed;
+    h2 = seed;
+    for( i = 0; i < len / 16; ++i )
+    {
+        memcpy( &k1, &buf[ 16 * i ],     sizeof( k1 ) );
+        memcpy( &k2, &buf[ 16 * i + 8 ], sizeof( k2 ) );
+
+        k1 *= __MIX_C1;
+        k1  = __rotl( k1, 31 );
+        k1 *= __MIX_C2;
+        h1 ^= k1;
+        h1  = __rotl( h1, 27 );
+        h1 += h2;
+        h1  = h1 * 5 + 0x52dce729;
+
+        k2 *= __MIX_C2;
+        k2  = __rotl( k2, 33 );
+        k2 *= __MIX_C1;
+        h2 ^= k2;
+        h2  = __rotl( h2, 31 );
+        h2 += h1;
+        h2  = h2 * 5 + 0x38495ab5;
+    }
+
+    /*---------------------------------
+    Mix in the last 0 to 15 bytes
+    ---------------------------------*/
+    tail = (const uint8 *)&buf[ len & ~15u ];
+    rem  = len & 15;
+    k1   = 0;
+    k2   = 0;
+    for( i = rem; i > 8; --i )
+    {
+        k2 ^= (uint64)tail[ i - 1 ] << ( 8 * ( i - 9 ) );
+    }
+    if( rem > 8 )
+    {
+        k2 *= __MIX_C2;
+        k2  = __rotl( k2, 33 );
+        k2 *= __MIX_C1;
+        h2 ^= k2;
+    }
+    for( i = ( rem > 8 ) ? 8 : rem; i > 0; --i )
+    {
+        k1 ^= (uint64)tail[ i - 1 ] << ( 8 * ( i - 1 ) );
+    }
+    if( rem > 0 )
+    {
+        k1 *= __MIX_C1;
+        k1  = __rotl( k1, 31 );
+        k1 *= __MIX_C2;
+        h1 ^= k1;
+    }
+
+    h1 ^= len;
+    h2 ^= len;
+    h1 += h2;
+    h2 += h1;
+    h1  = __fmix( h1 );
+    h2  = __fmix( h2 );
+    h1 += h2;
+    h2 += h1;
+
+    h[ 0 ] = h1;
+    h[ 1 ] = h2;
+
+}   /* hash_bytes() */
@@ -0,0 +1,33 @@
+/**************************************************
+*
+*   NAME:
+*       hash.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for the
+*       128-bit hash that names cached output
+*       and fingerprints top-level forms
+*
+**************************************************/
+
+#ifndef __HASH_H__
+#define __HASH_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "types.h"
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+void hash_bytes
+(
+    const char             *buf,    /* bytes to hash            */
+    uint                    len,    /* how many                 */
+    uint64                  seed,   /* seed                     */
+    uint64                 *h       /* two words of hash        */
+);
+
+#endif /* __HASH_H__ */
@@ -17,6 +17,8 @@
 #include <string.h>
 
 #include "hashmap.h"
+#include "stats.h"
+#include "trace.h"
 #include "types.h"
 
 /*-------------------------------------------------
@@ -54,6 +56,9 @@ struct map
                 map_type;   /* type of map              */
     struct __map_element
               **table;      /* the table                */
+    const struct map_allocator_type
+               *alloc;      /* where its memory is from */
+    void       *user;       /* allocator's state        */
 };  /* map */
 
 /*-------------------------------------------------
@@ -87,21 +92,42 @@ inline uint32 __ptr_to_handle
             PRIVATE FUNCTION PROTOTYPES
 -------------------------------------------------*/
 
+static void *__std_alloc
+(
+    void       *user,       /* unused                   */
+    size_t      size        /* bytes wanted             */
+);
+
+static void *__std_realloc
+(
+    void       *user,       /* unused                   */
+    void       *ptr,        /* block to resize          */
+    size_t      old_size,   /* its size                 */
+    size_t      size        /* bytes wanted             */
+);
+
+static void __std_free
+(
+    void       *user,       /* unused                   */
+    void       *ptr,        /* block to free            */
+    size_t      size        /* its size                 */
+);
+
 struct __map_element *__create_element
 (
-    void
+    struct map *m       /* map it is for        */
 );
 
 void __free_element_data
 (
+   struct map           *m, /* map it is in     */
    struct __map_element *e  /* element to free  */
 );
 
 void __free_table
 (
-    struct __map_element
-              **t,      /* the table we're freeing  */
-    uint32      cap     /* capacity of the table    */
+    struct map *m       /* map whose table we're    */
+                        /*  freeing                 */
 );
 
 struct __map_element *__get_element
@@ -119,6 +145,7 @@ uint32 __hash_key
 
 map_error_code_t8 __init_element
 (
+    struct map *m,      /* map it is for            */
     struct __map_element
                *e,      /* element to initialize    */
     key_t8      key,    /* element's key            */
@@ -140,11 +167,94 @@ map_error_code_t8 __resize_map
     uint32      new_size/* new size of the map  */
 );
 
+/*-------------------------------------------------
+                      VARIABLES
+-------------------------------------------------*/
+
+/*-------------------------------------
+libc's allocator, for maps created
+without one
+-------------------------------------*/
+static const struct map_allocator_type __std_allocator =
+{
+    __std_alloc,
+    __std_realloc,
+    __std_free
+};
+
 /*-------------------------------------------------
                    PROCEDURES
 -------------------------------------------------*/
 
 
+/**************************************************
+*
+*   FUNCTION:
+*       __std_alloc - "Standard Allocate"
+*
+*   DESCRIPTION:
+*       Allocates a block with stats_malloc().
+*
+**************************************************/
+static void *__std_alloc
+(
+    void       *user,       /* unused                   */
+    size_t      size        /* bytes wanted             */
+)
+{
+    (void)user;
+    return( stats_malloc( size ) );
+
+}   /* __std_alloc() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __std_realloc - "Standard Reallocate"
+*
+*   DESCRIPTION:
+*       Resizes a block with stats_realloc().
+*
+**************************************************/
+static void *__std_realloc
+(
+    void       *user,       /* unused                   */
+    void       *ptr,        /* block to resize          */
+    size_t      old_size,   /* its size                 */
+    size_t      size        /* bytes wanted             */
+)
+{
+    (void)user;
+    (void)old_size;
+    return( stats_realloc( ptr, size ) );
+
+}   /* __std_realloc() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __std_free - "Standard Free"
+*
+*   DESCRIPTION:
+*       Frees a block with free().
+*
+**************************************************/
+static void __std_free
+(
+    void       *user,       /* unused                   */
+    void       *ptr,        /* block to free            */
+    size_t      size        /* its size                 */
+)
+{
+    (void)user;
+    (void)size;
+    free( ptr );
+
+}   /* __std_free() */
+
+
 /**************************************************
 *
 *   FUNCTION:
@@ -165,10 +275,10 @@ map_error_code_t8 __resize_map
 **************************************************/
 struct __map_element *__create_element
 (
-    void
+    struct map *m       /* map it is for        */
 )
 {
-    return( (struct __map_element *)malloc( sizeof( struct __map_element ) ) );
+    return( (struct __map_element *)m->alloc->alloc( m->user, sizeof( struct __map_element ) ) );
 
 }   /* __create_element() */
 
@@ -184,18 +294,19 @@ struct __map_element *__create_element
 **************************************************/
 void __free_element_data
 (
+   struct map           *m, /* map it is in     */
    struct __map_element *e  /* element to free  */
 )
 {
     if( e->key != NULL )
     {
-        free( e->key );
+        m->alloc->free( m->user, e->key, strlen( e->key ) + 1 );
         e->key = NULL;
     }
 
     if( e->val != NULL )
     {
-        free( e->val );
+        m->alloc->free( m->user, e->val, e->size );
         e->val = NULL;
     }
 
@@ -210,14 +321,14 @@ void __free_element_data
 *       __free_table - "Free Table"
 *
 *   DESCRIPTION:
-*       This function frees a map's table.
+*       This function frees a map's table and
+*       its elements.
 *
 **************************************************/
 void __free_table
 (
-    struct __map_element
-              **t,      /* the table we're freeing  */
-    uint32      cap     /* capacity of the table    */
+    struct map *m       /* map whose table we're    */
+                        /*  freeing                 */
 )
 {
     /*---------------------------------
@@ -227,18 +338,24 @@ void __free_table
     struct __map_element *cur;  /* pointer to current element   */
     struct __map_element *next; /* pointer to next element      */
 
-    for( i = 0; i < cap; ++i )
+    if( NULL == m->table )
     {
-        cur = t[ i ];
+        return;
+    }
+
+    for( i = 0; i < m->capacity; ++i )
+    {
+        cur = m->table[ i ];
         while( NULL != cur )
         {
             next = cur->next;
-            __free_element_data( cur );
-            free( cur );
+            __free_element_data( m, cur );
+            m->alloc->free( m->user, cur, sizeof( *cur ) );
             cur = next;
         }
     }
-    free( t );
+    m->alloc->free( m->user, m->table, sizeof( *m->table ) * m->capacity );
+    m->table = NULL;
 
 }   /* __free_table() */
 
@@ -370,6 +487,7 @@ uint32 __hash_key
 **************************************************/
 map_error_code_t8 __init_element
 (
+    struct map *m,      /* map it is for            */
     struct __map_element
                *e,      /* element to initialize    */
     key_t8      key,    /* element's key            */
@@ -395,7 +513,7 @@ map_error_code_t8 __init_element
     Allocate space for the key
     and copy the data over
     ---------------------------------*/
-    e->key = (key_t8)malloc( sizeof( char ) * len );
+    e->key = (key_t8)m->alloc->alloc( m->user, sizeof( char ) * len );
     if( NULL == e->key )
     {
         return( ERR_NO_MEMORY );
@@ -406,9 +524,11 @@ map_error_code_t8 __init_element
     Allocate space for the value
     and copy the data over
     ---------------------------------*/
-    e->val = (void *)malloc( sizeof( char ) * size );
+    e->val = (void *)m->alloc->alloc( m->user, sizeof( char ) * size );
     if( NULL == e->val )
     {
+        m->alloc->free( m->user, e->key, len );
+        e->key = NULL;
         return( ERR_NO_MEMORY );
     }
     memcpy( (void *)e->val, (void *)val, size );
@@ -467,7 +587,7 @@ map_error_code_t8 __init_map
     /*---------------------------------
     Allocate space for the table
     ---------------------------------*/
-    m->table = (struct __map_element **)malloc( sizeof( struct __map_element * ) * size );
+    m->table = (struct __map_element **)m->alloc->alloc( m->user, sizeof( struct __map_element * ) * size );
     if( NULL == m->table )
     {
         return( ERR_NO_MEMORY );
@@ -500,7 +620,13 @@ map_error_code_t8 __init_map
 *       __resize_map - "Resize Map"
 *
 *   DESCRIPTION:
-*       This resizes a map to the supplied size
+*       This resizes a map to the supplied size.
+*       The table is grown in place with the
+*       allocator's realloc, and the elements
+*       are moved to their new buckets, so no
+*       element, key or value is allocated or
+*       moved. The resize is a span on the
+*       trace.
 *
 *   RETURNS:
 *       Returns an error code
@@ -511,10 +637,15 @@ map_error_code_t8 __init_map
 *         it is equal to NULL).
 *       * ERR_NO_MEMORY is returned if this
 *         function was unable to allocate memory
-*         for the map's values.
+*         for the larger table. The map is left
+*         as it was.
 *       * ERR_NO_ERROR is returned if there were
 *         no errors.
 *
+*   NOTES:
+*       * new_size must be larger than the
+*         map's capacity.
+*
 **************************************************/
 map_error_code_t8 __resize_map
 (
@@ -526,10 +657,10 @@ map_error_code_t8 __resize_map
     Local variables
     ---------------------------------*/
     uint32                  i;          /* for-loop iterator    */
-    map_error_code_t8       error;      /* error code           */
-    uint32                  old_cap;    /* old capacity         */
+    uint32                  idx;        /* element's new bucket */
     struct __map_element   *cur;        /* current element      */
-    struct __map_element  **old_map;    /* old table            */
+    struct __map_element   *next;       /* element after it     */
+    struct __map_element  **table;      /* grown table          */
 
     /*---------------------------------
     Check for a valid map reference
@@ -539,46 +670,48 @@ map_error_code_t8 __resize_map
         return( ERR_NULL_REF );
     }
 
-    /*---------------------------------
-    Store the old table values
-    ---------------------------------*/
-    old_map = m->table;
-    old_cap = m->capacity;
+    trace_begin( "hashmap", "resize", "%u to %u slots, %u elements", (uint)m->capacity, (uint)new_size, (uint)m->size );
 
     /*---------------------------------
-    Resize the map
+    Grow the table
     ---------------------------------*/
-    error = __init_map( m, new_size, __MAP_TYPE_DYNAMIC );
-    if( ERR_NO_ERROR != error )
+    table = (struct __map_element **)m->alloc->realloc( m->user, m->table,
+                                                        sizeof( *table ) * m->capacity,
+                                                        sizeof( *table ) * new_size );
+    if( NULL == table )
     {
-        __free_table( old_map, old_cap );
-        return( error );
+        trace_end( "hashmap", "resize", NULL );
+        return( ERR_NO_MEMORY );
+    }
+
+    for( i = m->capacity; i < new_size; ++i )
+    {
+        table[ i ] = NULL;
     }
 
     /*---------------------------------
-    Add all of the elements from the
-    old table to the new table
+    Move each element of the old
+    buckets to its new one. One moved
+    to a bucket not yet visited is
+    visited again there, and stays.
     ---------------------------------*/
-    for( i = 0; i < old_cap; ++i )
+    for( i = 0; i < m->capacity; ++i )
     {
-        cur = old_map[ i ];
+        cur        = table[ i ];
+        table[ i ] = NULL;
         while( NULL != cur )
         {
-            error = add_map( m, cur->key, cur->val, cur->size );
-            if( 0 == error )
-            {
-                __free_table( old_map, old_cap );
-                return( ERR_ADD_ERROR );
-            }
-
-            cur = cur->next;
+            next         = cur->next;
+            idx          = __hash_key( cur->key, new_size );
+            cur->next    = table[ idx ];
+            table[ idx ] = cur;
+            cur          = next;
         }
     }
 
-    /*---------------------------------
-    Free the old table
-    ---------------------------------*/
-    __free_table( old_map, old_cap );
+    m->table    = table;
+    m->capacity = new_size;
+    trace_end( "hashmap", "resize", NULL );
 
     return( ERR_NO_ERROR );
 
@@ -591,7 +724,11 @@ map_error_code_t8 __resize_map
 *       create_map - "Create Map"
 *
 *   DESCRIPTION:
-*       This creates a map
+*       This creates a map. All of its memory
+*       comes from the supplied allocator, or
+*       from malloc() if there is none. The map
+*       has no table until it is initialized,
+*       but can be freed before then.
 *
 *   RETURNS:
 *       Returns a pointer to a map
@@ -603,10 +740,36 @@ map_error_code_t8 __resize_map
 **************************************************/
 struct map *create_map
 (
-    void
+    const struct map_allocator_type
+               *alloc,  /* allocator, or NULL   */
+                        /*  for libc's          */
+    void       *user    /* allocator's state    */
 )
 {
-    return( (struct map *)malloc( sizeof( struct map ) ) );
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct map *m;      /* new map              */
+
+    if( NULL == alloc )
+    {
+        alloc = &__std_allocator;
+    }
+
+    m = (struct map *)alloc->alloc( user, sizeof( struct map ) );
+    if( NULL == m )
+    {
+        return( NULL );
+    }
+
+    m->size     = 0;
+    m->capacity = 0;
+    m->map_type = __MAP_TYPE_STATIC;
+    m->table    = NULL;
+    m->alloc    = alloc;
+    m->user     = user;
+
+    return( m );
 
 }   /* create() */
 
@@ -642,10 +805,10 @@ struct map *create_map
 *         no errors.
 *
 *   NOTES:
-*       * DO NOT USE THIS IF YOU PLAN ON USING
-*         THE HANDLES THAT ARE RETURNED WHEN YOU
-*         USE THE ADD FUNCTION. THESE HANDLES
-*         WILL CHANGE WHEN THE MAP IS RESIZED.
+*       * The handles returned by the add
+*         function stay valid when the map is
+*         resized, but not once the value of
+*         their key is replaced.
 *
 **************************************************/
 map_error_code_t8 init_dynamic_map
@@ -754,6 +917,7 @@ uint32 add_map
     ---------------------------------*/
     uint32                  idx;            /* hashed index of the new element  */
     struct __map_element   *new_element;    /* element to add                   */
+    struct __map_element   *next;           /* element chained after a match    */
 
     /*---------------------------------
     Check if the map reference is valid
@@ -779,13 +943,17 @@ uint32 add_map
 
         /*-----------------------------
         Clear all element data and
-        copy over the new stuff
+        copy over the new stuff. The
+        element stays in its bucket, so
+        keep the rest of the chain.
         -----------------------------*/
-        __free_element_data( new_element );
-        if( ERR_NO_ERROR != __init_element( new_element, key, val, size ) )
+        next = new_element->next;
+        __free_element_data( m, new_element );
+        if( ERR_NO_ERROR != __init_element( m, new_element, key, val, size ) )
         {
             return( 0 );
         }
+        new_element->next = next;
         return( __ptr_to_handle( new_element->val ) );
     }
 
@@ -806,7 +974,7 @@ uint32 add_map
     /*---------------------------------
     Create a new map element
     ---------------------------------*/
-    new_element = __create_element();
+    new_element = __create_element( m );
     if( NULL == new_element )
     {
         return( 0 );
@@ -815,8 +983,9 @@ uint32 add_map
     /*---------------------------------
     Initialize the map element
     ---------------------------------*/
-    if( ERR_NO_ERROR != __init_element( new_element, key, val, size ) )
+    if( ERR_NO_ERROR != __init_element( m, new_element, key, val, size ) )
     {
+        m->alloc->free( m->user, new_element, sizeof( *new_element ) );
         return( 0 );
     }
 
@@ -990,8 +1159,8 @@ void free_map
     Free the table, and then free the
     map
     ---------------------------------*/
-    __free_table( m->table, m->capacity );
-    free( m );
+    __free_table( m );
+    m->alloc->free( m->user, m, sizeof( *m ) );
 
 }   /* free_map() */
 
@@ -15,6 +15,8 @@
 /*-------------------------------------------------
                    PROJECT INCLUDES
 -------------------------------------------------*/
+#include <stddef.h>
+
 #include "types.h"
 
 /*-------------------------------------------------
@@ -37,6 +39,24 @@ typedef char* key_t8;
 struct map;
 typedef struct map HashMap;
 
+/*-------------------------------------
+Where a map's memory comes from. Each
+function is handed the user pointer the
+map was created with, and free and
+realloc the size of the block, so a
+pool or an arena can stand in for libc.
+-------------------------------------*/
+typedef void *(*map_alloc_func)( void *user, size_t size );
+typedef void *(*map_realloc_func)( void *user, void *ptr, size_t old_size, size_t size );
+typedef void (*map_free_func)( void *user, void *ptr, size_t size );
+
+struct map_allocator_type
+{
+    map_alloc_func      alloc;      /* allocates a block        */
+    map_realloc_func    realloc;    /* resizes a block          */
+    map_free_func       free;       /* frees a block            */
+};
+
 /*-------------------------------------------------
                       VARIABLES
 -------------------------------------------------*/
@@ -49,7 +69,10 @@ typedef void (*disp_callback)( void *data );
 
 struct map *create_map
 (
-    void
+    const struct map_allocator_type
+               *alloc,  /* allocator, or NULL   */
+                        /*  for libc's          */
+    void       *user    /* allocator's state    */
 );
 
 map_error_code_t8 init_dynamic_map
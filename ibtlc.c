@@ -0,0 +1,1319 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       ibtlc.c
+*
+*   DESCRIPTION:
+*       Command-line compiler. Compiles one IBTL
+*       source file to Gforth, written to a
+*       file or to standard output, so it can be
+*       piped straight into gforth. Given more
+*       than one source, or a directory, it
+*       compiles them all on a thread pool, each
+*       to a .fs file of its own. With a cache
+*       directory, output for a source that was
+*       compiled before is copied from there.
+*       With a state directory, only the
+*       top-level forms that changed since the
+*       last compilation are compiled again.
+*       With -x, the program is run in-process
+*       instead, printing what Gforth would,
+*       and with -p its statements are
+*       profiled as it runs. With --trace, a
+*       timeline of what each thread did is
+*       written as it exits. With -X, each
+*       program is run in-process twice, with
+*       its loops compiled to machine code and
+*       without, to check the two print the
+*       same.
+*
+*   USAGE:
+*       ibtlc [options] [-o file] source
+*       ibtlc [options] [-j jobs] [-d dir]
+*             source|directory...
+*       ibtlc [options] -X source|directory...
+*
+*       options: [-t] [-O0] [-r] [-c cache]
+*                [-l MiB] [-i state] [-s] [-x]
+*                [-p profile] [--stats]
+*                [--stats-json file]
+*                [--trace file]
+*
+*       -t   runs the scanner and parser on
+*            threads of their own
+*       -O0  doesn't fold constants or run the
+*            peephole optimizer
+*       -r   reports the peephole rewrites made
+*            by each rule on stderr
+*       -o   writes to file instead of stdout.
+*            Nothing is written, and an old file
+*            is removed, if the source doesn't
+*            compile.
+*       -j   compiles on this many threads; the
+*            default is one per online CPU
+*       -d   writes the .fs files to dir instead
+*            of next to their sources
+*       -c   caches output in the cache directory
+*       -l   trims the cache to this many MiB
+*            after compiling; the default is 256
+*       -i   keeps each source's forms and
+*            their output in the state
+*            directory, and reuses the output
+*            of the forms that haven't changed
+*       -s   reports cache hits and misses,
+*            forms reused, and with -x the
+*            opcodes dispatched and loops
+*            compiled, on stderr
+*       -x   runs a single source on the
+*            bytecode interpreter, writing what
+*            it prints instead of its Gforth
+*       -p   with -x, counts and times each
+*            statement as it runs, and writes
+*            where the time went, by source
+*            line, to the profile file, and
+*            folded stacks for a flame graph to
+*            the profile file with ".folded"
+*            added
+*       --stats
+*            reports, for a single source, the
+*            wall and CPU time of each phase
+*            and what it allocated, the tokens,
+*            nodes and forms, and the peak RSS,
+*            on stderr
+*       --stats-json
+*            writes the same to file, as JSON
+*       --trace
+*            writes, as it exits, when each
+*            thread was in each phase, ran each
+*            job, waited on another stage,
+*            resized a hash map or looked in
+*            the cache, to file as Chrome trace
+*            events for Perfetto
+*       -X   runs each source on the bytecode
+*            interpreter with every loop
+*            compiled to machine code, and
+*            again with none, and reports the
+*            sources whose output differs
+*
+*       A directory stands for the .ibtl files
+*       in it.
+*
+*   BUILD:
+*       cc -O2 -o ibtlc ibtlc.c batch.c cache.c
+*          incremental.c hash.c vm.c jit.c
+*          bytecode.c profile.c
+*          compiler.c emit.c peephole.c fold.c
+*          eval.c typecheck.c
+*          arena.c pipeline.c spsc_queue.c
+*          parser.c ast.c scanner.c number.c
+*          srcloc.c symbol_table.c hashmap.c
+*          stats.c trace.c
+*          -lm -lpthread
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "cache.h"
+#include "compiler.h"
+#include "incremental.h"
+#include "srcloc.h"
+#include "stats.h"
+#include "symbol_table.h"
+#include "trace.h"
+#include "types.h"
+#include "vm.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __SOURCE_EXT        ".ibtl" /* sources in a directory           */
+#define __OUTPUT_EXT        ".fs"   /* compiled files in batch mode     */
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+The command line
+-------------------------------------*/
+struct __args_type
+{
+    struct compile_options_type
+                        opts;           /* compiler options         */
+    boolean             rules;          /* report rewrites?         */
+    boolean             batch;          /* compile on a pool?       */
+    uint                num_threads;    /* threads for a batch      */
+    const char         *out;            /* output file or NULL      */
+    const char         *dir;            /* output directory or NULL */
+    const char         *cache_dir;      /* cache directory or NULL  */
+    uint64              cache_limit;    /* bytes the cache keeps    */
+    const char         *state_dir;      /* form state directory or  */
+                                        /*  NULL                    */
+    boolean             cache_stats;    /* report on the cache?     */
+    boolean             run;            /* run instead of compile?  */
+    boolean             check_jit;      /* compare compiled loops   */
+                                        /*  with the interpreter?   */
+    boolean             phase_stats;    /* report on the phases?    */
+    const char         *stats_json;     /* file to write them to as */
+                                        /*  JSON, or NULL           */
+    struct stats_type   stats;          /* phases of the compile    */
+    const char         *trace;          /* trace file or NULL       */
+    char              **sources;        /* sources and directories  */
+    uint                num_sources;    /* how many                 */
+};
+
+/*-------------------------------------
+Jobs for a batch, as they are found
+-------------------------------------*/
+struct __job_list_type
+{
+    struct batch_job_type
+                       *jobs;           /* jobs found               */
+    uint                num_jobs;       /* jobs in use              */
+    uint                job_cap;        /* jobs allocated           */
+};
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static boolean __parse_args
+(
+    int                     argc,   /* number of arguments      */
+    char                  **argv,   /* arguments                */
+    struct __args_type     *args    /* parsed command line      */
+);
+
+static int __is_source
+(
+    const struct dirent    *ent     /* directory entry          */
+);
+
+static boolean __add_job
+(
+    struct __job_list_type *list,   /* jobs                     */
+    const char             *in,     /* source file              */
+    const char             *dir,    /* output directory or NULL */
+    const char             *state_dir
+                                    /* state directory or NULL  */
+);
+
+static boolean __add_source
+(
+    struct __job_list_type *list,   /* jobs                     */
+    const char             *path,   /* source or directory      */
+    const char             *dir,    /* output directory or NULL */
+    const char             *state_dir
+                                    /* state directory or NULL  */
+);
+
+static void __report_rules
+(
+    const uint64           *counts  /* rewrites by rule         */
+);
+
+static void __report_stats
+(
+    const struct __args_type
+                           *args,   /* command line             */
+    const char             *in,     /* source file              */
+    uint                    len,    /* source length            */
+    const struct compile_result_type
+                           *result  /* outcome                  */
+);
+
+static boolean __copy_output
+(
+    FILE                   *fp      /* compiled output          */
+);
+
+static int __compile_one
+(
+    const struct __args_type
+                           *args,   /* command line             */
+    struct cache_type      *cache   /* output cache, or NULL    */
+);
+
+static int __compile_batch
+(
+    const struct __args_type
+                           *args,   /* command line             */
+    struct cache_type      *cache   /* output cache, or NULL    */
+);
+
+static boolean __same_output
+(
+    FILE                   *a,      /* one output               */
+    FILE                   *b       /* the other                */
+);
+
+static int __check_jit
+(
+    const struct __args_type
+                           *args    /* command line             */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __parse_args - "Parse Arguments"
+*
+*   DESCRIPTION:
+*       Parses the command line into compiler
+*       options and file names. The sources are
+*       gathered at the front of argv, in the
+*       order they were given.
+*
+*   RETURNS:
+*       Returns FALSE on an unknown option, a
+*       missing source file, -o or -x in
+*       batch mode, -o or -x with -X, -p
+*       without -x, or --stats or --stats-json
+*       with more than one source or -X.
+*
+**************************************************/
+static boolean __parse_args
+(
+    int                     argc,   /* number of arguments      */
+    char                  **argv,   /* arguments                */
+    struct __args_type     *args    /* parsed command line      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    int     i;      /* for-loop iterator    */
+    long    cpus;   /* online CPUs          */
+
+    memset( args, 0, sizeof( *args ) );
+    init_compile_options( &args->opts );
+    cpus              = sysconf( _SC_NPROCESSORS_ONLN );
+    args->num_threads = ( cpus > 0 ) ? (uint)cpus : 1;
+    args->cache_limit = CACHE_DEFAULT_LIMIT;
+    args->sources     = &argv[ 1 ];
+
+    for( i = 1; i < argc; ++i )
+    {
+        if( 0 == strcmp( argv[ i ], "-t" ) )
+        {
+            args->opts.threaded = TRUE;
+        }
+        else if( 0 == strcmp( argv[ i ], "-O0" ) )
+        {
+            args->opts.fold     = FALSE;
+            args->opts.peephole = FALSE;
+        }
+        else if( 0 == strcmp( argv[ i ], "-r" ) )
+        {
+            args->rules = TRUE;
+        }
+        else if( ( 0 == strcmp( argv[ i ], "-o" ) )
+              && ( i + 1 < argc ) )
+        {
+            args->out = argv[ ++i ];
+        }
+        else if( ( 0 == strcmp( argv[ i ], "-j" ) )
+              && ( i + 1 < argc )
+              && ( atoi( argv[ i + 1 ] ) > 0 ) )
+        {
+            args->num_threads = (uint)atoi( argv[ ++i ] );
+            args->batch       = TRUE;
+        }
+        else if( ( 0 == strcmp( argv[ i ], "-d" ) )
+              && ( i + 1 < argc ) )
+        {
+            args->dir   = argv[ ++i ];
+            args->batch = TRUE;
+        }
+        else if( ( 0 == strcmp( argv[ i ], "-c" ) )
+              && ( i + 1 < argc ) )
+        {
+            args->cache_dir = argv[ ++i ];
+        }
+        else if( ( 0 == strcmp( argv[ i ], "-l" ) )
+              && ( i + 1 < argc ) )
+        {
+            args->cache_limit = (uint64)strtoull( argv[ ++i ], NULL, 10 ) << 20;
+        }
+        else if( ( 0 == strcmp( argv[ i ], "-i" ) )
+              && ( i + 1 < argc ) )
+        {
+            args->state_dir = argv[ ++i ];
+        }
+        else if( 0 == strcmp( argv[ i ], "-s" ) )
+        {
+            args->cache_stats = TRUE;
+        }
+        else if( 0 == strcmp( argv[ i ], "-x" ) )
+        {
+            args->run = TRUE;
+        }
+        else if( ( 0 == strcmp( argv[ i ], "-p" ) )
+              && ( i + 1 < argc ) )
+        {
+            args->opts.profile = argv[ ++i ];
+        }
+        else if( 0 == strcmp( argv[ i ], "--stats" ) )
+        {
+            args->phase_stats = TRUE;
+        }
+        else if( ( 0 == strcmp( argv[ i ], "--stats-json" ) )
+              && ( i + 1 < argc ) )
+        {
+            args->stats_json = argv[ ++i ];
+        }
+        else if( ( 0 == strcmp( argv[ i ], "--trace" ) )
+              && ( i + 1 < argc ) )
+        {
+            args->trace = argv[ ++i ];
+        }
+        else if( 0 == strcmp( argv[ i ], "-X" ) )
+        {
+            args->check_jit = TRUE;
+        }
+        else if( '-' != argv[ i ][ 0 ] )
+        {
+            args->sources[ args->num_sources++ ] = argv[ i ];
+        }
+        else
+        {
+            return( FALSE );
+        }
+    }
+
+    if( args->num_sources > 1 )
+    {
+        args->batch = TRUE;
+    }
+
+    if( ( NULL != args->opts.profile )
+     && !args->run )
+    {
+        return( FALSE );
+    }
+
+    if( ( args->phase_stats || ( NULL != args->stats_json ) )
+     && ( args->batch || args->check_jit ) )
+    {
+        return( FALSE );
+    }
+
+    if( args->check_jit )
+    {
+        return( ( 0 != args->num_sources ) && ( NULL == args->out ) && !args->run );
+    }
+
+    return( ( 0 != args->num_sources )
+         && ( !args->batch || ( ( NULL == args->out ) && !args->run ) ) );
+
+}   /* __parse_args() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __is_source - "Is Source"
+*
+*   DESCRIPTION:
+*       scandir() filter for the names of IBTL
+*       sources.
+*
+**************************************************/
+static int __is_source
+(
+    const struct dirent    *ent     /* directory entry          */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    size_t      len;            /* length of the name       */
+
+    len = strlen( ent->d_name );
+    return( ( len > sizeof( __SOURCE_EXT ) - 1 )
+         && ( 0 == strcmp( &ent->d_name[ len - ( sizeof( __SOURCE_EXT ) - 1 ) ], __SOURCE_EXT ) ) );
+
+}   /* __is_source() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __add_job - "Add Job"
+*
+*   DESCRIPTION:
+*       Adds a job for a source file. The
+*       output goes next to the source, or in
+*       dir, with the source's extension
+*       replaced by __OUTPUT_EXT. With a state
+*       directory, the job gets a state file
+*       there.
+*
+*   RETURNS:
+*       Returns FALSE if out of memory.
+*
+**************************************************/
+static boolean __add_job
+(
+    struct __job_list_type *list,   /* jobs                     */
+    const char             *in,     /* source file              */
+    const char             *dir,    /* output directory or NULL */
+    const char             *state_dir
+                                    /* state directory or NULL  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct batch_job_type  *jobs;   /* grown job array          */
+    const char             *base;   /* start of the output name */
+    const char             *dot;    /* start of the extension   */
+    char                   *out;    /* output file              */
+    char                   *in_copy;/* source file              */
+    char                   *state;  /* state file or NULL       */
+    size_t                  len;    /* length kept of the name  */
+
+    if( list->num_jobs == list->job_cap )
+    {
+        list->job_cap = ( 0 == list->job_cap ) ? 64 : 2 * list->job_cap;
+        jobs          = (struct batch_job_type *)realloc( list->jobs, list->job_cap * sizeof( *jobs ) );
+        if( NULL == jobs )
+        {
+            return( FALSE );
+        }
+        list->jobs = jobs;
+    }
+
+    base = in;
+    if( NULL != dir )
+    {
+        base = strrchr( in, '/' );
+        base = ( NULL == base ) ? in : base + 1;
+    }
+    dot = strrchr( base, '.' );
+    len = ( ( NULL == dot ) || ( NULL != strchr( dot, '/' ) ) ) ? strlen( base ) : (size_t)( dot - base );
+
+    in_copy = strdup( in );
+    out     = (char *)malloc( ( ( NULL == dir ) ? 0 : strlen( dir ) + 1 ) + len + sizeof( __OUTPUT_EXT ) );
+    state   = ( NULL == state_dir ) ? NULL : make_state_path( state_dir, in );
+    if( ( NULL == in_copy )
+     || ( NULL == out )
+     || ( ( NULL != state_dir ) && ( NULL == state ) ) )
+    {
+        free( in_copy );
+        free( out );
+        free( state );
+        return( FALSE );
+    }
+
+    if( NULL == dir )
+    {
+        sprintf( out, "%.*s%s", (int)len, base, __OUTPUT_EXT );
+    }
+    else
+    {
+        sprintf( out, "%s/%.*s%s", dir, (int)len, base, __OUTPUT_EXT );
+    }
+
+    memset( &list->jobs[ list->num_jobs ], 0, sizeof( list->jobs[ 0 ] ) );
+    list->jobs[ list->num_jobs ].in    = in_copy;
+    list->jobs[ list->num_jobs ].out   = out;
+    list->jobs[ list->num_jobs ].state = state;
+    ++list->num_jobs;
+
+    return( TRUE );
+
+}   /* __add_job() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __add_source - "Add Source"
+*
+*   DESCRIPTION:
+*       Adds a job for a source file, or for
+*       each .ibtl file in a directory, in name
+*       order.
+*
+*   RETURNS:
+*       Returns FALSE if out of memory or if a
+*       directory couldn't be read.
+*
+**************************************************/
+static boolean __add_source
+(
+    struct __job_list_type *list,   /* jobs                     */
+    const char             *path,   /* source or directory      */
+    const char             *dir,    /* output directory or NULL */
+    const char             *state_dir
+                                    /* state directory or NULL  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct stat     st;             /* file status              */
+    struct dirent **names;          /* sources in the directory */
+    char           *in;             /* path of a source         */
+    int             num_names;      /* how many                 */
+    int             i;              /* for-loop iterator        */
+    boolean         ok;             /* all added?               */
+
+    if( ( 0 != stat( path, &st ) )
+     || ( !S_ISDIR( st.st_mode ) ) )
+    {
+        return( __add_job( list, path, dir, state_dir ) );
+    }
+
+    num_names = scandir( path, &names, __is_source, alphasort );
+    if( num_names < 0 )
+    {
+        return( FALSE );
+    }
+
+    ok = TRUE;
+    for( i = 0; i < num_names; ++i )
+    {
+        in = (char *)malloc( strlen( path ) + strlen( names[ i ]->d_name ) + 2 );
+        if( NULL == in )
+        {
+            ok = FALSE;
+        }
+        else
+        {
+            sprintf( in, "%s/%s", path, names[ i ]->d_name );
+            ok = ok && __add_job( list, in, dir, state_dir );
+            free( in );
+        }
+        free( names[ i ] );
+    }
+    free( names );
+
+    return( ok );
+
+}   /* __add_source() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __report_rules - "Report Rules"
+*
+*   DESCRIPTION:
+*       Prints how often each peephole rule
+*       fired, skipping the ones that didn't.
+*
+**************************************************/
+static void __report_rules
+(
+    const uint64           *counts  /* rewrites by rule         */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint64  total;      /* rewrites by all rules    */
+    uint    i;          /* for-loop iterator        */
+
+    total = 0;
+    for( i = 0; i < PEEP_NUM_RULES; ++i )
+    {
+        if( 0 != counts[ i ] )
+        {
+            fprintf( stderr, "%-24s %10llu\n", peep_rule_str( (peep_rule_t8)i ), (unsigned long long)counts[ i ] );
+            total += counts[ i ];
+        }
+    }
+    fprintf( stderr, "%-24s %10llu\n", "total", (unsigned long long)total );
+
+}   /* __report_rules() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __report_stats - "Report Statistics"
+*
+*   DESCRIPTION:
+*       Prints the statistics of a single
+*       source's phases on stderr, and writes
+*       them as JSON, as the command line
+*       asks.
+*
+**************************************************/
+static void __report_stats
+(
+    const struct __args_type
+                           *args,   /* command line             */
+    const char             *in,     /* source file              */
+    uint                    len,    /* source length            */
+    const struct compile_result_type
+                           *result  /* outcome                  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct stats_type  *stats;      /* statistics               */
+    FILE               *fp;         /* JSON file                */
+
+    stats            = args->opts.stats;
+    stats->forms     = result->num_forms;
+    stats->bytes_in  = len;
+    stats->bytes_out = result->bytes_out;
+    if( args->phase_stats )
+    {
+        write_stats( stats, stderr, in );
+    }
+
+    if( NULL != args->stats_json )
+    {
+        fp = fopen( args->stats_json, "w" );
+        if( NULL != fp )
+        {
+            write_stats_json( stats, fp, in );
+        }
+        if( ( NULL == fp )
+         || ( 0 != fclose( fp ) ) )
+        {
+            fprintf( stderr, "unable to write %s\n", args->stats_json );
+        }
+    }
+
+}   /* __report_stats() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __copy_output - "Copy Output"
+*
+*   DESCRIPTION:
+*       Copies a temporary file of compiled
+*       output to stdout from the start.
+*
+*   RETURNS:
+*       Returns FALSE if it couldn't all be
+*       copied.
+*
+**************************************************/
+static boolean __copy_output
+(
+    FILE                   *fp      /* compiled output          */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char        buf[ 4096 ];    /* bytes being copied       */
+    size_t      len;            /* bytes read               */
+
+    rewind( fp );
+    while( 0 != ( len = fread( buf, 1, sizeof( buf ), fp ) ) )
+    {
+        if( len != fwrite( buf, 1, len, stdout ) )
+        {
+            return( FALSE );
+        }
+    }
+
+    return( !ferror( fp ) && ( 0 == fflush( stdout ) ) );
+
+}   /* __copy_output() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __compile_one - "Compile One"
+*
+*   DESCRIPTION:
+*       Compiles a single source file to the
+*       output file or stdout, or runs it.
+*       Compiled output goes to a temporary
+*       file first and only reaches the output
+*       file or stdout if the whole source
+*       compiled, so a failure leaves nothing
+*       a build could take as up to date.
+*
+*   RETURNS:
+*       Returns the exit status.
+*
+**************************************************/
+static int __compile_one
+(
+    const struct __args_type
+                           *args,   /* command line             */
+    struct cache_type      *cache   /* output cache, or NULL    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct compile_result_type  result;     /* outcome              */
+    struct line_table_type      lt;         /* source lines         */
+    const char                 *in;         /* source file          */
+    char                       *src;        /* source               */
+    char                       *state;      /* state file or NULL   */
+    char                       *temp;       /* temporary output     */
+                                            /*  file's name         */
+    FILE                       *staged;     /* output for stdout    */
+    uint                        len;        /* source length        */
+    int                         fd;         /* output               */
+
+    in    = args->sources[ 0 ];
+    src   = read_source_file( in, &len );
+    state = ( NULL == args->state_dir ) ? NULL : make_state_path( args->state_dir, in );
+    if( ( NULL == src )
+     || ( ( NULL != args->state_dir ) && ( NULL == state ) ) )
+    {
+        fprintf( stderr, "unable to read %s\n", in );
+        free( src );
+        free( state );
+        return( 2 );
+    }
+
+    /*---------------------------------
+    A run's output is what the program
+    prints, so it goes to stdout as it
+    is printed
+    ---------------------------------*/
+    fd     = STDOUT_FILENO;
+    temp   = NULL;
+    staged = NULL;
+    if( NULL != args->out )
+    {
+        fd = open_output_file( args->out, &temp );
+    }
+    else if( !args->run )
+    {
+        staged = tmpfile();
+        fd     = ( NULL == staged ) ? -1 : fileno( staged );
+    }
+    if( fd < 0 )
+    {
+        fprintf( stderr, "unable to write %s\n", ( NULL == args->out ) ? "a temporary file" : args->out );
+        free( src );
+        free( state );
+        return( 2 );
+    }
+
+    if( args->run )
+    {
+        run_buffer( src, len, fd, &args->opts, &result );
+    }
+    else if( NULL != cache )
+    {
+        cache_compile( cache, src, len, fd, &args->opts, state, &result );
+    }
+    else
+    {
+        compile_incremental( src, len, fd, &args->opts, state, &result );
+    }
+
+    if( NULL != temp )
+    {
+        if( !close_output_file( fd, args->out, temp, COMPILE_NO_ERROR == result.error )
+         && ( COMPILE_NO_ERROR == result.error ) )
+        {
+            result.error   = COMPILE_WRITE_ERROR;
+            result.message = compile_error_str( COMPILE_WRITE_ERROR );
+        }
+    }
+    else if( NULL != staged )
+    {
+        if( ( COMPILE_NO_ERROR == result.error )
+         && !__copy_output( staged ) )
+        {
+            result.error   = COMPILE_WRITE_ERROR;
+            result.message = compile_error_str( COMPILE_WRITE_ERROR );
+        }
+        fclose( staged );
+    }
+
+    if( ( COMPILE_PARSE_ERROR == result.error )
+     || ( COMPILE_TYPE_ERROR == result.error )
+     || ( COMPILE_RUN_ERROR == result.error ) )
+    {
+        init_line_table( &lt, src, len );
+        report_diagnostic( &lt, stderr, in, result.error_offset, result.message );
+        free_line_table( &lt );
+    }
+    else if( COMPILE_NO_ERROR != result.error )
+    {
+        fprintf( stderr, "%s: %s\n", in, result.message );
+    }
+
+    if( args->rules )
+    {
+        __report_rules( result.peep_counts );
+    }
+    if( args->cache_stats
+     && ( NULL != state ) )
+    {
+        fprintf( stderr, "forms: %u reused, %u compiled\n", result.num_reused, result.num_forms - result.num_reused );
+    }
+    if( args->cache_stats
+     && args->run )
+    {
+        fprintf( stderr, "dispatches: %llu, loops compiled: %u\n", (unsigned long long)result.dispatches, result.jit_loops );
+    }
+    if( NULL != args->opts.stats )
+    {
+        __report_stats( args, in, len, &result );
+    }
+    free( src );
+    free( state );
+
+    if( COMPILE_NO_ERROR == result.error )
+    {
+        return( 0 );
+    }
+    return( ( COMPILE_PARSE_ERROR == result.error ) || ( COMPILE_TYPE_ERROR == result.error ) || ( COMPILE_RUN_ERROR == result.error ) ? 1 : 2 );
+
+}   /* __compile_one() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __compile_batch - "Compile Batch"
+*
+*   DESCRIPTION:
+*       Compiles every source, and every source
+*       in every directory, on a thread pool.
+*       Diagnostics are printed in the order
+*       the sources were given, once all of
+*       them are compiled.
+*
+*   RETURNS:
+*       Returns the worst exit status of any
+*       source.
+*
+**************************************************/
+static int __compile_batch
+(
+    const struct __args_type
+                           *args,   /* command line             */
+    struct cache_type      *cache   /* output cache, or NULL    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __job_list_type  list;       /* jobs                 */
+    struct batch_job_type  *job;        /* job being reported   */
+    batch_error_t8          error;      /* pool's error         */
+    uint64                  counts[ PEEP_NUM_RULES ];
+                                        /* rewrites by rule     */
+    uint64                  steals;     /* jobs stolen          */
+    uint64                  num_forms;  /* forms in all sources */
+    uint64                  num_reused; /* forms reused         */
+    uint                    i;          /* job index            */
+    uint                    j;          /* rule index           */
+    int                     status;     /* exit status          */
+
+    memset( &list, 0, sizeof( list ) );
+    memset( counts, 0, sizeof( counts ) );
+    num_forms  = 0;
+    num_reused = 0;
+    status     = 0;
+    for( i = 0; i < args->num_sources; ++i )
+    {
+        if( !__add_source( &list, args->sources[ i ], args->dir, args->state_dir ) )
+        {
+            fprintf( stderr, "unable to read %s\n", args->sources[ i ] );
+            status = 2;
+        }
+    }
+
+    error = run_batch( list.jobs, list.num_jobs, args->num_threads, &args->opts, cache, &steals );
+    if( BATCH_NO_ERROR != error )
+    {
+        fprintf( stderr, "%s\n", batch_error_str( error ) );
+        status = 2;
+    }
+
+    for( i = 0; ( BATCH_NO_ERROR == error ) && ( i < list.num_jobs ); ++i )
+    {
+        job = &list.jobs[ i ];
+        if( NULL != job->report )
+        {
+            fputs( job->report, stderr );
+        }
+        if( job->status > status )
+        {
+            status = job->status;
+        }
+        for( j = 0; j < PEEP_NUM_RULES; ++j )
+        {
+            counts[ j ] += job->result.peep_counts[ j ];
+        }
+        num_forms  += job->result.num_forms;
+        num_reused += job->result.num_reused;
+    }
+
+    if( args->rules )
+    {
+        __report_rules( counts );
+    }
+    if( args->cache_stats
+     && ( NULL != args->state_dir ) )
+    {
+        fprintf( stderr, "forms: %llu reused, %llu compiled\n", (unsigned long long)num_reused, (unsigned long long)( num_forms - num_reused ) );
+    }
+
+    for( i = 0; i < list.num_jobs; ++i )
+    {
+        free_batch_job( &list.jobs[ i ] );
+        free( (char *)list.jobs[ i ].in );
+        free( (char *)list.jobs[ i ].out );
+        free( (char *)list.jobs[ i ].state );
+    }
+    free( list.jobs );
+
+    return( status );
+
+}   /* __compile_batch() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __same_output - "Same Output"
+*
+*   DESCRIPTION:
+*       Compares two temporary files from the
+*       start.
+*
+*   RETURNS:
+*       Returns TRUE if they hold the same
+*       bytes.
+*
+**************************************************/
+static boolean __same_output
+(
+    FILE                   *a,      /* one output               */
+    FILE                   *b       /* the other                */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char        buf_a[ 4096 ];  /* bytes of a               */
+    char        buf_b[ 4096 ];  /* bytes of b               */
+    size_t      len_a;          /* read from a              */
+    size_t      len_b;          /* read from b              */
+
+    rewind( a );
+    rewind( b );
+    do
+    {
+        len_a = fread( buf_a, 1, sizeof( buf_a ), a );
+        len_b = fread( buf_b, 1, sizeof( buf_b ), b );
+        if( ( len_a != len_b )
+         || ( 0 != memcmp( buf_a, buf_b, len_a ) ) )
+        {
+            return( FALSE );
+        }
+    } while( 0 != len_a );
+
+    return( !ferror( a ) && !ferror( b ) );
+
+}   /* __same_output() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __check_jit - "Check JIT"
+*
+*   DESCRIPTION:
+*       Runs every source, and every source in
+*       every directory, once with each loop
+*       compiled to machine code the first
+*       time it is taken and once on the
+*       interpreter alone, and compares what
+*       they print and how they end. Sources
+*       that differ are named on stderr, then
+*       a summary.
+*
+*   RETURNS:
+*       Returns 1 if any source differs, 2 if
+*       one couldn't be run, and 0 otherwise.
+*
+**************************************************/
+static int __check_jit
+(
+    const struct __args_type
+                           *args    /* command line             */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __job_list_type  list;       /* sources              */
+    struct compile_options_type
+                            opts;       /* options of a run     */
+    struct compile_result_type
+                            results[ 2 ];
+                                        /* with and without     */
+    FILE                   *outs[ 2 ];  /* what each printed    */
+    const char             *in;         /* source file          */
+    char                   *src;        /* source               */
+    uint                    len;        /* source length        */
+    uint                    num_same;   /* sources that agree   */
+    uint                    num_differ; /* sources that don't   */
+    uint                    num_loops;  /* loops compiled       */
+    uint                    i;          /* source index         */
+    uint                    j;          /* run index            */
+    int                     status;     /* exit status          */
+
+    memset( &list, 0, sizeof( list ) );
+    num_same   = 0;
+    num_differ = 0;
+    num_loops  = 0;
+    status     = 0;
+    for( i = 0; i < args->num_sources; ++i )
+    {
+        if( !__add_source( &list, args->sources[ i ], NULL, NULL ) )
+        {
+            fprintf( stderr, "unable to read %s\n", args->sources[ i ] );
+            status = 2;
+        }
+    }
+
+    opts = args->opts;
+    for( i = 0; i < list.num_jobs; ++i )
+    {
+        in        = list.jobs[ i ].in;
+        src       = read_source_file( in, &len );
+        outs[ 0 ] = tmpfile();
+        outs[ 1 ] = tmpfile();
+        if( ( NULL == src )
+         || ( NULL == outs[ 0 ] )
+         || ( NULL == outs[ 1 ] ) )
+        {
+            fprintf( stderr, "unable to run %s\n", in );
+            status = 2;
+        }
+        else
+        {
+            for( j = 0; j < 2; ++j )
+            {
+                opts.jit_trips = ( 0 == j ) ? 1 : 0;
+                run_buffer( src, len, fileno( outs[ j ] ), &opts, &results[ j ] );
+            }
+            num_loops += results[ 0 ].jit_loops;
+
+            if( ( results[ 0 ].error == results[ 1 ].error )
+             && ( results[ 0 ].error_offset == results[ 1 ].error_offset )
+             && ( results[ 0 ].bytes_out == results[ 1 ].bytes_out )
+             && __same_output( outs[ 0 ], outs[ 1 ] ) )
+            {
+                ++num_same;
+            }
+            else
+            {
+                fprintf( stderr, "%s: compiled loops print differently from the interpreter\n", in );
+                ++num_differ;
+            }
+        }
+
+        for( j = 0; j < 2; ++j )
+        {
+            if( NULL != outs[ j ] )
+            {
+                fclose( outs[ j ] );
+            }
+        }
+        free( src );
+    }
+
+    fprintf( stderr, "jit: %u sources agree, %u differ, %u loops compiled\n", num_same, num_differ, num_loops );
+
+    for( i = 0; i < list.num_jobs; ++i )
+    {
+        free( (char *)list.jobs[ i ].in );
+        free( (char *)list.jobs[ i ].out );
+        free( (char *)list.jobs[ i ].state );
+    }
+    free( list.jobs );
+
+    if( 0 != num_differ )
+    {
+        return( 1 );
+    }
+    return( status );
+
+}   /* __check_jit() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       main - "Main"
+*
+*   DESCRIPTION:
+*       Compiles the source files.
+*
+*   RETURNS:
+*       Returns 0 on success, 1 if a program
+*       has an error and 2 if one couldn't be
+*       compiled for any other reason.
+*
+**************************************************/
+int main
+(
+    int         argc,   /* number of arguments  */
+    char      **argv    /* arguments            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __args_type  args;       /* command line         */
+    struct cache_type   cache;      /* output cache         */
+    struct cache_type  *cp;         /* cache in use or NULL */
+    struct stats_type  *sp;         /* statistics or NULL   */
+    struct stats_clock_type
+                        clock;      /* times the symbols    */
+    struct stat         st;         /* source's status      */
+    cache_error_t8      error;      /* cache's error        */
+    uint64              kept;       /* bytes left in cache  */
+    int                 status;     /* exit status          */
+
+    if( !__parse_args( argc, argv, &args ) )
+    {
+        fprintf( stderr, "usage: %s [options] [-o file] source\n"
+                         "       %s [options] [-j jobs] [-d dir] source|directory...\n"
+                         "       %s [options] -X source|directory...\n"
+                         "options: [-t] [-O0] [-r] [-c cache] [-l MiB] [-i state] [-s] [-x] [-p profile]\n"
+                         "         [--stats] [--stats-json file] [--trace file]\n", argv[ 0 ], argv[ 0 ], argv[ 0 ] );
+        return( 2 );
+    }
+
+    if( NULL != args.trace )
+    {
+        init_trace();
+    }
+
+    init_stats( &args.stats );
+    sp = ( args.phase_stats || ( NULL != args.stats_json ) ) ? &args.stats : NULL;
+    if( NULL != sp )
+    {
+        count_allocs();
+    }
+    stats_start( sp, STATS_SYMBOLS, &clock );
+    if( SYM_NO_ERROR != init_symbol_table() )
+    {
+        fprintf( stderr, "unable to initialize the symbol table\n" );
+        return( 2 );
+    }
+    stats_stop( sp, STATS_SYMBOLS, &clock );
+
+    if( ( !args.batch )
+     && ( !args.run )
+     && ( NULL == args.out )
+     && ( 0 == stat( args.sources[ 0 ], &st ) )
+     && ( S_ISDIR( st.st_mode ) ) )
+    {
+        args.batch = TRUE;
+    }
+
+    /*---------------------------------
+    A directory's sources are compiled
+    on a pool, so can't share one set
+    of statistics
+    ---------------------------------*/
+    if( ( NULL != sp )
+     && args.batch )
+    {
+        fprintf( stderr, "--stats needs a single source\n" );
+        sp = NULL;
+    }
+    args.opts.stats = sp;
+
+    /*---------------------------------
+    A cache that can't be used only
+    costs the speed-up
+    ---------------------------------*/
+    cp = NULL;
+    if( NULL != args.cache_dir )
+    {
+        error = init_cache( &cache, args.cache_dir, args.cache_limit );
+        if( CACHE_NO_ERROR == error )
+        {
+            cp = &cache;
+        }
+        else
+        {
+            fprintf( stderr, "%s: %s\n", args.cache_dir, cache_error_str( error ) );
+        }
+    }
+
+    /*---------------------------------
+    Nor can a state directory
+    ---------------------------------*/
+    if( ( NULL != args.state_dir )
+     && ( 0 != mkdir( args.state_dir, 0755 ) )
+     && ( EEXIST != errno ) )
+    {
+        fprintf( stderr, "%s: unable to make the state directory\n", args.state_dir );
+        args.state_dir = NULL;
+    }
+
+    if( args.check_jit )
+    {
+        status = __check_jit( &args );
+    }
+    else
+    {
+        status = args.batch ? __compile_batch( &args, cp ) : __compile_one( &args, cp );
+    }
+
+    if( NULL != cp )
+    {
+        kept = trim_cache( cp );
+        if( args.cache_stats )
+        {
+            fprintf( stderr, "cache: %llu hits, %llu misses, %llu stored, %llu evicted, %llu bytes copied, %llu bytes kept\n",
+                     (unsigned long long)atomic_load( &cp->hits ),
+                     (unsigned long long)atomic_load( &cp->misses ),
+                     (unsigned long long)atomic_load( &cp->stores ),
+                     (unsigned long long)atomic_load( &cp->evictions ),
+                     (unsigned long long)atomic_load( &cp->bytes_copied ),
+                     (unsigned long long)kept );
+        }
+        free_cache( cp );
+    }
+    unload_tables();
+
+    if( ( NULL != args.trace )
+     && !write_trace( args.trace ) )
+    {
+        fprintf( stderr, "unable to write %s\n", args.trace );
+    }
+
+    return( status );
+
+}   /* main() */
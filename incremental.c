@@ -0,0 +1,1546 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       incremental.c
+*
+*   DESCRIPTION:
+*       Recompiles a source one top-level form
+*       at a time. Each form is fingerprinted by
+*       a hash of its text and by the bindings
+*       of the variables it uses or declares,
+*       and its output is saved in a state file
+*       along with the fingerprint. On the next
+*       run a form whose text and bindings are
+*       unchanged isn't parsed or checked: the
+*       variables it declares are bound again
+*       and its saved output is spliced in. Only
+*       the other forms are compiled, each run
+*       of them through the usual pipeline, so
+*       the work done after an edit grows with
+*       the edit rather than with the source.
+*
+*       The output of a form depends on nothing
+*       but its text and those bindings: the
+*       emitter starts every form on a line of
+*       its own, the peephole optimizer doesn't
+*       look across lines, and the variables a
+*       form binds are declared right before
+*       its code.
+*
+*       A binding's index is part of the
+*       variable's Gforth name, so adding or
+*       removing a variable renames the ones
+*       bound after it, and the forms that use
+*       them are compiled again.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ast.h"
+#include "compiler.h"
+#include "emit.h"
+#include "fold.h"
+#include "hash.h"
+#include "incremental.h"
+#include "pipeline.h"
+#include "stats.h"
+#include "tokens.h"
+#include "trace.h"
+#include "typecheck.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __STATE_MAGIC       "IBTLFRM1"  /* first bytes of a state file      */
+#define __STATE_BUFFER      65536       /* stdio buffer for writing state   */
+#define __STATE_ALIGN       8           /* alignment of the records         */
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A state file is a header, then the
+bindings of the run that saved it:
+
+    binding header, name        x num_bindings - 1
+
+padded to __STATE_ALIGN, then a record
+per form in source order:
+
+    record header
+    binding index               x num_deps
+
+then the output of every form, in the
+same order, so the output of a stretch
+of unchanged forms can be written with
+one call. A form refers to variables
+by their index in the saved bindings,
+so each name is saved once. The file
+is in the machine's own byte order,
+since state never leaves the machine.
+
+A form's dependencies are sorted, so
+the bindings it declares come last,
+in the order they were bound.
+-------------------------------------*/
+struct __state_header_type
+{
+    char                magic[ 8 ];     /* __STATE_MAGIC            */
+    uint64              stamp;          /* compile_stamp()          */
+    uint                num_forms;      /* records                  */
+    uint                num_bindings;   /* bindings + 1, as in      */
+                                        /*  type_info_type          */
+};
+
+struct __binding_header_type
+{
+    uint16              len;            /* length of the name       */
+    type_class_t8       type;           /* declared type            */
+    uint8               pad;            /* unused                   */
+};
+
+struct __record_header_type
+{
+    uint64              hash[ 2 ];      /* hash of the form's text  */
+    uint                first_binding;  /* first binding declared   */
+    uint                num_declared;   /* bindings declared        */
+    uint                num_deps;       /* bindings it refers to    */
+    uint                out_len;        /* bytes of output          */
+};
+
+/*-------------------------------------
+A binding or form saved by the last
+run. The pointers are into the mapped
+state file.
+-------------------------------------*/
+struct __saved_binding_type
+{
+    const char         *name;           /* variable's name          */
+    uint16              len;            /* length of the name       */
+    type_class_t8       type;           /* declared type            */
+};
+
+struct __record_type
+{
+    struct __record_header_type
+                        hdr;            /* fingerprint and sizes    */
+    const uint         *deps;           /* saved bindings used      */
+    const char         *out;            /* output                   */
+};
+
+/*-------------------------------------
+A top-level form of this run. Its
+output is either a saved record's or
+a range of the temporary file. deps
+indexes the bindings it refers to in
+the compiler's deps[].
+-------------------------------------*/
+struct __form_type
+{
+    uint64              hash[ 2 ];      /* hash of its text         */
+    uint                start;          /* offset of its '['        */
+    uint                len;            /* length through its ']'   */
+    const struct __record_type
+                       *old;            /* output reused, or NULL   */
+    uint64              out_start;      /* output in the temp file  */
+    uint                out_len;        /* bytes of output          */
+    uint                first_binding;  /* first binding declared   */
+    uint                num_declared;   /* bindings declared        */
+    uint                deps;           /* first of its bindings    */
+    uint                num_deps;       /* bindings it refers to    */
+};
+
+/*-------------------------------------
+State of one incremental compilation
+-------------------------------------*/
+struct __incr_type
+{
+    const struct compile_options_type
+                           *opts;       /* options                  */
+    uint64                  stamp;      /* compile_stamp()          */
+    const char             *src;        /* source                   */
+    struct type_info_type   ti;         /* types and bindings       */
+    struct emit_type        emitter;    /* writes the temp file     */
+    FILE                   *temp;       /* compiled output          */
+    uint64                  prelude_len;/* bytes of prelude in it   */
+    uint                    num_folded; /* lists folded             */
+
+    struct __form_type     *forms;      /* forms of the source      */
+    uint                    num_forms;  /* forms in use             */
+    uint                    form_cap;   /* forms allocated          */
+    uint                    next_form;  /* form the sink gets next  */
+    uint                    run_end;    /* past the run's forms     */
+
+    uint                   *deps;       /* bindings of the forms    */
+    uint                    num_deps;   /* bindings in use          */
+    uint                    dep_cap;    /* bindings allocated       */
+    uint                   *seen;       /* form that last referred  */
+                                        /*  to each binding         */
+    uint                    seen_cap;   /* entries allocated        */
+
+    char                   *map;        /* mapped state file        */
+    size_t                  map_len;    /* its length               */
+    struct __saved_binding_type
+                           *saved;      /* bindings of the last run */
+    uint                    num_saved;  /* how many, + 1            */
+    struct __record_type   *records;    /* forms of the last run    */
+    uint                    num_records;/* how many                 */
+    uint                   *buckets;    /* record + 1 by hash       */
+    uint                    bucket_mask;/* buckets - 1              */
+};
+
+/*-------------------------------------------------
+                 GLOBAL VARIABLES
+-------------------------------------------------*/
+
+static atomic_uint          __next_temp;    /* names temporary state    */
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static boolean __grow
+(
+    void                  **array,  /* array to grow            */
+    uint                   *cap,    /* its capacity             */
+    uint                    need,   /* elements needed          */
+    size_t                  size    /* size of an element       */
+);
+
+static boolean __split_forms
+(
+    struct __incr_type     *c,      /* compiler                 */
+    const char             *src,    /* source buffer            */
+    uint                    len     /* length of the source     */
+);
+
+static void __load_state
+(
+    struct __incr_type     *c,      /* compiler                 */
+    const char             *state   /* state file               */
+);
+
+static boolean __matches
+(
+    const struct __incr_type
+                           *c,      /* compiler                 */
+    const struct __record_type
+                           *r       /* saved form               */
+);
+
+static const struct __record_type *__find_record
+(
+    const struct __incr_type
+                           *c,      /* compiler                 */
+    const struct __form_type
+                           *form,   /* form to look up          */
+    boolean                 match   /* check its bindings?      */
+);
+
+static boolean __reuse
+(
+    struct __incr_type     *c,      /* compiler                 */
+    struct __form_type     *form,   /* unchanged form           */
+    const struct __record_type
+                           *r       /* its saved record         */
+);
+
+static int __compare_bindings
+(
+    const void             *a,      /* binding index            */
+    const void             *b       /* binding index            */
+);
+
+static boolean __compile_batch
+(
+    void                   *user,   /* compiler                 */
+    struct ast_type        *forms   /* batch of forms           */
+);
+
+static boolean __compile_run
+(
+    struct __incr_type     *c,      /* compiler                 */
+    uint                    first,  /* first form of the run    */
+    uint                    end     /* past its last form       */
+);
+
+static boolean __write_all
+(
+    int                     fd,     /* file or pipe             */
+    const char             *buf,    /* bytes to write           */
+    size_t                  len     /* how many                 */
+);
+
+static boolean __write_output
+(
+    const struct __incr_type
+                           *c,      /* compiler                 */
+    const char             *out,    /* mapped temp file         */
+    int                     fd,     /* file or pipe to write    */
+    uint64                 *bytes_out
+                                    /* bytes written            */
+);
+
+static void __save_state
+(
+    const struct __incr_type
+                           *c,      /* compiler                 */
+    const char             *out,    /* mapped temp file         */
+    const char             *state   /* state file               */
+);
+
+static void __free_incr
+(
+    struct __incr_type     *c       /* compiler to free         */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __grow - "Grow"
+*
+*   DESCRIPTION:
+*       Makes room for need elements, at least
+*       doubling the array each time it grows.
+*
+*   RETURNS:
+*       Returns FALSE if out of memory. The
+*       array is unchanged then.
+*
+**************************************************/
+static boolean __grow
+(
+    void                  **array,  /* array to grow            */
+    uint                   *cap,    /* its capacity             */
+    uint                    need,   /* elements needed          */
+    size_t                  size    /* size of an element       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    void       *grown;          /* reallocated array        */
+    uint        new_cap;        /* new capacity             */
+
+    if( need <= *cap )
+    {
+        return( TRUE );
+    }
+
+    new_cap = ( 0 == *cap ) ? need : *cap;
+    while( new_cap < need )
+    {
+        new_cap *= 2;
+    }
+
+    grown = stats_realloc( *array, new_cap * size );
+    if( NULL == grown )
+    {
+        return( FALSE );
+    }
+
+    *array = grown;
+    *cap   = new_cap;
+    return( TRUE );
+
+}   /* __grow() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __split_forms - "Split Forms"
+*
+*   DESCRIPTION:
+*       Finds and hashes the top-level forms
+*       without scanning them: only brackets and
+*       string delimiters matter, since a string
+*       is the only token that can hold a
+*       bracket.
+*
+*   RETURNS:
+*       Returns FALSE if out of memory, or if
+*       anything but whitespace lies between
+*       the forms or a bracket or string is left
+*       open. Such a source is compiled whole,
+*       so it is reported as usual.
+*
+**************************************************/
+static boolean __split_forms
+(
+    struct __incr_type     *c,      /* compiler                 */
+    const char             *src,    /* source buffer            */
+    uint                    len     /* length of the source     */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __form_type *form;       /* form found               */
+    const char         *end;        /* closing '"'              */
+    uint                pos;        /* offset being looked at   */
+    uint                start;      /* offset of the form's '[' */
+    uint                depth;      /* open brackets            */
+
+    pos = 0;
+    while( pos < len )
+    {
+        if( ( ' ' == src[ pos ] )
+         || ( ( src[ pos ] >= '\t' ) && ( src[ pos ] <= '\r' ) ) )
+        {
+            ++pos;
+            continue;
+        }
+
+        if( '[' != src[ pos ] )
+        {
+            return( FALSE );
+        }
+
+        /*-----------------------------
+        Find the matching ']'
+        -----------------------------*/
+        start = pos++;
+        depth = 1;
+        while( ( depth > 0 )
+            && ( pos < len ) )
+        {
+            switch( src[ pos ] )
+            {
+                case '[':
+                    ++depth;
+                    break;
+
+                case ']':
+                    --depth;
+                    break;
+
+                case '"':
+                    end = (const char *)memchr( &src[ pos + 1 ], '"', len - pos - 1 );
+                    if( NULL == end )
+                    {
+                        return( FALSE );
+                    }
+                    pos = (uint)( end - src );
+                    break;
+
+                default:
+                    break;
+            }
+            ++pos;
+        }
+
+        if( ( depth > 0 )
+         || !__grow( (void **)&c->forms, &c->form_cap, c->num_forms + 1, sizeof( *c->forms ) ) )
+        {
+            return( FALSE );
+        }
+
+        form = &c->forms[ c->num_forms++ ];
+        memset( form, 0, sizeof( *form ) );
+        form->start = start;
+        form->len   = pos - start;
+        hash_bytes( &src[ start ], form->len, c->stamp, form->hash );
+    }
+
+    return( TRUE );
+
+}   /* __split_forms() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __load_state - "Load State"
+*
+*   DESCRIPTION:
+*       Maps the state file of the last run and
+*       indexes its records by hash.
+*
+*   NOTES:
+*       * A missing, truncated or foreign file,
+*         or one saved under another stamp, is
+*         ignored: every form is then compiled.
+*
+**************************************************/
+static void __load_state
+(
+    struct __incr_type     *c,      /* compiler                 */
+    const char             *state   /* state file               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __state_header_type
+                        hdr;            /* file header              */
+    struct __binding_header_type
+                        bh;             /* a saved binding          */
+    struct __record_type
+                       *r;              /* record being read        */
+    struct stat         st;             /* file status              */
+    const char         *p;              /* read position            */
+    const char         *end;            /* end of the file          */
+    size_t              size;           /* size of a dependency list*/
+    uint                num_buckets;    /* buckets allocated        */
+    uint                idx;            /* bucket index             */
+    uint                i;              /* record or binding index  */
+    uint                j;              /* dependency index         */
+    int                 fd;             /* state file               */
+
+    fd = open( state, O_RDONLY );
+    if( fd < 0 )
+    {
+        return;
+    }
+
+    if( ( 0 != fstat( fd, &st ) )
+     || ( (size_t)st.st_size < sizeof( hdr ) ) )
+    {
+        close( fd );
+        return;
+    }
+
+    c->map = (char *)mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0 );
+    close( fd );
+    if( MAP_FAILED == c->map )
+    {
+        c->map = NULL;
+        return;
+    }
+    c->map_len = (size_t)st.st_size;
+
+    memcpy( &hdr, c->map, sizeof( hdr ) );
+    if( ( 0 != memcmp( hdr.magic, __STATE_MAGIC, sizeof( hdr.magic ) ) )
+     || ( hdr.stamp != c->stamp )
+     || ( 0 == hdr.num_bindings )
+     || ( hdr.num_bindings > ( c->map_len - sizeof( hdr ) ) / sizeof( bh ) + 1 )
+     || ( hdr.num_forms > ( c->map_len - sizeof( hdr ) ) / sizeof( struct __record_header_type ) ) )
+    {
+        return;
+    }
+
+    num_buckets = 16;
+    while( num_buckets < 2 * hdr.num_forms )
+    {
+        num_buckets <<= 1;
+    }
+    c->saved   = (struct __saved_binding_type *)stats_malloc( hdr.num_bindings * sizeof( *c->saved ) );
+    c->records = (struct __record_type *)stats_malloc( ( hdr.num_forms + 1 ) * sizeof( *c->records ) );
+    c->buckets = (uint *)stats_calloc( num_buckets, sizeof( *c->buckets ) );
+    if( ( NULL == c->saved )
+     || ( NULL == c->records )
+     || ( NULL == c->buckets ) )
+    {
+        return;
+    }
+    c->bucket_mask = num_buckets - 1;
+
+    /*---------------------------------
+    Read the bindings, checking every
+    length against the end of the file
+    ---------------------------------*/
+    p   = c->map + sizeof( hdr );
+    end = c->map + c->map_len;
+    for( i = 1; i < hdr.num_bindings; ++i )
+    {
+        if( (size_t)( end - p ) < sizeof( bh ) )
+        {
+            return;
+        }
+        memcpy( &bh, p, sizeof( bh ) );
+        p += sizeof( bh );
+        if( (size_t)( end - p ) < bh.len )
+        {
+            return;
+        }
+        c->saved[ i ].name = p;
+        c->saved[ i ].len  = bh.len;
+        c->saved[ i ].type = bh.type;
+        p += bh.len;
+    }
+    p = c->map + ( ( ( p - c->map ) + __STATE_ALIGN - 1 ) & ~(size_t)( __STATE_ALIGN - 1 ) );
+    if( p > end )
+    {
+        return;
+    }
+
+    /*---------------------------------
+    Then the records, whose bindings
+    must all have been saved
+    ---------------------------------*/
+    for( i = 0; i < hdr.num_forms; ++i )
+    {
+        r = &c->records[ i ];
+        if( (size_t)( end - p ) < sizeof( r->hdr ) )
+        {
+            return;
+        }
+        memcpy( &r->hdr, p, sizeof( r->hdr ) );
+        p += sizeof( r->hdr );
+
+        size = (size_t)r->hdr.num_deps * sizeof( *r->deps );
+        if( ( (size_t)( end - p ) < size )
+         || ( r->hdr.num_declared > hdr.num_bindings )
+         || ( r->hdr.first_binding > hdr.num_bindings - r->hdr.num_declared ) )
+        {
+            return;
+        }
+        r->deps = (const uint *)p;
+        p += size;
+        for( j = 0; j < r->hdr.num_deps; ++j )
+        {
+            if( ( TYPE_NO_BINDING == r->deps[ j ] )
+             || ( r->deps[ j ] >= hdr.num_bindings ) )
+            {
+                return;
+            }
+        }
+
+    }
+
+    for( i = 0; i < hdr.num_forms; ++i )
+    {
+        r = &c->records[ i ];
+        if( (size_t)( end - p ) < r->hdr.out_len )
+        {
+            return;
+        }
+        r->out = p;
+        p += r->hdr.out_len;
+    }
+
+    /*---------------------------------
+    The file is whole; index it
+    ---------------------------------*/
+    for( i = 0; i < hdr.num_forms; ++i )
+    {
+        idx = (uint)c->records[ i ].hdr.hash[ 0 ] & c->bucket_mask;
+        while( 0 != c->buckets[ idx ] )
+        {
+            idx = ( idx + 1 ) & c->bucket_mask;
+        }
+        c->buckets[ idx ] = i + 1;
+    }
+    c->num_saved   = hdr.num_bindings;
+    c->num_records = hdr.num_forms;
+
+}   /* __load_state() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __matches - "Matches"
+*
+*   DESCRIPTION:
+*       Checks a saved form against the bindings
+*       made so far. Every variable it uses must
+*       still have the same binding and type,
+*       and the variables it declares must still
+*       be free and get the same bindings.
+*
+*   RETURNS:
+*       Returns TRUE if checking the form now
+*       would bind the same variables as when
+*       its output was saved.
+*
+**************************************************/
+static boolean __matches
+(
+    const struct __incr_type
+                           *c,      /* compiler                 */
+    const struct __record_type
+                           *r       /* saved form               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct __saved_binding_type
+                   *s;              /* binding when saved       */
+    uint            d;              /* its index                */
+    uint            b;              /* binding now              */
+    uint            i;              /* dependency index         */
+
+    if( ( r->hdr.num_declared > 0 )
+     && ( c->ti.num_bindings != r->hdr.first_binding ) )
+    {
+        return( FALSE );
+    }
+
+    for( i = 0; i < r->hdr.num_deps; ++i )
+    {
+        d = r->deps[ i ];
+        s = &c->saved[ d ];
+        b = find_binding( &c->ti, s->name, s->len );
+
+        if( ( r->hdr.num_declared > 0 )
+         && ( d >= r->hdr.first_binding ) )
+        {
+            if( TYPE_NO_BINDING != b )
+            {
+                return( FALSE );
+            }
+        }
+        else if( ( b != d )
+              || ( c->ti.bindings[ b ].type != s->type ) )
+        {
+            return( FALSE );
+        }
+    }
+
+    return( TRUE );
+
+}   /* __matches() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __find_record - "Find Record"
+*
+*   DESCRIPTION:
+*       Looks for a saved form with the same
+*       text as a form of this run. Identical
+*       forms can be saved more than once, with
+*       different bindings, so each is tried.
+*
+*   RETURNS:
+*       Returns the saved form whose output can
+*       be reused, or NULL. Without match, the
+*       first saved form with the same text.
+*
+**************************************************/
+static const struct __record_type *__find_record
+(
+    const struct __incr_type
+                           *c,      /* compiler                 */
+    const struct __form_type
+                           *form,   /* form to look up          */
+    boolean                 match   /* check its bindings?      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct __record_type
+                   *r;              /* candidate                */
+    uint            idx;            /* bucket index             */
+
+    if( 0 == c->num_records )
+    {
+        return( NULL );
+    }
+
+    idx = (uint)form->hash[ 0 ] & c->bucket_mask;
+    while( 0 != c->buckets[ idx ] )
+    {
+        r = &c->records[ c->buckets[ idx ] - 1 ];
+        if( ( r->hdr.hash[ 0 ] == form->hash[ 0 ] )
+         && ( r->hdr.hash[ 1 ] == form->hash[ 1 ] )
+         && ( !match || __matches( c, r ) ) )
+        {
+            return( r );
+        }
+        idx = ( idx + 1 ) & c->bucket_mask;
+    }
+
+    return( NULL );
+
+}   /* __find_record() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __reuse - "Reuse"
+*
+*   DESCRIPTION:
+*       Takes an unchanged form's output from
+*       its record. The variables it declares
+*       are bound again, in the same order, and
+*       count as already declared, since the
+*       saved output declares them.
+*
+*   RETURNS:
+*       Returns FALSE if out of memory.
+*
+**************************************************/
+static boolean __reuse
+(
+    struct __incr_type     *c,      /* compiler                 */
+    struct __form_type     *form,   /* unchanged form           */
+    const struct __record_type
+                           *r       /* its saved record         */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct __saved_binding_type
+                   *s;              /* binding when saved       */
+    uint            d;              /* its index                */
+    uint            b;              /* new binding              */
+    uint            i;              /* dependency index         */
+
+    if( !__grow( (void **)&c->deps, &c->dep_cap, c->num_deps + r->hdr.num_deps, sizeof( *c->deps ) ) )
+    {
+        return( FALSE );
+    }
+
+    form->old           = r;
+    form->out_len       = r->hdr.out_len;
+    form->first_binding = r->hdr.first_binding;
+    form->num_declared  = r->hdr.num_declared;
+    form->deps          = c->num_deps;
+    form->num_deps      = r->hdr.num_deps;
+
+    for( i = 0; i < r->hdr.num_deps; ++i )
+    {
+        d = r->deps[ i ];
+        s = &c->saved[ d ];
+        if( ( r->hdr.num_declared > 0 )
+         && ( d >= r->hdr.first_binding )
+         && ( TYPE_NO_ERROR != add_binding( &c->ti, s->name, s->len, s->type, &b ) ) )
+        {
+            return( FALSE );
+        }
+        c->deps[ c->num_deps++ ] = d;
+    }
+
+    c->emitter.num_declared = c->ti.num_bindings - 1;
+    return( TRUE );
+
+}   /* __reuse() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __compare_bindings - "Compare Bindings"
+*
+*   DESCRIPTION:
+*       qsort() comparator for binding indices.
+*
+**************************************************/
+static int __compare_bindings
+(
+    const void             *a,      /* binding index            */
+    const void             *b       /* binding index            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        x;              /* first index              */
+    uint        y;              /* second index             */
+
+    x = *(const uint *)a;
+    y = *(const uint *)b;
+    return( ( x > y ) - ( x < y ) );
+
+}   /* __compare_bindings() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __compile_batch - "Compile Batch"
+*
+*   DESCRIPTION:
+*       The pipeline's sink: checks a batch of
+*       forms, notes the bindings each one
+*       refers to before folding can drop any,
+*       folds, and emits the forms one at a time
+*       so each one's output can be told apart.
+*
+*   RETURNS:
+*       Returns FALSE to stop at the first
+*       error, or if the parser didn't see the
+*       forms __split_forms() did.
+*
+**************************************************/
+static boolean __compile_batch
+(
+    void                   *user,   /* compiler                 */
+    struct ast_type        *forms   /* batch of forms           */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __incr_type         *c;          /* compiler             */
+    struct __form_type         *f;          /* form of this run     */
+    const struct ast_node_type *nodes;      /* node array           */
+    uint                        node;       /* top-level form       */
+    uint                        end;        /* past its subtree     */
+    uint                        n;          /* node in the form     */
+    uint                        b;          /* binding              */
+    uint                        first;      /* batch's first form   */
+    uint                        next;       /* next binding made    */
+    uint                        old_cap;    /* seen[] before growth */
+    struct stats_clock_type     clock;      /* times a phase        */
+    boolean                     ok;         /* checked?             */
+
+    c     = (struct __incr_type *)user;
+    nodes = forms->nodes;
+    next  = c->ti.num_bindings;
+    stats_start( c->opts->stats, STATS_CHECK, &clock );
+    ok = ( TYPE_NO_ERROR == check_types( &c->ti, forms ) );
+    stats_stop( c->opts->stats, STATS_CHECK, &clock );
+    if( !ok )
+    {
+        return( FALSE );
+    }
+
+    old_cap = c->seen_cap;
+    if( !__grow( (void **)&c->seen, &c->seen_cap, c->ti.num_bindings, sizeof( *c->seen ) ) )
+    {
+        return( FALSE );
+    }
+    memset( &c->seen[ old_cap ], 0, ( c->seen_cap - old_cap ) * sizeof( *c->seen ) );
+
+    /*---------------------------------
+    Note the bindings of each form
+    ---------------------------------*/
+    first = c->next_form;
+    for( node = nodes[ AST_ROOT ].first_child; AST_NO_NODE != node; node = nodes[ node ].next_sibling )
+    {
+        f = &c->forms[ c->next_form ];
+        if( ( c->next_form == c->run_end )
+         || ( &forms->src[ nodes[ node ].offset ] != &c->src[ f->start ] ) )
+        {
+            return( FALSE );
+        }
+
+        end         = ( AST_NO_NODE != nodes[ node ].next_sibling ) ? nodes[ node ].next_sibling : forms->num_nodes;
+        f->old      = NULL;
+        f->deps     = c->num_deps;
+        f->num_deps = 0;
+        for( n = node + 1; n < end; ++n )
+        {
+            b = c->ti.syms[ n ];
+            if( ( TOK_IDENT != nodes[ n ].token_class )
+             || ( TYPE_NO_BINDING == b )
+             || ( c->seen[ b ] == c->next_form + 1 ) )
+            {
+                continue;
+            }
+
+            if( !__grow( (void **)&c->deps, &c->dep_cap, c->num_deps + 1, sizeof( *c->deps ) ) )
+            {
+                return( FALSE );
+            }
+            c->seen[ b ]             = c->next_form + 1;
+            c->deps[ c->num_deps++ ] = b;
+            ++f->num_deps;
+        }
+
+        qsort( &c->deps[ f->deps ], f->num_deps, sizeof( *c->deps ), __compare_bindings );
+        f->num_declared = 0;
+        while( ( f->num_declared < f->num_deps )
+            && ( c->deps[ f->deps + f->num_deps - f->num_declared - 1 ] >= next ) )
+        {
+            ++f->num_declared;
+        }
+        f->first_binding = ( f->num_declared > 0 ) ? next : 0;
+        next += f->num_declared;
+        ++c->next_form;
+    }
+
+    if( c->opts->fold )
+    {
+        stats_start( c->opts->stats, STATS_OPTIMIZE, &clock );
+        c->num_folded += fold_constants( forms, &c->ti );
+        stats_stop( c->opts->stats, STATS_OPTIMIZE, &clock );
+    }
+
+    /*---------------------------------
+    Emit each form after the variables
+    it declares
+    ---------------------------------*/
+    stats_start( c->opts->stats, STATS_EMIT, &clock );
+    f = &c->forms[ first ];
+    for( node = nodes[ AST_ROOT ].first_child; AST_NO_NODE != node; node = nodes[ node ].next_sibling, ++f )
+    {
+        f->out_start = c->emitter.bytes_put;
+        emit_declarations( &c->emitter, &c->ti, f->first_binding + f->num_declared );
+        emit_form( &c->emitter, forms, &c->ti, node );
+        f->out_len = (uint)( c->emitter.bytes_put - f->out_start );
+    }
+    stats_stop( c->opts->stats, STATS_EMIT, &clock );
+
+    return( EMIT_NO_ERROR == c->emitter.error );
+
+}   /* __compile_batch() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __compile_run - "Compile Run"
+*
+*   DESCRIPTION:
+*       Compiles a run of consecutive forms that
+*       couldn't be reused, as one source.
+*
+*   RETURNS:
+*       Returns FALSE if any form of the run
+*       failed.
+*
+**************************************************/
+static boolean __compile_run
+(
+    struct __incr_type     *c,      /* compiler                 */
+    uint                    first,  /* first form of the run    */
+    uint                    end     /* past its last form       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct pipe_result_type pr;     /* front end's outcome      */
+    uint                    start;  /* offset of the run        */
+
+    start        = c->forms[ first ].start;
+    c->next_form = first;
+    c->run_end   = end;
+    run_pipeline( &c->src[ start ], c->forms[ end - 1 ].start + c->forms[ end - 1 ].len - start,
+                  __compile_batch, c, c->opts->threaded, c->opts->stats, &pr );
+
+    return( ( PIPE_NO_ERROR == pr.error )
+         && ( c->next_form == end ) );
+
+}   /* __compile_run() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __write_all - "Write All"
+*
+*   DESCRIPTION:
+*       Writes a buffer, retrying partial writes
+*       and interrupted calls.
+*
+*   RETURNS:
+*       Returns FALSE if the write failed.
+*
+**************************************************/
+static boolean __write_all
+(
+    int                     fd,     /* file or pipe             */
+    const char             *buf,    /* bytes to write           */
+    size_t                  len     /* how many                 */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    ssize_t     written;        /* bytes written by a call  */
+
+    while( len > 0 )
+    {
+        written = write( fd, buf, len );
+        if( written < 0 )
+        {
+            if( EINTR == errno )
+            {
+                continue;
+            }
+            return( FALSE );
+        }
+        buf += written;
+        len -= (size_t)written;
+    }
+
+    return( TRUE );
+
+}   /* __write_all() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __write_output - "Write Output"
+*
+*   DESCRIPTION:
+*       Splices the output together: the prelude,
+*       then each form's output, saved or new.
+*       Output that was contiguous before, like
+*       a stretch of unchanged forms, goes out
+*       in one write.
+*
+*   RETURNS:
+*       Returns FALSE if the output couldn't be
+*       written.
+*
+**************************************************/
+static boolean __write_output
+(
+    const struct __incr_type
+                           *c,      /* compiler                 */
+    const char             *out,    /* mapped temp file         */
+    int                     fd,     /* file or pipe to write    */
+    uint64                 *bytes_out
+                                    /* bytes written            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct __form_type
+                   *f;              /* form being written       */
+    const char     *pending;        /* bytes not yet written    */
+    const char     *next;           /* form's output            */
+    size_t          len;            /* length of pending        */
+    uint            i;              /* form index               */
+
+    pending    = out;
+    len        = (size_t)c->prelude_len;
+    *bytes_out = 0;
+    for( i = 0; i < c->num_forms; ++i )
+    {
+        f    = &c->forms[ i ];
+        next = ( NULL != f->old ) ? f->old->out : &out[ f->out_start ];
+        if( next != &pending[ len ] )
+        {
+            if( !__write_all( fd, pending, len ) )
+            {
+                return( FALSE );
+            }
+            *bytes_out += len;
+            pending     = next;
+            len         = 0;
+        }
+        len += f->out_len;
+    }
+
+    *bytes_out += len;
+    return( __write_all( fd, pending, len ) );
+
+}   /* __write_output() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __save_state - "Save State"
+*
+*   DESCRIPTION:
+*       Saves every form's fingerprint and
+*       output for the next run. The file is
+*       written under a temporary name and
+*       renamed over the old one, so a run that
+*       is cut short leaves the old state.
+*
+*   NOTES:
+*       * Failing to save only costs the next
+*         run its reuse.
+*       * State that would be saved unchanged
+*         is left alone.
+*
+**************************************************/
+static void __save_state
+(
+    const struct __incr_type
+                           *c,      /* compiler                 */
+    const char             *out,    /* mapped temp file         */
+    const char             *state   /* state file               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __state_header_type
+                        hdr;            /* file header              */
+    struct __record_header_type
+                        rec;            /* record header            */
+    struct __binding_header_type
+                        bh;             /* a binding                */
+    const struct __form_type
+                       *f;              /* form being saved         */
+    const struct binding_type
+                       *b;              /* binding being saved      */
+    static const char   zeros[ __STATE_ALIGN ] = { 0 };
+                                        /* padding                  */
+    size_t              size;           /* bytes written so far     */
+    const char         *pending;        /* output not yet written   */
+    const char         *next;           /* form's output            */
+    size_t              len;            /* length of pending        */
+    char               *temp;           /* temporary name           */
+    FILE               *fp;             /* temporary file           */
+    uint                i;              /* form or binding index    */
+    int                 fd;             /* temporary file           */
+    boolean             ok;             /* all written?             */
+
+    /*---------------------------------
+    Nothing to save if every form was
+    reused in its old place
+    ---------------------------------*/
+    if( ( c->num_forms == c->num_records )
+     && ( c->num_forms > 0 ) )
+    {
+        for( i = 0; i < c->num_forms; ++i )
+        {
+            if( c->forms[ i ].old != &c->records[ i ] )
+            {
+                break;
+            }
+        }
+        if( c->num_forms == i )
+        {
+            return;
+        }
+    }
+
+    temp = (char *)malloc( strlen( state ) + 32 );
+    if( NULL == temp )
+    {
+        return;
+    }
+    sprintf( temp, "%s.%d.%u", state, (int)getpid(), atomic_fetch_add( &__next_temp, 1 ) );
+
+    fd = open( temp, O_WRONLY | O_CREAT | O_EXCL, 0644 );
+    fp = ( fd >= 0 ) ? fdopen( fd, "w" ) : NULL;
+    if( NULL == fp )
+    {
+        if( fd >= 0 )
+        {
+            close( fd );
+            unlink( temp );
+        }
+        free( temp );
+        return;
+    }
+    setvbuf( fp, NULL, _IOFBF, __STATE_BUFFER );
+
+    memset( &hdr, 0, sizeof( hdr ) );
+    memcpy( hdr.magic, __STATE_MAGIC, sizeof( hdr.magic ) );
+    hdr.stamp     = c->stamp;
+    hdr.num_forms    = c->num_forms;
+    hdr.num_bindings = c->ti.num_bindings;
+    ok   = ( 1 == fwrite( &hdr, sizeof( hdr ), 1, fp ) );
+    size = sizeof( hdr );
+
+    for( i = 1; ok && ( i < c->ti.num_bindings ); ++i )
+    {
+        b = &c->ti.bindings[ i ];
+        memset( &bh, 0, sizeof( bh ) );
+        bh.len  = b->len;
+        bh.type = b->type;
+        ok = ( 1 == fwrite( &bh, sizeof( bh ), 1, fp ) )
+          && ( b->len == fwrite( b->name, 1, b->len, fp ) );
+        size += sizeof( bh ) + b->len;
+    }
+    size = ( __STATE_ALIGN - size % __STATE_ALIGN ) % __STATE_ALIGN;
+    ok   = ok && ( size == fwrite( zeros, 1, size, fp ) );
+
+    for( i = 0; ok && ( i < c->num_forms ); ++i )
+    {
+        f = &c->forms[ i ];
+        memset( &rec, 0, sizeof( rec ) );
+        rec.hash[ 0 ]     = f->hash[ 0 ];
+        rec.hash[ 1 ]     = f->hash[ 1 ];
+        rec.first_binding = f->first_binding;
+        rec.num_declared  = f->num_declared;
+        rec.num_deps      = f->num_deps;
+        rec.out_len       = f->out_len;
+        ok = ( 1 == fwrite( &rec, sizeof( rec ), 1, fp ) )
+          && ( f->num_deps == fwrite( &c->deps[ f->deps ], sizeof( *c->deps ), f->num_deps, fp ) );
+    }
+
+    /*---------------------------------
+    Then the output, a stretch at a
+    time
+    ---------------------------------*/
+    pending = out;
+    len     = 0;
+    for( i = 0; ok && ( i < c->num_forms ); ++i )
+    {
+        f    = &c->forms[ i ];
+        next = ( NULL != f->old ) ? f->old->out : &out[ f->out_start ];
+        if( next != &pending[ len ] )
+        {
+            ok      = ( len == fwrite( pending, 1, len, fp ) );
+            pending = next;
+            len     = 0;
+        }
+        len += f->out_len;
+    }
+    ok = ok && ( len == fwrite( pending, 1, len, fp ) );
+
+    if( ( 0 == fclose( fp ) )
+     && ok
+     && ( 0 == rename( temp, state ) ) )
+    {
+        free( temp );
+        return;
+    }
+
+    unlink( temp );
+    free( temp );
+
+}   /* __save_state() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __free_incr - "Free Incremental Compiler"
+*
+*   DESCRIPTION:
+*       Frees everything a compilation holds,
+*       including the mapped state file.
+*
+**************************************************/
+static void __free_incr
+(
+    struct __incr_type     *c       /* compiler to free         */
+)
+{
+    if( NULL != c->map )
+    {
+        munmap( c->map, c->map_len );
+    }
+    if( NULL != c->temp )
+    {
+        fclose( c->temp );
+    }
+    free_emitter( &c->emitter );
+    free_type_info( &c->ti );
+    free( c->forms );
+    free( c->deps );
+    free( c->seen );
+    free( c->saved );
+    free( c->records );
+    free( c->buckets );
+
+}   /* __free_incr() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       compile_incremental - "Compile
+*                              Incrementally"
+*
+*   DESCRIPTION:
+*       Compiles a program to Gforth, reusing
+*       the output of every top-level form that
+*       is unchanged since the state file was
+*       saved, and saves the state for the next
+*       run. Runs of other forms are compiled as
+*       compile_buffer() would, into a temporary
+*       file, and the output is spliced together
+*       once every form is done. With no state
+*       file the source is just compiled.
+*
+*       The output is the same program
+*       compile_buffer() writes, but a variable
+*       is declared right before the form that
+*       binds it rather than before that form's
+*       batch.
+*
+*   ERRORS:
+*       * As compile_buffer(). A program with an
+*         error, or one whose forms can't be
+*         told apart, is compiled again whole,
+*         straight to the output, so it is
+*         reported the usual way. So is one
+*         whose temporary file can't be made or
+*         written.
+*
+*   NOTES:
+*       * num_forms counts every form, and
+*         num_reused the ones whose output was
+*         reused; the other counts in the result
+*         only cover the forms compiled.
+*       * Safe to call from several threads, as
+*         long as each has a state file of its
+*         own.
+*
+**************************************************/
+void compile_incremental
+(
+    const char             *src,    /* source buffer            */
+    uint                    len,    /* length of the source     */
+    int                     fd,     /* file or pipe to write    */
+    const struct compile_options_type
+                           *opts,   /* options                  */
+    const char             *state,  /* state file, or NULL      */
+    struct compile_result_type
+                           *result  /* outcome                  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __incr_type          c;          /* compiler             */
+    const struct __record_type *r;          /* saved form           */
+    char                       *out;        /* mapped temp file     */
+    uint                        i;          /* form index           */
+    uint                        run;        /* first form of a run  */
+    boolean                     in_run;     /* run being gathered?  */
+    boolean                     ok;         /* no failure so far?   */
+
+    if( NULL == state )
+    {
+        compile_buffer( src, len, fd, opts, result );
+        return;
+    }
+
+    memset( result, 0, sizeof( *result ) );
+    memset( &c, 0, sizeof( c ) );
+    c.opts  = opts;
+    c.stamp = compile_stamp( opts );
+    c.src   = src;
+    c.temp  = tmpfile();
+    ok = ( NULL != c.temp )
+      && __split_forms( &c, src, len )
+      && ( TYPE_NO_ERROR == init_type_info( &c.ti ) )
+      && ( EMIT_NO_ERROR == init_emitter( &c.emitter, fileno( c.temp ), opts->peephole ) );
+
+    /*---------------------------------
+    Reuse what can be reused, in order,
+    since whether a form can be reused
+    depends on the bindings made by the
+    forms before it. A form with no
+    saved twin at all can't be, so it
+    joins the run being gathered without
+    that run being compiled first.
+    ---------------------------------*/
+    if( ok )
+    {
+        trace_begin( "state", "load", "%s", state );
+        __load_state( &c, state );
+        trace_end( "state", "load", NULL );
+        emit_prelude( &c.emitter );
+        c.prelude_len = c.emitter.bytes_put;
+    }
+
+    in_run = FALSE;
+    run    = 0;
+    for( i = 0; ok && ( i < c.num_forms ); ++i )
+    {
+        if( in_run )
+        {
+            if( NULL == __find_record( &c, &c.forms[ i ], FALSE ) )
+            {
+                continue;
+            }
+            ok     = __compile_run( &c, run, i );
+            in_run = FALSE;
+        }
+
+        r = ok ? __find_record( &c, &c.forms[ i ], TRUE ) : NULL;
+        if( NULL != r )
+        {
+            ok = __reuse( &c, &c.forms[ i ], r );
+            ++result->num_reused;
+        }
+        else if( ok )
+        {
+            run    = i;
+            in_run = TRUE;
+        }
+    }
+
+    if( ok && in_run )
+    {
+        ok = __compile_run( &c, run, c.num_forms );
+    }
+    ok = ok && ( EMIT_NO_ERROR == flush_emitter( &c.emitter ) );
+
+    /*---------------------------------
+    Anything that went wrong is left to
+    compile_buffer() to report
+    ---------------------------------*/
+    out = ok ? (char *)mmap( NULL, (size_t)c.emitter.bytes_out, PROT_READ, MAP_PRIVATE, fileno( c.temp ), 0 ) : (char *)MAP_FAILED;
+    if( MAP_FAILED == out )
+    {
+        __free_incr( &c );
+        compile_buffer( src, len, fd, opts, result );
+        return;
+    }
+
+    if( !__write_output( &c, out, fd, &result->bytes_out ) )
+    {
+        result->error = COMPILE_WRITE_ERROR;
+    }
+    else
+    {
+        __save_state( &c, out, state );
+    }
+
+    result->message    = compile_error_str( result->error );
+    result->num_forms  = c.num_forms;
+    result->num_folded = c.num_folded;
+    memcpy( result->peep_counts, c.emitter.peep.counts, sizeof( result->peep_counts ) );
+
+    munmap( out, (size_t)c.emitter.bytes_out );
+    __free_incr( &c );
+
+}   /* compile_incremental() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       make_state_path - "Make State Path"
+*
+*   DESCRIPTION:
+*       Names a source's state file in a state
+*       directory, by a hash of the source's
+*       path, so sources with the same name in
+*       different directories don't share one.
+*
+*   RETURNS:
+*       Returns the path, to be freed by the
+*       caller, or NULL if out of memory.
+*
+**************************************************/
+char *make_state_path
+(
+    const char             *dir,    /* state directory          */
+    const char             *source  /* source file              */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char       *path;           /* state file               */
+    uint64      h[ 2 ];         /* hash of the source path  */
+
+    path = (char *)malloc( strlen( dir ) + 34 + sizeof( INCR_STATE_EXT ) );
+    if( NULL == path )
+    {
+        return( NULL );
+    }
+
+    hash_bytes( source, (uint)strlen( source ), 0, h );
+    sprintf( path, "%s/%016llx%016llx%s", dir, (unsigned long long)h[ 0 ], (unsigned long long)h[ 1 ], INCR_STATE_EXT );
+    return( path );
+
+}   /* make_state_path() */
@@ -0,0 +1,51 @@
+/**************************************************
+*
+*   NAME:
+*       incremental.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       recompiling a source one top-level form
+*       at a time, reusing the output of forms
+*       that haven't changed
+*
+**************************************************/
+
+#ifndef __INCREMENTAL_H__
+#define __INCREMENTAL_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "compiler.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define INCR_STATE_EXT      ".forms"    /* extension of a state file    */
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+void compile_incremental
+(
+    const char             *src,    /* source buffer            */
+    uint                    len,    /* length of the source     */
+    int                     fd,     /* file or pipe to write    */
+    const struct compile_options_type
+                           *opts,   /* options                  */
+    const char             *state,  /* state file, or NULL      */
+    struct compile_result_type
+                           *result  /* outcome                  */
+);
+
+char *make_state_path
+(
+    const char             *dir,    /* state directory          */
+    const char             *source  /* source file              */
+);
+
+#endif /* __INCREMENTAL_H__ */
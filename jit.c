@@ -0,0 +1,1318 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       jit.c
+*
+*   DESCRIPTION:
+*       Compiles the loops the interpreter runs
+*       most often to x86-64 machine code, on
+*       Linux. Each opcode has a template, a
+*       snippet of machine code assembled once,
+*       by hand, with a hole for its operand:
+*       a constant, a variable's offset or a
+*       jump. A loop is compiled by copying the
+*       templates of its opcodes one after the
+*       other, filling in the holes and
+*       patching the jumps, into a mapping that
+*       is then made executable. Nothing is
+*       allocated to registers, and both stacks
+*       stay in memory, so the code that runs
+*       is what the interpreter would do,
+*       without the dispatch.
+*
+*       An opcode without a template, such as
+*       one that prints or works on strings,
+*       gets a stub that leaves the loop and
+*       gives its code index, and so does a
+*       jump out of the loop. The interpreter
+*       takes over from there. Integer "/" and
+*       "%" leave the same way if they would
+*       fail, so the interpreter runs them
+*       again and reports the failure.
+*
+*       Registers: rbx is the data stack top,
+*       r12 the real stack top, r13 the
+*       variables and r14 the jit_state_type,
+*       all saved by the prologue, as the
+*       System V ABI asks.
+*
+*       Elsewhere loops are never compiled.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "bytecode.h"
+#include "jit.h"
+#include "stats.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#if defined( __x86_64__ ) && defined( __linux__ )
+#define __JIT                           /* machine code to run?     */
+#endif
+
+#define __INITIAL_CODE  4096            /* first bytes of a loop    */
+#define __MAX_VARS      ( 0x7FFFFFFFu / sizeof( union bc_var_type ) )
+                                        /* variables a 32-bit       */
+                                        /*  offset can reach        */
+#define __EXIT_PC       1               /* hole for the code index  */
+                                        /*  in the exit stub        */
+#define __EXIT_JUMP     6               /* hole for its jump        */
+
+/*-------------------------------------
+What the hole in a template is filled
+with
+-------------------------------------*/
+typedef uint8 __hole_t8;
+enum
+{
+    __HOLE_NONE = 0,                    /* there is no hole         */
+    __HOLE_INT,                         /* 64-bit int constant      */
+    __HOLE_REAL,                        /* 64-bit real constant     */
+    __HOLE_VAR,                         /* 32-bit variable offset   */
+    __HOLE_CODE                         /* 32-bit jump to a code    */
+                                        /*  index                   */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+An opcode's machine code
+-------------------------------------*/
+struct __template_type
+{
+    const uint8        *code;           /* its bytes, or NULL if it */
+                                        /*  has none                */
+    uint8               len;            /* their number             */
+    uint8               hole;           /* offset of the operand    */
+    __hole_t8           kind;           /* what the operand is      */
+    boolean             bails;          /* can it fail?             */
+};
+
+/*-------------------------------------
+A jump whose target isn't known until
+the whole loop is copied
+-------------------------------------*/
+struct __jit_fixup_type
+{
+    uint                at;             /* offset of its rel32      */
+    uint                target;         /* code index it goes to    */
+};
+
+/*-------------------------------------
+An executable mapping, holding one loop
+-------------------------------------*/
+struct __jit_region_type
+{
+    void               *addr;           /* where it is mapped       */
+    size_t              len;            /* its length               */
+};
+
+/*-------------------------------------------------
+                        MACROS
+-------------------------------------------------*/
+
+/**************************************************
+*
+*   FUNCTION:
+*       __IMM64, __IMM32, __REL32 - "Holes"
+*
+*   DESCRIPTION:
+*       Leave room in a template for a 64-bit
+*       immediate, a 32-bit immediate or
+*       displacement, and a 32-bit jump.
+*
+**************************************************/
+#define __IMM64         0, 0, 0, 0, 0, 0, 0, 0
+#define __IMM32         0, 0, 0, 0
+#define __REL32         0, 0, 0, 0
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __TEMPLATE - "Template"
+*
+*   DESCRIPTION:
+*       Makes a template table entry.
+*
+**************************************************/
+#define __TEMPLATE( code, hole, kind, bails ) \
+    { code, sizeof( code ), hole, kind, bails }
+
+#define __NO_TEMPLATE   { NULL, 0, 0, __HOLE_NONE, FALSE }
+
+/*-------------------------------------------------
+                VARIABLE CONSTANTS
+-------------------------------------------------*/
+
+#if defined( __JIT )
+
+/*-------------------------------------
+Templates, as bytes, with the assembly
+they were assembled from. Each opcode's
+takes its operands from the stacks'
+tops in memory and leaves its results
+there.
+
+The prologue ends by jumping over the
+epilogue, which the exit stubs jump to
+with the code index to go on from in
+eax. Integer "/" and "%" jump to their
+end if the divisor is 0, or is -1 with
+the most negative cell, where an exit
+stub is put for them.
+-------------------------------------*/
+static const uint8 __code_prologue[] =
+{
+    0x53,                                       /* push     rbx             */
+    0x41, 0x54,                                 /* push     r12             */
+    0x41, 0x55,                                 /* push     r13             */
+    0x41, 0x56,                                 /* push     r14             */
+    0x49, 0x89, 0xFE,                           /* mov      r14, rdi        */
+    0x48, 0x8B, 0x1F,                           /* mov      rbx, [rdi]      */
+    0x4C, 0x8B, 0x67, 0x08,                     /* mov      r12, [rdi+8]    */
+    0x4C, 0x8B, 0x6F, 0x10,                     /* mov      r13, [rdi+16]   */
+    0xEB, 0x0F                                  /* jmp      over epilogue   */
+};
+
+static const uint8 __code_epilogue[] =
+{
+    0x49, 0x89, 0x1E,                           /* mov      [r14], rbx      */
+    0x4D, 0x89, 0x66, 0x08,                     /* mov      [r14+8], r12    */
+    0x41, 0x5E,                                 /* pop      r14             */
+    0x41, 0x5D,                                 /* pop      r13             */
+    0x41, 0x5C,                                 /* pop      r12             */
+    0x5B,                                       /* pop      rbx             */
+    0xC3                                        /* ret                      */
+};
+
+static const uint8 __code_lit[] =
+{
+    0x48, 0x83, 0xC3, 0x08,                     /* add      rbx, 8          */
+    0x48, 0xB8, __IMM64,                        /* movabs   rax, k          */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_fetch[] =
+{
+    0x49, 0x8B, 0x85, __IMM32,                  /* mov      rax, [r13+k]    */
+    0x48, 0x83, 0xC3, 0x08,                     /* add      rbx, 8          */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_store[] =
+{
+    0x48, 0x8B, 0x03,                           /* mov      rax, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x49, 0x89, 0x85, __IMM32                   /* mov      [r13+k], rax    */
+};
+
+static const uint8 __code_flit[] =
+{
+    0x49, 0x83, 0xC4, 0x08,                     /* add      r12, 8          */
+    0x48, 0xB8, __IMM64,                        /* movabs   rax, k          */
+    0x49, 0x89, 0x04, 0x24                      /* mov      [r12], rax      */
+};
+
+static const uint8 __code_ffetch[] =
+{
+    0x49, 0x8B, 0x85, __IMM32,                  /* mov      rax, [r13+k]    */
+    0x49, 0x83, 0xC4, 0x08,                     /* add      r12, 8          */
+    0x49, 0x89, 0x04, 0x24                      /* mov      [r12], rax      */
+};
+
+static const uint8 __code_fstore[] =
+{
+    0x49, 0x8B, 0x04, 0x24,                     /* mov      rax, [r12]      */
+    0x49, 0x83, 0xEC, 0x08,                     /* sub      r12, 8          */
+    0x49, 0x89, 0x85, __IMM32                   /* mov      [r13+k], rax    */
+};
+
+static const uint8 __code_add[] =
+{
+    0x48, 0x8B, 0x03,                           /* mov      rax, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x48, 0x01, 0x03                            /* add      [rbx], rax      */
+};
+
+static const uint8 __code_sub[] =
+{
+    0x48, 0x8B, 0x03,                           /* mov      rax, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x48, 0x29, 0x03                            /* sub      [rbx], rax      */
+};
+
+static const uint8 __code_mul[] =
+{
+    0x48, 0x8B, 0x03,                           /* mov      rax, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x48, 0x0F, 0xAF, 0x03,                     /* imul     rax, [rbx]      */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_div[] =
+{
+    0x48, 0x8B, 0x0B,                           /* mov      rcx, [rbx]      */
+    0x48, 0x85, 0xC9,                           /* test     rcx, rcx        */
+    0x74, 0x2E,                                 /* je       bail            */
+    0x48, 0x83, 0xF9, 0xFF,                     /* cmp      rcx, -1         */
+    0x75, 0x09,                                 /* jne      divide          */
+    0x48, 0x8B, 0x43, 0xF8,                     /* mov      rax, [rbx-8]    */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x70, 0x1F,                                 /* jo       bail            */
+    0x48, 0x8B, 0x43, 0xF8,                     /* mov      rax, [rbx-8]    */
+    0x48, 0x99,                                 /* cqo                      */
+    0x48, 0xF7, 0xF9,                           /* idiv     rcx             */
+    0x48, 0x85, 0xD2,                           /* test     rdx, rdx        */
+    0x74, 0x08,                                 /* je       store           */
+    0x48, 0x31, 0xCA,                           /* xor      rdx, rcx        */
+    0x79, 0x03,                                 /* jns      store           */
+    0x48, 0xFF, 0xC8,                           /* dec      rax             */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x48, 0x89, 0x03,                           /* mov      [rbx], rax      */
+    0xEB, 0x0A                                  /* jmp      over bail       */
+};
+
+static const uint8 __code_mod[] =
+{
+    0x48, 0x8B, 0x0B,                           /* mov      rcx, [rbx]      */
+    0x48, 0x85, 0xC9,                           /* test     rcx, rcx        */
+    0x74, 0x31,                                 /* je       bail            */
+    0x48, 0x83, 0xF9, 0xFF,                     /* cmp      rcx, -1         */
+    0x75, 0x09,                                 /* jne      divide          */
+    0x48, 0x8B, 0x43, 0xF8,                     /* mov      rax, [rbx-8]    */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x70, 0x22,                                 /* jo       bail            */
+    0x48, 0x8B, 0x43, 0xF8,                     /* mov      rax, [rbx-8]    */
+    0x48, 0x99,                                 /* cqo                      */
+    0x48, 0xF7, 0xF9,                           /* idiv     rcx             */
+    0x48, 0x85, 0xD2,                           /* test     rdx, rdx        */
+    0x74, 0x0B,                                 /* je       store           */
+    0x48, 0x89, 0xD0,                           /* mov      rax, rdx        */
+    0x48, 0x31, 0xC8,                           /* xor      rax, rcx        */
+    0x79, 0x03,                                 /* jns      store           */
+    0x48, 0x01, 0xCA,                           /* add      rdx, rcx        */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x48, 0x89, 0x13,                           /* mov      [rbx], rdx      */
+    0xEB, 0x0A                                  /* jmp      over bail       */
+};
+
+static const uint8 __code_and[] =
+{
+    0x48, 0x8B, 0x03,                           /* mov      rax, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x48, 0x21, 0x03                            /* and      [rbx], rax      */
+};
+
+static const uint8 __code_or[] =
+{
+    0x48, 0x8B, 0x03,                           /* mov      rax, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x48, 0x09, 0x03                            /* or       [rbx], rax      */
+};
+
+static const uint8 __code_lshift[] =
+{
+    0x48, 0x8B, 0x0B,                           /* mov      rcx, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x48, 0xD3, 0x23                            /* shl      [rbx], cl       */
+};
+
+static const uint8 __code_arshift[] =
+{
+    0x48, 0x8B, 0x0B,                           /* mov      rcx, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x48, 0xD3, 0x3B                            /* sar      [rbx], cl       */
+};
+
+static const uint8 __code_eq[] =
+{
+    0x48, 0x8B, 0x0B,                           /* mov      rcx, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x31, 0xC0,                                 /* xor      eax, eax        */
+    0x48, 0x39, 0x0B,                           /* cmp      [rbx], rcx      */
+    0x0F, 0x94, 0xC0,                           /* sete     al              */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_lt[] =
+{
+    0x48, 0x8B, 0x0B,                           /* mov      rcx, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x31, 0xC0,                                 /* xor      eax, eax        */
+    0x48, 0x39, 0x0B,                           /* cmp      [rbx], rcx      */
+    0x0F, 0x9C, 0xC0,                           /* setl     al              */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_gt[] =
+{
+    0x48, 0x8B, 0x0B,                           /* mov      rcx, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x31, 0xC0,                                 /* xor      eax, eax        */
+    0x48, 0x39, 0x0B,                           /* cmp      [rbx], rcx      */
+    0x0F, 0x9F, 0xC0,                           /* setg     al              */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_le[] =
+{
+    0x48, 0x8B, 0x0B,                           /* mov      rcx, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x31, 0xC0,                                 /* xor      eax, eax        */
+    0x48, 0x39, 0x0B,                           /* cmp      [rbx], rcx      */
+    0x0F, 0x9E, 0xC0,                           /* setle    al              */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_ge[] =
+{
+    0x48, 0x8B, 0x0B,                           /* mov      rcx, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x31, 0xC0,                                 /* xor      eax, eax        */
+    0x48, 0x39, 0x0B,                           /* cmp      [rbx], rcx      */
+    0x0F, 0x9D, 0xC0,                           /* setge    al              */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_ne[] =
+{
+    0x48, 0x8B, 0x0B,                           /* mov      rcx, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x31, 0xC0,                                 /* xor      eax, eax        */
+    0x48, 0x39, 0x0B,                           /* cmp      [rbx], rcx      */
+    0x0F, 0x95, 0xC0,                           /* setne    al              */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_fadd[] =
+{
+    0xF2, 0x41, 0x0F, 0x10, 0x44, 0x24, 0xF8,   /* movsd    xmm0, [r12-8]   */
+    0xF2, 0x41, 0x0F, 0x58, 0x04, 0x24,         /* addsd    xmm0, [r12]     */
+    0x49, 0x83, 0xEC, 0x08,                     /* sub      r12, 8          */
+    0xF2, 0x41, 0x0F, 0x11, 0x04, 0x24          /* movsd    [r12], xmm0     */
+};
+
+static const uint8 __code_fsub[] =
+{
+    0xF2, 0x41, 0x0F, 0x10, 0x44, 0x24, 0xF8,   /* movsd    xmm0, [r12-8]   */
+    0xF2, 0x41, 0x0F, 0x5C, 0x04, 0x24,         /* subsd    xmm0, [r12]     */
+    0x49, 0x83, 0xEC, 0x08,                     /* sub      r12, 8          */
+    0xF2, 0x41, 0x0F, 0x11, 0x04, 0x24          /* movsd    [r12], xmm0     */
+};
+
+static const uint8 __code_fmul[] =
+{
+    0xF2, 0x41, 0x0F, 0x10, 0x44, 0x24, 0xF8,   /* movsd    xmm0, [r12-8]   */
+    0xF2, 0x41, 0x0F, 0x59, 0x04, 0x24,         /* mulsd    xmm0, [r12]     */
+    0x49, 0x83, 0xEC, 0x08,                     /* sub      r12, 8          */
+    0xF2, 0x41, 0x0F, 0x11, 0x04, 0x24          /* movsd    [r12], xmm0     */
+};
+
+static const uint8 __code_fdiv[] =
+{
+    0xF2, 0x41, 0x0F, 0x10, 0x44, 0x24, 0xF8,   /* movsd    xmm0, [r12-8]   */
+    0xF2, 0x41, 0x0F, 0x5E, 0x04, 0x24,         /* divsd    xmm0, [r12]     */
+    0x49, 0x83, 0xEC, 0x08,                     /* sub      r12, 8          */
+    0xF2, 0x41, 0x0F, 0x11, 0x04, 0x24          /* movsd    [r12], xmm0     */
+};
+
+static const uint8 __code_feq[] =
+{
+    0xF2, 0x41, 0x0F, 0x10, 0x44, 0x24, 0xF8,   /* movsd    xmm0, [r12-8]   */
+    0x66, 0x41, 0x0F, 0x2E, 0x04, 0x24,         /* ucomisd  xmm0, [r12]     */
+    0x0F, 0x94, 0xC0,                           /* sete     al              */
+    0x0F, 0x9B, 0xC1,                           /* setnp    cl              */
+    0x20, 0xC8,                                 /* and      al, cl          */
+    0x0F, 0xB6, 0xC0,                           /* movzx    eax, al         */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x49, 0x83, 0xEC, 0x10,                     /* sub      r12, 16         */
+    0x48, 0x83, 0xC3, 0x08,                     /* add      rbx, 8          */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_flt[] =
+{
+    0xF2, 0x41, 0x0F, 0x10, 0x04, 0x24,         /* movsd    xmm0, [r12]     */
+    0x66, 0x41, 0x0F, 0x2E, 0x44, 0x24, 0xF8,   /* ucomisd  xmm0, [r12-8]   */
+    0x0F, 0x97, 0xC0,                           /* seta     al              */
+    0x0F, 0xB6, 0xC0,                           /* movzx    eax, al         */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x49, 0x83, 0xEC, 0x10,                     /* sub      r12, 16         */
+    0x48, 0x83, 0xC3, 0x08,                     /* add      rbx, 8          */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_fgt[] =
+{
+    0xF2, 0x41, 0x0F, 0x10, 0x44, 0x24, 0xF8,   /* movsd    xmm0, [r12-8]   */
+    0x66, 0x41, 0x0F, 0x2E, 0x04, 0x24,         /* ucomisd  xmm0, [r12]     */
+    0x0F, 0x97, 0xC0,                           /* seta     al              */
+    0x0F, 0xB6, 0xC0,                           /* movzx    eax, al         */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x49, 0x83, 0xEC, 0x10,                     /* sub      r12, 16         */
+    0x48, 0x83, 0xC3, 0x08,                     /* add      rbx, 8          */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_fle[] =
+{
+    0xF2, 0x41, 0x0F, 0x10, 0x04, 0x24,         /* movsd    xmm0, [r12]     */
+    0x66, 0x41, 0x0F, 0x2E, 0x44, 0x24, 0xF8,   /* ucomisd  xmm0, [r12-8]   */
+    0x0F, 0x93, 0xC0,                           /* setae    al              */
+    0x0F, 0xB6, 0xC0,                           /* movzx    eax, al         */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x49, 0x83, 0xEC, 0x10,                     /* sub      r12, 16         */
+    0x48, 0x83, 0xC3, 0x08,                     /* add      rbx, 8          */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_fge[] =
+{
+    0xF2, 0x41, 0x0F, 0x10, 0x44, 0x24, 0xF8,   /* movsd    xmm0, [r12-8]   */
+    0x66, 0x41, 0x0F, 0x2E, 0x04, 0x24,         /* ucomisd  xmm0, [r12]     */
+    0x0F, 0x93, 0xC0,                           /* setae    al              */
+    0x0F, 0xB6, 0xC0,                           /* movzx    eax, al         */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x49, 0x83, 0xEC, 0x10,                     /* sub      r12, 16         */
+    0x48, 0x83, 0xC3, 0x08,                     /* add      rbx, 8          */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_fne[] =
+{
+    0xF2, 0x41, 0x0F, 0x10, 0x44, 0x24, 0xF8,   /* movsd    xmm0, [r12-8]   */
+    0x66, 0x41, 0x0F, 0x2E, 0x04, 0x24,         /* ucomisd  xmm0, [r12]     */
+    0x0F, 0x95, 0xC0,                           /* setne    al              */
+    0x0F, 0x9A, 0xC1,                           /* setp     cl              */
+    0x08, 0xC8,                                 /* or       al, cl          */
+    0x0F, 0xB6, 0xC0,                           /* movzx    eax, al         */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x49, 0x83, 0xEC, 0x10,                     /* sub      r12, 16         */
+    0x48, 0x83, 0xC3, 0x08,                     /* add      rbx, 8          */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_not[] =
+{
+    0x31, 0xC0,                                 /* xor      eax, eax        */
+    0x48, 0x83, 0x3B, 0x00,                     /* cmp      [rbx], 0        */
+    0x0F, 0x94, 0xC0,                           /* sete     al              */
+    0x48, 0xF7, 0xD8,                           /* neg      rax             */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_negate[] =
+{
+    0x48, 0xF7, 0x1B                            /* neg      [rbx]           */
+};
+
+static const uint8 __code_fnegate[] =
+{
+    0x49, 0x0F, 0xBA, 0x3C, 0x24, 0x3F          /* btc      [r12], 63       */
+};
+
+static const uint8 __code_toreal[] =
+{
+    0xF2, 0x48, 0x0F, 0x2A, 0x03,               /* cvtsi2sd xmm0, [rbx]     */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x49, 0x83, 0xC4, 0x08,                     /* add      r12, 8          */
+    0xF2, 0x41, 0x0F, 0x11, 0x04, 0x24          /* movsd    [r12], xmm0     */
+};
+
+static const uint8 __code_drop[] =
+{
+    0x48, 0x83, 0xEB, 0x08                      /* sub      rbx, 8          */
+};
+
+static const uint8 __code_fdrop[] =
+{
+    0x49, 0x83, 0xEC, 0x08                      /* sub      r12, 8          */
+};
+
+static const uint8 __code_dup[] =
+{
+    0x48, 0x8B, 0x03,                           /* mov      rax, [rbx]      */
+    0x48, 0x83, 0xC3, 0x08,                     /* add      rbx, 8          */
+    0x48, 0x89, 0x03                            /* mov      [rbx], rax      */
+};
+
+static const uint8 __code_fdup[] =
+{
+    0x49, 0x8B, 0x04, 0x24,                     /* mov      rax, [r12]      */
+    0x49, 0x83, 0xC4, 0x08,                     /* add      r12, 8          */
+    0x49, 0x89, 0x04, 0x24                      /* mov      [r12], rax      */
+};
+
+static const uint8 __code_branch[] =
+{
+    0xE9, __REL32                               /* jmp      target          */
+};
+
+static const uint8 __code_zbranch[] =
+{
+    0x48, 0x8B, 0x03,                           /* mov      rax, [rbx]      */
+    0x48, 0x83, 0xEB, 0x08,                     /* sub      rbx, 8          */
+    0x48, 0x85, 0xC0,                           /* test     rax, rax        */
+    0x0F, 0x84, __REL32                         /* je       target          */
+};
+
+static const uint8 __code_exit[] =
+{
+    0xB8, __IMM32,                              /* mov      eax, k          */
+    0xE9, __REL32                               /* jmp      epilogue        */
+};
+
+/*-------------------------------------
+Templates by opcode. Superinstructions
+have none; they are copied as the pair
+they do the work of.
+-------------------------------------*/
+static const struct __template_type __templates[ BC_NUM_OPS ] =
+{
+    __NO_TEMPLATE,                                                  /* BC_HALT      */
+    __TEMPLATE( __code_lit,     6,  __HOLE_INT,  FALSE ),           /* BC_LIT       */
+    __TEMPLATE( __code_flit,    6,  __HOLE_REAL, FALSE ),           /* BC_FLIT      */
+    __NO_TEMPLATE,                                                  /* BC_SLIT      */
+    __TEMPLATE( __code_fetch,   3,  __HOLE_VAR,  FALSE ),           /* BC_FETCH     */
+    __TEMPLATE( __code_ffetch,  3,  __HOLE_VAR,  FALSE ),           /* BC_FFETCH    */
+    __NO_TEMPLATE,                                                  /* BC_SFETCH    */
+    __TEMPLATE( __code_store,   10, __HOLE_VAR,  FALSE ),           /* BC_STORE     */
+    __TEMPLATE( __code_fstore,  11, __HOLE_VAR,  FALSE ),           /* BC_FSTORE    */
+    __NO_TEMPLATE,                                                  /* BC_SSTORE    */
+    __TEMPLATE( __code_add,     0,  __HOLE_NONE, FALSE ),           /* BC_ADD       */
+    __TEMPLATE( __code_sub,     0,  __HOLE_NONE, FALSE ),           /* BC_SUB       */
+    __TEMPLATE( __code_mul,     0,  __HOLE_NONE, FALSE ),           /* BC_MUL       */
+    __TEMPLATE( __code_div,     0,  __HOLE_NONE, TRUE  ),           /* BC_DIV       */
+    __TEMPLATE( __code_mod,     0,  __HOLE_NONE, TRUE  ),           /* BC_MOD       */
+    __TEMPLATE( __code_and,     0,  __HOLE_NONE, FALSE ),           /* BC_AND       */
+    __TEMPLATE( __code_or,      0,  __HOLE_NONE, FALSE ),           /* BC_OR        */
+    __TEMPLATE( __code_lshift,  0,  __HOLE_NONE, FALSE ),           /* BC_LSHIFT    */
+    __TEMPLATE( __code_arshift, 0,  __HOLE_NONE, FALSE ),           /* BC_ARSHIFT   */
+    __NO_TEMPLATE,                                                  /* BC_POW       */
+    __TEMPLATE( __code_eq,      0,  __HOLE_NONE, FALSE ),           /* BC_EQ        */
+    __TEMPLATE( __code_lt,      0,  __HOLE_NONE, FALSE ),           /* BC_LT        */
+    __TEMPLATE( __code_gt,      0,  __HOLE_NONE, FALSE ),           /* BC_GT        */
+    __TEMPLATE( __code_le,      0,  __HOLE_NONE, FALSE ),           /* BC_LE        */
+    __TEMPLATE( __code_ge,      0,  __HOLE_NONE, FALSE ),           /* BC_GE        */
+    __TEMPLATE( __code_ne,      0,  __HOLE_NONE, FALSE ),           /* BC_NE        */
+    __TEMPLATE( __code_fadd,    0,  __HOLE_NONE, FALSE ),           /* BC_FADD      */
+    __TEMPLATE( __code_fsub,    0,  __HOLE_NONE, FALSE ),           /* BC_FSUB      */
+    __TEMPLATE( __code_fmul,    0,  __HOLE_NONE, FALSE ),           /* BC_FMUL      */
+    __TEMPLATE( __code_fdiv,    0,  __HOLE_NONE, FALSE ),           /* BC_FDIV      */
+    __NO_TEMPLATE,                                                  /* BC_FPOW      */
+    __TEMPLATE( __code_feq,     0,  __HOLE_NONE, FALSE ),           /* BC_FEQ       */
+    __TEMPLATE( __code_flt,     0,  __HOLE_NONE, FALSE ),           /* BC_FLT       */
+    __TEMPLATE( __code_fgt,     0,  __HOLE_NONE, FALSE ),           /* BC_FGT       */
+    __TEMPLATE( __code_fle,     0,  __HOLE_NONE, FALSE ),           /* BC_FLE       */
+    __TEMPLATE( __code_fge,     0,  __HOLE_NONE, FALSE ),           /* BC_FGE       */
+    __TEMPLATE( __code_fne,     0,  __HOLE_NONE, FALSE ),           /* BC_FNE       */
+    __NO_TEMPLATE,                                                  /* BC_SCAT      */
+    __NO_TEMPLATE,                                                  /* BC_SEQ       */
+    __NO_TEMPLATE,                                                  /* BC_SLT       */
+    __NO_TEMPLATE,                                                  /* BC_SGT       */
+    __NO_TEMPLATE,                                                  /* BC_SLE       */
+    __NO_TEMPLATE,                                                  /* BC_SGE       */
+    __NO_TEMPLATE,                                                  /* BC_SNE       */
+    __TEMPLATE( __code_not,     0,  __HOLE_NONE, FALSE ),           /* BC_NOT       */
+    __TEMPLATE( __code_negate,  0,  __HOLE_NONE, FALSE ),           /* BC_NEGATE    */
+    __TEMPLATE( __code_fnegate, 0,  __HOLE_NONE, FALSE ),           /* BC_FNEGATE   */
+    __NO_TEMPLATE,                                                  /* BC_FSIN      */
+    __NO_TEMPLATE,                                                  /* BC_FCOS      */
+    __NO_TEMPLATE,                                                  /* BC_FTAN      */
+    __TEMPLATE( __code_toreal,  0,  __HOLE_NONE, FALSE ),           /* BC_TO_REAL   */
+    __TEMPLATE( __code_drop,    0,  __HOLE_NONE, FALSE ),           /* BC_DROP      */
+    __TEMPLATE( __code_fdrop,   0,  __HOLE_NONE, FALSE ),           /* BC_FDROP     */
+    __NO_TEMPLATE,                                                  /* BC_SDROP     */
+    __TEMPLATE( __code_dup,     0,  __HOLE_NONE, FALSE ),           /* BC_DUP       */
+    __TEMPLATE( __code_fdup,    0,  __HOLE_NONE, FALSE ),           /* BC_FDUP      */
+    __NO_TEMPLATE,                                                  /* BC_PRINT     */
+    __NO_TEMPLATE,                                                  /* BC_FPRINT    */
+    __NO_TEMPLATE,                                                  /* BC_SPRINT    */
+    __NO_TEMPLATE,                                                  /* BC_BPRINT    */
+    __NO_TEMPLATE,                                                  /* BC_PROF_ENTER */
+    __NO_TEMPLATE,                                                  /* BC_PROF_EXIT */
+    __TEMPLATE( __code_branch,  1,  __HOLE_CODE, FALSE ),           /* BC_BRANCH    */
+    __TEMPLATE( __code_zbranch, 12, __HOLE_CODE, FALSE )            /* BC_ZBRANCH   */
+};
+
+#endif /* __JIT */
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+#if defined( __JIT )
+
+static boolean __grow
+(
+    struct jit_type        *jit,    /* JIT                      */
+    void                  **array,  /* array to grow            */
+    uint                   *cap,    /* its capacity             */
+    uint                    need,   /* elements needed          */
+    size_t                  size    /* size of an element       */
+);
+
+static uint __put_code
+(
+    struct jit_type        *jit,    /* JIT                      */
+    const uint8            *code,   /* machine code             */
+    uint                    len     /* its length               */
+);
+
+static void __put_exit
+(
+    struct jit_type        *jit,    /* JIT                      */
+    uint                    pc      /* code index to go on from */
+);
+
+static void __put_op
+(
+    struct jit_type        *jit,    /* JIT                      */
+    uint                    pc,     /* code index of the opcode */
+    uint                    at      /* code index of its        */
+                                    /*  instruction             */
+);
+
+static boolean __can_run
+(
+    const struct jit_type  *jit,    /* JIT                      */
+    uint                    pc      /* code index of an         */
+                                    /*  instruction             */
+);
+
+static jit_func __compile_loop
+(
+    struct jit_type        *jit,    /* JIT                      */
+    uint                    begin,  /* code index of the loop   */
+    uint                    end     /* code index after it      */
+);
+
+static jit_func __map_code
+(
+    struct jit_type        *jit     /* JIT                      */
+);
+
+#endif /* __JIT */
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+#if defined( __JIT )
+
+/**************************************************
+*
+*   FUNCTION:
+*       __grow - "Grow"
+*
+*   DESCRIPTION:
+*       Makes room for need elements in one of
+*       the JIT's arrays, doubling it as often
+*       as it takes.
+*
+*   RETURNS:
+*       Returns FALSE, and marks the loop being
+*       compiled failed, if it couldn't be
+*       grown.
+*
+**************************************************/
+static boolean __grow
+(
+    struct jit_type        *jit,    /* JIT                      */
+    void                  **array,  /* array to grow            */
+    uint                   *cap,    /* its capacity             */
+    uint                    need,   /* elements needed          */
+    size_t                  size    /* size of an element       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    void       *grown;          /* reallocated array        */
+    uint        new_cap;        /* new capacity             */
+
+    if( need <= *cap )
+    {
+        return( TRUE );
+    }
+
+    new_cap = ( 0 == *cap ) ? 16 : *cap;
+    while( new_cap < need )
+    {
+        new_cap *= 2;
+    }
+
+    grown = stats_realloc( *array, new_cap * size );
+    if( NULL == grown )
+    {
+        jit->failed = TRUE;
+        return( FALSE );
+    }
+    *array = grown;
+    *cap   = new_cap;
+
+    return( TRUE );
+
+}   /* __grow() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_code - "Put Code"
+*
+*   DESCRIPTION:
+*       Appends machine code to the loop being
+*       compiled.
+*
+*   RETURNS:
+*       Returns the offset it was put at.
+*
+**************************************************/
+static uint __put_code
+(
+    struct jit_type        *jit,    /* JIT                      */
+    const uint8            *code,   /* machine code             */
+    uint                    len     /* its length               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint                    at;     /* offset put at            */
+
+    at = jit->buf_len;
+    if( !__grow( jit, (void **)&jit->buf, &jit->buf_cap, at + len, sizeof( *jit->buf ) ) )
+    {
+        return( at );
+    }
+    memcpy( &jit->buf[ at ], code, len );
+    jit->buf_len += len;
+
+    return( at );
+
+}   /* __put_code() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_exit - "Put Exit"
+*
+*   DESCRIPTION:
+*       Appends a stub that leaves the loop,
+*       for the interpreter to go on from a
+*       code index.
+*
+**************************************************/
+static void __put_exit
+(
+    struct jit_type        *jit,    /* JIT                      */
+    uint                    pc      /* code index to go on from */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint                    at;     /* offset of the stub       */
+    sint32                  rel;    /* jump to the epilogue     */
+
+    at = __put_code( jit, __code_exit, sizeof( __code_exit ) );
+    if( jit->failed )
+    {
+        return;
+    }
+
+    rel = (sint32)sizeof( __code_prologue ) - (sint32)( at + sizeof( __code_exit ) );
+    memcpy( &jit->buf[ at + __EXIT_PC ], &pc, 4 );
+    memcpy( &jit->buf[ at + __EXIT_JUMP ], &rel, 4 );
+
+}   /* __put_exit() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_op - "Put Opcode"
+*
+*   DESCRIPTION:
+*       Appends an opcode's template, with its
+*       operand filled in. At a
+*       superinstruction it is the first of
+*       its pair's. A jump is noted, to
+*       be patched once the loop is copied.
+*       An opcode that can fail is followed by
+*       an exit to its instruction.
+*
+*   NOTES:
+*       * The opcode must have a template.
+*       * Only a "/" or "%" of its own can
+*         fail: the superinstructions they
+*         are fused into never divide by 0 or
+*         -1.
+*
+**************************************************/
+static void __put_op
+(
+    struct jit_type        *jit,    /* JIT                      */
+    uint                    pc,     /* code index of the opcode */
+    uint                    at      /* code index of its        */
+                                    /*  instruction             */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct bc_program_type
+                           *prog;   /* program                  */
+    const struct __template_type
+                           *t;      /* opcode's template        */
+    struct __jit_fixup_type
+                           *fixup;  /* jump to patch            */
+    uint                    start;  /* offset of the template   */
+    uint                    k;      /* operand                  */
+    sint32                  disp;   /* variable's offset        */
+
+    prog  = jit->prog;
+    t     = &__templates[ bc_first_op( (bc_op_t8)prog->code[ pc ] ) ];
+    start = __put_code( jit, t->code, t->len );
+    if( jit->failed )
+    {
+        return;
+    }
+
+    k = ( __HOLE_NONE == t->kind ) ? 0 : prog->code[ pc + 1 ];
+    switch( t->kind )
+    {
+        case __HOLE_INT:
+            memcpy( &jit->buf[ start + t->hole ], &prog->ints[ k ], 8 );
+            break;
+
+        case __HOLE_REAL:
+            memcpy( &jit->buf[ start + t->hole ], &prog->reals[ k ], 8 );
+            break;
+
+        case __HOLE_VAR:
+            disp = (sint32)( k * sizeof( union bc_var_type ) );
+            memcpy( &jit->buf[ start + t->hole ], &disp, 4 );
+            break;
+
+        case __HOLE_CODE:
+            if( !__grow( jit, (void **)&jit->fixups, &jit->fixup_cap, jit->num_fixups + 1, sizeof( *jit->fixups ) ) )
+            {
+                return;
+            }
+            fixup = &jit->fixups[ jit->num_fixups++ ];
+            fixup->at     = start + t->hole;
+            fixup->target = k;
+            break;
+
+        default:
+            break;
+    }
+
+    if( t->bails )
+    {
+        __put_exit( jit, at );
+    }
+
+}   /* __put_op() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __can_run - "Can Run"
+*
+*   DESCRIPTION:
+*       Tells whether an instruction has
+*       machine code: both opcodes of a
+*       superinstruction need templates.
+*
+**************************************************/
+static boolean __can_run
+(
+    const struct jit_type  *jit,    /* JIT                      */
+    uint                    pc      /* code index of an         */
+                                    /*  instruction             */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const uint             *code;   /* bytecode                 */
+    bc_op_t8                op;     /* its opcode               */
+    bc_op_t8                first;  /* first of its pair        */
+
+    code  = jit->prog->code;
+    op    = (bc_op_t8)code[ pc ];
+    first = bc_first_op( op );
+    if( NULL == __templates[ first ].code )
+    {
+        return( FALSE );
+    }
+
+    return( ( first == op )
+         || ( NULL != __templates[ code[ pc + bc_op_length( first ) ] ].code ) );
+
+}   /* __can_run() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __compile_loop - "Compile Loop"
+*
+*   DESCRIPTION:
+*       Copies the templates of a loop's
+*       instructions, from its first up to and
+*       including the branch back to it, then
+*       patches its jumps: one to an
+*       instruction in the loop goes to its
+*       code, and one out of it to an exit.
+*
+*   RETURNS:
+*       Returns the loop's code, or NULL if it
+*       couldn't be made.
+*
+**************************************************/
+static jit_func __compile_loop
+(
+    struct jit_type        *jit,    /* JIT                      */
+    uint                    begin,  /* code index of the loop   */
+    uint                    end     /* code index after it      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const uint             *code;   /* bytecode                 */
+    struct __jit_fixup_type
+                           *fixup;  /* jump to patch            */
+    bc_op_t8                first;  /* first opcode of a pair   */
+    uint                    pc;     /* code index               */
+    uint                    dest;   /* offset a jump goes to    */
+    uint                    i;      /* fixup index              */
+    sint32                  rel;    /* jump's displacement      */
+
+    code            = jit->prog->code;
+    jit->buf_len    = 0;
+    jit->num_fixups = 0;
+    jit->failed     = FALSE;
+
+    __put_code( jit, __code_prologue, sizeof( __code_prologue ) );
+    __put_code( jit, __code_epilogue, sizeof( __code_epilogue ) );
+
+    /*---------------------------------
+    Copy the instructions
+    ---------------------------------*/
+    for( pc = begin; pc < end; pc += bc_op_length( (bc_op_t8)code[ pc ] ) )
+    {
+        jit->labels[ pc ] = jit->buf_len;
+        if( !__can_run( jit, pc ) )
+        {
+            __put_exit( jit, pc );
+            continue;
+        }
+
+        first = bc_first_op( (bc_op_t8)code[ pc ] );
+        __put_op( jit, pc, pc );
+        if( first != code[ pc ] )
+        {
+            __put_op( jit, pc + bc_op_length( first ), pc );
+        }
+    }
+
+    /*---------------------------------
+    The loop ends with its branch back,
+    but leave it anyway should it fall
+    off the end
+    ---------------------------------*/
+    __put_exit( jit, end );
+
+    /*---------------------------------
+    Patch the jumps
+    ---------------------------------*/
+    for( i = 0; ( i < jit->num_fixups ) && !jit->failed; ++i )
+    {
+        fixup = &jit->fixups[ i ];
+        if( ( begin <= fixup->target ) && ( fixup->target < end ) )
+        {
+            dest = jit->labels[ fixup->target ];
+        }
+        else
+        {
+            dest = jit->buf_len;
+            __put_exit( jit, fixup->target );
+        }
+        rel = (sint32)dest - (sint32)( fixup->at + 4 );
+        memcpy( &jit->buf[ fixup->at ], &rel, 4 );
+    }
+
+    if( jit->failed )
+    {
+        return( NULL );
+    }
+
+    return( __map_code( jit ) );
+
+}   /* __compile_loop() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __map_code - "Map Code"
+*
+*   DESCRIPTION:
+*       Copies the loop just compiled into a
+*       mapping of its own, which is then made
+*       executable, and never writable again.
+*
+*   RETURNS:
+*       Returns the loop's code, or NULL if it
+*       couldn't be mapped.
+*
+**************************************************/
+static jit_func __map_code
+(
+    struct jit_type        *jit     /* JIT                      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __jit_region_type
+                           *region; /* loop's mapping           */
+    void                   *addr;   /* where it is mapped       */
+
+    if( !__grow( jit, (void **)&jit->regions, &jit->region_cap, jit->num_regions + 1, sizeof( *jit->regions ) ) )
+    {
+        return( NULL );
+    }
+
+    addr = mmap( NULL, jit->buf_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if( MAP_FAILED == addr )
+    {
+        return( NULL );
+    }
+
+    memcpy( addr, jit->buf, jit->buf_len );
+    if( 0 != mprotect( addr, jit->buf_len, PROT_READ | PROT_EXEC ) )
+    {
+        munmap( addr, jit->buf_len );
+        return( NULL );
+    }
+
+    region = &jit->regions[ jit->num_regions++ ];
+    region->addr = addr;
+    region->len  = jit->buf_len;
+
+    return( (jit_func)addr );
+
+}   /* __map_code() */
+
+#endif /* __JIT */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_jit - "Initialize JIT"
+*
+*   DESCRIPTION:
+*       Readies a program's loops to be
+*       compiled once they have been taken
+*       trips times. With 0 trips, or where
+*       there is no machine code to compile
+*       to, none ever is.
+*
+*   ERRORS:
+*       * Sets JIT_NO_MEMORY if the counters
+*         couldn't be allocated.
+*
+**************************************************/
+jit_error_t8 init_jit
+(
+    struct jit_type        *jit,    /* JIT to initialize        */
+    const struct bc_program_type
+                           *prog,   /* ended program            */
+    uint                    trips   /* trips before compiling   */
+)
+{
+    memset( jit, 0, sizeof( *jit ) );
+    jit->prog = prog;
+
+#if !defined( __JIT )
+    trips = 0;
+#endif
+    if( prog->num_vars > __MAX_VARS )
+    {
+        trips = 0;
+    }
+
+    jit->trips = trips;
+    if( 0 == trips )
+    {
+        return( JIT_NO_ERROR );
+    }
+
+    jit->counts  = (uint *)stats_calloc( prog->len + 1, sizeof( *jit->counts ) );
+    jit->entries = (jit_func *)stats_calloc( prog->len + 1, sizeof( *jit->entries ) );
+    jit->labels  = (uint *)stats_malloc( ( prog->len + 1 ) * sizeof( *jit->labels ) );
+    if( ( NULL == jit->counts ) || ( NULL == jit->entries ) || ( NULL == jit->labels ) )
+    {
+        free_jit( jit );
+        return( JIT_NO_MEMORY );
+    }
+
+    return( JIT_NO_ERROR );
+
+}   /* init_jit() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       jit_find_loop - "JIT Find Loop"
+*
+*   DESCRIPTION:
+*       Counts a trip round a loop, the
+*       interpreter having just branched back
+*       to its first instruction, and compiles
+*       it on the trip that makes it hot.
+*
+*   RETURNS:
+*       Returns the loop's code, or NULL if it
+*       isn't compiled.
+*
+*   NOTES:
+*       * A loop is compiled at most once: if
+*         it can't be, it is left to the
+*         interpreter. So is one whose first
+*         instruction has no machine code, as
+*         its code would only ever leave.
+*
+**************************************************/
+jit_func jit_find_loop
+(
+    struct jit_type        *jit,    /* JIT                      */
+    uint                    begin,  /* code index of the loop   */
+    uint                    end     /* code index after it      */
+)
+{
+    if( 0 == jit->trips )
+    {
+        return( NULL );
+    }
+
+    if( NULL != jit->entries[ begin ] )
+    {
+        return( jit->entries[ begin ] );
+    }
+
+    if( ++jit->counts[ begin ] != jit->trips )
+    {
+        return( NULL );
+    }
+
+#if defined( __JIT )
+    if( __can_run( jit, begin ) )
+    {
+        jit->entries[ begin ] = __compile_loop( jit, begin, end );
+        if( NULL != jit->entries[ begin ] )
+        {
+            ++jit->num_loops;
+        }
+    }
+#else
+    (void)end;
+#endif
+
+    return( jit->entries[ begin ] );
+
+}   /* jit_find_loop() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_jit - "Free JIT"
+*
+*   DESCRIPTION:
+*       Unmaps a program's compiled loops and
+*       frees the JIT.
+*
+**************************************************/
+void free_jit
+(
+    struct jit_type        *jit     /* JIT to free              */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint                    i;      /* region index             */
+
+    for( i = 0; i < jit->num_regions; ++i )
+    {
+        munmap( jit->regions[ i ].addr, jit->regions[ i ].len );
+    }
+
+    free( jit->counts );
+    free( jit->entries );
+    free( jit->labels );
+    free( jit->fixups );
+    free( jit->buf );
+    free( jit->regions );
+    memset( jit, 0, sizeof( *jit ) );
+
+}   /* free_jit() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       jit_error_str - "JIT Error String"
+*
+*   DESCRIPTION:
+*       Describes a JIT error code.
+*
+**************************************************/
+const char *jit_error_str
+(
+    jit_error_t8            error   /* error code               */
+)
+{
+    switch( error )
+    {
+        case JIT_NO_ERROR:
+            return( "no error" );
+
+        case JIT_NO_MEMORY:
+            return( "out of memory" );
+
+        default:
+            return( "unknown error" );
+    }
+
+}   /* jit_error_str() */
@@ -0,0 +1,125 @@
+/**************************************************
+*
+*   NAME:
+*       jit.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       compiling hot loops to machine code
+*
+**************************************************/
+
+#ifndef __JIT_H__
+#define __JIT_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "bytecode.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define JIT_TRIPS           1000    /* trips before a loop is compiled  */
+
+/*-------------------------------------
+Error types
+-------------------------------------*/
+typedef sint8 jit_error_t8;
+enum
+{
+    JIT_NO_ERROR          =  0,     /* no error                         */
+    JIT_NO_MEMORY         = -1      /* out of memory                    */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+The interpreter's state as compiled
+code sees it. Both stacks are wholly in
+memory, each pointer at its top. The
+order of the fields is known to the
+machine code.
+-------------------------------------*/
+struct jit_state_type
+{
+    sint64             *sp;             /* data stack top           */
+    double             *fp;             /* real stack top           */
+    union bc_var_type  *vars;           /* variables                */
+};
+
+/*-------------------------------------
+A compiled loop. It runs from the
+loop's first opcode until it reaches
+one outside the loop or one it can't
+run, and gives that opcode's code
+index, for the interpreter to go on
+from.
+-------------------------------------*/
+typedef uint (*jit_func)( struct jit_state_type *state );
+
+/*-------------------------------------
+The loops of a program, how often each
+has been taken and the code compiled
+for those that were taken often
+-------------------------------------*/
+struct jit_type
+{
+    const struct bc_program_type
+                       *prog;           /* program                  */
+    uint                trips;          /* trips before compiling,  */
+                                        /*  0 for never             */
+    uint               *counts;         /* trips to each code index */
+    jit_func           *entries;        /* loop compiled at each    */
+                                        /*  code index, or NULL     */
+    uint               *labels;         /* machine code offset of   */
+                                        /*  each code index         */
+    struct __jit_fixup_type
+                       *fixups;         /* jumps to patch           */
+    uint                num_fixups;     /* in use                   */
+    uint                fixup_cap;      /* allocated                */
+    uint8              *buf;            /* machine code being made  */
+    uint                buf_len;        /* bytes in use             */
+    uint                buf_cap;        /* bytes allocated          */
+    boolean             failed;         /* out of memory making it? */
+    struct __jit_region_type
+                       *regions;        /* executable mappings      */
+    uint                num_regions;    /* in use                   */
+    uint                region_cap;     /* allocated                */
+    uint                num_loops;      /* loops compiled           */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+jit_error_t8 init_jit
+(
+    struct jit_type        *jit,    /* JIT to initialize        */
+    const struct bc_program_type
+                           *prog,   /* ended program            */
+    uint                    trips   /* trips before compiling   */
+);
+
+jit_func jit_find_loop
+(
+    struct jit_type        *jit,    /* JIT                      */
+    uint                    begin,  /* code index of the loop   */
+    uint                    end     /* code index after it      */
+);
+
+void free_jit
+(
+    struct jit_type        *jit     /* JIT to free              */
+);
+
+const char *jit_error_str
+(
+    jit_error_t8            error   /* error code               */
+);
+
+#endif /* __JIT_H__ */
@@ -0,0 +1,39 @@
+/**************************************************
+*
+*   NAME:
+*       number.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       decoding numeric literals into their
+*       binary values
+*
+**************************************************/
+
+#ifndef __NUMBER_H__
+#define __NUMBER_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "types.h"
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+boolean decode_int_literal
+(
+    const char *str,    /* literal's characters     */
+    uint        len,    /* number of characters     */
+    sint64     *val     /* decoded value            */
+);
+
+boolean decode_real_literal
+(
+    const char *str,    /* literal's characters     */
+    uint        len,    /* number of characters     */
+    double     *val     /* decoded value            */
+);
+
+#endif /* __NUMBER_H__ */
@@ -0,0 +1,656 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       parser.c
+*
+*   DESCRIPTION:
+*       Builds the flat AST for the bracketed
+*       prefix language in one forward pass.
+*       Tokens are pushed into the parser in
+*       batches, and open lists are tracked on
+*       an explicit stack rather than by
+*       recursion.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "parser.h"
+#include "scanner.h"
+#include "stats.h"
+#include "tokens.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __INITIAL_STACK_CAP 64      /* initial parse stack frames   */
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static parse_error_t8 __grow_stack
+(
+    struct parser_type     *p       /* parser                   */
+);
+
+static void __resolve_sign_opp
+(
+    struct ast_type        *ast,    /* tree                     */
+    uint                    list,   /* closed list node         */
+    uint                    count   /* elements in the list     */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __grow_stack - "Grow Stack"
+*
+*   DESCRIPTION:
+*       Doubles the capacity of the parse
+*       stack.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * PARSE_NO_MEMORY if the stack couldn't
+*         be grown. The stack is unchanged.
+*
+**************************************************/
+static parse_error_t8 __grow_stack
+(
+    struct parser_type     *p       /* parser                   */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct parse_frame_type    *stack;      /* grown stack      */
+    uint                        new_cap;    /* grown capacity   */
+
+    new_cap = p->stack_cap << 1;
+    if( new_cap <= p->stack_cap )
+    {
+        return( PARSE_NO_MEMORY );
+    }
+
+    stack = (struct parse_frame_type *)stats_realloc( p->stack, (size_t)new_cap * sizeof( *stack ) );
+    if( NULL == stack )
+    {
+        return( PARSE_NO_MEMORY );
+    }
+
+    p->stack     = stack;
+    p->stack_cap = new_cap;
+
+    return( PARSE_NO_ERROR );
+
+}   /* __grow_stack() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __resolve_sign_opp - "Resolve Sign
+*                             Operator"
+*
+*   DESCRIPTION:
+*       "-" and "+" are both unary and binary
+*       operators, so the scanner can't tell
+*       which one it saw. Once a list is closed
+*       the number of operands decides it.
+*
+**************************************************/
+static void __resolve_sign_opp
+(
+    struct ast_type        *ast,    /* tree                     */
+    uint                    list,   /* closed list node         */
+    uint                    count   /* elements in the list     */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct ast_node_type   *opp;        /* list's first element */
+    boolean                 is_minus;   /* "-" rather than "+"? */
+
+    if( AST_NO_NODE == ast->nodes[ list ].first_child )
+    {
+        return;
+    }
+
+    opp = &ast->nodes[ ast->nodes[ list ].first_child ];
+    if( ( TOK_BINARY_OPP == opp->token_class )
+     && ( ( TOK_ADD_OPP == opp->subclass ) || ( TOK_SUB_OPP == opp->subclass ) ) )
+    {
+        is_minus = ( TOK_SUB_OPP == opp->subclass );
+    }
+    else if( ( TOK_UNARY_OPP == opp->token_class )
+          && ( ( TOK_NEG_OPP == opp->subclass ) || ( TOK_POS_OPP == opp->subclass ) ) )
+    {
+        is_minus = ( TOK_NEG_OPP == opp->subclass );
+    }
+    else
+    {
+        return;
+    }
+
+    if( 2 == count )
+    {
+        opp->token_class = TOK_UNARY_OPP;
+        opp->subclass    = is_minus ? TOK_NEG_OPP : TOK_POS_OPP;
+    }
+    else
+    {
+        opp->token_class = TOK_BINARY_OPP;
+        opp->subclass    = is_minus ? TOK_SUB_OPP : TOK_ADD_OPP;
+    }
+
+}   /* __resolve_sign_opp() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_parser - "Initialize Parser"
+*
+*   DESCRIPTION:
+*       Prepares a parser to fill an initialized
+*       tree. The root is the only open list.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * PARSE_NO_MEMORY if the parse stack
+*         couldn't be allocated.
+*
+**************************************************/
+parse_error_t8 init_parser
+(
+    struct parser_type *p,              /* parser to initialize     */
+    struct ast_type    *ast             /* initialized tree to fill */
+)
+{
+    p->ast          = ast;
+    p->depth        = 0;
+    p->error        = PARSE_NO_ERROR;
+    p->error_offset = 0;
+    p->stack_cap    = __INITIAL_STACK_CAP;
+    p->stack        = (struct parse_frame_type *)stats_malloc( p->stack_cap * sizeof( *p->stack ) );
+    if( NULL == p->stack )
+    {
+        p->stack_cap = 0;
+        return( PARSE_NO_MEMORY );
+    }
+
+    p->stack[ 0 ].list  = AST_ROOT;
+    p->stack[ 0 ].last  = AST_NO_NODE;
+    p->stack[ 0 ].count = 0;
+    p->depth            = 1;
+
+    return( PARSE_NO_ERROR );
+
+}   /* init_parser() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       parse_tokens - "Parse Tokens"
+*
+*   DESCRIPTION:
+*       Consumes a batch of tokens. '[' pushes a
+*       frame for the new list, ']' pops it,
+*       and every element is linked after the
+*       last child of the list on top of the
+*       stack. Both are constant time, so the
+*       cost per token doesn't depend on how
+*       deeply the input is nested.
+*
+*       Batches may split a form anywhere; the
+*       parser picks up where it left off.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * PARSE_UNEXPECTED_END for a ']' with no
+*         open list.
+*       * PARSE_NO_MEMORY if the tree or the
+*         stack couldn't be grown.
+*       * Once an error is returned, every later
+*         call returns it again.
+*
+**************************************************/
+parse_error_t8 parse_tokens
+(
+    struct parser_type *p,              /* parser                   */
+    const struct scan_token_type
+                       *toks,           /* tokens to consume        */
+    uint                n               /* number of tokens         */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct scan_token_type   *tok;    /* current token        */
+    const struct scan_token_type   *end;    /* past the last token  */
+    struct ast_type                *ast;    /* tree                 */
+    struct parse_frame_type        *top;    /* innermost open list  */
+    uint                            node;   /* new node             */
+
+    if( PARSE_NO_ERROR != p->error )
+    {
+        return( p->error );
+    }
+
+    ast = p->ast;
+    end = toks + n;
+    for( tok = toks; tok < end; ++tok )
+    {
+        if( ( TOK_LIST_TYPE == tok->token_class )
+         && ( TOK_LIST_END == tok->subclass ) )
+        {
+            if( 1 == p->depth )
+            {
+                p->error        = PARSE_UNEXPECTED_END;
+                p->error_offset = tok->offset;
+                return( p->error );
+            }
+
+            top = &p->stack[ --p->depth ];
+            __resolve_sign_opp( ast, top->list, top->count );
+            continue;
+        }
+
+        /*-----------------------------
+        Append the element and link it
+        -----------------------------*/
+        node = add_ast_node( ast, tok );
+        if( AST_NO_NODE == node )
+        {
+            p->error        = PARSE_NO_MEMORY;
+            p->error_offset = tok->offset;
+            return( p->error );
+        }
+
+        top = &p->stack[ p->depth - 1 ];
+        if( AST_NO_NODE == top->last )
+        {
+            ast->nodes[ top->list ].first_child = node;
+        }
+        else
+        {
+            ast->nodes[ top->last ].next_sibling = node;
+        }
+        top->last = node;
+        ++top->count;
+
+        /*-----------------------------
+        Open a new list
+        -----------------------------*/
+        if( TOK_LIST_TYPE == tok->token_class )
+        {
+            if( ( p->depth == p->stack_cap )
+             && ( PARSE_NO_ERROR != __grow_stack( p ) ) )
+            {
+                p->error        = PARSE_NO_MEMORY;
+                p->error_offset = tok->offset;
+                return( p->error );
+            }
+
+            top = &p->stack[ p->depth++ ];
+            top->list  = node;
+            top->last  = AST_NO_NODE;
+            top->count = 0;
+        }
+    }
+
+    return( PARSE_NO_ERROR );
+
+}   /* parse_tokens() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       finish_parse - "Finish Parse"
+*
+*   DESCRIPTION:
+*       Checks that every list was closed once
+*       the input has run out.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * PARSE_MISSING_END if a list is still
+*         open; error_offset is set to the
+*         innermost one.
+*
+**************************************************/
+parse_error_t8 finish_parse
+(
+    struct parser_type *p               /* parser                   */
+)
+{
+    if( ( PARSE_NO_ERROR == p->error )
+     && ( p->depth > 1 ) )
+    {
+        p->error        = PARSE_MISSING_END;
+        p->error_offset = p->ast->nodes[ p->stack[ p->depth - 1 ].list ].offset;
+    }
+
+    return( p->error );
+
+}   /* finish_parse() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       complete_nodes - "Complete Nodes"
+*
+*   DESCRIPTION:
+*       Returns the number of nodes in the
+*       top-level forms that have been closed
+*       and not yet detached.
+*
+**************************************************/
+uint complete_nodes
+(
+    const struct parser_type
+                       *p               /* parser                   */
+)
+{
+    if( p->depth > 1 )
+    {
+        return( p->stack[ 1 ].list - 1 );
+    }
+
+    return( p->ast->num_nodes - 1 );
+
+}   /* complete_nodes() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       detach_forms - "Detach Forms"
+*
+*   DESCRIPTION:
+*       Moves every closed top-level form out of
+*       the tree being built and into another
+*       tree, whose root becomes their parent.
+*       A form still being parsed stays behind
+*       and is moved down to follow the root.
+*
+*       Because nodes are in pre-order, the
+*       closed forms are the contiguous range
+*       ahead of the open one. They always
+*       start right after the root, so they
+*       keep their indices in the new tree; the
+*       open form is rebased by the number of
+*       nodes detached. Every node is moved at
+*       most once: once a form is left open, no
+*       other form can close until it does.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * PARSE_NO_MEMORY if the other tree
+*         couldn't be grown. Neither tree is
+*         changed.
+*
+*   NOTES:
+*       * The other tree is reset first.
+*
+**************************************************/
+parse_error_t8 detach_forms
+(
+    struct parser_type *p,              /* parser                   */
+    struct ast_type    *out             /* tree to receive forms    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct ast_type        *ast;        /* tree being built         */
+    struct ast_node_type   *nodes;      /* out's nodes              */
+    struct ast_node_type   *node;       /* moved node               */
+    struct ast_node_type   *node_end;   /* past the moved nodes     */
+    uint                    open;       /* open form, if any        */
+    uint                    form;       /* top-level form           */
+    uint                    shift;      /* nodes detached           */
+    uint                    i;          /* frame index              */
+
+    ast = p->ast;
+    reset_ast( out );
+    shift = complete_nodes( p );
+    if( 0 == shift )
+    {
+        return( PARSE_NO_ERROR );
+    }
+
+    /*---------------------------------
+    Copy the closed forms
+    ---------------------------------*/
+    if( ( out->capacity < shift + 1 )
+     && ( AST_NO_ERROR != reserve_ast( out, shift + 1 ) ) )
+    {
+        return( PARSE_NO_MEMORY );
+    }
+
+    nodes = out->nodes;
+    memcpy( &nodes[ 1 ], &ast->nodes[ 1 ], (size_t)shift * sizeof( *nodes ) );
+    out->num_nodes = shift + 1;
+    nodes[ AST_ROOT ].first_child = 1;
+
+    open = shift + 1;
+    form = 1;
+    while( ( AST_NO_NODE != nodes[ form ].next_sibling )
+        && ( nodes[ form ].next_sibling < open ) )
+    {
+        form = nodes[ form ].next_sibling;
+    }
+    nodes[ form ].next_sibling = AST_NO_NODE;
+
+    /*---------------------------------
+    Move the open form down
+    ---------------------------------*/
+    if( p->depth > 1 )
+    {
+        memmove( &ast->nodes[ 1 ], &ast->nodes[ open ], (size_t)( ast->num_nodes - open ) * sizeof( *ast->nodes ) );
+        node_end = &ast->nodes[ ast->num_nodes - shift ];
+        for( node = &ast->nodes[ 1 ]; node < node_end; ++node )
+        {
+            if( AST_NO_NODE != node->first_child )
+            {
+                node->first_child -= shift;
+            }
+            if( AST_NO_NODE != node->next_sibling )
+            {
+                node->next_sibling -= shift;
+            }
+        }
+
+        for( i = 1; i < p->depth; ++i )
+        {
+            p->stack[ i ].list -= shift;
+            if( AST_NO_NODE != p->stack[ i ].last )
+            {
+                p->stack[ i ].last -= shift;
+            }
+        }
+
+        ast->nodes[ AST_ROOT ].first_child = 1;
+        p->stack[ 0 ].last                 = 1;
+        p->stack[ 0 ].count                = 1;
+    }
+    else
+    {
+        ast->nodes[ AST_ROOT ].first_child = AST_NO_NODE;
+        p->stack[ 0 ].last                 = AST_NO_NODE;
+        p->stack[ 0 ].count                = 0;
+    }
+    ast->num_nodes -= shift;
+
+    return( PARSE_NO_ERROR );
+
+}   /* detach_forms() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_parser - "Free Parser"
+*
+*   DESCRIPTION:
+*       Frees the parse stack. The tree isn't
+*       touched.
+*
+**************************************************/
+void free_parser
+(
+    struct parser_type *p               /* parser to free           */
+)
+{
+    free( p->stack );
+    p->stack     = NULL;
+    p->stack_cap = 0;
+    p->depth     = 0;
+
+}   /* free_parser() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       parse_buffer - "Parse Buffer"
+*
+*   DESCRIPTION:
+*       Scans and parses a source buffer into a
+*       new tree, handing the parser one batch
+*       of tokens at a time. The top-level forms
+*       become the children of the root.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * On any error, error_offset is set to
+*         the offending lexeme. The tree holds
+*         whatever was built so far and must
+*         still be freed with free_ast().
+*
+*   NOTES:
+*       * The symbol table must be initialized.
+*
+**************************************************/
+parse_error_t8 parse_buffer
+(
+    const char         *src,            /* source buffer            */
+    uint                len,            /* length of the source     */
+    struct ast_type    *ast,            /* tree to build            */
+    uint               *error_offset    /* offset of an error       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct scanner_type     s;                          /* scanner          */
+    struct parser_type      p;                          /* parser           */
+    struct scan_token_type  batch[ SCAN_BATCH_SIZE ];   /* token batch      */
+    parse_error_t8          error;                      /* error code       */
+    uint                    n;                          /* tokens in batch  */
+
+    *error_offset = 0;
+    if( AST_NO_ERROR != init_ast( ast, src, len, 0 ) )
+    {
+        return( PARSE_NO_MEMORY );
+    }
+
+    if( PARSE_NO_ERROR != init_parser( &p, ast ) )
+    {
+        return( PARSE_NO_MEMORY );
+    }
+
+    init_scanner( &s, src, len );
+    error = PARSE_NO_ERROR;
+    while( ( PARSE_NO_ERROR == error )
+        && ( 0 != ( n = scan_batch( &s, batch, SCAN_BATCH_SIZE ) ) ) )
+    {
+        error = parse_tokens( &p, batch, n );
+    }
+
+    if( ( PARSE_NO_ERROR == error )
+     && ( SCAN_NO_ERROR != s.error ) )
+    {
+        error           = PARSE_SCAN_ERROR;
+        p.error_offset  = s.error_offset;
+    }
+
+    if( PARSE_NO_ERROR == error )
+    {
+        error = finish_parse( &p );
+    }
+
+    *error_offset = p.error_offset;
+    free_parser( &p );
+
+    return( error );
+
+}   /* parse_buffer() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       parse_error_str - "Parse Error String"
+*
+*   DESCRIPTION:
+*       Returns a description of a parse error.
+*
+**************************************************/
+const char *parse_error_str
+(
+    parse_error_t8      error           /* error code               */
+)
+{
+    switch( error )
+    {
+        case PARSE_NO_ERROR:
+            return( "no error" );
+
+        case PARSE_NO_MEMORY:
+            return( "out of memory" );
+
+        case PARSE_SCAN_ERROR:
+            return( "invalid token" );
+
+        case PARSE_UNEXPECTED_END:
+            return( "']' without a matching '['" );
+
+        case PARSE_MISSING_END:
+            return( "'[' without a matching ']'" );
+
+        default:
+            return( "unknown error" );
+    }
+
+}   /* parse_error_str() */
@@ -0,0 +1,121 @@
+/**************************************************
+*
+*   NAME:
+*       parser.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for the
+*       parser
+*
+**************************************************/
+
+#ifndef __PARSER_H__
+#define __PARSER_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "ast.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+/*-------------------------------------
+Error types
+-------------------------------------*/
+typedef sint8 parse_error_t8;
+enum
+{
+    PARSE_NO_ERROR         =  0,    /* no error                         */
+    PARSE_NO_MEMORY        = -1,    /* out of memory                    */
+    PARSE_SCAN_ERROR       = -2,    /* the scanner rejected a lexeme    */
+    PARSE_UNEXPECTED_END   = -3,    /* ']' without a matching '['       */
+    PARSE_MISSING_END      = -4     /* '[' without a matching ']'       */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+One open list on the parse stack
+-------------------------------------*/
+struct parse_frame_type
+{
+    uint        list;           /* list node being filled       */
+    uint        last;           /* its last child so far        */
+    uint        count;          /* its children so far          */
+};
+
+/*-------------------------------------
+Parser state. Open lists are kept on
+an explicit stack instead of the C
+stack, so nesting depth is limited
+only by memory. Frame 0 is the root.
+-------------------------------------*/
+struct parser_type
+{
+    struct ast_type            *ast;            /* tree being built         */
+    struct parse_frame_type    *stack;          /* open lists               */
+    uint                        depth;          /* frames in use            */
+    uint                        stack_cap;      /* frames allocated         */
+    parse_error_t8              error;          /* first error              */
+    uint                        error_offset;   /* offset of the error      */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+parse_error_t8 init_parser
+(
+    struct parser_type *p,              /* parser to initialize     */
+    struct ast_type    *ast             /* initialized tree to fill */
+);
+
+parse_error_t8 parse_tokens
+(
+    struct parser_type *p,              /* parser                   */
+    const struct scan_token_type
+                       *toks,           /* tokens to consume        */
+    uint                n               /* number of tokens         */
+);
+
+parse_error_t8 finish_parse
+(
+    struct parser_type *p               /* parser                   */
+);
+
+uint complete_nodes
+(
+    const struct parser_type
+                       *p               /* parser                   */
+);
+
+parse_error_t8 detach_forms
+(
+    struct parser_type *p,              /* parser                   */
+    struct ast_type    *out             /* tree to receive forms    */
+);
+
+void free_parser
+(
+    struct parser_type *p               /* parser to free           */
+);
+
+parse_error_t8 parse_buffer
+(
+    const char         *src,            /* source buffer            */
+    uint                len,            /* length of the source     */
+    struct ast_type    *ast,            /* tree to build            */
+    uint               *error_offset    /* offset of an error       */
+);
+
+const char *parse_error_str
+(
+    parse_error_t8      error           /* error code               */
+);
+
+#endif /* __PARSER_H__ */
@@ -0,0 +1,561 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       peephole.c
+*
+*   DESCRIPTION:
+*       Rewrites short runs of emitted Gforth
+*       words into cheaper ones before they are
+*       written. The emitter pushes every word
+*       through a small window; as each word
+*       arrives the rules are tried against the
+*       words that end with it, so the stream
+*       is scanned once. A rewrite pushes its
+*       replacement through the rules again, so
+*       rewrites cascade.
+*
+*       Rules are only applied to the words
+*       the emitter generates, and rely on how
+*       it uses them: "+", "*" and "i/" only
+*       ever see ints, "and" only flags. "0="
+*       sees ints too, once "x 0 =" is
+*       rewritten to "x 0=", so "0= 0=" is only
+*       dropped after a word that leaves a
+*       well-formed flag.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <string.h>
+
+#include "peephole.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __MAX_PATTERN       6       /* longest pattern                  */
+#define __MAX_REPLACEMENT   3       /* longest replacement              */
+#define __MATCHED           ( -1 )  /* replacement word is literal text */
+
+/*-------------------------------------
+How a pattern word is matched
+-------------------------------------*/
+typedef uint8 __match_t8;
+enum
+{
+    __MATCH_TEXT = 0,               /* this exact word                  */
+    __MATCH_CONST,                  /* any int literal, true or false   */
+    __MATCH_REAL,                   /* any real literal                 */
+    __MATCH_STRING,                 /* any string literal               */
+    __MATCH_NAME,                   /* any variable                     */
+    __MATCH_FLAG,                   /* any word that leaves a flag      */
+    __MATCH_FIRST                   /* the word the pattern began with  */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+One word of a pattern
+-------------------------------------*/
+struct __pattern_type
+{
+    __match_t8          match;      /* how it is matched        */
+    const char         *text;       /* for __MATCH_TEXT         */
+    uint8               text_len;   /* its length               */
+};
+
+/*-------------------------------------
+One word of a replacement: literal
+text, or a word of the match
+-------------------------------------*/
+struct __replacement_type
+{
+    sint8               from;       /* matched word or __MATCHED*/
+    peep_class_t8       cls;        /* class of literal text    */
+    const char         *text;       /* literal text             */
+    uint8               text_len;   /* its length               */
+};
+
+/*-------------------------------------
+A rewrite rule
+-------------------------------------*/
+struct __rule_type
+{
+    const char         *str;        /* description              */
+    uint8               len;        /* words in the pattern     */
+    struct __pattern_type
+                        pattern[ __MAX_PATTERN ];
+    uint8               repl_len;   /* words in the replacement */
+    struct __replacement_type
+                        repl[ __MAX_REPLACEMENT ];
+};
+
+/*-------------------------------------------------
+                        MACROS
+-------------------------------------------------*/
+
+/*-------------------------------------
+Shorthand for the rule table: a word
+matched by text or by class, and a
+replacement word that is plain, a
+constant or taken from the match
+-------------------------------------*/
+#define __W( s )    { __MATCH_TEXT, s, sizeof( s ) - 1 }
+#define __K( m )    { m, NULL, 0 }
+#define __G( s )    { __MATCHED, PEEP_PLAIN, s, sizeof( s ) - 1 }
+#define __C( s )    { __MATCHED, PEEP_CONST, s, sizeof( s ) - 1 }
+#define __M( i )    { i, PEEP_PLAIN, NULL, 0 }
+
+/*-------------------------------------------------
+                VARIABLE CONSTANTS
+-------------------------------------------------*/
+
+/*-------------------------------------
+The rules, in peep_rule_t8 order. The
+first one that matches wins.
+-------------------------------------*/
+static const struct __rule_type __rules[ PEEP_NUM_RULES ] =
+{
+    { "negate negate ->",       2, { __W( "negate" ),  __W( "negate" )  }, 0, { { 0 } } },
+    { "fnegate fnegate ->",     2, { __W( "fnegate" ), __W( "fnegate" ) }, 0, { { 0 } } },
+    { "f 0= 0= -> f",           3, { __K( __MATCH_FLAG ), __W( "0=" ), __W( "0=" ) }, 1, { __M( 0 ) } },
+    { "0 + ->",                 2, { __W( "0" ),       __W( "+" )       }, 0, { { 0 } } },
+    { "0 - ->",                 2, { __W( "0" ),       __W( "-" )       }, 0, { { 0 } } },
+    { "1 * ->",                 2, { __W( "1" ),       __W( "*" )       }, 0, { { 0 } } },
+    { "1 i/ ->",                2, { __W( "1" ),       __W( "i/" )      }, 0, { { 0 } } },
+    { "1 i** ->",               2, { __W( "1" ),       __W( "i**" )     }, 0, { { 0 } } },
+    { "true and ->",            2, { __W( "true" ),    __W( "and" )     }, 0, { { 0 } } },
+    { "false or ->",            2, { __W( "false" ),   __W( "or" )      }, 0, { { 0 } } },
+    { "0 * -> drop 0",          2, { __W( "0" ),       __W( "*" )       }, 2, { __G( "drop" ), __C( "0" ) } },
+    { "0 i** -> drop 1",        2, { __W( "0" ),       __W( "i**" )     }, 2, { __G( "drop" ), __C( "1" ) } },
+    { "1 + -> 1+",              2, { __W( "1" ),       __W( "+" )       }, 1, { __G( "1+" ) } },
+    { "1 - -> 1-",              2, { __W( "1" ),       __W( "-" )       }, 1, { __G( "1-" ) } },
+    { "1 lshift -> 2*",         2, { __W( "1" ),       __W( "lshift" )  }, 1, { __G( "2*" ) } },
+    { "1 arshift -> 2/",        2, { __W( "1" ),       __W( "arshift" ) }, 1, { __G( "2/" ) } },
+    { "0 = -> 0=",              2, { __W( "0" ),       __W( "=" )       }, 1, { __G( "0=" ) } },
+    { "0 <> -> 0<>",            2, { __W( "0" ),       __W( "<>" )      }, 1, { __G( "0<>" ) } },
+    { "0 < -> 0<",              2, { __W( "0" ),       __W( "<" )       }, 1, { __G( "0<" ) } },
+    { "0 > -> 0>",              2, { __W( "0" ),       __W( ">" )       }, 1, { __G( "0>" ) } },
+    { "true 0= -> false",       2, { __W( "true" ),    __W( "0=" )      }, 1, { __C( "false" ) } },
+    { "false 0= -> true",       2, { __W( "false" ),   __W( "0=" )      }, 1, { __C( "true" ) } },
+    { "c drop ->",              2, { __K( __MATCH_CONST ),  __W( "drop" )  }, 0, { { 0 } } },
+    { "r fdrop ->",             2, { __K( __MATCH_REAL ),   __W( "fdrop" ) }, 0, { { 0 } } },
+    { "s\" ..\" 2drop ->",      2, { __K( __MATCH_STRING ), __W( "2drop" ) }, 0, { { 0 } } },
+    { "x @ drop ->",            3, { __K( __MATCH_NAME ), __W( "@" ),  __W( "drop" )  }, 0, { { 0 } } },
+    { "x f@ fdrop ->",          3, { __K( __MATCH_NAME ), __W( "f@" ), __W( "fdrop" ) }, 0, { { 0 } } },
+    { "x 2@ 2drop ->",          3, { __K( __MATCH_NAME ), __W( "2@" ), __W( "2drop" ) }, 0, { { 0 } } },
+    { "x @ 1+ x ! -> 1 x +!",   5, { __K( __MATCH_NAME ), __W( "@" ), __W( "1+" ), __K( __MATCH_FIRST ), __W( "!" ) },
+                                   3, { __C( "1" ), __M( 0 ), __G( "+!" ) } },
+    { "x @ c + x ! -> c x +!",  6, { __K( __MATCH_NAME ), __W( "@" ), __K( __MATCH_CONST ), __W( "+" ), __K( __MATCH_FIRST ), __W( "!" ) },
+                                   3, { __M( 2 ), __M( 0 ), __G( "+!" ) } }
+};
+
+/*-------------------------------------
+Words the emitter uses that leave a
+true or false flag, whatever they are
+given
+-------------------------------------*/
+static const char * const __flag_words[] =
+{
+    "=", "<>", "<", ">", "i<=", "i>=",
+    "f=", "f<>", "f<", "f>", "f<=", "f>=",
+    "str=", "str<>", "str<", "str>", "str<=", "str>=",
+    "0=", "0<>", "0<", "0>"
+};
+
+#define __NUM_FLAG_WORDS    ( sizeof( __flag_words ) / sizeof( __flag_words[ 0 ] ) )
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static boolean __is_flag_word
+(
+    const struct peep_word_type
+                           *word    /* word to check            */
+);
+
+static boolean __matches
+(
+    const struct peephole_type
+                           *p,      /* optimizer                */
+    const struct __rule_type
+                           *rule    /* rule to try              */
+);
+
+static void __rewrite
+(
+    struct peephole_type   *p,      /* optimizer                */
+    const struct __rule_type
+                           *rule    /* rule that matched        */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __is_flag_word - "Is Flag Word"
+*
+*   DESCRIPTION:
+*       Checks whether a word leaves a flag.
+*
+**************************************************/
+static boolean __is_flag_word
+(
+    const struct peep_word_type
+                           *word    /* word to check            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        i;              /* flag word                */
+
+    if( PEEP_PLAIN != word->cls )
+    {
+        return( FALSE );
+    }
+
+    for( i = 0; i < __NUM_FLAG_WORDS; ++i )
+    {
+        if( ( strlen( __flag_words[ i ] ) == word->len )
+         && ( 0 == memcmp( __flag_words[ i ], word->str, word->len ) ) )
+        {
+            return( TRUE );
+        }
+    }
+
+    return( FALSE );
+
+}   /* __is_flag_word() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __matches - "Matches"
+*
+*   DESCRIPTION:
+*       Checks a rule's pattern against the
+*       newest words in the window.
+*
+*   RETURNS:
+*       Returns TRUE if the pattern matches.
+*
+**************************************************/
+static boolean __matches
+(
+    const struct peephole_type
+                           *p,      /* optimizer                */
+    const struct __rule_type
+                           *rule    /* rule to try              */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct peep_word_type    *word;   /* word being matched   */
+    const struct peep_word_type    *first;  /* first matched word   */
+    const struct __pattern_type    *pat;    /* its pattern          */
+    uint                            i;      /* pattern word         */
+
+    if( rule->len > p->count )
+    {
+        return( FALSE );
+    }
+
+    first = &p->window[ ( p->first + p->count - rule->len ) & ( PEEP_WINDOW - 1 ) ];
+    for( i = rule->len; i-- > 0; )
+    {
+        word = &p->window[ ( p->first + p->count - rule->len + i ) & ( PEEP_WINDOW - 1 ) ];
+        pat  = &rule->pattern[ i ];
+        switch( pat->match )
+        {
+            case __MATCH_TEXT:
+                if( ( PEEP_STRING == word->cls )
+                 || ( pat->text_len != word->len )
+                 || ( 0 != memcmp( pat->text, word->str, word->len ) ) )
+                {
+                    return( FALSE );
+                }
+                break;
+
+            case __MATCH_CONST:
+                if( PEEP_CONST != word->cls )
+                {
+                    return( FALSE );
+                }
+                break;
+
+            case __MATCH_REAL:
+                if( PEEP_REAL != word->cls )
+                {
+                    return( FALSE );
+                }
+                break;
+
+            case __MATCH_STRING:
+                if( PEEP_STRING != word->cls )
+                {
+                    return( FALSE );
+                }
+                break;
+
+            case __MATCH_NAME:
+                if( PEEP_NAME != word->cls )
+                {
+                    return( FALSE );
+                }
+                break;
+
+            case __MATCH_FLAG:
+                if( !__is_flag_word( word ) )
+                {
+                    return( FALSE );
+                }
+                break;
+
+            case __MATCH_FIRST:
+                if( ( first->cls != word->cls )
+                 || ( first->len != word->len )
+                 || ( 0 != memcmp( first->str, word->str, word->len ) ) )
+                {
+                    return( FALSE );
+                }
+                break;
+
+            default:
+                return( FALSE );
+        }
+    }
+
+    return( TRUE );
+
+}   /* __matches() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __rewrite - "Rewrite"
+*
+*   DESCRIPTION:
+*       Replaces the matched words by the
+*       rule's replacement, pushing it through
+*       the rules in turn. Words taken from the
+*       match are saved before the match is
+*       removed, since pushing reuses their
+*       slots.
+*
+**************************************************/
+static void __rewrite
+(
+    struct peephole_type   *p,      /* optimizer                */
+    const struct __rule_type
+                           *rule    /* rule that matched        */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct peep_word_type   saved[ __MAX_PATTERN ];     /* matched words    */
+    const struct __replacement_type
+                           *repl;                       /* replacement word */
+    const struct peep_word_type
+                           *word;                       /* matched word     */
+    uint                    i;                          /* word index       */
+
+    for( i = 0; i < rule->len; ++i )
+    {
+        word       = &p->window[ ( p->first + p->count - rule->len + i ) & ( PEEP_WINDOW - 1 ) ];
+        saved[ i ] = *word;
+        if( word->str == word->buf )
+        {
+            saved[ i ].str = saved[ i ].buf;
+        }
+    }
+    p->count -= rule->len;
+
+    for( i = 0; i < rule->repl_len; ++i )
+    {
+        repl = &rule->repl[ i ];
+        if( __MATCHED == repl->from )
+        {
+            peep_push( p, repl->text, repl->text_len, repl->cls );
+        }
+        else
+        {
+            word = &saved[ (uint)repl->from ];
+            peep_push( p, word->str, word->len, word->cls );
+        }
+    }
+
+}   /* __rewrite() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_peephole - "Initialize Peephole"
+*
+*   DESCRIPTION:
+*       Empties the window and zeroes the
+*       counts.
+*
+**************************************************/
+void init_peephole
+(
+    struct peephole_type   *p       /* optimizer to initialize  */
+)
+{
+    memset( p, 0, sizeof( *p ) );
+
+}   /* init_peephole() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       peep_push - "Peephole Push"
+*
+*   DESCRIPTION:
+*       Adds a word to the window and applies
+*       the first rule that matches the words
+*       ending with it.
+*
+*   NOTES:
+*       * The window must have room: take the
+*         oldest word out first once it holds
+*         PEEP_WINDOW words. No rule's
+*         replacement is longer than its
+*         pattern, so a rewrite never needs
+*         more room than the word pushed.
+*
+**************************************************/
+void peep_push
+(
+    struct peephole_type   *p,      /* optimizer                */
+    const char             *str,    /* word                     */
+    uint                    len,    /* its length               */
+    peep_class_t8           cls     /* what it is               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct peep_word_type  *word;   /* new word                 */
+    const struct __pattern_type
+                           *last;   /* rule's last pattern word */
+    uint                    i;      /* rule                     */
+
+    word      = &p->window[ ( p->first + p->count ) & ( PEEP_WINDOW - 1 ) ];
+    word->len = len;
+    word->cls = cls;
+    word->str = str;
+    if( len <= PEEP_WORD_LEN )
+    {
+        memcpy( word->buf, str, len );
+        word->str = word->buf;
+    }
+    ++p->count;
+
+    /*---------------------------------
+    Every rule ends in a Gforth word, so
+    only those can complete a match
+    ---------------------------------*/
+    if( PEEP_PLAIN != cls )
+    {
+        return;
+    }
+
+    for( i = 0; i < PEEP_NUM_RULES; ++i )
+    {
+        last = &__rules[ i ].pattern[ __rules[ i ].len - 1 ];
+        if( ( last->text_len == len )
+         && ( last->text[ 0 ] == str[ 0 ] )
+         && ( __matches( p, &__rules[ i ] ) ) )
+        {
+            ++p->counts[ i ];
+            __rewrite( p, &__rules[ i ] );
+            return;
+        }
+    }
+
+}   /* peep_push() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       peep_oldest - "Peephole Oldest"
+*
+*   DESCRIPTION:
+*       Returns the oldest word in the window,
+*       which no later word can rewrite once
+*       the window is full.
+*
+**************************************************/
+const struct peep_word_type *peep_oldest
+(
+    const struct peephole_type
+                           *p       /* optimizer                */
+)
+{
+    return( &p->window[ p->first ] );
+
+}   /* peep_oldest() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       peep_pop_oldest - "Peephole Pop Oldest"
+*
+*   DESCRIPTION:
+*       Removes the oldest word from the window.
+*
+**************************************************/
+void peep_pop_oldest
+(
+    struct peephole_type   *p       /* optimizer                */
+)
+{
+    p->first = ( p->first + 1 ) & ( PEEP_WINDOW - 1 );
+    --p->count;
+
+}   /* peep_pop_oldest() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       peep_rule_str - "Peephole Rule String"
+*
+*   DESCRIPTION:
+*       Describes a rule, as its pattern and
+*       replacement.
+*
+**************************************************/
+const char *peep_rule_str
+(
+    peep_rule_t8            rule    /* rule                     */
+)
+{
+    if( rule >= PEEP_NUM_RULES )
+    {
+        return( "unknown rule" );
+    }
+
+    return( __rules[ rule ].str );
+
+}   /* peep_rule_str() */
@@ -0,0 +1,146 @@
+/**************************************************
+*
+*   NAME:
+*       peephole.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for the
+*       peephole optimizer over emitted words
+*
+**************************************************/
+
+#ifndef __PEEPHOLE_H__
+#define __PEEPHOLE_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define PEEP_WINDOW         8       /* words held back, a power of 2    */
+#define PEEP_WORD_LEN       32      /* longest word that is copied      */
+
+/*-------------------------------------
+What a word is, as far as the rules
+are concerned
+-------------------------------------*/
+typedef uint8 peep_class_t8;
+enum
+{
+    PEEP_PLAIN = 0,                 /* Gforth word                      */
+    PEEP_CONST,                     /* int literal, true or false       */
+    PEEP_REAL,                      /* real literal                     */
+    PEEP_STRING,                    /* string literal's lexeme          */
+    PEEP_NAME                       /* variable's name                  */
+};
+
+/*-------------------------------------
+Rewrite rules, in the order they are
+tried
+-------------------------------------*/
+typedef uint8 peep_rule_t8;
+enum
+{
+    PEEP_NEG_NEG = 0,               /* negate negate        ->          */
+    PEEP_FNEG_FNEG,                 /* fnegate fnegate      ->          */
+    PEEP_NOT_NOT,                   /* f 0= 0=              -> f        */
+    PEEP_ADD_ZERO,                  /* 0 +                  ->          */
+    PEEP_SUB_ZERO,                  /* 0 -                  ->          */
+    PEEP_MUL_ONE,                   /* 1 *                  ->          */
+    PEEP_DIV_ONE,                   /* 1 i/                 ->          */
+    PEEP_EXP_ONE,                   /* 1 i**                ->          */
+    PEEP_AND_TRUE,                  /* true and             ->          */
+    PEEP_OR_FALSE,                  /* false or             ->          */
+    PEEP_MUL_ZERO,                  /* 0 *                  -> drop 0   */
+    PEEP_EXP_ZERO,                  /* 0 i**                -> drop 1   */
+    PEEP_ADD_ONE,                   /* 1 +                  -> 1+       */
+    PEEP_SUB_ONE,                   /* 1 -                  -> 1-       */
+    PEEP_SHL_ONE,                   /* 1 lshift             -> 2*       */
+    PEEP_SAR_ONE,                   /* 1 arshift            -> 2/       */
+    PEEP_EQ_ZERO,                   /* 0 =                  -> 0=       */
+    PEEP_NE_ZERO,                   /* 0 <>                 -> 0<>      */
+    PEEP_LT_ZERO,                   /* 0 <                  -> 0<       */
+    PEEP_GT_ZERO,                   /* 0 >                  -> 0>       */
+    PEEP_NOT_TRUE,                  /* true 0=              -> false    */
+    PEEP_NOT_FALSE,                 /* false 0=             -> true     */
+    PEEP_DROP_CONST,                /* c drop               ->          */
+    PEEP_DROP_REAL,                 /* r fdrop              ->          */
+    PEEP_DROP_STRING,               /* s" .." 2drop         ->          */
+    PEEP_DROP_FETCH,                /* x @ drop             ->          */
+    PEEP_DROP_FFETCH,               /* x f@ fdrop           ->          */
+    PEEP_DROP_2FETCH,               /* x 2@ 2drop           ->          */
+    PEEP_INC_VAR,                   /* x @ 1+ x !           -> 1 x +!   */
+    PEEP_ADD_VAR,                   /* x @ c + x !          -> c x +!   */
+    PEEP_NUM_RULES                  /* number of rules                  */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A word held back. Words up to
+PEEP_WORD_LEN long are copied into
+buf; longer ones are pointed to and
+must stay put until they are taken.
+-------------------------------------*/
+struct peep_word_type
+{
+    const char         *str;                    /* text             */
+    uint                len;                    /* its length       */
+    peep_class_t8       cls;                    /* what it is       */
+    char                buf[ PEEP_WORD_LEN ];   /* copied text      */
+};
+
+/*-------------------------------------
+The last few words emitted, as a ring,
+and how often each rule fired
+-------------------------------------*/
+struct peephole_type
+{
+    struct peep_word_type
+                        window[ PEEP_WINDOW ];  /* held-back words  */
+    uint                first;                  /* oldest word      */
+    uint                count;                  /* words held back  */
+    uint64              counts[ PEEP_NUM_RULES ];
+                                                /* rewrites by rule */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+void init_peephole
+(
+    struct peephole_type   *p       /* optimizer to initialize  */
+);
+
+void peep_push
+(
+    struct peephole_type   *p,      /* optimizer                */
+    const char             *str,    /* word                     */
+    uint                    len,    /* its length               */
+    peep_class_t8           cls     /* what it is               */
+);
+
+const struct peep_word_type *peep_oldest
+(
+    const struct peephole_type
+                           *p       /* optimizer                */
+);
+
+void peep_pop_oldest
+(
+    struct peephole_type   *p       /* optimizer                */
+);
+
+const char *peep_rule_str
+(
+    peep_rule_t8            rule    /* rule                     */
+);
+
+#endif /* __PEEPHOLE_H__ */
@@ -0,0 +1,872 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       pipeline.c
+*
+*   DESCRIPTION:
+*       Runs the front end as a pipeline. The
+*       scanner, the parser and the form sink
+*       (normally the code generator) each get
+*       a thread, connected by bounded lock-free
+*       queues: token batches flow from the
+*       scanner to the parser, and batches of
+*       complete top-level forms flow from the
+*       parser to the sink.
+*
+*       Every queue has a partner that returns
+*       empty batches to the producer. Only
+*       PIPE_NUM_BATCHES batches exist per
+*       queue, so a producer that gets ahead
+*       waits for the consumer to hand one back
+*       and memory use stays bounded no matter
+*       how large the source is.
+*
+*       A stage only waits when its neighbour
+*       is behind, so on a large file the run
+*       takes about as long as the slowest
+*       stage rather than the sum of all three.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "parser.h"
+#include "pipeline.h"
+#include "scanner.h"
+#include "spsc_queue.h"
+#include "stats.h"
+#include "trace.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __QUEUE_CAP         ( PIPE_NUM_BATCHES * 2 )
+                                    /* room for every batch plus    */
+                                    /*  the end marker              */
+#define __SPIN_COUNT        256     /* polls before yielding        */
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+Token batch
+-------------------------------------*/
+struct __token_batch_type
+{
+    uint                    n;                          /* tokens used  */
+    struct scan_token_type  toks[ PIPE_TOKEN_BATCH ];   /* tokens       */
+};
+
+/*-------------------------------------
+State shared by the stages. A NULL
+item on a full queue marks the end of
+the stream.
+-------------------------------------*/
+struct __pipeline_type
+{
+    const char                 *src;            /* source buffer            */
+    uint                        len;            /* length of the source     */
+    pipe_sink_func              sink;           /* last stage               */
+    void                       *user;           /* sink's state             */
+    struct stats_type          *stats;          /* statistics, or NULL      */
+
+    struct spsc_queue_type      tok_full;       /* scanner -> parser        */
+    struct spsc_queue_type      tok_free;       /* parser -> scanner        */
+    struct spsc_queue_type      node_full;      /* parser -> sink           */
+    struct spsc_queue_type      node_free;      /* sink -> parser           */
+    struct __token_batch_type  *tok_batches;    /* token batch pool         */
+    struct ast_type            *node_batches;   /* node batch pool          */
+    uint                        num_node_batches;
+                                                /* node batches initialized */
+
+    atomic_int                  cancel;         /* a stage gave up          */
+    scan_error_t8               scan_error;     /* scanner's error          */
+    uint                        scan_offset;    /* offset of scanner error  */
+    pipe_error_t8               parse_result;   /* parser stage's error     */
+    parse_error_t8              parse_error;    /* parser's error           */
+    uint                        parse_offset;   /* offset of parser error   */
+    boolean                     sink_failed;    /* sink stage gave up?      */
+    uint                        num_forms;      /* forms sunk               */
+    uint                        num_batches;    /* calls to the sink        */
+};
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static boolean __wait_pop
+(
+    struct __pipeline_type *pl,     /* pipeline                 */
+    struct spsc_queue_type *q,      /* queue to pop from        */
+    void                  **item    /* popped item              */
+);
+
+static boolean __init_pools
+(
+    struct __pipeline_type *pl      /* pipeline                 */
+);
+
+static void __free_pools
+(
+    struct __pipeline_type *pl      /* pipeline                 */
+);
+
+static void *__scan_stage
+(
+    void                   *arg     /* pipeline                 */
+);
+
+static void *__parse_stage
+(
+    void                   *arg     /* pipeline                 */
+);
+
+static boolean __sink_form_batch
+(
+    struct __pipeline_type *pl,     /* pipeline                 */
+    struct ast_type        *forms   /* batch of forms           */
+);
+
+static void __sink_stage
+(
+    struct __pipeline_type *pl      /* pipeline                 */
+);
+
+static void __run_sequential
+(
+    struct __pipeline_type *pl      /* pipeline                 */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __wait_pop - "Wait Pop"
+*
+*   DESCRIPTION:
+*       Pops an item, waiting for one if the
+*       queue is empty. The wait spins briefly,
+*       since the other side is usually only a
+*       batch behind, then yields the core. A
+*       wait is a span on the trace.
+*
+*   RETURNS:
+*       Returns TRUE once an item was popped,
+*       FALSE if another stage cancelled the
+*       run while waiting.
+*
+**************************************************/
+static boolean __wait_pop
+(
+    struct __pipeline_type *pl,     /* pipeline                 */
+    struct spsc_queue_type *q,      /* queue to pop from        */
+    void                  **item    /* popped item              */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        spins;          /* polls since yielding     */
+
+    if( spsc_pop( q, item ) )
+    {
+        return( TRUE );
+    }
+
+    trace_begin( "pipeline", "wait", NULL );
+    spins = 0;
+    while( !spsc_pop( q, item ) )
+    {
+        if( atomic_load_explicit( &pl->cancel, memory_order_relaxed ) )
+        {
+            trace_end( "pipeline", "wait", NULL );
+            return( FALSE );
+        }
+
+        if( ++spins < __SPIN_COUNT )
+        {
+            #if defined( __x86_64__ ) || defined( __i386__ )
+            __builtin_ia32_pause();
+            #endif
+        }
+        else
+        {
+            spins = 0;
+            sched_yield();
+        }
+    }
+    trace_end( "pipeline", "wait", NULL );
+
+    return( TRUE );
+
+}   /* __wait_pop() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __init_pools - "Initialize Pools"
+*
+*   DESCRIPTION:
+*       Allocates the queues and the batches,
+*       and puts every batch on its free queue.
+*
+*   RETURNS:
+*       Returns TRUE on success
+*
+*   ERRORS:
+*       * Returns FALSE if anything couldn't be
+*         allocated. Whatever was allocated must
+*         still be freed with __free_pools().
+*
+**************************************************/
+static boolean __init_pools
+(
+    struct __pipeline_type *pl      /* pipeline                 */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        i;              /* batch index              */
+
+    pl->tok_batches      = NULL;
+    pl->node_batches     = NULL;
+    pl->num_node_batches = 0;
+    if( !init_spsc_queue( &pl->tok_full,  __QUEUE_CAP )
+     || !init_spsc_queue( &pl->tok_free,  __QUEUE_CAP )
+     || !init_spsc_queue( &pl->node_full, __QUEUE_CAP )
+     || !init_spsc_queue( &pl->node_free, __QUEUE_CAP ) )
+    {
+        return( FALSE );
+    }
+
+    pl->tok_batches  = (struct __token_batch_type *)stats_malloc( PIPE_NUM_BATCHES * sizeof( *pl->tok_batches ) );
+    pl->node_batches = (struct ast_type *)stats_malloc( PIPE_NUM_BATCHES * sizeof( *pl->node_batches ) );
+    if( ( NULL == pl->tok_batches )
+     || ( NULL == pl->node_batches ) )
+    {
+        return( FALSE );
+    }
+
+    for( i = 0; i < PIPE_NUM_BATCHES; ++i )
+    {
+        if( AST_NO_ERROR != init_ast( &pl->node_batches[ i ], pl->src, pl->len, PIPE_NODE_BATCH * 2 ) )
+        {
+            return( FALSE );
+        }
+        ++pl->num_node_batches;
+
+        spsc_push( &pl->tok_free,  &pl->tok_batches[ i ] );
+        spsc_push( &pl->node_free, &pl->node_batches[ i ] );
+    }
+
+    return( TRUE );
+
+}   /* __init_pools() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __free_pools - "Free Pools"
+*
+*   DESCRIPTION:
+*       Frees the queues and the batches.
+*
+**************************************************/
+static void __free_pools
+(
+    struct __pipeline_type *pl      /* pipeline                 */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        i;              /* batch index              */
+
+    for( i = 0; i < pl->num_node_batches; ++i )
+    {
+        free_ast( &pl->node_batches[ i ] );
+    }
+
+    free( pl->node_batches );
+    free( pl->tok_batches );
+    free_spsc_queue( &pl->node_free );
+    free_spsc_queue( &pl->node_full );
+    free_spsc_queue( &pl->tok_free );
+    free_spsc_queue( &pl->tok_full );
+
+}   /* __free_pools() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __scan_stage - "Scan Stage"
+*
+*   DESCRIPTION:
+*       Fills free token batches from the source
+*       and queues them for the parser. The
+*       scanner's error, if any, is recorded
+*       before the end marker is queued, so the
+*       parser sees it once it reaches the end.
+*
+**************************************************/
+static void *__scan_stage
+(
+    void                   *arg     /* pipeline                 */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __pipeline_type     *pl;     /* pipeline             */
+    struct __token_batch_type  *batch;  /* batch being filled   */
+    struct scanner_type         s;      /* scanner              */
+    struct stats_clock_type     clock;  /* times the scan       */
+    void                       *item;   /* popped item          */
+
+    pl = (struct __pipeline_type *)arg;
+    trace_thread( "scan" );
+    init_scanner( &s, pl->src, pl->len );
+    for( ;; )
+    {
+        if( !__wait_pop( pl, &pl->tok_free, &item ) )
+        {
+            return( NULL );
+        }
+
+        batch    = (struct __token_batch_type *)item;
+        stats_start( pl->stats, STATS_SCAN, &clock );
+        batch->n = scan_batch( &s, batch->toks, PIPE_TOKEN_BATCH );
+        stats_stop( pl->stats, STATS_SCAN, &clock );
+        if( NULL != pl->stats )
+        {
+            pl->stats->tokens += batch->n;
+        }
+        if( 0 == batch->n )
+        {
+            spsc_push( &pl->tok_free, batch );
+            break;
+        }
+
+        spsc_push( &pl->tok_full, batch );
+    }
+
+    pl->scan_error  = s.error;
+    pl->scan_offset = s.error_offset;
+    spsc_push( &pl->tok_full, NULL );
+
+    return( NULL );
+
+}   /* __scan_stage() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __parse_stage - "Parse Stage"
+*
+*   DESCRIPTION:
+*       Parses token batches as they arrive.
+*       Whenever the closed top-level forms add
+*       up to PIPE_NODE_BATCH nodes they are
+*       detached into a free node batch and
+*       queued for the sink, so the tree being
+*       built never holds more than one batch
+*       plus the form still open.
+*
+*       On a parse error the run is cancelled,
+*       but the forms already queued are still
+*       handed to the sink.
+*
+**************************************************/
+static void *__parse_stage
+(
+    void                   *arg     /* pipeline                 */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __pipeline_type     *pl;     /* pipeline             */
+    struct __token_batch_type  *batch;  /* token batch          */
+    struct ast_type            *forms;  /* node batch           */
+    struct ast_type             ast;    /* tree being built     */
+    struct parser_type          p;      /* parser               */
+    struct stats_clock_type     clock;  /* times the parse      */
+    parse_error_t8              error;  /* parse error          */
+    boolean                     at_end; /* end marker seen?     */
+    void                       *item;   /* popped item          */
+
+    pl = (struct __pipeline_type *)arg;
+    trace_thread( "parse" );
+    if( AST_NO_ERROR != init_ast( &ast, pl->src, pl->len, PIPE_NODE_BATCH * 2 ) )
+    {
+        pl->parse_result = PIPE_NO_MEMORY;
+        atomic_store( &pl->cancel, 1 );
+        spsc_push( &pl->node_full, NULL );
+        return( NULL );
+    }
+
+    if( PARSE_NO_ERROR != init_parser( &p, &ast ) )
+    {
+        free_ast( &ast );
+        pl->parse_result = PIPE_NO_MEMORY;
+        atomic_store( &pl->cancel, 1 );
+        spsc_push( &pl->node_full, NULL );
+        return( NULL );
+    }
+
+    /*---------------------------------
+    Parse until the end marker
+    ---------------------------------*/
+    error  = PARSE_NO_ERROR;
+    at_end = FALSE;
+    while( !at_end )
+    {
+        if( !__wait_pop( pl, &pl->tok_full, &item ) )
+        {
+            break;
+        }
+
+        if( NULL == item )
+        {
+            at_end = TRUE;
+            if( SCAN_NO_ERROR != pl->scan_error )
+            {
+                error          = PARSE_SCAN_ERROR;
+                p.error_offset = pl->scan_offset;
+            }
+            else
+            {
+                stats_start( pl->stats, STATS_PARSE, &clock );
+                error = finish_parse( &p );
+                stats_stop( pl->stats, STATS_PARSE, &clock );
+            }
+        }
+        else
+        {
+            batch = (struct __token_batch_type *)item;
+            stats_start( pl->stats, STATS_PARSE, &clock );
+            error = parse_tokens( &p, batch->toks, batch->n );
+            stats_stop( pl->stats, STATS_PARSE, &clock );
+            spsc_push( &pl->tok_free, batch );
+        }
+
+        if( PARSE_NO_ERROR != error )
+        {
+            break;
+        }
+
+        /*-----------------------------
+        Hand off the closed forms
+        -----------------------------*/
+        if( ( complete_nodes( &p ) >= PIPE_NODE_BATCH )
+         || ( at_end && ( 0 != complete_nodes( &p ) ) ) )
+        {
+            if( !__wait_pop( pl, &pl->node_free, &item ) )
+            {
+                break;
+            }
+
+            forms = (struct ast_type *)item;
+            stats_start( pl->stats, STATS_PARSE, &clock );
+            error = detach_forms( &p, forms );
+            stats_stop( pl->stats, STATS_PARSE, &clock );
+            if( PARSE_NO_ERROR != error )
+            {
+                spsc_push( &pl->node_free, forms );
+                break;
+            }
+
+            spsc_push( &pl->node_full, forms );
+        }
+    }
+
+    if( PARSE_NO_ERROR != error )
+    {
+        pl->parse_result = ( PARSE_NO_MEMORY == error ) ? PIPE_NO_MEMORY : PIPE_PARSE_ERROR;
+        pl->parse_error  = error;
+        pl->parse_offset = p.error_offset;
+        atomic_store( &pl->cancel, 1 );
+    }
+
+    spsc_push( &pl->node_full, NULL );
+    free_parser( &p );
+    free_ast( &ast );
+
+    return( NULL );
+
+}   /* __parse_stage() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __sink_form_batch - "Sink Form Batch"
+*
+*   DESCRIPTION:
+*       Hands one batch of forms to the sink and
+*       counts them.
+*
+*   RETURNS:
+*       Returns what the sink returned
+*
+**************************************************/
+static boolean __sink_form_batch
+(
+    struct __pipeline_type *pl,     /* pipeline                 */
+    struct ast_type        *forms   /* batch of forms           */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        form;           /* top-level form           */
+
+    for( form = forms->nodes[ AST_ROOT ].first_child; AST_NO_NODE != form; form = forms->nodes[ form ].next_sibling )
+    {
+        ++pl->num_forms;
+    }
+    ++pl->num_batches;
+    if( NULL != pl->stats )
+    {
+        pl->stats->nodes += forms->num_nodes;
+    }
+
+    return( pl->sink( pl->user, forms ) );
+
+}   /* __sink_form_batch() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __sink_stage - "Sink Stage"
+*
+*   DESCRIPTION:
+*       Hands each batch of forms to the sink
+*       and returns it to the parser, until the
+*       end marker arrives or the sink gives up.
+*
+**************************************************/
+static void __sink_stage
+(
+    struct __pipeline_type *pl      /* pipeline                 */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct ast_type    *forms;      /* batch of forms           */
+    boolean             ok;         /* sink accepted the batch? */
+    void               *item;       /* popped item              */
+
+    for( ;; )
+    {
+        if( !__wait_pop( pl, &pl->node_full, &item )
+         || ( NULL == item ) )
+        {
+            return;
+        }
+
+        forms = (struct ast_type *)item;
+        ok    = __sink_form_batch( pl, forms );
+        spsc_push( &pl->node_free, forms );
+        if( !ok )
+        {
+            pl->sink_failed = TRUE;
+            atomic_store( &pl->cancel, 1 );
+            return;
+        }
+    }
+
+}   /* __sink_stage() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __run_sequential - "Run Sequential"
+*
+*   DESCRIPTION:
+*       Runs the same stages one after another
+*       on the calling thread, with one batch of
+*       each kind. Forms reach the sink in the
+*       same batches as in a threaded run.
+*
+**************************************************/
+static void __run_sequential
+(
+    struct __pipeline_type *pl      /* pipeline                 */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __token_batch_type  *batch;  /* token batch          */
+    struct ast_type            *forms;  /* node batch           */
+    struct ast_type             ast;    /* tree being built     */
+    struct parser_type          p;      /* parser               */
+    struct scanner_type         s;      /* scanner              */
+    struct stats_clock_type     clock;  /* times a phase        */
+    parse_error_t8              error;  /* parse error          */
+    boolean                     at_end; /* source exhausted?    */
+
+    batch = &pl->tok_batches[ 0 ];
+    forms = &pl->node_batches[ 0 ];
+    if( AST_NO_ERROR != init_ast( &ast, pl->src, pl->len, PIPE_NODE_BATCH * 2 ) )
+    {
+        pl->parse_result = PIPE_NO_MEMORY;
+        return;
+    }
+
+    if( PARSE_NO_ERROR != init_parser( &p, &ast ) )
+    {
+        free_ast( &ast );
+        pl->parse_result = PIPE_NO_MEMORY;
+        return;
+    }
+
+    init_scanner( &s, pl->src, pl->len );
+    error  = PARSE_NO_ERROR;
+    at_end = FALSE;
+    while( !at_end )
+    {
+        stats_start( pl->stats, STATS_SCAN, &clock );
+        batch->n = scan_batch( &s, batch->toks, PIPE_TOKEN_BATCH );
+        stats_stop( pl->stats, STATS_SCAN, &clock );
+        if( NULL != pl->stats )
+        {
+            pl->stats->tokens += batch->n;
+        }
+
+        stats_start( pl->stats, STATS_PARSE, &clock );
+        if( 0 == batch->n )
+        {
+            at_end = TRUE;
+            if( SCAN_NO_ERROR != s.error )
+            {
+                error          = PARSE_SCAN_ERROR;
+                p.error_offset = s.error_offset;
+            }
+            else
+            {
+                error = finish_parse( &p );
+            }
+        }
+        else
+        {
+            error = parse_tokens( &p, batch->toks, batch->n );
+        }
+        stats_stop( pl->stats, STATS_PARSE, &clock );
+
+        if( PARSE_NO_ERROR != error )
+        {
+            break;
+        }
+
+        if( ( complete_nodes( &p ) >= PIPE_NODE_BATCH )
+         || ( at_end && ( 0 != complete_nodes( &p ) ) ) )
+        {
+            stats_start( pl->stats, STATS_PARSE, &clock );
+            error = detach_forms( &p, forms );
+            stats_stop( pl->stats, STATS_PARSE, &clock );
+            if( PARSE_NO_ERROR != error )
+            {
+                break;
+            }
+
+            if( !__sink_form_batch( pl, forms ) )
+            {
+                pl->sink_failed = TRUE;
+                break;
+            }
+        }
+    }
+
+    if( PARSE_NO_ERROR != error )
+    {
+        pl->parse_result = ( PARSE_NO_MEMORY == error ) ? PIPE_NO_MEMORY : PIPE_PARSE_ERROR;
+        pl->parse_error  = error;
+        pl->parse_offset = p.error_offset;
+    }
+
+    free_parser( &p );
+    free_ast( &ast );
+
+}   /* __run_sequential() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       run_pipeline - "Run Pipeline"
+*
+*   DESCRIPTION:
+*       Scans and parses a source buffer and
+*       hands its top-level forms to a sink. If
+*       threaded, the scanner and the parser get
+*       threads of their own and the sink runs
+*       on the calling thread; otherwise all
+*       three run in turn on the calling thread.
+*
+*   RETURNS:
+*       Fills in the outcome of the run
+*
+*   ERRORS:
+*       * PIPE_PARSE_ERROR if the source didn't
+*         parse; parse_error and error_offset
+*         describe it. Forms before the error
+*         may already have reached the sink.
+*       * PIPE_SINK_ERROR if the sink returned
+*         FALSE.
+*       * PIPE_NO_MEMORY or PIPE_NO_THREAD if
+*         the pipeline couldn't be set up.
+*
+*   NOTES:
+*       * The symbol table must be initialized
+*         and mustn't change during the run.
+*       * With statistics, the scanner's and
+*         the parser's work is timed, and the
+*         tokens and nodes counted. The sink
+*         times its own.
+*
+**************************************************/
+void run_pipeline
+(
+    const char             *src,        /* source buffer            */
+    uint                    len,        /* length of the source     */
+    pipe_sink_func          sink,       /* last stage               */
+    void                   *user,       /* passed to the sink       */
+    boolean                 threaded,   /* a thread per stage?      */
+    struct stats_type      *stats,      /* statistics, or NULL      */
+    struct pipe_result_type
+                           *result      /* outcome of the run       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __pipeline_type  pl;             /* pipeline             */
+    pthread_t               scan_thread;    /* scanner stage        */
+    pthread_t               parse_thread;   /* parser stage         */
+
+    memset( result, 0, sizeof( *result ) );
+    memset( &pl, 0, sizeof( pl ) );
+    pl.src   = src;
+    pl.len   = len;
+    pl.sink  = sink;
+    pl.user  = user;
+    pl.stats = stats;
+    atomic_init( &pl.cancel, 0 );
+
+    if( !__init_pools( &pl ) )
+    {
+        __free_pools( &pl );
+        result->error = PIPE_NO_MEMORY;
+        return;
+    }
+
+    if( !threaded )
+    {
+        __run_sequential( &pl );
+    }
+    else
+    {
+        if( 0 != pthread_create( &scan_thread, NULL, __scan_stage, &pl ) )
+        {
+            __free_pools( &pl );
+            result->error = PIPE_NO_THREAD;
+            return;
+        }
+
+        if( 0 != pthread_create( &parse_thread, NULL, __parse_stage, &pl ) )
+        {
+            atomic_store( &pl.cancel, 1 );
+            pthread_join( scan_thread, NULL );
+            __free_pools( &pl );
+            result->error = PIPE_NO_THREAD;
+            return;
+        }
+
+        __sink_stage( &pl );
+        pthread_join( parse_thread, NULL );
+        pthread_join( scan_thread, NULL );
+    }
+
+    /*---------------------------------
+    Report the first failure
+    ---------------------------------*/
+    if( PIPE_NO_ERROR != pl.parse_result )
+    {
+        result->error        = pl.parse_result;
+        result->parse_error  = pl.parse_error;
+        result->error_offset = pl.parse_offset;
+    }
+    else if( pl.sink_failed )
+    {
+        result->error = PIPE_SINK_ERROR;
+    }
+    result->num_forms   = pl.num_forms;
+    result->num_batches = pl.num_batches;
+
+    __free_pools( &pl );
+
+}   /* run_pipeline() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       pipe_error_str - "Pipeline Error String"
+*
+*   DESCRIPTION:
+*       Returns a description of a pipeline
+*       error.
+*
+**************************************************/
+const char *pipe_error_str
+(
+    pipe_error_t8           error       /* error code               */
+)
+{
+    switch( error )
+    {
+        case PIPE_NO_ERROR:
+            return( "no error" );
+
+        case PIPE_NO_MEMORY:
+            return( "out of memory" );
+
+        case PIPE_NO_THREAD:
+            return( "couldn't start a pipeline thread" );
+
+        case PIPE_PARSE_ERROR:
+            return( "parse error" );
+
+        case PIPE_SINK_ERROR:
+            return( "code generation failed" );
+
+        default:
+            return( "unknown error" );
+    }
+
+}   /* pipe_error_str() */
@@ -0,0 +1,98 @@
+/**************************************************
+*
+*   NAME:
+*       pipeline.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for the
+*       pipelined front end
+*
+**************************************************/
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "ast.h"
+#include "parser.h"
+#include "stats.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define PIPE_TOKEN_BATCH    1024    /* tokens per token batch       */
+#define PIPE_NODE_BATCH     4096    /* nodes that trigger a node    */
+                                    /*  batch                       */
+#define PIPE_NUM_BATCHES    8       /* batches in flight per queue  */
+
+/*-------------------------------------
+Error types
+-------------------------------------*/
+typedef sint8 pipe_error_t8;
+enum
+{
+    PIPE_NO_ERROR         =  0,     /* no error                         */
+    PIPE_NO_MEMORY        = -1,     /* out of memory                    */
+    PIPE_NO_THREAD        = -2,     /* a stage thread couldn't start    */
+    PIPE_PARSE_ERROR      = -3,     /* the source didn't parse          */
+    PIPE_SINK_ERROR       = -4      /* the form sink gave up            */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+Last stage of the pipeline. It is
+handed the complete top-level forms
+in source order, a batch at a time,
+as a tree whose root's children are
+the forms. The tree is only valid
+during the call, and the sink may
+rewrite it in place. Returns FALSE
+to stop the pipeline.
+-------------------------------------*/
+typedef boolean (*pipe_sink_func)
+(
+    void                   *user,   /* sink's own state         */
+    struct ast_type        *forms   /* batch of forms           */
+);
+
+/*-------------------------------------
+Outcome of a run
+-------------------------------------*/
+struct pipe_result_type
+{
+    pipe_error_t8       error;          /* error code               */
+    parse_error_t8      parse_error;    /* for PIPE_PARSE_ERROR     */
+    uint                error_offset;   /* offset of a parse error  */
+    uint                num_forms;      /* forms handed to the sink */
+    uint                num_batches;    /* calls to the sink        */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+void run_pipeline
+(
+    const char             *src,        /* source buffer            */
+    uint                    len,        /* length of the source     */
+    pipe_sink_func          sink,       /* last stage               */
+    void                   *user,       /* passed to the sink       */
+    boolean                 threaded,   /* a thread per stage?      */
+    struct stats_type      *stats,      /* statistics, or NULL      */
+    struct pipe_result_type
+                           *result      /* outcome of the run       */
+);
+
+const char *pipe_error_str
+(
+    pipe_error_t8           error       /* error code               */
+);
+
+#endif /* __PIPELINE_H__ */
@@ -0,0 +1,510 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       profile.c
+*
+*   DESCRIPTION:
+*       Reports where a profiled program run
+*       in-process spent its time. Each
+*       statement of the program, a top-level
+*       form or an element of a sequence or of
+*       a while body, is counted and timed as
+*       it runs, and is known by the source
+*       offset of its list.
+*
+*       The report lists the statements that
+*       ran, those that took the most time of
+*       their own first, each with its line
+*       and column and the start of its text.
+*       A statement's own time is its time
+*       less that of the statements run inside
+*       it.
+*
+*       Next to the report, in a file of the
+*       same name with PROFILE_FOLDED_EXT
+*       added, each statement's own time is
+*       written as a folded stack, a line of
+*       the statements it is in, outermost
+*       first, separated by ";", then the
+*       nanoseconds. This is the format
+*       flamegraph.pl and speedscope read.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bytecode.h"
+#include "profile.h"
+#include "srcloc.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __EXCERPT_LEN   40      /* text shown of a statement    */
+#define __HEAD_LEN      16      /* text of a frame's operator   */
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A line of the report
+-------------------------------------*/
+struct __row_type
+{
+    uint                prof;           /* profiled list            */
+    uint64              self;           /* nanoseconds of its own   */
+};
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static int __compare_rows
+(
+    const void             *a,      /* row                      */
+    const void             *b       /* row                      */
+);
+
+static void __put_excerpt
+(
+    FILE                   *fp,     /* stream to write to       */
+    const char             *src,    /* source                   */
+    uint                    len,    /* length of the source     */
+    uint                    offset  /* start of the list        */
+);
+
+static void __put_frame
+(
+    FILE                   *fp,     /* stream to write to       */
+    struct line_table_type *lt,     /* source lines             */
+    uint                    offset  /* start of the list        */
+);
+
+static void __write_report
+(
+    FILE                   *fp,     /* report                   */
+    const struct bc_program_type
+                           *prog,   /* profiled program, run    */
+    struct line_table_type *lt,     /* source lines             */
+    struct __row_type      *rows    /* a row per profiled list  */
+);
+
+static void __write_folded
+(
+    FILE                   *fp,     /* folded stacks            */
+    const struct bc_program_type
+                           *prog,   /* profiled program, run    */
+    struct line_table_type *lt,     /* source lines             */
+    const struct __row_type
+                           *rows,   /* a row per profiled list  */
+    uint                   *chain   /* room for a stack         */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __compare_rows - "Compare Rows"
+*
+*   DESCRIPTION:
+*       qsort() comparison putting the row
+*       with the most time of its own first,
+*       and rows with the same in source
+*       order.
+*
+**************************************************/
+static int __compare_rows
+(
+    const void             *a,      /* row                      */
+    const void             *b       /* row                      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct __row_type    *ra; /* first row                */
+    const struct __row_type    *rb; /* second row               */
+
+    ra = (const struct __row_type *)a;
+    rb = (const struct __row_type *)b;
+    if( ra->self != rb->self )
+    {
+        return( ( ra->self > rb->self ) ? -1 : 1 );
+    }
+    return( ( ra->prof < rb->prof ) ? -1 : ( ra->prof > rb->prof ) );
+
+}   /* __compare_rows() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_excerpt - "Put Excerpt"
+*
+*   DESCRIPTION:
+*       Writes the start of a list's text, up
+*       to its closing bracket, on one line,
+*       each run of white space written as a
+*       space.
+*
+**************************************************/
+static void __put_excerpt
+(
+    FILE                   *fp,     /* stream to write to       */
+    const char             *src,    /* source                   */
+    uint                    len,    /* length of the source     */
+    uint                    offset  /* start of the list        */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        i;              /* source index             */
+    uint        n;              /* characters written       */
+    uint        depth;          /* lists open               */
+    boolean     quoted;         /* in a string?             */
+    boolean     space;          /* in white space?          */
+
+    n      = 0;
+    depth  = 0;
+    quoted = FALSE;
+    space  = FALSE;
+    for( i = offset; ( i < len ) && ( n < __EXCERPT_LEN ); ++i )
+    {
+        if( !quoted
+         && ( ( ' ' == src[ i ] ) || ( '\t' == src[ i ] ) || ( '\n' == src[ i ] ) || ( '\r' == src[ i ] ) ) )
+        {
+            space = TRUE;
+            continue;
+        }
+        if( space )
+        {
+            fputc( ' ', fp );
+            ++n;
+            space = FALSE;
+        }
+        fputc( src[ i ], fp );
+        ++n;
+
+        if( '"' == src[ i ] )
+        {
+            quoted = !quoted;
+        }
+        else if( !quoted
+              && ( '[' == src[ i ] ) )
+        {
+            ++depth;
+        }
+        else if( !quoted
+              && ( ']' == src[ i ] )
+              && ( 0 == --depth ) )
+        {
+            return;
+        }
+    }
+
+    if( i < len )
+    {
+        fputs( " ...", fp );
+    }
+
+}   /* __put_excerpt() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_frame - "Put Frame"
+*
+*   DESCRIPTION:
+*       Writes a list as a frame of a folded
+*       stack: its operator or keyword, or
+*       "seq" for a sequence, and its line and
+*       column.
+*
+**************************************************/
+static void __put_frame
+(
+    FILE                   *fp,     /* stream to write to       */
+    struct line_table_type *lt,     /* source lines             */
+    uint                    offset  /* start of the list        */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        i;              /* source index             */
+    uint        n;              /* characters written       */
+    uint        line;           /* list's line              */
+    uint        col;            /* and column               */
+    char        c;              /* source character         */
+
+    i = offset + 1;
+    while( ( i < lt->len )
+        && ( ( ' ' == lt->src[ i ] ) || ( '\t' == lt->src[ i ] ) || ( '\n' == lt->src[ i ] ) || ( '\r' == lt->src[ i ] ) ) )
+    {
+        ++i;
+    }
+
+    if( ( i < lt->len )
+     && ( '[' == lt->src[ i ] ) )
+    {
+        fputs( "seq", fp );
+    }
+
+    for( n = 0; ( i < lt->len ) && ( n < __HEAD_LEN ); ++i, ++n )
+    {
+        c = lt->src[ i ];
+        if( ( ' ' == c ) || ( '\t' == c ) || ( '\n' == c ) || ( '\r' == c )
+         || ( '[' == c ) || ( ']' == c ) || ( ';' == c ) )
+        {
+            break;
+        }
+        fputc( c, fp );
+    }
+
+    if( find_location( lt, offset, &line, &col ) )
+    {
+        fprintf( fp, " %u:%u", line, col );
+    }
+
+}   /* __put_frame() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __write_report - "Write Report"
+*
+*   DESCRIPTION:
+*       Writes the statements that ran, the
+*       one with the most time of its own
+*       first. The rows are sorted in place.
+*
+**************************************************/
+static void __write_report
+(
+    FILE                   *fp,     /* report                   */
+    const struct bc_program_type
+                           *prog,   /* profiled program, run    */
+    struct line_table_type *lt,     /* source lines             */
+    struct __row_type      *rows    /* a row per profiled list  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct bc_prof_type  *p;      /* profiled list        */
+    uint64                      total;  /* time of the forms    */
+    uint                        ran;    /* lists that ran       */
+    uint                        line;   /* list's line          */
+    uint                        col;    /* and column           */
+    uint                        i;      /* row index            */
+
+    total = 0;
+    ran   = 0;
+    for( i = 0; i < prog->num_profs; ++i )
+    {
+        if( BC_NO_PROF == prog->profs[ i ].parent )
+        {
+            total += prog->profs[ i ].ns;
+        }
+        if( 0 != prog->profs[ i ].count )
+        {
+            ++ran;
+        }
+    }
+
+    qsort( rows, (size_t)prog->num_profs, sizeof( *rows ), __compare_rows );
+
+    fprintf( fp, "# %u of %u statements ran, in %.3f ms\n", ran, prog->num_profs, (double)total / 1e6 );
+    fprintf( fp, "# %12s %12s %12s %7s  %-10s %s\n", "count", "total ms", "self ms", "self %", "line:col", "statement" );
+    for( i = 0; i < prog->num_profs; ++i )
+    {
+        p = &prog->profs[ rows[ i ].prof ];
+        if( 0 == p->count )
+        {
+            continue;
+        }
+
+        line = 0;
+        col  = 0;
+        find_location( lt, p->offset, &line, &col );
+        fprintf( fp, "  %12llu %12.3f %12.3f %7.2f  %5u:%-4u ",
+                 (unsigned long long)p->count,
+                 (double)p->ns / 1e6,
+                 (double)rows[ i ].self / 1e6,
+                 ( 0 == total ) ? 0.0 : 100.0 * (double)rows[ i ].self / (double)total,
+                 line, col );
+        __put_excerpt( fp, lt->src, lt->len, p->offset );
+        fputc( '\n', fp );
+    }
+
+}   /* __write_report() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __write_folded - "Write Folded Stacks"
+*
+*   DESCRIPTION:
+*       Writes a folded stack for each
+*       statement that took time of its own,
+*       in source order.
+*
+**************************************************/
+static void __write_folded
+(
+    FILE                   *fp,     /* folded stacks            */
+    const struct bc_program_type
+                           *prog,   /* profiled program, run    */
+    struct line_table_type *lt,     /* source lines             */
+    const struct __row_type
+                           *rows,   /* a row per profiled list  */
+    uint                   *chain   /* room for a stack         */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        i;              /* profiled list            */
+    uint        k;              /* list in its stack        */
+    uint        n;              /* lists in its stack       */
+
+    for( i = 0; i < prog->num_profs; ++i )
+    {
+        if( 0 == rows[ i ].self )
+        {
+            continue;
+        }
+
+        n = 0;
+        for( k = i; BC_NO_PROF != k; k = prog->profs[ k ].parent )
+        {
+            chain[ n++ ] = k;
+        }
+        while( n > 0 )
+        {
+            __put_frame( fp, lt, prog->profs[ chain[ --n ] ].offset );
+            fputc( ( 0 == n ) ? ' ' : ';', fp );
+        }
+        fprintf( fp, "%llu\n", (unsigned long long)rows[ i ].self );
+    }
+
+}   /* __write_folded() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       write_profile - "Write Profile"
+*
+*   DESCRIPTION:
+*       Writes the report of a profiled
+*       program that has been run to path, and
+*       its folded stacks to path with
+*       PROFILE_FOLDED_EXT added.
+*
+*   RETURNS:
+*       Returns FALSE if either couldn't be
+*       written.
+*
+**************************************************/
+boolean write_profile
+(
+    const struct bc_program_type
+                           *prog,   /* profiled program, run    */
+    const char             *src,    /* its source               */
+    uint                    len,    /* length of the source     */
+    const char             *path    /* report file              */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct line_table_type  lt;     /* source lines             */
+    struct __row_type      *rows;   /* a row per profiled list  */
+    uint                   *chain;  /* a stack of lists         */
+    char                   *folded; /* folded stacks file       */
+    FILE                   *fp;     /* file being written       */
+    uint                    parent; /* list a list is in        */
+    uint                    i;      /* profiled list            */
+    boolean                 ok;     /* written?                 */
+
+    rows   = (struct __row_type *)malloc( ( prog->num_profs + 1 ) * sizeof( *rows ) );
+    chain  = (uint *)malloc( ( prog->num_profs + 1 ) * sizeof( *chain ) );
+    folded = (char *)malloc( strlen( path ) + sizeof( PROFILE_FOLDED_EXT ) );
+    if( ( NULL == rows ) || ( NULL == chain ) || ( NULL == folded ) )
+    {
+        free( rows );
+        free( chain );
+        free( folded );
+        return( FALSE );
+    }
+    strcpy( folded, path );
+    strcat( folded, PROFILE_FOLDED_EXT );
+
+    /*---------------------------------
+    A list's own time is its time less
+    that of the lists directly in it.
+    A list comes after the list it is
+    in.
+    ---------------------------------*/
+    for( i = 0; i < prog->num_profs; ++i )
+    {
+        rows[ i ].prof = i;
+        rows[ i ].self = prog->profs[ i ].ns;
+    }
+    for( i = 0; i < prog->num_profs; ++i )
+    {
+        parent = prog->profs[ i ].parent;
+        if( BC_NO_PROF != parent )
+        {
+            rows[ parent ].self -= ( rows[ parent ].self < prog->profs[ i ].ns ) ? rows[ parent ].self : prog->profs[ i ].ns;
+        }
+    }
+
+    init_line_table( &lt, src, len );
+    ok = FALSE;
+
+    fp = fopen( folded, "w" );
+    if( NULL != fp )
+    {
+        __write_folded( fp, prog, &lt, rows, chain );
+        ok = ( 0 == ferror( fp ) );
+        ok = ( 0 == fclose( fp ) ) && ok;
+    }
+
+    fp = ok ? fopen( path, "w" ) : NULL;
+    if( NULL != fp )
+    {
+        __write_report( fp, prog, &lt, rows );
+        ok = ( 0 == ferror( fp ) );
+        ok = ( 0 == fclose( fp ) ) && ok;
+    }
+    else
+    {
+        ok = FALSE;
+    }
+
+    free_line_table( &lt );
+    free( rows );
+    free( chain );
+    free( folded );
+
+    return( ok );
+
+}   /* write_profile() */
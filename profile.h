@@ -0,0 +1,42 @@
+/**************************************************
+*
+*   NAME:
+*       profile.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       reporting where a program run
+*       in-process spent its time
+*
+**************************************************/
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "bytecode.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define PROFILE_FOLDED_EXT  ".folded"   /* folded stacks, next to the   */
+                                        /*  report                      */
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+boolean write_profile
+(
+    const struct bc_program_type
+                           *prog,   /* profiled program, run    */
+    const char             *src,    /* its source               */
+    uint                    len,    /* length of the source     */
+    const char             *path    /* report file              */
+);
+
+#endif /* __PROFILE_H__ */
@@ -0,0 +1,595 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       relex.c
+*
+*   DESCRIPTION:
+*       Incremental re-lexing of an edited
+*       buffer. After an edit, only the tokens
+*       between the last safe restart point
+*       before the edit and the first old token
+*       the new scan lines up with again are
+*       re-scanned; the rest of the stream is
+*       kept and its offsets shifted.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "relex.h"
+#include "scanner.h"
+#include "stats.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __INITIAL_TOKENS    256     /* initial token stream capacity    */
+#define __RELEX_BATCH       16      /* tokens scanned per batch while   */
+                                    /*  looking for resynchronization   */
+#define __MAX_BUFFER_LEN    0xFFFFFFFFUL    /* offsets are 32 bits      */
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static uint __first_token_at
+(
+    const struct lex_buffer_type
+                           *lb,     /* lex buffer               */
+    uint                    offset  /* offset to search for     */
+);
+
+static relex_error_t8 __push_token
+(
+    struct scan_token_type **toks,  /* token array              */
+    uint                    *count, /* tokens in the array      */
+    uint                    *cap,   /* capacity of the array    */
+    const struct scan_token_type
+                            *tok    /* token to append          */
+);
+
+static relex_error_t8 __reserve_text
+(
+    struct lex_buffer_type *lb,     /* lex buffer               */
+    uint                    len     /* characters needed        */
+);
+
+static relex_error_t8 __reserve_tokens
+(
+    struct lex_buffer_type *lb,     /* lex buffer               */
+    uint                    n       /* tokens needed            */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __first_token_at - "First Token At"
+*
+*   DESCRIPTION:
+*       Binary searches for the first token that
+*       starts at or after an offset.
+*
+*   RETURNS:
+*       Returns the token's index, or num_toks
+*       if every token starts before offset.
+*
+**************************************************/
+static uint __first_token_at
+(
+    const struct lex_buffer_type
+                           *lb,     /* lex buffer               */
+    uint                    offset  /* offset to search for     */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint    lo;     /* first candidate      */
+    uint    hi;     /* past last candidate  */
+    uint    mid;    /* probe                */
+
+    lo = 0;
+    hi = lb->num_toks;
+    while( lo < hi )
+    {
+        mid = lo + ( ( hi - lo ) >> 1 );
+        if( lb->toks[ mid ].offset < offset )
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return( lo );
+
+}   /* __first_token_at() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __push_token - "Push Token"
+*
+*   DESCRIPTION:
+*       Appends a token to a growable array.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * RELEX_NO_MEMORY if the array couldn't
+*         be grown.
+*
+**************************************************/
+static relex_error_t8 __push_token
+(
+    struct scan_token_type **toks,  /* token array              */
+    uint                    *count, /* tokens in the array      */
+    uint                    *cap,   /* capacity of the array    */
+    const struct scan_token_type
+                            *tok    /* token to append          */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct scan_token_type *grown;  /* grown array          */
+    uint                    new_cap;/* grown capacity       */
+
+    if( *count == *cap )
+    {
+        new_cap = ( 0 == *cap ) ? __RELEX_BATCH : *cap << 1;
+        grown   = (struct scan_token_type *)stats_realloc( *toks, new_cap * sizeof( **toks ) );
+        if( NULL == grown )
+        {
+            return( RELEX_NO_MEMORY );
+        }
+        *toks = grown;
+        *cap  = new_cap;
+    }
+
+    ( *toks )[ ( *count )++ ] = *tok;
+    return( RELEX_NO_ERROR );
+
+}   /* __push_token() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __reserve_text - "Reserve Text"
+*
+*   DESCRIPTION:
+*       Makes sure the text buffer can hold len
+*       characters plus a terminator.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * RELEX_NO_MEMORY if the buffer couldn't
+*         be grown.
+*
+**************************************************/
+static relex_error_t8 __reserve_text
+(
+    struct lex_buffer_type *lb,     /* lex buffer               */
+    uint                    len     /* characters needed        */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char   *grown;      /* grown buffer         */
+    uint64  new_cap;    /* grown capacity       */
+
+    if( (uint64)len + 1 <= lb->text_cap )
+    {
+        return( RELEX_NO_ERROR );
+    }
+
+    new_cap = (uint64)len + 1 + ( len >> 1 );
+    if( new_cap > __MAX_BUFFER_LEN )
+    {
+        new_cap = __MAX_BUFFER_LEN;
+    }
+
+    grown = (char *)stats_realloc( lb->text, (size_t)new_cap );
+    if( NULL == grown )
+    {
+        return( RELEX_NO_MEMORY );
+    }
+    lb->text     = grown;
+    lb->text_cap = (uint)new_cap;
+
+    return( RELEX_NO_ERROR );
+
+}   /* __reserve_text() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __reserve_tokens - "Reserve Tokens"
+*
+*   DESCRIPTION:
+*       Makes sure the token stream can hold n
+*       tokens.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * RELEX_NO_MEMORY if the stream couldn't
+*         be grown.
+*
+**************************************************/
+static relex_error_t8 __reserve_tokens
+(
+    struct lex_buffer_type *lb,     /* lex buffer               */
+    uint                    n       /* tokens needed            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct scan_token_type *toks;       /* grown token array    */
+    uint8                  *restart;    /* grown restart array  */
+    uint                    new_cap;    /* grown capacity       */
+
+    if( n <= lb->tok_cap )
+    {
+        return( RELEX_NO_ERROR );
+    }
+
+    new_cap = ( 0 == lb->tok_cap ) ? __INITIAL_TOKENS : lb->tok_cap;
+    while( new_cap < n )
+    {
+        new_cap <<= 1;
+    }
+
+    toks = (struct scan_token_type *)stats_realloc( lb->toks, new_cap * sizeof( *toks ) );
+    if( NULL == toks )
+    {
+        return( RELEX_NO_MEMORY );
+    }
+    lb->toks = toks;
+
+    restart = (uint8 *)stats_realloc( lb->restart, new_cap * sizeof( *restart ) );
+    if( NULL == restart )
+    {
+        return( RELEX_NO_MEMORY );
+    }
+    lb->restart = restart;
+    lb->tok_cap = new_cap;
+
+    return( RELEX_NO_ERROR );
+
+}   /* __reserve_tokens() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_lex_buffer - "Initialize Lex Buffer"
+*
+*   DESCRIPTION:
+*       Copies the source text into the lex
+*       buffer and scans all of it.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * RELEX_NO_MEMORY if the text or the
+*         token stream couldn't be allocated.
+*
+*   NOTES:
+*       * Scanner errors aren't returned; they
+*         are recorded in lb->error.
+*
+**************************************************/
+relex_error_t8 init_lex_buffer
+(
+    struct lex_buffer_type *lb,     /* buffer to initialize     */
+    const char             *text,   /* initial source text      */
+    uint                    len     /* length of text           */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct scanner_type s;      /* scanner              */
+    uint                n;      /* tokens in a batch    */
+    uint                i;      /* for-loop iterator    */
+
+    memset( lb, 0, sizeof( *lb ) );
+    if( ( RELEX_NO_ERROR != __reserve_text( lb, len ) )
+     || ( RELEX_NO_ERROR != __reserve_tokens( lb, __INITIAL_TOKENS ) ) )
+    {
+        free_lex_buffer( lb );
+        return( RELEX_NO_MEMORY );
+    }
+    memcpy( lb->text, text, len );
+    lb->text[ len ] = '\0';
+    lb->len = len;
+
+    /*---------------------------------
+    Scan straight into the stream
+    ---------------------------------*/
+    init_scanner( &s, lb->text, lb->len );
+    do
+    {
+        if( RELEX_NO_ERROR != __reserve_tokens( lb, lb->num_toks + SCAN_BATCH_SIZE ) )
+        {
+            free_lex_buffer( lb );
+            return( RELEX_NO_MEMORY );
+        }
+
+        n = scan_batch( &s, &lb->toks[ lb->num_toks ], SCAN_BATCH_SIZE );
+        for( i = lb->num_toks; i < lb->num_toks + n; ++i )
+        {
+            lb->restart[ i ] = (uint8)scan_lookahead( &lb->toks[ i ] );
+        }
+        lb->num_toks += n;
+    } while( 0 != n );
+
+    lb->error        = s.error;
+    lb->error_offset = s.error_offset;
+
+    return( RELEX_NO_ERROR );
+
+}   /* init_lex_buffer() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       apply_lex_edit - "Apply Lex Edit"
+*
+*   DESCRIPTION:
+*       Replaces removed characters at offset
+*       with the inserted characters and
+*       updates the token stream.
+*
+*       Scanning restarts at the end of the last
+*       token whose lookahead window ends at or
+*       before the edit. It stops as soon as a
+*       new token starts where an old token
+*       past the edit starts, shifted by the
+*       edit's change in length: from there on
+*       the text and the scanner state match
+*       the old scan, so the remaining tokens
+*       are only shifted.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * RELEX_BAD_EDIT if the edit lies
+*         outside the buffer or would make it
+*         longer than 32-bit offsets allow.
+*       * RELEX_NO_MEMORY if the buffer couldn't
+*         be grown. If it was the text that
+*         couldn't grow, nothing is changed;
+*         otherwise the text is edited and the
+*         stream is cut at the restart point.
+*
+**************************************************/
+relex_error_t8 apply_lex_edit
+(
+    struct lex_buffer_type *lb,         /* buffer to edit           */
+    uint                    offset,     /* where the edit starts    */
+    uint                    removed,    /* characters removed       */
+    const char             *inserted,   /* characters inserted      */
+    uint                    ins_len     /* length of inserted       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct scanner_type     s;                          /* scanner              */
+    struct scan_token_type  batch[ __RELEX_BATCH ];     /* rescanned tokens     */
+    struct scan_token_type *fresh;                      /* replacement tokens   */
+    uint                    num_fresh;                  /* tokens in fresh      */
+    uint                    fresh_cap;                  /* capacity of fresh    */
+    uint                    first_dirty;                /* first replaced token */
+    uint                    restart_pos;                /* where scanning starts*/
+    uint                    j;                          /* old token to resync  */
+    uint                    tail;                       /* tokens kept after    */
+    uint                    n;                          /* tokens in a batch    */
+    uint                    i;                          /* for-loop iterator    */
+    uint64                  new_len;                    /* length after edit    */
+    sint64                  delta;                      /* change in length     */
+    boolean                 resynced;                   /* lined up again?      */
+    relex_error_t8          error;                      /* error code           */
+
+    if( ( offset > lb->len )
+     || ( removed > lb->len - offset ) )
+    {
+        return( RELEX_BAD_EDIT );
+    }
+
+    new_len = (uint64)lb->len - removed + ins_len;
+    if( new_len >= __MAX_BUFFER_LEN )
+    {
+        return( RELEX_BAD_EDIT );
+    }
+    delta = (sint64)ins_len - (sint64)removed;
+
+    /*---------------------------------
+    Find the last safe restart point:
+    walk back over tokens that the
+    edit could reach through their
+    lexeme or lookahead.
+    ---------------------------------*/
+    first_dirty = __first_token_at( lb, offset );
+    while( ( first_dirty > 0 )
+        && ( lb->toks[ first_dirty - 1 ].offset
+           + lb->toks[ first_dirty - 1 ].len
+           + lb->restart[ first_dirty - 1 ] > offset ) )
+    {
+        --first_dirty;
+    }
+
+    restart_pos = 0;
+    if( first_dirty > 0 )
+    {
+        restart_pos = lb->toks[ first_dirty - 1 ].offset + lb->toks[ first_dirty - 1 ].len;
+    }
+
+    /*---------------------------------
+    Only old tokens starting past the
+    removed text can be resync points
+    ---------------------------------*/
+    j = __first_token_at( lb, offset + removed );
+
+    /*---------------------------------
+    Edit the text
+    ---------------------------------*/
+    if( RELEX_NO_ERROR != __reserve_text( lb, (uint)new_len ) )
+    {
+        return( RELEX_NO_MEMORY );
+    }
+    memmove( &lb->text[ offset + ins_len ],
+             &lb->text[ offset + removed ],
+             lb->len - offset - removed + 1 );
+    memcpy( &lb->text[ offset ], inserted, ins_len );
+    lb->len = (uint)new_len;
+
+    /*---------------------------------
+    Rescan until a new token lines up
+    with a shifted old one
+    ---------------------------------*/
+    fresh     = NULL;
+    num_fresh = 0;
+    fresh_cap = 0;
+    resynced  = FALSE;
+    error     = RELEX_NO_ERROR;
+
+    init_scanner( &s, lb->text, lb->len );
+    s.pos = restart_pos;
+    while( ( !resynced ) && ( RELEX_NO_ERROR == error ) )
+    {
+        n = scan_batch( &s, batch, __RELEX_BATCH );
+        if( 0 == n )
+        {
+            break;
+        }
+
+        for( i = 0; i < n; ++i )
+        {
+            while( ( j < lb->num_toks )
+                && ( (sint64)lb->toks[ j ].offset + delta < (sint64)batch[ i ].offset ) )
+            {
+                ++j;
+            }
+
+            if( ( j < lb->num_toks )
+             && ( (sint64)lb->toks[ j ].offset + delta == (sint64)batch[ i ].offset ) )
+            {
+                resynced = TRUE;
+                break;
+            }
+
+            error = __push_token( &fresh, &num_fresh, &fresh_cap, &batch[ i ] );
+            if( RELEX_NO_ERROR != error )
+            {
+                break;
+            }
+        }
+    }
+
+    /*---------------------------------
+    Without a resync point the new scan
+    ran to the end (or to an error) and
+    replaces everything after the
+    restart point
+    ---------------------------------*/
+    if( !resynced )
+    {
+        j = lb->num_toks;
+        lb->error        = s.error;
+        lb->error_offset = s.error_offset;
+    }
+    else if( SCAN_NO_ERROR != lb->error )
+    {
+        lb->error_offset = (uint)( (sint64)lb->error_offset + delta );
+    }
+
+    if( ( RELEX_NO_ERROR != error )
+     || ( RELEX_NO_ERROR != __reserve_tokens( lb, first_dirty + num_fresh + ( lb->num_toks - j ) ) ) )
+    {
+        /*-----------------------------
+        The text is already edited, so
+        drop the stale tail rather than
+        keep tokens that don't match it
+        -----------------------------*/
+        free( fresh );
+        lb->num_toks = first_dirty;
+        return( RELEX_NO_MEMORY );
+    }
+
+    /*---------------------------------
+    Splice the new tokens in and shift
+    the ones after them
+    ---------------------------------*/
+    tail = lb->num_toks - j;
+    memmove( &lb->toks[ first_dirty + num_fresh ], &lb->toks[ j ], tail * sizeof( *lb->toks ) );
+    memmove( &lb->restart[ first_dirty + num_fresh ], &lb->restart[ j ], tail * sizeof( *lb->restart ) );
+
+    for( i = 0; i < num_fresh; ++i )
+    {
+        lb->toks[ first_dirty + i ]    = fresh[ i ];
+        lb->restart[ first_dirty + i ] = (uint8)scan_lookahead( &fresh[ i ] );
+    }
+
+    lb->num_toks = first_dirty + num_fresh + tail;
+    if( 0 != delta )
+    {
+        for( i = first_dirty + num_fresh; i < lb->num_toks; ++i )
+        {
+            lb->toks[ i ].offset = (uint)( (sint64)lb->toks[ i ].offset + delta );
+        }
+    }
+
+    free( fresh );
+    return( RELEX_NO_ERROR );
+
+}   /* apply_lex_edit() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_lex_buffer - "Free Lex Buffer"
+*
+*   DESCRIPTION:
+*       Frees a lex buffer's text and tokens.
+*
+**************************************************/
+void free_lex_buffer
+(
+    struct lex_buffer_type *lb      /* buffer to free           */
+)
+{
+    free( lb->text );
+    free( lb->toks );
+    free( lb->restart );
+    memset( lb, 0, sizeof( *lb ) );
+
+}   /* free_lex_buffer() */
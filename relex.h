@@ -0,0 +1,90 @@
+/**************************************************
+*
+*   NAME:
+*       relex.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       incrementally re-lexing an edited
+*       buffer
+*
+**************************************************/
+
+#ifndef __RELEX_H__
+#define __RELEX_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "scanner.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+/*-------------------------------------
+Error types
+-------------------------------------*/
+typedef sint8 relex_error_t8;
+enum
+{
+    RELEX_NO_ERROR  =  0,   /* no error                         */
+    RELEX_NO_MEMORY = -1,   /* out of memory                    */
+    RELEX_BAD_EDIT  = -2    /* edit lies outside the buffer     */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A source buffer together with its
+token stream. restart[ i ] is how far
+past token i the scanner looked, which
+decides whether scanning can restart
+at the end of token i after an edit.
+
+If the scanner hit an error, the
+stream ends just before the bad lexeme
+and error/error_offset describe it.
+-------------------------------------*/
+struct lex_buffer_type
+{
+    char                   *text;           /* source text                  */
+    uint                    len;            /* characters in text           */
+    uint                    text_cap;       /* capacity of text             */
+    struct scan_token_type *toks;           /* token stream                 */
+    uint8                  *restart;        /* per-token restart state      */
+    uint                    num_toks;       /* tokens in the stream         */
+    uint                    tok_cap;        /* capacity of toks/restart     */
+    scan_error_t8           error;          /* scanner error, if any        */
+    uint                    error_offset;   /* offset of the bad lexeme     */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+relex_error_t8 init_lex_buffer
+(
+    struct lex_buffer_type *lb,     /* buffer to initialize     */
+    const char             *text,   /* initial source text      */
+    uint                    len     /* length of text           */
+);
+
+relex_error_t8 apply_lex_edit
+(
+    struct lex_buffer_type *lb,         /* buffer to edit           */
+    uint                    offset,     /* where the edit starts    */
+    uint                    removed,    /* characters removed       */
+    const char             *inserted,   /* characters inserted      */
+    uint                    ins_len     /* length of inserted       */
+);
+
+void free_lex_buffer
+(
+    struct lex_buffer_type *lb      /* buffer to free           */
+);
+
+#endif /* __RELEX_H__ */
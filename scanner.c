@@ -0,0 +1,571 @@
+/**************************************************
+*
+*   NAME:
+*       scanner.c
+*
+*   DESCRIPTION:
+*       Contains the implementation for the
+*       lexical scanner
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+
+#include <string.h>
+
+#include "number.h"
+#include "scanner.h"
+#include "symbol_table.h"
+#include "tokens.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+/*-------------------------------------
+Character classes
+-------------------------------------*/
+typedef uint8 __char_class_t8;
+enum
+{
+    __CC_BAD = 0,               /* character can't start a token        */
+    __CC_SPC,                   /* whitespace                           */
+    __CC_ALP,                   /* letter or underscore                 */
+    __CC_DIG,                   /* decimal digit                        */
+    __CC_OPP,                   /* operator character                   */
+    __CC_LBR,                   /* list begin character                 */
+    __CC_RBR,                   /* list end character                   */
+    __CC_STR                    /* string constant delimiter            */
+};
+
+/*-------------------------------------------------
+                VARIABLE CONSTANTS
+-------------------------------------------------*/
+
+/*-------------------------------------
+Character class of every byte. Looking
+the class up in a table keeps the
+scanning loop free of chains of
+comparisons.
+-------------------------------------*/
+static const __char_class_t8 __char_class[ 256 ] =
+{
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* 00 - 07 */
+    __CC_BAD, __CC_SPC, __CC_SPC, __CC_SPC, __CC_SPC, __CC_SPC, __CC_BAD, __CC_BAD,   /* 08 - 0F */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* 10 - 17 */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* 18 - 1F */
+    __CC_SPC, __CC_OPP, __CC_STR, __CC_BAD, __CC_BAD, __CC_OPP, __CC_BAD, __CC_BAD,   /* 20 - 27 */
+    __CC_BAD, __CC_BAD, __CC_OPP, __CC_OPP, __CC_BAD, __CC_OPP, __CC_BAD, __CC_OPP,   /* 28 - 2F */
+    __CC_DIG, __CC_DIG, __CC_DIG, __CC_DIG, __CC_DIG, __CC_DIG, __CC_DIG, __CC_DIG,   /* 30 - 37 */
+    __CC_DIG, __CC_DIG, __CC_OPP, __CC_BAD, __CC_OPP, __CC_OPP, __CC_OPP, __CC_BAD,   /* 38 - 3F */
+    __CC_BAD, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP,   /* 40 - 47 */
+    __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP,   /* 48 - 4F */
+    __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP,   /* 50 - 57 */
+    __CC_ALP, __CC_ALP, __CC_ALP, __CC_LBR, __CC_BAD, __CC_RBR, __CC_OPP, __CC_ALP,   /* 58 - 5F */
+    __CC_BAD, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP,   /* 60 - 67 */
+    __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP,   /* 68 - 6F */
+    __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP, __CC_ALP,   /* 70 - 77 */
+    __CC_ALP, __CC_ALP, __CC_ALP, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* 78 - 7F */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* 80 - 87 */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* 88 - 8F */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* 90 - 97 */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* 98 - 9F */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* A0 - A7 */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* A8 - AF */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* B0 - B7 */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* B8 - BF */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* C0 - C7 */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* C8 - CF */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* D0 - D7 */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* D8 - DF */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* E0 - E7 */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* E8 - EF */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD,   /* F0 - F7 */
+    __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD, __CC_BAD    /* F8 - FF */
+};
+
+/*-------------------------------------------------
+                        MACROS
+-------------------------------------------------*/
+
+/**************************************************
+*
+*   FUNCTION:
+*       __class_of - "Class Of"
+*
+*   DESCRIPTION:
+*       Returns the character class of a
+*       character
+*
+**************************************************/
+#define __class_of( c ) ( __char_class[ (uint8)( c ) ] )
+
+/**************************************************
+*
+*   FUNCTION:
+*       __is_delim - "Is Delimiter"
+*
+*   DESCRIPTION:
+*       Returns TRUE if a character of the given
+*       class ends the lexeme before it
+*
+**************************************************/
+#define __is_delim( cc ) ( ( __CC_SPC == ( cc ) )   \
+                        || ( __CC_LBR == ( cc ) )   \
+                        || ( __CC_RBR == ( cc ) ) )
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static boolean __lookup_keyword
+(
+    const char             *lexeme, /* start of the lexeme      */
+    uint                    len,    /* length of the lexeme     */
+    struct scan_token_type *tok     /* token to fill            */
+);
+
+static boolean __decode_number
+(
+    const char             *lexeme, /* start of the lexeme      */
+    uint                    len,    /* length of the lexeme     */
+    struct scan_token_type *tok     /* literal token to fill    */
+);
+
+static uint __scan_number
+(
+    const char     *buf,    /* source buffer                */
+    uint            pos,    /* offset of the first digit    */
+    uint            len,    /* length of the buffer         */
+    type_class_t8  *type    /* literal type found           */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __decode_number - "Decode Number"
+*
+*   DESCRIPTION:
+*       Decodes a numeric literal into the
+*       token's value according to the
+*       literal's type.
+*
+*   RETURNS:
+*       Returns TRUE if the value is in range
+*       for its type and FALSE if it isn't.
+*
+**************************************************/
+static boolean __decode_number
+(
+    const char             *lexeme, /* start of the lexeme      */
+    uint                    len,    /* length of the lexeme     */
+    struct scan_token_type *tok     /* literal token to fill    */
+)
+{
+    if( TOK_INT_TYPE == tok->subclass )
+    {
+        return( decode_int_literal( lexeme, len, &tok->val.int_val ) );
+    }
+
+    return( decode_real_literal( lexeme, len, &tok->val.real_val ) );
+
+}   /* __decode_number() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __lookup_keyword - "Lookup Keyword"
+*
+*   DESCRIPTION:
+*       Looks a lexeme up in the keyword table
+*       and fills in the token's class and
+*       subclass if it is found.
+*
+*   RETURNS:
+*       Returns TRUE if the lexeme is a keyword
+*       and FALSE if it isn't.
+*
+**************************************************/
+static boolean __lookup_keyword
+(
+    const char             *lexeme, /* start of the lexeme      */
+    uint                    len,    /* length of the lexeme     */
+    struct scan_token_type *tok     /* token to fill            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char                word[ MAX_RES_WORD_STR_LEN ];   /* terminated lexeme    */
+    struct token_type  *data;                           /* keyword's token      */
+
+    /*---------------------------------
+    Anything longer than the longest
+    keyword can't be one
+    ---------------------------------*/
+    if( len >= MAX_RES_WORD_STR_LEN )
+    {
+        return( FALSE );
+    }
+
+    memcpy( word, lexeme, len );
+    word[ len ] = '\0';
+
+    data = get_keyword_data( word );
+    if( NULL == data )
+    {
+        return( FALSE );
+    }
+
+    /*---------------------------------
+    Every token class keeps its
+    subclass in the first byte of the
+    union, so read it through the
+    reserved word view.
+    ---------------------------------*/
+    tok->token_class = data->token_class;
+    tok->subclass    = data->res_word.word_class;
+
+    return( TRUE );
+
+}   /* __lookup_keyword() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __scan_number - "Scan Number"
+*
+*   DESCRIPTION:
+*       Scans a numeric literal. Integers are a
+*       run of digits; reals also have a
+*       fractional part and/or an exponent.
+*
+*   RETURNS:
+*       Returns the offset just past the
+*       literal.
+*
+**************************************************/
+static uint __scan_number
+(
+    const char     *buf,    /* source buffer                */
+    uint            pos,    /* offset of the first digit    */
+    uint            len,    /* length of the buffer         */
+    type_class_t8  *type    /* literal type found           */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint            exp_pos;    /* offset of the exponent digits    */
+
+    *type = TOK_INT_TYPE;
+    while( ( pos < len ) && ( __CC_DIG == __class_of( buf[ pos ] ) ) )
+    {
+        ++pos;
+    }
+
+    /*---------------------------------
+    Fractional part
+    ---------------------------------*/
+    if( ( pos < len ) && ( '.' == buf[ pos ] ) )
+    {
+        *type = TOK_REAL_TYPE;
+        ++pos;
+        while( ( pos < len ) && ( __CC_DIG == __class_of( buf[ pos ] ) ) )
+        {
+            ++pos;
+        }
+    }
+
+    /*---------------------------------
+    Exponent. It's only consumed if at
+    least one digit follows, otherwise
+    the caller sees a bad delimiter.
+    ---------------------------------*/
+    if( ( pos < len ) && ( ( 'e' == buf[ pos ] ) || ( 'E' == buf[ pos ] ) ) )
+    {
+        exp_pos = pos + 1;
+        if( ( exp_pos < len ) && ( ( '+' == buf[ exp_pos ] ) || ( '-' == buf[ exp_pos ] ) ) )
+        {
+            ++exp_pos;
+        }
+
+        if( ( exp_pos < len ) && ( __CC_DIG == __class_of( buf[ exp_pos ] ) ) )
+        {
+            *type = TOK_REAL_TYPE;
+            pos   = exp_pos;
+            while( ( pos < len ) && ( __CC_DIG == __class_of( buf[ pos ] ) ) )
+            {
+                ++pos;
+            }
+        }
+    }
+
+    return( pos );
+
+}   /* __scan_number() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_scanner - "Initialize Scanner"
+*
+*   DESCRIPTION:
+*       Initializes a scanner to scan the given
+*       buffer from the beginning. The buffer
+*       isn't copied and must outlive the
+*       scanner and every token it produces.
+*
+*   NOTES:
+*       * The symbol table must be initialized
+*         before anything is scanned, since
+*         keywords are looked up in it.
+*
+**************************************************/
+void init_scanner
+(
+    struct scanner_type    *s,      /* scanner to initialize    */
+    const char             *buf,    /* source buffer            */
+    uint                    len     /* length of the buffer     */
+)
+{
+    s->buf          = buf;
+    s->len          = len;
+    s->pos          = 0;
+    s->error        = SCAN_NO_ERROR;
+    s->error_offset = 0;
+
+}   /* init_scanner() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       scan_batch - "Scan Batch"
+*
+*   DESCRIPTION:
+*       Fills the caller's token buffer with as
+*       many tokens as fit. The scanner's
+*       position is kept in locals for the
+*       whole batch and only written back once
+*       at the end.
+*
+*   RETURNS:
+*       Returns the number of tokens placed in
+*       token_buf. 0 is returned once the end
+*       of the buffer is reached.
+*
+*   ERRORS:
+*       * On a bad lexeme, the tokens before it
+*         are returned and the error and its
+*         offset are stored in the scanner.
+*         Every later call returns 0.
+*
+**************************************************/
+uint scan_batch
+(
+    struct scanner_type    *s,          /* scanner                  */
+    struct scan_token_type *token_buf,  /* tokens to fill           */
+    uint                    capacity    /* capacity of token_buf    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const char             *buf;    /* source buffer                */
+    const char             *end;    /* closing quote of a string    */
+    uint                    len;    /* length of the source buffer  */
+    uint                    pos;    /* current offset               */
+    uint                    start;  /* offset of the current lexeme */
+    uint                    n;      /* number of tokens scanned     */
+    scan_error_t8           error;  /* error code                   */
+    __char_class_t8         cc;     /* current character class      */
+    type_class_t8           type;   /* numeric literal type         */
+    struct scan_token_type *tok;    /* token being filled           */
+
+    if( SCAN_NO_ERROR != s->error )
+    {
+        return( 0 );
+    }
+
+    buf   = s->buf;
+    len   = s->len;
+    pos   = s->pos;
+    n     = 0;
+    start = pos;
+    error = SCAN_NO_ERROR;
+
+    while( n < capacity )
+    {
+        /*-----------------------------
+        Skip whitespace
+        -----------------------------*/
+        while( ( pos < len ) && ( __CC_SPC == __class_of( buf[ pos ] ) ) )
+        {
+            ++pos;
+        }
+
+        if( pos >= len )
+        {
+            break;
+        }
+
+        start = pos;
+        tok   = &token_buf[ n ];
+        cc    = __class_of( buf[ pos ] );
+        tok->val.int_val = 0;
+
+        switch( cc )
+        {
+            case __CC_LBR:
+                tok->token_class = TOK_LIST_TYPE;
+                tok->subclass    = TOK_LIST_BEGIN;
+                ++pos;
+                break;
+
+            case __CC_RBR:
+                tok->token_class = TOK_LIST_TYPE;
+                tok->subclass    = TOK_LIST_END;
+                ++pos;
+                break;
+
+            case __CC_STR:
+                end = (const char *)memchr( &buf[ pos + 1 ], TOK_STR_CHAR, len - pos - 1 );
+                if( NULL == end )
+                {
+                    error = SCAN_UNTERMINATED_STR;
+                    break;
+                }
+                tok->token_class = TOK_LITERAL;
+                tok->subclass    = TOK_STRING_TYPE;
+                pos = (uint)( end - buf ) + 1;
+                break;
+
+            case __CC_DIG:
+                pos = __scan_number( buf, pos, len, &type );
+                tok->token_class = TOK_LITERAL;
+                tok->subclass    = type;
+                if( !__decode_number( &buf[ start ], pos - start, tok ) )
+                {
+                    error = SCAN_LITERAL_RANGE;
+                }
+                break;
+
+            case __CC_ALP:
+                do
+                {
+                    ++pos;
+                    cc = ( pos < len ) ? __class_of( buf[ pos ] ) : __CC_SPC;
+                } while( ( __CC_ALP == cc ) || ( __CC_DIG == cc ) );
+
+                if( !__lookup_keyword( &buf[ start ], pos - start, tok ) )
+                {
+                    tok->token_class = TOK_IDENT;
+                    tok->subclass    = 0;
+                }
+                break;
+
+            case __CC_OPP:
+                do
+                {
+                    ++pos;
+                } while( ( pos < len ) && ( __CC_OPP == __class_of( buf[ pos ] ) ) );
+
+                if( !__lookup_keyword( &buf[ start ], pos - start, tok ) )
+                {
+                    error = SCAN_INVALID_TOKEN;
+                }
+                break;
+
+            default:
+                error = SCAN_INVALID_TOKEN;
+                break;
+        }
+
+        /*-----------------------------
+        Every lexeme other than a list
+        character has to be followed by
+        a delimiter
+        -----------------------------*/
+        if( ( SCAN_NO_ERROR == error )
+         && ( TOK_LIST_TYPE != tok->token_class )
+         && ( pos < len )
+         && ( !__is_delim( __class_of( buf[ pos ] ) ) ) )
+        {
+            error = SCAN_INVALID_TOKEN;
+        }
+
+        if( ( SCAN_NO_ERROR == error )
+         && ( pos - start > SCAN_MAX_TOKEN_LEN ) )
+        {
+            error = SCAN_TOKEN_TOO_LONG;
+        }
+
+        if( SCAN_NO_ERROR != error )
+        {
+            s->error        = error;
+            s->error_offset = start;
+            break;
+        }
+
+        tok->offset = start;
+        tok->len    = (uint16)( pos - start );
+        ++n;
+    }
+
+    s->pos = pos;
+    return( n );
+
+}   /* scan_batch() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       scan_lookahead - "Scan Lookahead"
+*
+*   DESCRIPTION:
+*       Returns how many characters past the end
+*       of a token's lexeme the scanner may have
+*       examined to produce it. List characters
+*       need no lookahead. Numbers may peek at
+*       an exponent marker, its sign and a
+*       digit. Everything else checks the one
+*       delimiter that follows it.
+*
+*       An edit that starts past this window
+*       can't change the token, so the token's
+*       end is a safe place to restart scanning.
+*
+**************************************************/
+uint scan_lookahead
+(
+    const struct scan_token_type
+                           *tok     /* scanned token            */
+)
+{
+    if( TOK_LIST_TYPE == tok->token_class )
+    {
+        return( 0 );
+    }
+
+    if( ( TOK_LITERAL == tok->token_class )
+     && ( TOK_STRING_TYPE != tok->subclass ) )
+    {
+        return( 3 );
+    }
+
+    return( 1 );
+
+}   /* scan_lookahead() */
@@ -1,7 +1,7 @@
 /**************************************************
 *   NAME:
 *       scanner.h
-*  
+*
 *   DESCRIPTION;
 *       provides the public interface for the
 *       lexical scanner
@@ -13,6 +13,90 @@
 
 #include "types.h"
 #include "hashmap.h"
+#include "tokens.h"
+
+/*-------------------------------------------------
+                      CONSTANTS
+-------------------------------------------------*/
+
+#define SCAN_MAX_TOKEN_LEN  0xFFFF  /* longest lexeme a compact token   */
+                                    /*  can describe                    */
+#define SCAN_BATCH_SIZE     256     /* suggested token batch capacity   */
+
+/*-------------------------------------
+Scanner error types
+-------------------------------------*/
+typedef sint8 scan_error_t8;
+enum
+{
+    SCAN_NO_ERROR         =  0,     /* no error                         */
+    SCAN_INVALID_TOKEN    = -1,     /* lexeme isn't a valid token       */
+    SCAN_UNTERMINATED_STR = -2,     /* string constant never closed     */
+    SCAN_TOKEN_TOO_LONG   = -3,     /* lexeme longer than the maximum   */
+    SCAN_LITERAL_RANGE    = -4      /* numeric literal out of range     */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+Compact token produced by the scanner.
+
+The lexeme itself isn't copied; it is
+described by its byte offset and
+length in the source buffer. The
+subclass holds the operator, literal
+type, reserved word or list class,
+depending on token_class. Integer and
+real literals also carry their
+decoded value, so no later stage has
+to parse the text again.
+-------------------------------------*/
+struct scan_token_type
+{
+    token_class_t8  token_class;    /* token class                      */
+    uint8           subclass;       /* class within the token class     */
+    uint16          len;            /* length of the lexeme in bytes    */
+    uint            offset;         /* 32-bit byte offset of the lexeme */
+    union literal_value_type
+                    val;            /* value of a numeric literal       */
+};
+
+/*-------------------------------------
+Scanner state
+-------------------------------------*/
+struct scanner_type
+{
+    const char     *buf;            /* source buffer being scanned      */
+    uint            len;            /* length of the source buffer      */
+    uint            pos;            /* offset of the next character     */
+    scan_error_t8   error;          /* first error encountered          */
+    uint            error_offset;   /* offset of the offending lexeme   */
+};
+
+/*-------------------------------------------------
+                FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+void init_scanner
+(
+    struct scanner_type    *s,      /* scanner to initialize    */
+    const char             *buf,    /* source buffer            */
+    uint                    len     /* length of the buffer     */
+);
+
+uint scan_batch
+(
+    struct scanner_type    *s,          /* scanner                  */
+    struct scan_token_type *token_buf,  /* tokens to fill           */
+    uint                    capacity    /* capacity of token_buf    */
+);
 
+uint scan_lookahead
+(
+    const struct scan_token_type
+                           *tok     /* scanned token            */
+);
 
 #endif /* __SCANNER_H__ */
@@ -0,0 +1,182 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       spsc_queue.c
+*
+*   DESCRIPTION:
+*       Implementation of the bounded, lock-free
+*       single-producer/single-consumer queue
+*       used to hand batches between pipeline
+*       stages.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "spsc_queue.h"
+#include "stats.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_spsc_queue - "Initialize SPSC
+*                          Queue"
+*
+*   DESCRIPTION:
+*       Allocates an empty queue.
+*
+*   RETURNS:
+*       Returns TRUE on success
+*
+*   ERRORS:
+*       * Returns FALSE if the capacity isn't a
+*         power of 2 or the ring couldn't be
+*         allocated.
+*
+**************************************************/
+boolean init_spsc_queue
+(
+    struct spsc_queue_type *q,      /* queue to initialize      */
+    uint                    cap     /* capacity, a power of 2   */
+)
+{
+    q->slots = NULL;
+    q->mask  = 0;
+    atomic_init( &q->head, 0 );
+    atomic_init( &q->tail, 0 );
+
+    if( ( 0 == cap )
+     || ( 0 != ( cap & ( cap - 1 ) ) ) )
+    {
+        return( FALSE );
+    }
+
+    q->slots = (void **)stats_malloc( (size_t)cap * sizeof( *q->slots ) );
+    if( NULL == q->slots )
+    {
+        return( FALSE );
+    }
+    q->mask = cap - 1;
+
+    return( TRUE );
+
+}   /* init_spsc_queue() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       spsc_push - "SPSC Push"
+*
+*   DESCRIPTION:
+*       Adds an item at the tail. Only the
+*       producer thread may call this.
+*
+*   RETURNS:
+*       Returns TRUE if the item was pushed,
+*       FALSE if the queue is full.
+*
+*   NOTES:
+*       * The release store publishes the item,
+*         and everything the producer wrote
+*         before it, to the consumer.
+*
+**************************************************/
+boolean spsc_push
+(
+    struct spsc_queue_type *q,      /* queue                    */
+    void                   *item    /* item to push             */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        tail;           /* producer's counter       */
+    uint        head;           /* consumer's counter       */
+
+    tail = atomic_load_explicit( &q->tail, memory_order_relaxed );
+    head = atomic_load_explicit( &q->head, memory_order_acquire );
+    if( tail - head > q->mask )
+    {
+        return( FALSE );
+    }
+
+    q->slots[ tail & q->mask ] = item;
+    atomic_store_explicit( &q->tail, tail + 1, memory_order_release );
+
+    return( TRUE );
+
+}   /* spsc_push() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       spsc_pop - "SPSC Pop"
+*
+*   DESCRIPTION:
+*       Removes the item at the head. Only the
+*       consumer thread may call this.
+*
+*   RETURNS:
+*       Returns TRUE if an item was popped,
+*       FALSE if the queue is empty.
+*
+**************************************************/
+boolean spsc_pop
+(
+    struct spsc_queue_type *q,      /* queue                    */
+    void                  **item    /* popped item              */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        head;           /* consumer's counter       */
+    uint        tail;           /* producer's counter       */
+
+    head = atomic_load_explicit( &q->head, memory_order_relaxed );
+    tail = atomic_load_explicit( &q->tail, memory_order_acquire );
+    if( head == tail )
+    {
+        return( FALSE );
+    }
+
+    *item = q->slots[ head & q->mask ];
+    atomic_store_explicit( &q->head, head + 1, memory_order_release );
+
+    return( TRUE );
+
+}   /* spsc_pop() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_spsc_queue - "Free SPSC Queue"
+*
+*   DESCRIPTION:
+*       Frees the ring. Items still queued
+*       aren't touched.
+*
+**************************************************/
+void free_spsc_queue
+(
+    struct spsc_queue_type *q       /* queue to free            */
+)
+{
+    free( q->slots );
+    q->slots = NULL;
+    q->mask  = 0;
+
+}   /* free_spsc_queue() */
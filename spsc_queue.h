@@ -0,0 +1,79 @@
+/**************************************************
+*
+*   NAME:
+*       spsc_queue.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for the
+*       bounded, lock-free single-producer/
+*       single-consumer queue
+*
+**************************************************/
+
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdatomic.h>
+
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define SPSC_CACHE_LINE     64      /* keeps the two ends apart     */
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+Ring of pointers. head is only
+written by the consumer and tail only
+by the producer, each on its own
+cache line, so the two threads never
+contend for a line except to hand an
+item over. Both counters run freely
+and are masked into the ring.
+-------------------------------------*/
+struct spsc_queue_type
+{
+    void          **slots;          /* ring of items                */
+    uint            mask;           /* capacity - 1                 */
+    _Alignas( SPSC_CACHE_LINE )
+    atomic_uint     head;           /* next item to pop             */
+    _Alignas( SPSC_CACHE_LINE )
+    atomic_uint     tail;           /* next slot to push into       */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+boolean init_spsc_queue
+(
+    struct spsc_queue_type *q,      /* queue to initialize      */
+    uint                    cap     /* capacity, a power of 2   */
+);
+
+boolean spsc_push
+(
+    struct spsc_queue_type *q,      /* queue                    */
+    void                   *item    /* item to push             */
+);
+
+boolean spsc_pop
+(
+    struct spsc_queue_type *q,      /* queue                    */
+    void                  **item    /* popped item              */
+);
+
+void free_spsc_queue
+(
+    struct spsc_queue_type *q       /* queue to free            */
+);
+
+#endif /* __SPSC_QUEUE_H__ */
@@ -0,0 +1,357 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       srcloc.c
+*
+*   DESCRIPTION:
+*       Maps byte offsets to lines and columns.
+*
+*       Tokens only carry a byte offset. The
+*       line-start index is built the first time
+*       a location is needed, typically by a
+*       diagnostic, so scanning never pays for
+*       location tracking. Newlines are counted
+*       16 bytes at a time with SSE2 where it's
+*       available.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+#include "srcloc.h"
+#include "stats.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __VECTOR_LEN    16      /* bytes compared per SSE2 step */
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static boolean __build_line_table
+(
+    struct line_table_type *lt      /* table to build           */
+);
+
+static uint __count_newlines
+(
+    const char     *src,    /* source buffer            */
+    uint            len     /* length of the source     */
+);
+
+static void __fill_line_starts
+(
+    const char     *src,    /* source buffer            */
+    uint            len,    /* length of the source     */
+    uint           *starts  /* line starts to fill      */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __count_newlines - "Count Newlines"
+*
+*   DESCRIPTION:
+*       Counts the '\n' characters in a buffer.
+*
+**************************************************/
+static uint __count_newlines
+(
+    const char     *src,    /* source buffer            */
+    uint            len     /* length of the source     */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint    i;      /* current offset       */
+    uint    count;  /* newlines found       */
+
+    i     = 0;
+    count = 0;
+
+#if defined( __SSE2__ )
+    {
+    __m128i nl = _mm_set1_epi8( '\n' );
+
+    for( ; i + __VECTOR_LEN <= len; i += __VECTOR_LEN )
+    {
+        count += (uint)__builtin_popcount( _mm_movemask_epi8(
+                    _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *)&src[ i ] ), nl ) ) );
+    }
+    }
+#endif
+
+    for( ; i < len; ++i )
+    {
+        count += ( '\n' == src[ i ] );
+    }
+
+    return( count );
+
+}   /* __count_newlines() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __fill_line_starts - "Fill Line Starts"
+*
+*   DESCRIPTION:
+*       Records the offset just past every '\n'
+*       after the implicit first line start.
+*
+**************************************************/
+static void __fill_line_starts
+(
+    const char     *src,    /* source buffer            */
+    uint            len,    /* length of the source     */
+    uint           *starts  /* line starts to fill      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint    i;      /* current offset       */
+    uint    n;      /* line starts filled   */
+
+    i = 0;
+    n = 0;
+    starts[ n++ ] = 0;
+
+#if defined( __SSE2__ )
+    {
+    __m128i nl = _mm_set1_epi8( '\n' );
+    uint    mask;
+
+    for( ; i + __VECTOR_LEN <= len; i += __VECTOR_LEN )
+    {
+        mask = (uint)_mm_movemask_epi8(
+                    _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *)&src[ i ] ), nl ) );
+        while( 0 != mask )
+        {
+            starts[ n++ ] = i + (uint)__builtin_ctz( mask ) + 1;
+            mask &= mask - 1;
+        }
+    }
+    }
+#endif
+
+    for( ; i < len; ++i )
+    {
+        if( '\n' == src[ i ] )
+        {
+            starts[ n++ ] = i + 1;
+        }
+    }
+
+}   /* __fill_line_starts() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __build_line_table - "Build Line Table"
+*
+*   DESCRIPTION:
+*       Counts the lines, sizes the index
+*       exactly and fills it.
+*
+*   RETURNS:
+*       Returns FALSE if the index couldn't be
+*       allocated.
+*
+**************************************************/
+static boolean __build_line_table
+(
+    struct line_table_type *lt      /* table to build           */
+)
+{
+    lt->num_lines   = __count_newlines( lt->src, lt->len ) + 1;
+    lt->line_starts = (uint *)stats_malloc( lt->num_lines * sizeof( *lt->line_starts ) );
+    if( NULL == lt->line_starts )
+    {
+        lt->num_lines = 0;
+        return( FALSE );
+    }
+
+    __fill_line_starts( lt->src, lt->len, lt->line_starts );
+    lt->built = TRUE;
+
+    return( TRUE );
+
+}   /* __build_line_table() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_line_table - "Initialize Line Table"
+*
+*   DESCRIPTION:
+*       Associates a line table with a source
+*       buffer. Nothing is scanned yet.
+*
+**************************************************/
+void init_line_table
+(
+    struct line_table_type *lt,     /* table to initialize      */
+    const char             *src,    /* source buffer            */
+    uint                    len     /* length of the source     */
+)
+{
+    lt->src         = src;
+    lt->len         = len;
+    lt->line_starts = NULL;
+    lt->num_lines   = 0;
+    lt->built       = FALSE;
+
+}   /* init_line_table() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       find_location - "Find Location"
+*
+*   DESCRIPTION:
+*       Maps a byte offset to a 1-based line and
+*       column by binary searching the
+*       line-start index, building it first if
+*       needed.
+*
+*   RETURNS:
+*       Returns FALSE if the offset is past the
+*       end of the source or the index couldn't
+*       be built.
+*
+**************************************************/
+boolean find_location
+(
+    struct line_table_type *lt,     /* line table               */
+    uint                    offset, /* byte offset in source    */
+    uint                   *line,   /* 1-based line             */
+    uint                   *col     /* 1-based column           */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint    lo;     /* first candidate line     */
+    uint    hi;     /* past last candidate line */
+    uint    mid;    /* probe                    */
+
+    if( offset > lt->len )
+    {
+        return( FALSE );
+    }
+
+    if( ( !lt->built )
+     && ( !__build_line_table( lt ) ) )
+    {
+        return( FALSE );
+    }
+
+    /*---------------------------------
+    Find the last line starting at or
+    before offset
+    ---------------------------------*/
+    lo = 0;
+    hi = lt->num_lines;
+    while( hi - lo > 1 )
+    {
+        mid = lo + ( ( hi - lo ) >> 1 );
+        if( lt->line_starts[ mid ] <= offset )
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    *line = lo + 1;
+    *col  = offset - lt->line_starts[ lo ] + 1;
+
+    return( TRUE );
+
+}   /* find_location() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       report_diagnostic - "Report Diagnostic"
+*
+*   DESCRIPTION:
+*       Writes "name:line:col: error: msg" for
+*       the given offset.
+*
+**************************************************/
+void report_diagnostic
+(
+    struct line_table_type *lt,     /* line table               */
+    FILE                   *fp,     /* stream to write to       */
+    const char             *name,   /* source file name         */
+    uint                    offset, /* offset of the problem    */
+    const char             *msg     /* diagnostic message       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint    line;   /* 1-based line         */
+    uint    col;    /* 1-based column       */
+
+    if( find_location( lt, offset, &line, &col ) )
+    {
+        fprintf( fp, "%s:%u:%u: error: %s\n", name, line, col, msg );
+    }
+    else
+    {
+        fprintf( fp, "%s: error: %s\n", name, msg );
+    }
+
+}   /* report_diagnostic() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_line_table - "Free Line Table"
+*
+*   DESCRIPTION:
+*       Frees the line-start index, if it was
+*       built.
+*
+**************************************************/
+void free_line_table
+(
+    struct line_table_type *lt      /* table to free            */
+)
+{
+    free( lt->line_starts );
+    lt->line_starts = NULL;
+    lt->num_lines   = 0;
+    lt->built       = FALSE;
+
+}   /* free_line_table() */
@@ -0,0 +1,74 @@
+/**************************************************
+*
+*   NAME:
+*       srcloc.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       mapping token byte offsets to source
+*       lines and columns
+*
+**************************************************/
+
+#ifndef __SRCLOC_H__
+#define __SRCLOC_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdio.h>
+
+#include "types.h"
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+Line-start index of a source buffer.
+Nothing is computed until the first
+offset is looked up.
+-------------------------------------*/
+struct line_table_type
+{
+    const char *src;            /* source buffer                */
+    uint        len;            /* length of the source         */
+    uint       *line_starts;    /* offset of each line's start  */
+    uint        num_lines;      /* entries in line_starts       */
+    boolean     built;          /* line_starts computed?        */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+void init_line_table
+(
+    struct line_table_type *lt,     /* table to initialize      */
+    const char             *src,    /* source buffer            */
+    uint                    len     /* length of the source     */
+);
+
+boolean find_location
+(
+    struct line_table_type *lt,     /* line table               */
+    uint                    offset, /* byte offset in source    */
+    uint                   *line,   /* 1-based line             */
+    uint                   *col     /* 1-based column           */
+);
+
+void report_diagnostic
+(
+    struct line_table_type *lt,     /* line table               */
+    FILE                   *fp,     /* stream to write to       */
+    const char             *name,   /* source file name         */
+    uint                    offset, /* offset of the problem    */
+    const char             *msg     /* diagnostic message       */
+);
+
+void free_line_table
+(
+    struct line_table_type *lt      /* table to free            */
+);
+
+#endif /* __SRCLOC_H__ */
@@ -0,0 +1,523 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       stats.c
+*
+*   DESCRIPTION:
+*       Times the compiler's phases and counts
+*       what they allocate, for --stats. Each
+*       stretch of work a phase does is timed
+*       with the monotonic clock and with the
+*       CPU clock of the thread doing it, so
+*       a phase on a thread of its own is
+*       timed as truly as one that takes
+*       turns with the others. With no
+*       statistics to add to, starting and
+*       stopping a phase only marks it on the
+*       trace, if one is being recorded.
+*
+*       Allocations are counted by the
+*       compiler allocating through
+*       stats_malloc(), stats_calloc() and
+*       stats_realloc(). Once count_allocs()
+*       has turned counting on, a thread in a
+*       timed phase adds each call, and the
+*       bytes asked for, to that phase. With
+*       counting off they cost a test of a
+*       global before handing on to the C
+*       library; nothing else is counted, so
+*       a sanitizer's allocator or a static
+*       link is left alone.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "stats.h"
+#include "trace.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                VARIABLE CONSTANTS
+-------------------------------------------------*/
+
+/*-------------------------------------
+Counting allocations? Set before any
+threads start, and only read after.
+-------------------------------------*/
+static boolean __counting;
+
+/*-------------------------------------
+Phase the thread is in, or NULL
+-------------------------------------*/
+static _Thread_local struct stats_phase_type *__current;
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static uint64 __read_clock
+(
+    clockid_t               id      /* clock                    */
+);
+
+static void __count
+(
+    size_t                  size    /* bytes asked for          */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __count - "Count"
+*
+*   DESCRIPTION:
+*       Adds an allocation to the phase the
+*       thread is in, if allocations are being
+*       counted and it is in one.
+*
+**************************************************/
+static void __count
+(
+    size_t                  size    /* bytes asked for          */
+)
+{
+    if( __counting && ( NULL != __current ) )
+    {
+        ++__current->allocs;
+        __current->alloc_bytes += size;
+    }
+
+}   /* __count() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       count_allocs - "Count Allocations"
+*
+*   DESCRIPTION:
+*       Turns on counting of the allocations
+*       made through stats_malloc() and the
+*       others. Must be called before any
+*       threads are started.
+*
+**************************************************/
+void count_allocs
+(
+    void
+)
+{
+    __counting = TRUE;
+
+}   /* count_allocs() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __read_clock - "Read Clock"
+*
+*   DESCRIPTION:
+*       Reads a clock.
+*
+*   RETURNS:
+*       Returns its time in nanoseconds.
+*
+**************************************************/
+static uint64 __read_clock
+(
+    clockid_t               id      /* clock                    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct timespec     ts;     /* clock reading            */
+
+    clock_gettime( id, &ts );
+    return( (uint64)ts.tv_sec * 1000000000u + (uint64)ts.tv_nsec );
+
+}   /* __read_clock() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       put_json_string - "Put JSON String"
+*
+*   DESCRIPTION:
+*       Writes a string as a quoted JSON
+*       string, for the statistics and the
+*       trace.
+*
+**************************************************/
+void put_json_string
+(
+    FILE                   *fp,     /* stream to write to       */
+    const char             *str     /* string                   */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const uint8    *s;          /* character                */
+
+    fputc( '"', fp );
+    for( s = (const uint8 *)str; '\0' != *s; ++s )
+    {
+        if( ( '"' == *s ) || ( '\\' == *s ) )
+        {
+            fprintf( fp, "\\%c", *s );
+        }
+        else if( *s < 0x20 )
+        {
+            fprintf( fp, "\\u%04x", *s );
+        }
+        else
+        {
+            fputc( *s, fp );
+        }
+    }
+    fputc( '"', fp );
+
+}   /* put_json_string() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_stats - "Initialize Statistics"
+*
+*   DESCRIPTION:
+*       Clears the statistics of a compilation.
+*
+**************************************************/
+void init_stats
+(
+    struct stats_type      *stats   /* statistics to clear      */
+)
+{
+    memset( stats, 0, sizeof( *stats ) );
+
+}   /* init_stats() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       stats_malloc - "Statistics Memory
+*                       Allocate"
+*
+*   DESCRIPTION:
+*       malloc(), counted against the phase the
+*       thread is in.
+*
+**************************************************/
+void *stats_malloc
+(
+    size_t                  size    /* bytes wanted             */
+)
+{
+    __count( size );
+    return( malloc( size ) );
+
+}   /* stats_malloc() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       stats_calloc - "Statistics Clear
+*                       Allocate"
+*
+*   DESCRIPTION:
+*       calloc(), counted against the phase the
+*       thread is in.
+*
+**************************************************/
+void *stats_calloc
+(
+    size_t                  n,      /* elements wanted          */
+    size_t                  size    /* bytes in each            */
+)
+{
+    __count( n * size );
+    return( calloc( n, size ) );
+
+}   /* stats_calloc() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       stats_realloc - "Statistics Reallocate"
+*
+*   DESCRIPTION:
+*       realloc(), counted against the phase the
+*       thread is in.
+*
+**************************************************/
+void *stats_realloc
+(
+    void                   *ptr,    /* block to resize, or NULL */
+    size_t                  size    /* bytes wanted             */
+)
+{
+    __count( size );
+    return( realloc( ptr, size ) );
+
+}   /* stats_realloc() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       stats_start - "Statistics Start"
+*
+*   DESCRIPTION:
+*       Starts timing a stretch of a phase on
+*       the calling thread. Its allocations go
+*       to the phase until it is stopped. The
+*       stretch is a span on the trace.
+*
+*   NOTES:
+*       * Only begins the span if stats is
+*         NULL.
+*
+**************************************************/
+void stats_start
+(
+    struct stats_type      *stats,  /* statistics, or NULL      */
+    stats_phase_t8          phase,  /* phase starting           */
+    struct stats_clock_type
+                           *clock   /* its clock                */
+)
+{
+    trace_begin( "phase", stats_phase_str( phase ), NULL );
+    if( NULL == stats )
+    {
+        return;
+    }
+
+    clock->outer = __current;
+    __current    = &stats->phases[ phase ];
+    clock->wall  = __read_clock( CLOCK_MONOTONIC );
+    clock->cpu   = __read_clock( CLOCK_THREAD_CPUTIME_ID );
+
+}   /* stats_start() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       stats_stop - "Statistics Stop"
+*
+*   DESCRIPTION:
+*       Adds the time since a phase was started
+*       to it, and goes back to the phase it
+*       interrupted, if any, and ends its
+*       span on the trace.
+*
+*   NOTES:
+*       * Only ends the span if stats is NULL.
+*
+**************************************************/
+void stats_stop
+(
+    struct stats_type      *stats,  /* statistics, or NULL      */
+    stats_phase_t8          phase,  /* phase stopping           */
+    struct stats_clock_type
+                           *clock   /* its clock                */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct stats_phase_type    *p;  /* phase                    */
+
+    if( NULL != stats )
+    {
+        p           = &stats->phases[ phase ];
+        p->cpu_ns  += __read_clock( CLOCK_THREAD_CPUTIME_ID ) - clock->cpu;
+        p->wall_ns += __read_clock( CLOCK_MONOTONIC ) - clock->wall;
+        __current   = clock->outer;
+    }
+    trace_end( "phase", stats_phase_str( phase ), NULL );
+
+}   /* stats_stop() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       write_stats - "Write Statistics"
+*
+*   DESCRIPTION:
+*       Writes the statistics as a table, a
+*       line per phase that did anything, then
+*       the counts and the peak resident set
+*       size of the process.
+*
+**************************************************/
+void write_stats
+(
+    const struct stats_type
+                           *stats,  /* statistics               */
+    FILE                   *fp,     /* stream to write to       */
+    const char             *name    /* source file name         */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct stats_phase_type  *p;      /* phase            */
+    struct stats_phase_type         total;  /* all phases       */
+    struct rusage                   ru;     /* process usage    */
+    uint                            i;      /* phase            */
+
+    memset( &total, 0, sizeof( total ) );
+    fprintf( fp, "%s:\n", name );
+    fprintf( fp, "  %-10s %12s %12s %12s %14s\n", "phase", "wall ms", "cpu ms", "allocs", "alloc bytes" );
+    for( i = 0; i < STATS_NUM_PHASES; ++i )
+    {
+        p = &stats->phases[ i ];
+        if( ( 0 == p->wall_ns ) && ( 0 == p->allocs ) )
+        {
+            continue;
+        }
+
+        fprintf( fp, "  %-10s %12.3f %12.3f %12llu %14llu\n", stats_phase_str( (stats_phase_t8)i ),
+                 (double)p->wall_ns / 1e6, (double)p->cpu_ns / 1e6,
+                 (unsigned long long)p->allocs, (unsigned long long)p->alloc_bytes );
+        total.wall_ns     += p->wall_ns;
+        total.cpu_ns      += p->cpu_ns;
+        total.allocs      += p->allocs;
+        total.alloc_bytes += p->alloc_bytes;
+    }
+    fprintf( fp, "  %-10s %12.3f %12.3f %12llu %14llu\n", "total",
+             (double)total.wall_ns / 1e6, (double)total.cpu_ns / 1e6,
+             (unsigned long long)total.allocs, (unsigned long long)total.alloc_bytes );
+    fprintf( fp, "  %llu source bytes, %llu tokens, %llu nodes, %u forms, %llu bytes written\n",
+             (unsigned long long)stats->bytes_in, (unsigned long long)stats->tokens,
+             (unsigned long long)stats->nodes, stats->forms, (unsigned long long)stats->bytes_out );
+    if( 0 == getrusage( RUSAGE_SELF, &ru ) )
+    {
+        fprintf( fp, "  peak RSS %ld KiB\n", ru.ru_maxrss );
+    }
+
+}   /* write_stats() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       write_stats_json - "Write Statistics as
+*                           JSON"
+*
+*   DESCRIPTION:
+*       Writes the statistics as a JSON object,
+*       every phase included, times in
+*       nanoseconds. The peak RSS is null if it
+*       couldn't be read.
+*
+**************************************************/
+void write_stats_json
+(
+    const struct stats_type
+                           *stats,  /* statistics               */
+    FILE                   *fp,     /* stream to write to       */
+    const char             *name    /* source file name         */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct stats_phase_type  *p;      /* phase            */
+    struct rusage                   ru;     /* process usage    */
+    uint                            i;      /* phase            */
+
+    fprintf( fp, "{\"source\":" );
+    put_json_string( fp, name );
+    fprintf( fp, ",\"phases\":{" );
+    for( i = 0; i < STATS_NUM_PHASES; ++i )
+    {
+        p = &stats->phases[ i ];
+        fprintf( fp, "%s\"%s\":{\"wall_ns\":%llu,\"cpu_ns\":%llu,\"allocs\":%llu,\"alloc_bytes\":%llu}",
+                 ( 0 == i ) ? "" : ",", stats_phase_str( (stats_phase_t8)i ),
+                 (unsigned long long)p->wall_ns, (unsigned long long)p->cpu_ns,
+                 (unsigned long long)p->allocs, (unsigned long long)p->alloc_bytes );
+    }
+    fprintf( fp, "},\"source_bytes\":%llu,\"tokens\":%llu,\"nodes\":%llu,\"forms\":%u,\"bytes_out\":%llu,\"peak_rss_kib\":",
+             (unsigned long long)stats->bytes_in, (unsigned long long)stats->tokens,
+             (unsigned long long)stats->nodes, stats->forms, (unsigned long long)stats->bytes_out );
+    if( 0 == getrusage( RUSAGE_SELF, &ru ) )
+    {
+        fprintf( fp, "%ld}\n", ru.ru_maxrss );
+    }
+    else
+    {
+        fprintf( fp, "null}\n" );
+    }
+
+}   /* write_stats_json() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       stats_phase_str - "Statistics Phase
+*                          String"
+*
+*   DESCRIPTION:
+*       Names a phase.
+*
+**************************************************/
+const char *stats_phase_str
+(
+    stats_phase_t8          phase   /* phase                    */
+)
+{
+    switch( phase )
+    {
+        case STATS_SYMBOLS:
+            return( "symbols" );
+
+        case STATS_SCAN:
+            return( "scan" );
+
+        case STATS_PARSE:
+            return( "parse" );
+
+        case STATS_CHECK:
+            return( "check" );
+
+        case STATS_OPTIMIZE:
+            return( "optimize" );
+
+        case STATS_EMIT:
+            return( "emit" );
+
+        case STATS_LOWER:
+            return( "lower" );
+
+        case STATS_RUN:
+            return( "run" );
+
+        default:
+            return( "unknown" );
+    }
+
+}   /* stats_phase_str() */
@@ -0,0 +1,165 @@
+/**************************************************
+*
+*   NAME:
+*       stats.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       timing the compiler's phases and
+*       counting what they allocate
+*
+**************************************************/
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdio.h>
+
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+/*-------------------------------------
+Phases of a compilation or a run
+in-process
+-------------------------------------*/
+typedef uint8 stats_phase_t8;
+enum
+{
+    STATS_SYMBOLS = 0,              /* symbol table initialization      */
+    STATS_SCAN,                     /* scanning                         */
+    STATS_PARSE,                    /* parsing                          */
+    STATS_CHECK,                    /* type checking                    */
+    STATS_OPTIMIZE,                 /* constant folding                 */
+    STATS_EMIT,                     /* emitting Gforth, peephole        */
+                                    /*  optimizer included              */
+    STATS_LOWER,                    /* lowering to bytecode             */
+    STATS_RUN,                      /* running the bytecode             */
+    STATS_NUM_PHASES                /* number of phases                 */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+What a phase took. Only one thread
+is ever in a given phase, so no field
+is shared.
+-------------------------------------*/
+struct stats_phase_type
+{
+    uint64              wall_ns;        /* monotonic time           */
+    uint64              cpu_ns;         /* its thread's CPU time    */
+    uint64              allocs;         /* stats_malloc, _calloc    */
+                                        /*  and _realloc calls      */
+    uint64              alloc_bytes;    /* bytes they asked for     */
+};
+
+/*-------------------------------------
+Statistics of one compilation
+-------------------------------------*/
+struct stats_type
+{
+    struct stats_phase_type
+                        phases[ STATS_NUM_PHASES ];
+                                        /* each phase               */
+    uint64              tokens;         /* tokens scanned           */
+    uint64              nodes;          /* tree nodes parsed        */
+    uint                forms;          /* top-level forms          */
+    uint64              bytes_in;       /* source bytes             */
+    uint64              bytes_out;      /* bytes written            */
+};
+
+/*-------------------------------------
+A phase being timed, on the stack of
+the thread in it
+-------------------------------------*/
+struct stats_clock_type
+{
+    uint64              wall;           /* monotonic time at start  */
+    uint64              cpu;            /* CPU time at start        */
+    struct stats_phase_type
+                       *outer;          /* phase it interrupted     */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+void init_stats
+(
+    struct stats_type      *stats   /* statistics to clear      */
+);
+
+void count_allocs
+(
+    void
+);
+
+void *stats_malloc
+(
+    size_t                  size    /* bytes wanted             */
+);
+
+void *stats_calloc
+(
+    size_t                  n,      /* elements wanted          */
+    size_t                  size    /* bytes in each            */
+);
+
+void *stats_realloc
+(
+    void                   *ptr,    /* block to resize, or NULL */
+    size_t                  size    /* bytes wanted             */
+);
+
+void stats_start
+(
+    struct stats_type      *stats,  /* statistics, or NULL      */
+    stats_phase_t8          phase,  /* phase starting           */
+    struct stats_clock_type
+                           *clock   /* its clock                */
+);
+
+void stats_stop
+(
+    struct stats_type      *stats,  /* statistics, or NULL      */
+    stats_phase_t8          phase,  /* phase stopping           */
+    struct stats_clock_type
+                           *clock   /* its clock                */
+);
+
+void write_stats
+(
+    const struct stats_type
+                           *stats,  /* statistics               */
+    FILE                   *fp,     /* stream to write to       */
+    const char             *name    /* source file name         */
+);
+
+void write_stats_json
+(
+    const struct stats_type
+                           *stats,  /* statistics               */
+    FILE                   *fp,     /* stream to write to       */
+    const char             *name    /* source file name         */
+);
+
+void put_json_string
+(
+    FILE                   *fp,     /* stream to write to       */
+    const char             *str     /* string                   */
+);
+
+const char *stats_phase_str
+(
+    stats_phase_t8          phase   /* phase                    */
+);
+
+#endif /* __STATS_H__ */
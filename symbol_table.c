@@ -15,6 +15,7 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "hashmap.h"
@@ -48,15 +49,16 @@ struct __reserved_symbol
 /*-------------------------------------
 Table containing all reserved words
 and the corresponding token values.
-
-TODO: Fill the out_str fieds with
-      Gforth output
+The out_str fields hold the Gforth
+word for an int (or bool) operand;
+"i/", "imod", "i**", "i<=" and "i>="
+are defined by the emitted prelude.
 -------------------------------------*/
 const struct __reserved_symbol __keywords[] =
 {
     { "while",  { TOK_RESERVED_WORD, { TOK_WHILE,      "while",  "while"  } } },
-    { "let",    { TOK_RESERVED_WORD, { TOK_LET,        "let",    "let"    } } },
-    { "stdout", { TOK_RESERVED_WORD, { TOK_STDOUT,     "stdout", "stdout" } } },
+    { "let",    { TOK_RESERVED_WORD, { TOK_LET,        "let",    ""       } } },
+    { "stdout", { TOK_RESERVED_WORD, { TOK_STDOUT,     "stdout", "."      } } },
     { "true",   { TOK_RESERVED_WORD, { TOK_TRUE,       "true",   "true"   } } },
     { "if",     { TOK_RESERVED_WORD, { TOK_IF,         "if",     "if"     } } },
     { "false",  { TOK_RESERVED_WORD, { TOK_FALSE,      "false",  "false"  } } },
@@ -69,23 +71,23 @@ const struct __reserved_symbol __keywords[] =
     { "+",      { TOK_BINARY_OPP,    { TOK_ADD_OPP,    "+",      "+"      } } },
     { "-",      { TOK_BINARY_OPP,    { TOK_SUB_OPP,    "-",      "-"      } } },
     { "*",      { TOK_BINARY_OPP,    { TOK_MUL_OPP,    "*",      "*"      } } },
-    { "/",      { TOK_BINARY_OPP,    { TOK_DIV_OPP,    "/",      "/"      } } },
-    { "%",      { TOK_BINARY_OPP,    { TOK_MOD_OPP,    "%",      "%"      } } },
-    { "^",      { TOK_BINARY_OPP,    { TOK_EXP_OPP,    "^",      "^"      } } },
+    { "/",      { TOK_BINARY_OPP,    { TOK_DIV_OPP,    "/",      "i/"     } } },
+    { "%",      { TOK_BINARY_OPP,    { TOK_MOD_OPP,    "%",      "imod"   } } },
+    { "^",      { TOK_BINARY_OPP,    { TOK_EXP_OPP,    "^",      "i**"    } } },
     { "=",      { TOK_BINARY_OPP,    { TOK_EQ_OPP,     "=",      "="      } } },
     { "<",      { TOK_BINARY_OPP,    { TOK_LT_OPP,     "<",      "<"      } } },
     { ">",      { TOK_BINARY_OPP,    { TOK_GT_OPP,     ">",      ">"      } } },
-    { "<=",     { TOK_BINARY_OPP,    { TOK_LE_OPP,     "<=",     "<="     } } },
-    { ">=",     { TOK_BINARY_OPP,    { TOK_GE_OPP,     ">=",     ">="     } } },
-    { "!=",     { TOK_BINARY_OPP,    { TOK_NE_OPP,     "!=",     "!="     } } },
-    { ":=",     { TOK_BINARY_OPP,    { TOK_ASSN_OPP,   ":=",     ":="     } } },
+    { "<=",     { TOK_BINARY_OPP,    { TOK_LE_OPP,     "<=",     "i<="    } } },
+    { ">=",     { TOK_BINARY_OPP,    { TOK_GE_OPP,     ">=",     "i>="    } } },
+    { "!=",     { TOK_BINARY_OPP,    { TOK_NE_OPP,     "!=",     "<>"     } } },
+    { ":=",     { TOK_BINARY_OPP,    { TOK_ASSN_OPP,   ":=",     "!"      } } },
     { "[",      { TOK_LIST_TYPE,     { TOK_LIST_BEGIN, "[",      "["      } } },
     { "]",      { TOK_LIST_TYPE,     { TOK_LIST_END,   "]",      "]"      } } },
-    { "sin",    { TOK_UNARY_OPP,     { TOK_SIN_OPP,    "sin",    "sin"    } } },
-    { "cos",    { TOK_UNARY_OPP,     { TOK_COS_OPP,    "cos",    "cos"    } } },
-    { "tan",    { TOK_UNARY_OPP,     { TOK_TAN_OPP,    "tan",    "tan"    } } },
-    { "not",    { TOK_UNARY_OPP,     { TOK_NOT_OPP,    "not",    "not"    } } },
-    { "-",      { TOK_UNARY_OPP,     { TOK_NEG_OPP,    "-",      "neg"    } } },
+    { "sin",    { TOK_UNARY_OPP,     { TOK_SIN_OPP,    "sin",    "fsin"   } } },
+    { "cos",    { TOK_UNARY_OPP,     { TOK_COS_OPP,    "cos",    "fcos"   } } },
+    { "tan",    { TOK_UNARY_OPP,     { TOK_TAN_OPP,    "tan",    "ftan"   } } },
+    { "not",    { TOK_UNARY_OPP,     { TOK_NOT_OPP,    "not",    "0="     } } },
+    { "-",      { TOK_UNARY_OPP,     { TOK_NEG_OPP,    "-",      "negate" } } },
     { "+",      { TOK_UNARY_OPP,     { TOK_POS_OPP,    "+",      ""       } } }
 };
 
@@ -98,9 +100,12 @@ The actual symbol table consists of
 two tables: one reserved for just the
 keywords, and the other reserved for
 the identifiers and variable constants.
+The identifiers used through the
+functions without a context go in a
+context of their own.
 -------------------------------------*/
 static struct map *__keyword_table = NULL;
-static struct map *__id_table      = NULL;
+static struct sym_context_type __global_context = { NULL };
 
 /*-------------------------------------------------
                         MACROS
@@ -235,7 +240,7 @@ sym_table_error_t8 init_symbol_table
     table
     ---------------------------------*/
     table_size = (sint)ceil( 0.5 * (double)( size( __keywords ) ) );
-    __keyword_table = create_map();
+    __keyword_table = create_map( NULL, NULL );
     if( NULL == __keyword_table )
     {
         return( SYM_INIT_ERROR );
@@ -251,13 +256,7 @@ sym_table_error_t8 init_symbol_table
     Create and initialize the
     identifier table
     ---------------------------------*/
-    __id_table = create_map();
-    if( NULL == __id_table )
-    {
-        return( SYM_INIT_ERROR );
-    }
-
-    if( ERR_NO_ERROR != init_static_map( __id_table, 0 ) )
+    if( SYM_NO_ERROR != init_sym_context( &__global_context, NULL, NULL ) )
     {
         return( SYM_INIT_ERROR );
     }
@@ -324,7 +323,7 @@ boolean is_identifier
     char       *str     /* string to check      */
 )
 {
-    return( is_in_map( __id_table, str ) );
+    return( is_in_map( __global_context.ids, str ) );
 
 }   /* is_identifier() */
 
@@ -367,15 +366,72 @@ struct token_type *get_token_data
     char       *str     /* string to check      */
 )
 {
-    void *ret_val = get( __keyword_table, str );
-    if( NULL != ret_val )
+    return( get_context_data( &__global_context, str ) );
+
+}   /* get_token_data() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       get_keyword_data - "Get Keyword Data"
+*
+*   DESCRIPTION:
+*       Retrieves the token data if the string
+*       is a keyword. Unlike get_token_data(),
+*       the identifier table isn't searched.
+*
+**************************************************/
+struct token_type *get_keyword_data
+(
+    char       *str     /* string to check      */
+)
+{
+    return( (struct token_type *)get( __keyword_table, str ) );
+
+}   /* get_keyword_data() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       get_keyword_class_data - "Get Keyword
+*                                 Class Data"
+*
+*   DESCRIPTION:
+*       Retrieves the keyword token of a token
+*       class and subclass. Unlike a lookup by
+*       string, this tells the unary and binary
+*       "+" and "-" apart.
+*
+*   RETURNS:
+*       Returns the token, or NULL if there is
+*       no such keyword.
+*
+**************************************************/
+const struct token_type *get_keyword_class_data
+(
+    uint8       token_class,    /* token class          */
+    uint8       subclass        /* class within it      */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint32  i;          /* a for-loop iterator      */
+
+    for( i = 0; i < size( __keywords ); ++i )
     {
-        return( (struct token_type *)ret_val );
+        if( ( token_class == __keywords[ i ].tok.token_class )
+         && ( subclass == __keywords[ i ].tok.opp.bin_opp_class ) )
+        {
+            return( &__keywords[ i ].tok );
+        }
     }
 
-    return( (struct token_type *)get( __id_table, str ) );
+    return( NULL );
 
-}   /* get_token_data() */
+}   /* get_keyword_class_data() */
 
 
 /**************************************************
@@ -402,19 +458,141 @@ sym_table_error_t8 update_symbol_table
     struct token_type  *data    /* token corresponding to string    */
 )
 {
-    /*---------------------------------
-    Local variables
-    ---------------------------------*/
-    map_error_code_t8 error;
+    return( update_sym_context( &__global_context, str, data ) );
+
+}   /* update_symbol_table() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_sym_context - "Initialize Symbol
+*                           Context"
+*
+*   DESCRIPTION:
+*       Creates an empty identifier table for
+*       one compilation, its memory from the
+*       supplied allocator, or from libc if
+*       there is none. The keywords are shared
+*       with every other context.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * Returns SYM_INIT_ERROR if the table
+*         couldn't be created.
+*
+**************************************************/
+sym_table_error_t8 init_sym_context
+(
+    struct sym_context_type
+                       *ctx,    /* context to initialize            */
+    const struct map_allocator_type
+                       *alloc,  /* allocator, or NULL for libc's    */
+    void               *user    /* allocator's state                */
+)
+{
+    ctx->ids = create_map( alloc, user );
+    if( NULL == ctx->ids )
+    {
+        return( SYM_INIT_ERROR );
+    }
 
-    error = add_map( __id_table, str, data, sizeof( *data ) );
-    if( ERR_NO_ERROR != error )
+    if( ERR_NO_ERROR != init_dynamic_map( ctx->ids, -1 ) )
+    {
+        free_map( ctx->ids );
+        ctx->ids = NULL;
+        return( SYM_INIT_ERROR );
+    }
+
+    return( SYM_NO_ERROR );
+
+}   /* init_sym_context() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       update_sym_context - "Update Symbol
+*                             Context"
+*
+*   DESCRIPTION:
+*       Adds an entry to a context's identifier
+*       table.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * Returns SYM_UPDATE_ERROR if the
+*         table couldn't be updated.
+*
+**************************************************/
+sym_table_error_t8 update_sym_context
+(
+    struct sym_context_type
+                       *ctx,    /* context to add to                */
+    char               *str,    /* string to add                    */
+    struct token_type  *data    /* token corresponding to string    */
+)
+{
+    if( 0 == add_map( ctx->ids, str, data, sizeof( *data ) ) )
     {
         return( SYM_UPDATE_ERROR );
     }
     return( SYM_NO_ERROR );
 
-}   /* update_symbol_table() */
+}   /* update_sym_context() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       get_context_data - "Get Context Data"
+*
+*   DESCRIPTION:
+*       Retrieves the token data of a keyword,
+*       or of an identifier in the context.
+*
+**************************************************/
+struct token_type *get_context_data
+(
+    struct sym_context_type
+                       *ctx,    /* context to search                */
+    char               *str     /* string to check                  */
+)
+{
+    void *ret_val = get( __keyword_table, str );
+    if( NULL != ret_val )
+    {
+        return( (struct token_type *)ret_val );
+    }
+
+    return( (struct token_type *)get( ctx->ids, str ) );
+
+}   /* get_context_data() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_sym_context - "Free Symbol Context"
+*
+*   DESCRIPTION:
+*       Frees a context's identifier table.
+*
+**************************************************/
+void free_sym_context
+(
+    struct sym_context_type
+                       *ctx     /* context to free                  */
+)
+{
+    free_map( ctx->ids );
+    ctx->ids = NULL;
+
+}   /* free_sym_context() */
 
 
 /**************************************************
@@ -446,7 +624,7 @@ sym_table_error_t8 print_table
         return( SYM_PRINT_ERROR );
     }
 
-    if( ERR_NO_ERROR != show_map( __id_table, __print_entry ) )
+    if( ERR_NO_ERROR != show_map( __global_context.ids, __print_entry ) )
     {
         return( SYM_PRINT_ERROR );
     }
@@ -471,6 +649,6 @@ void unload_tables
 )
 {
     free_map( __keyword_table );
-    free_map( __id_table );
+    free_sym_context( &__global_context );
 
 }   /*unload_tables() */
@@ -15,6 +15,8 @@
 /*-------------------------------------------------
                  PROJECT INCLUDES
 -------------------------------------------------*/
+#include "hashmap.h"
+#include "tokens.h"
 #include "types.h"
 
 /*-------------------------------------------------
@@ -35,6 +37,23 @@ enum
     SYM_ALREADY_INITIALIZED = -5    /* initialization error */
 };
 
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+The identifiers of one compilation.
+Keywords aren't copied into contexts:
+the keyword table is built once by
+init_symbol_table() and only read
+after that, so threads share it while
+each updates a context of its own.
+-------------------------------------*/
+struct sym_context_type
+{
+    struct map         *ids;        /* identifiers and constants    */
+};
+
 /*-------------------------------------------------
                  FUNCION PROTOTYPES
 -------------------------------------------------*/
@@ -64,12 +83,53 @@ struct token_type *get_token_data
     char       *str     /* string to check      */
 );
 
+struct token_type *get_keyword_data
+(
+    char       *str     /* string to check      */
+);
+
+const struct token_type *get_keyword_class_data
+(
+    uint8       token_class,    /* token class          */
+    uint8       subclass        /* class within it      */
+);
+
 sym_table_error_t8 update_symbol_table
 (
     char               *str,    /* string to add                    */
     struct token_type  *data    /* token corresponding to string    */
 );
 
+sym_table_error_t8 init_sym_context
+(
+    struct sym_context_type
+                       *ctx,    /* context to initialize            */
+    const struct map_allocator_type
+                       *alloc,  /* allocator, or NULL for libc's    */
+    void               *user    /* allocator's state                */
+);
+
+sym_table_error_t8 update_sym_context
+(
+    struct sym_context_type
+                       *ctx,    /* context to add to                */
+    char               *str,    /* string to add                    */
+    struct token_type  *data    /* token corresponding to string    */
+);
+
+struct token_type *get_context_data
+(
+    struct sym_context_type
+                       *ctx,    /* context to search                */
+    char               *str     /* string to check                  */
+);
+
+void free_sym_context
+(
+    struct sym_context_type
+                       *ctx     /* context to free                  */
+);
+
 sym_table_error_t8 print_table
 (
     void
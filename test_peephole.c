@@ -0,0 +1,215 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       test_peephole.c
+*
+*   DESCRIPTION:
+*       Peephole optimizer regression tests.
+*       Compiles short programs and checks that
+*       the Gforth emitted for a statement is
+*       what it should be after the rewrites,
+*       so a rule that changes what a program
+*       prints is caught without Gforth.
+*
+*   USAGE:
+*       test_peephole
+*
+*       Prints each case that fails and exits
+*       with 1 if any did.
+*
+*   BUILD:
+*       cc -O2 -o test_peephole test_peephole.c
+*          compiler.c emit.c peephole.c fold.c
+*          eval.c typecheck.c arena.c jit.c
+*          bytecode.c hash.c pipeline.c
+*          spsc_queue.c
+*          parser.c ast.c scanner.c number.c
+*          srcloc.c symbol_table.c hashmap.c
+*          stats.c trace.c -lm -lpthread
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compiler.h"
+#include "symbol_table.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __MAX_OUTPUT        65536   /* longest output checked           */
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A case: a program and a line its
+output must have
+-------------------------------------*/
+struct __case_type
+{
+    const char         *name;           /* what it checks           */
+    const char         *src;            /* program                  */
+    const char         *line;           /* line expected            */
+};
+
+/*-------------------------------------------------
+                VARIABLE CONSTANTS
+-------------------------------------------------*/
+
+/*-------------------------------------
+"x 0 =" becomes "x 0=", whose operand
+is an int, so "0= 0=" after it must
+stay: without it 5 is stored in a bool,
+and true = prints false.
+-------------------------------------*/
+#define __DECLARE   "[let [[x int] [b bool]]] [:= x 5] "
+
+static const struct __case_type __cases[] =
+{
+    { "not of an int compare with 0",
+      __DECLARE "[:= b [not [= x 0]]] [stdout [= b true]]",
+      ":noname v1-x @ 0= 0= v2-b ! ; execute" },
+    { "not not of an int compare with 0",
+      __DECLARE "[:= b [not [not [= x 0]]]]",
+      ":noname v1-x @ 0= v2-b ! ; execute" },
+    { "not not of a compare",
+      __DECLARE "[:= b [not [not [< x 3]]]]",
+      ":noname v1-x @ 3 < v2-b ! ; execute" },
+    { "not not of a bool",
+      __DECLARE "[:= b [not [not b]]]",
+      ":noname v2-b @ 0= 0= v2-b ! ; execute" }
+};
+
+#define __NUM_CASES         ( sizeof( __cases ) / sizeof( __cases[ 0 ] ) )
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static boolean __run_case
+(
+    const struct __case_type
+                           *c       /* case to run              */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __run_case - "Run Case"
+*
+*   DESCRIPTION:
+*       Compiles a case's program and looks for
+*       its line in the output. Prints the
+*       output if the line isn't there.
+*
+*   RETURNS:
+*       Returns TRUE if the case passed.
+*
+**************************************************/
+static boolean __run_case
+(
+    const struct __case_type
+                           *c       /* case to run              */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct compile_options_type opts;   /* compiler options     */
+    struct compile_result_type  result; /* outcome              */
+    static char                 out[ __MAX_OUTPUT ];
+                                        /* output               */
+    FILE                       *fp;     /* output file          */
+    size_t                      n;      /* bytes of output      */
+    const char                 *line;   /* line found           */
+    size_t                      len;    /* its length           */
+
+    fp = tmpfile();
+    if( NULL == fp )
+    {
+        printf( "%s: unable to make a temporary file\n", c->name );
+        return( FALSE );
+    }
+
+    init_compile_options( &opts );
+    compile_buffer( c->src, (uint)strlen( c->src ), fileno( fp ), &opts, &result );
+    rewind( fp );
+    n        = fread( out, 1, sizeof( out ) - 1, fp );
+    out[ n ] = '\0';
+    fclose( fp );
+    if( COMPILE_NO_ERROR != result.error )
+    {
+        printf( "%s: %s\n", c->name, result.message );
+        return( FALSE );
+    }
+
+    len = strlen( c->line );
+    for( line = strstr( out, c->line ); NULL != line; line = strstr( line + 1, c->line ) )
+    {
+        if( ( ( line == out ) || ( '\n' == line[ -1 ] ) )
+         && ( '\n' == line[ len ] ) )
+        {
+            return( TRUE );
+        }
+    }
+
+    printf( "%s: expected\n  %s\nin\n%s", c->name, c->line, out );
+    return( FALSE );
+
+}   /* __run_case() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       main - "Main"
+*
+*   DESCRIPTION:
+*       Runs every case.
+*
+**************************************************/
+int main
+(
+    void
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        i;              /* case                     */
+    uint        failed;         /* cases that failed        */
+
+    if( SYM_NO_ERROR != init_symbol_table() )
+    {
+        fprintf( stderr, "unable to initialize the symbol table\n" );
+        return( 1 );
+    }
+
+    failed = 0;
+    for( i = 0; i < __NUM_CASES; ++i )
+    {
+        if( !__run_case( &__cases[ i ] ) )
+        {
+            ++failed;
+        }
+    }
+
+    printf( "peephole: %u passed, %u failed\n", (uint)__NUM_CASES - failed, failed );
+    unload_tables();
+    return( ( 0 == failed ) ? 0 : 1 );
+
+}   /* main() */
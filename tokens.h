@@ -152,6 +152,16 @@ struct opp_type
     char    out_str[ MAX_OPP_STR_LEN ]; /* corresponding gforth equivalent  */
 };
 
+/*-------------------------------------
+Literal value, decoded once by the
+scanner
+-------------------------------------*/
+union literal_value_type
+{
+    sint64              int_val;    /* value of an integer literal      */
+    double              real_val;   /* value of a real literal          */
+};
+
 /*-------------------------------------
 Literal token type
 -------------------------------------*/
@@ -159,6 +169,8 @@ struct literal_type
 {
     type_class_t8       type_class; /* type class of the literal        */
     char               *str;        /* literal's string representation  */
+    union literal_value_type
+                        val;        /* literal's binary value           */
 };
 
 /*-------------------------------------
@@ -0,0 +1,571 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       trace.c
+*
+*   DESCRIPTION:
+*       Records a timeline of what each thread
+*       of the compiler does, for --trace, and
+*       writes it as Chrome trace events, which
+*       Perfetto and chrome://tracing open.
+*
+*       Each thread appends its begin and end
+*       events to a buffer of its own, a list
+*       of fixed-size chunks, so recording
+*       takes no lock and never moves what was
+*       recorded. A thread's buffer is pushed
+*       onto the list of all buffers with a
+*       compare-and-swap the first time it
+*       records anything, and outlives the
+*       thread, so the whole timeline is there
+*       to write once the threads have been
+*       joined.
+*
+*       Until init_trace() is called, recording
+*       an event is a test of a flag.
+*
+*       Buffers, chunks and details come from
+*       plain malloc(), not stats_malloc(), so
+*       recording inside a phase doesn't add
+*       to the allocations --stats counts.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "stats.h"
+#include "trace.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __CHUNK_EVENTS      1024    /* events in a chunk                */
+#define __DETAIL_LEN        256     /* longest detail kept              */
+#define __NAME_LEN          32      /* longest thread name kept         */
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+An event. cat and name are literals;
+detail is the event's own.
+-------------------------------------*/
+struct __event_type
+{
+    uint64              ns;             /* monotonic time           */
+    const char         *cat;            /* category                 */
+    const char         *name;           /* span's name              */
+    char               *detail;         /* detail, or NULL          */
+    char                phase;          /* 'B'egin or 'E'nd         */
+};
+
+/*-------------------------------------
+A chunk of a thread's events
+-------------------------------------*/
+struct __chunk_type
+{
+    struct __chunk_type
+                       *next;           /* next chunk, or NULL      */
+    uint                num_events;     /* events in use            */
+    struct __event_type events[ __CHUNK_EVENTS ];
+                                        /* the events               */
+};
+
+/*-------------------------------------
+A thread's events. Only the thread
+writes them, until it is joined.
+-------------------------------------*/
+struct __buffer_type
+{
+    struct __buffer_type
+                       *next;           /* next thread's buffer     */
+    struct __chunk_type
+                       *first;          /* oldest chunk             */
+    struct __chunk_type
+                       *last;           /* chunk being filled       */
+    uint64              dropped;        /* events that found no     */
+                                        /*  memory                  */
+    uint                tid;            /* thread's ID              */
+    char                name[ __NAME_LEN ];
+                                        /* thread's name, or empty  */
+};
+
+/*-------------------------------------------------
+                VARIABLE CONSTANTS
+-------------------------------------------------*/
+
+static boolean              __on;       /* recording?               */
+static uint64               __origin;   /* time recording started   */
+static struct __buffer_type * _Atomic
+                            __buffers;  /* every thread's buffer    */
+
+/*-------------------------------------
+Calling thread's buffer, or NULL
+-------------------------------------*/
+static _Thread_local struct __buffer_type *__buffer;
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static uint64 __now
+(
+    void
+);
+
+static struct __buffer_type *__get_buffer
+(
+    void
+);
+
+static void __put_event
+(
+    char                    phase,  /* 'B'egin or 'E'nd         */
+    const char             *cat,    /* category                 */
+    const char             *name,   /* span's name              */
+    const char             *fmt,    /* format of its detail, or */
+                                    /*  NULL                    */
+    va_list                 ap      /* values for the format    */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __now - "Now"
+*
+*   DESCRIPTION:
+*       Reads the monotonic clock.
+*
+*   RETURNS:
+*       Returns its time in nanoseconds.
+*
+**************************************************/
+static uint64 __now
+(
+    void
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct timespec     ts;     /* clock reading            */
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( (uint64)ts.tv_sec * 1000000000u + (uint64)ts.tv_nsec );
+
+}   /* __now() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __get_buffer - "Get Buffer"
+*
+*   DESCRIPTION:
+*       Gets the calling thread's buffer,
+*       making it and adding it to the list of
+*       buffers the first time.
+*
+*   RETURNS:
+*       Returns the buffer, or NULL if it
+*       couldn't be allocated.
+*
+**************************************************/
+static struct __buffer_type *__get_buffer
+(
+    void
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __buffer_type   *b;      /* new buffer               */
+
+    if( NULL != __buffer )
+    {
+        return( __buffer );
+    }
+
+    b = (struct __buffer_type *)calloc( 1, sizeof( *b ) );
+    if( NULL == b )
+    {
+        return( NULL );
+    }
+
+    b->tid  = (uint)syscall( SYS_gettid );
+    b->next = atomic_load_explicit( &__buffers, memory_order_relaxed );
+    while( !atomic_compare_exchange_weak_explicit( &__buffers, &b->next, b, memory_order_release, memory_order_relaxed ) )
+    {
+    }
+
+    __buffer = b;
+    return( b );
+
+}   /* __get_buffer() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put_event - "Put Event"
+*
+*   DESCRIPTION:
+*       Appends an event to the calling
+*       thread's buffer. An event that can't
+*       be stored is counted as dropped, and a
+*       detail that can't be copied is left
+*       out.
+*
+**************************************************/
+static void __put_event
+(
+    char                    phase,  /* 'B'egin or 'E'nd         */
+    const char             *cat,    /* category                 */
+    const char             *name,   /* span's name              */
+    const char             *fmt,    /* format of its detail, or */
+                                    /*  NULL                    */
+    va_list                 ap      /* values for the format    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __buffer_type   *b;      /* thread's buffer          */
+    struct __chunk_type    *chunk;  /* chunk to append to       */
+    struct __event_type    *e;      /* event                    */
+    char                    detail[ __DETAIL_LEN ];
+                                    /* formatted detail         */
+    uint64                  ns;     /* time of the event        */
+
+    ns = __now();
+    b  = __get_buffer();
+    if( NULL == b )
+    {
+        return;
+    }
+
+    chunk = b->last;
+    if( ( NULL == chunk )
+     || ( __CHUNK_EVENTS == chunk->num_events ) )
+    {
+        chunk = (struct __chunk_type *)malloc( sizeof( *chunk ) );
+        if( NULL == chunk )
+        {
+            ++b->dropped;
+            return;
+        }
+
+        chunk->next       = NULL;
+        chunk->num_events = 0;
+        if( NULL == b->last )
+        {
+            b->first = chunk;
+        }
+        else
+        {
+            b->last->next = chunk;
+        }
+        b->last = chunk;
+    }
+
+    e         = &chunk->events[ chunk->num_events++ ];
+    e->ns     = ns;
+    e->cat    = cat;
+    e->name   = name;
+    e->phase  = phase;
+    e->detail = NULL;
+    if( NULL != fmt )
+    {
+        vsnprintf( detail, sizeof( detail ), fmt, ap );
+        e->detail = strdup( detail );
+    }
+
+}   /* __put_event() */
+
+
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_trace - "Initialize Trace"
+*
+*   DESCRIPTION:
+*       Starts recording. Times on the timeline
+*       are from this call, and the calling
+*       thread is named "main".
+*
+*   NOTES:
+*       * Must be called before any other
+*         thread is started.
+*
+**************************************************/
+void init_trace
+(
+    void
+)
+{
+    __origin = __now();
+    __on     = TRUE;
+    trace_thread( "main" );
+
+}   /* init_trace() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       trace_thread - "Trace Thread"
+*
+*   DESCRIPTION:
+*       Names the calling thread on the
+*       timeline.
+*
+*   NOTES:
+*       * Does nothing unless recording.
+*
+**************************************************/
+void trace_thread
+(
+    const char             *fmt,    /* format of its name       */
+    ...                             /* values for the format    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __buffer_type   *b;      /* thread's buffer          */
+    va_list                 ap;     /* values for the format    */
+
+    if( !__on )
+    {
+        return;
+    }
+
+    b = __get_buffer();
+    if( NULL != b )
+    {
+        va_start( ap, fmt );
+        vsnprintf( b->name, sizeof( b->name ), fmt, ap );
+        va_end( ap );
+    }
+
+}   /* trace_thread() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       trace_begin - "Trace Begin"
+*
+*   DESCRIPTION:
+*       Begins a span on the calling thread.
+*       Spans on a thread must end in the
+*       reverse of the order they began.
+*
+*   NOTES:
+*       * Does nothing unless recording, and
+*         the detail isn't formatted then.
+*
+**************************************************/
+void trace_begin
+(
+    const char             *cat,    /* category, a literal      */
+    const char             *name,   /* span's name, a literal   */
+    const char             *fmt,    /* format of its detail, or */
+                                    /*  NULL                    */
+    ...                             /* values for the format    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    va_list                 ap;     /* values for the format    */
+
+    if( !__on )
+    {
+        return;
+    }
+
+    va_start( ap, fmt );
+    __put_event( 'B', cat, name, fmt, ap );
+    va_end( ap );
+
+}   /* trace_begin() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       trace_end - "Trace End"
+*
+*   DESCRIPTION:
+*       Ends the span the calling thread began
+*       last. A detail given here is shown
+*       along with the one given at its
+*       beginning.
+*
+*   NOTES:
+*       * Does nothing unless recording, and
+*         the detail isn't formatted then.
+*
+**************************************************/
+void trace_end
+(
+    const char             *cat,    /* category, a literal      */
+    const char             *name,   /* span's name, a literal   */
+    const char             *fmt,    /* format of its detail, or */
+                                    /*  NULL                    */
+    ...                             /* values for the format    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    va_list                 ap;     /* values for the format    */
+
+    if( !__on )
+    {
+        return;
+    }
+
+    va_start( ap, fmt );
+    __put_event( 'E', cat, name, fmt, ap );
+    va_end( ap );
+
+}   /* trace_end() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       write_trace - "Write Trace"
+*
+*   DESCRIPTION:
+*       Stops recording and writes the timeline
+*       as a Chrome trace_event JSON object:
+*       each thread's name, then its events in
+*       the order they were recorded, times in
+*       microseconds. The number of events
+*       dropped for want of memory is written
+*       as well. Every buffer is freed, whether
+*       or not the file could be written.
+*
+*   RETURNS:
+*       Returns TRUE if the file was written.
+*
+*   NOTES:
+*       * Every thread that recorded events
+*         must have been joined.
+*
+**************************************************/
+boolean write_trace
+(
+    const char             *path    /* file to write            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __buffer_type   *b;      /* thread's buffer          */
+    struct __buffer_type   *next_b; /* buffer after it          */
+    struct __chunk_type    *chunk;  /* chunk of its events      */
+    struct __chunk_type    *next_c; /* chunk after it           */
+    const struct __event_type
+                           *e;      /* event                    */
+    FILE                   *fp;     /* trace file               */
+    uint64                  dropped;/* events dropped           */
+    uint64                  ns;     /* event's time             */
+    boolean                 first;  /* no event written yet?    */
+    boolean                 ok;     /* written?                 */
+    uint                    pid;    /* process ID               */
+    uint                    i;      /* event in the chunk       */
+
+    __on    = FALSE;
+    pid     = (uint)getpid();
+    dropped = 0;
+    first   = TRUE;
+    fp      = fopen( path, "w" );
+    if( NULL != fp )
+    {
+        fprintf( fp, "{\"traceEvents\":[" );
+    }
+
+    for( b = atomic_load_explicit( &__buffers, memory_order_acquire ); NULL != b; b = next_b )
+    {
+        if( ( NULL != fp )
+         && ( '\0' != b->name[ 0 ] ) )
+        {
+            fprintf( fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":",
+                     first ? "" : ",", pid, b->tid );
+            put_json_string( fp, b->name );
+            fprintf( fp, "}}" );
+            first = FALSE;
+        }
+
+        for( chunk = b->first; NULL != chunk; chunk = next_c )
+        {
+            for( i = 0; i < chunk->num_events; ++i )
+            {
+                e = &chunk->events[ i ];
+                if( NULL != fp )
+                {
+                    ns = e->ns - __origin;
+                    fprintf( fp, "%s\n{\"name\":", first ? "" : "," );
+                    put_json_string( fp, e->name );
+                    fprintf( fp, ",\"cat\":" );
+                    put_json_string( fp, e->cat );
+                    fprintf( fp, ",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":%u,\"tid\":%u",
+                             e->phase, (unsigned long long)( ns / 1000 ), (uint)( ns % 1000 ), pid, b->tid );
+                    if( NULL != e->detail )
+                    {
+                        fprintf( fp, ",\"args\":{\"%s\":", ( 'B' == e->phase ) ? "detail" : "outcome" );
+                        put_json_string( fp, e->detail );
+                        fputc( '}', fp );
+                    }
+                    fputc( '}', fp );
+                    first = FALSE;
+                }
+                free( e->detail );
+            }
+
+            next_c = chunk->next;
+            free( chunk );
+        }
+
+        dropped += b->dropped;
+        next_b   = b->next;
+        free( b );
+    }
+    atomic_store_explicit( &__buffers, NULL, memory_order_relaxed );
+    __buffer = NULL;
+
+    if( NULL == fp )
+    {
+        return( FALSE );
+    }
+
+    fprintf( fp, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":%llu}}\n", (unsigned long long)dropped );
+    ok = ( 0 == ferror( fp ) );
+    ok = ( 0 == fclose( fp ) ) && ok;
+    return( ok );
+
+}   /* write_trace() */
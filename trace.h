@@ -0,0 +1,59 @@
+/**************************************************
+*
+*   NAME:
+*       trace.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       recording a timeline of what each
+*       thread of the compiler does
+*
+**************************************************/
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "types.h"
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+void init_trace
+(
+    void
+);
+
+void trace_thread
+(
+    const char             *fmt,    /* format of its name       */
+    ...                             /* values for the format    */
+);
+
+void trace_begin
+(
+    const char             *cat,    /* category, a literal      */
+    const char             *name,   /* span's name, a literal   */
+    const char             *fmt,    /* format of its detail, or */
+                                    /*  NULL                    */
+    ...                             /* values for the format    */
+);
+
+void trace_end
+(
+    const char             *cat,    /* category, a literal      */
+    const char             *name,   /* span's name, a literal   */
+    const char             *fmt,    /* format of its detail, or */
+                                    /*  NULL                    */
+    ...                             /* values for the format    */
+);
+
+boolean write_trace
+(
+    const char             *path    /* file to write            */
+);
+
+#endif /* __TRACE_H__ */
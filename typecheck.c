@@ -0,0 +1,1186 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       typecheck.c
+*
+*   DESCRIPTION:
+*       Infers and checks the type of every node
+*       of a tree in one forward sweep over the
+*       node array. Lists are typed bottom-up,
+*       when the sweep leaves them, so their
+*       elements are always typed first. Results
+*       go in parallel arrays indexed by node
+*       rather than in the nodes themselves.
+*
+*       A let adds each of its variables to the
+*       compilation's bindings once. Uses of a
+*       variable are resolved to its binding
+*       through a small table keyed on the name,
+*       without copying the lexeme or going to
+*       the symbol table. The table belongs to
+*       the compilation, so several can be
+*       checked on threads of their own.
+*
+*       Binding names come from the
+*       compilation's arena, so adding a
+*       variable costs no call to malloc().
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "ast.h"
+#include "stats.h"
+#include "tokens.h"
+#include "typecheck.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __INITIAL_NODES     1024        /* first size of the node arrays    */
+#define __INITIAL_BINDINGS  64          /* first size of the bindings       */
+#define __INITIAL_BUCKETS   128         /* first buckets, a power of 2      */
+#define __INITIAL_STACK     64          /* first size of the stack          */
+#define __MAX_MANGLE_LEN    12          /* "v", a binding index and "-"     */
+
+#define __HASH_BASIS        2166136261u /* FNV-1a offset basis              */
+#define __HASH_PRIME        16777619u   /* FNV-1a prime                     */
+
+/*-------------------------------------
+What an open list is, which decides
+how its elements are read
+-------------------------------------*/
+typedef uint8 __frame_kind_t8;
+enum
+{
+    __FRAME_FORM = 0,               /* expression, statement or sequence    */
+    __FRAME_BINDINGS,               /* a let's list of [name type] pairs    */
+    __FRAME_BINDING                 /* one [name type] pair                 */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+One open list. end is the index just
+past its subtree.
+-------------------------------------*/
+struct __type_frame_type
+{
+    uint                list;       /* list node                */
+    uint                end;        /* past its last descendant */
+    __frame_kind_t8     kind;       /* kind of list             */
+};
+
+/*-------------------------------------------------
+                        MACROS
+-------------------------------------------------*/
+
+/**************************************************
+*
+*   FUNCTION:
+*       __is_value - "Is Value"
+*
+*   DESCRIPTION:
+*       Checks whether a type is a primitive
+*       type rather than TYPE_NONE or
+*       TYPE_ERROR.
+*
+**************************************************/
+#define __is_value( t ) ( (t) < TOK_NUM_TYPES )
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __is_numeric - "Is Numeric"
+*
+*   DESCRIPTION:
+*       Checks whether a type is int or real.
+*
+**************************************************/
+#define __is_numeric( t ) ( ( TOK_INT_TYPE == (t) ) || ( TOK_REAL_TYPE == (t) ) )
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static boolean __grow_array
+(
+    void                  **array,  /* array to grow            */
+    uint                   *cap,    /* its capacity             */
+    uint                    need,   /* elements needed          */
+    size_t                  size    /* size of an element       */
+);
+
+static uint __hash_name
+(
+    const char             *name,   /* name to hash             */
+    uint                    len     /* length of the name       */
+);
+
+static type_class_t8 __binary_type
+(
+    bin_opp_class_t8        opp,    /* operator                 */
+    type_class_t8           a,      /* left operand             */
+    type_class_t8           b       /* right operand            */
+);
+
+static type_class_t8 __unary_type
+(
+    unary_opp_class_t8      opp,    /* operator                 */
+    type_class_t8           a       /* operand                  */
+);
+
+static type_error_t8 __bind_let
+(
+    struct type_info_type  *ti,     /* results                  */
+    const struct ast_type  *ast,    /* tree                     */
+    uint                    list    /* let's list of bindings   */
+);
+
+static void __type_leaf
+(
+    struct type_info_type  *ti,     /* results                  */
+    const struct ast_type  *ast,    /* tree                     */
+    uint                    node,   /* leaf to type             */
+    __frame_kind_t8         kind    /* kind of its list         */
+);
+
+static void __type_list
+(
+    struct type_info_type  *ti,     /* results                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct __type_frame_type
+                           *frame   /* closed list              */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __grow_array - "Grow Array"
+*
+*   DESCRIPTION:
+*       Doubles an array until it holds at least
+*       the number of elements needed.
+*
+*   RETURNS:
+*       Returns TRUE on success
+*
+*   ERRORS:
+*       * Returns FALSE if the array couldn't be
+*         grown. The array is unchanged.
+*
+**************************************************/
+static boolean __grow_array
+(
+    void                  **array,  /* array to grow            */
+    uint                   *cap,    /* its capacity             */
+    uint                    need,   /* elements needed          */
+    size_t                  size    /* size of an element       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    void       *grown;          /* grown array              */
+    uint        new_cap;        /* grown capacity           */
+
+    if( need <= *cap )
+    {
+        return( TRUE );
+    }
+
+    new_cap = *cap;
+    while( new_cap < need )
+    {
+        if( new_cap << 1 <= new_cap )
+        {
+            return( FALSE );
+        }
+        new_cap <<= 1;
+    }
+
+    grown = stats_realloc( *array, (size_t)new_cap * size );
+    if( NULL == grown )
+    {
+        return( FALSE );
+    }
+
+    *array = grown;
+    *cap   = new_cap;
+
+    return( TRUE );
+
+}   /* __grow_array() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __hash_name - "Hash Name"
+*
+*   DESCRIPTION:
+*       Hashes a name straight out of the
+*       source buffer.
+*
+**************************************************/
+static uint __hash_name
+(
+    const char             *name,   /* name to hash             */
+    uint                    len     /* length of the name       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    uint        hash;           /* running hash             */
+    uint        i;              /* character index          */
+
+    hash = __HASH_BASIS;
+    for( i = 0; i < len; ++i )
+    {
+        hash = ( hash ^ (uint8)name[ i ] ) * __HASH_PRIME;
+    }
+
+    return( hash );
+
+}   /* __hash_name() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       find_binding - "Find Binding"
+*
+*   DESCRIPTION:
+*       Looks a variable up by name.
+*
+*   RETURNS:
+*       Returns the index of its binding, or
+*       TYPE_NO_BINDING if it was never
+*       declared.
+*
+**************************************************/
+uint find_binding
+(
+    const struct type_info_type
+                           *ti,     /* results                  */
+    const char             *name,   /* name to find             */
+    uint                    len     /* length of the name       */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct binding_type  *b;      /* candidate binding    */
+    uint                        idx;    /* bucket index         */
+
+    idx = __hash_name( name, len ) & ti->bucket_mask;
+    while( TYPE_NO_BINDING != ti->buckets[ idx ] )
+    {
+        b = &ti->bindings[ ti->buckets[ idx ] ];
+        if( ( b->len == len )
+         && ( 0 == memcmp( b->name, name, len ) ) )
+        {
+            return( ti->buckets[ idx ] );
+        }
+        idx = ( idx + 1 ) & ti->bucket_mask;
+    }
+
+    return( TYPE_NO_BINDING );
+
+}   /* find_binding() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       add_binding - "Add Binding"
+*
+*   DESCRIPTION:
+*       Declares a variable. This is the only
+*       place the checker adds a binding.
+*       Declaring a variable again with
+*       the same type is allowed and does
+*       nothing.
+*
+*   RETURNS:
+*       Returns an error code, and the index of
+*       the variable's binding in binding
+*
+*   ERRORS:
+*       * TYPE_REDECLARED if the variable was
+*         declared with another type.
+*       * TYPE_NO_MEMORY if the binding couldn't
+*         be added.
+*
+**************************************************/
+type_error_t8 add_binding
+(
+    struct type_info_type  *ti,     /* results                  */
+    const char             *name,   /* variable's name          */
+    uint                    len,    /* length of the name       */
+    type_class_t8           type,   /* declared type            */
+    uint                   *binding /* its binding              */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct binding_type    *b;          /* new binding          */
+    uint                   *buckets;    /* rehashed buckets     */
+    uint                    num_buckets;/* buckets allocated    */
+    uint                    idx;        /* bucket index         */
+    uint                    i;          /* binding index        */
+
+    idx = find_binding( ti, name, len );
+    if( TYPE_NO_BINDING != idx )
+    {
+        *binding = idx;
+        return( ( ti->bindings[ idx ].type == type ) ? TYPE_NO_ERROR : TYPE_REDECLARED );
+    }
+
+    /*---------------------------------
+    Make room, keeping the buckets at
+    most half full
+    ---------------------------------*/
+    if( !__grow_array( (void **)&ti->bindings, &ti->binding_cap, ti->num_bindings + 1, sizeof( *ti->bindings ) ) )
+    {
+        return( TYPE_NO_MEMORY );
+    }
+
+    num_buckets = ti->bucket_mask + 1;
+    if( 2 * ( ti->num_bindings + 1 ) > num_buckets )
+    {
+        num_buckets <<= 1;
+        buckets = (uint *)stats_calloc( num_buckets, sizeof( *buckets ) );
+        if( NULL == buckets )
+        {
+            return( TYPE_NO_MEMORY );
+        }
+
+        for( i = 1; i < ti->num_bindings; ++i )
+        {
+            idx = __hash_name( ti->bindings[ i ].name, ti->bindings[ i ].len ) & ( num_buckets - 1 );
+            while( TYPE_NO_BINDING != buckets[ idx ] )
+            {
+                idx = ( idx + 1 ) & ( num_buckets - 1 );
+            }
+            buckets[ idx ] = i;
+        }
+
+        free( ti->buckets );
+        ti->buckets     = buckets;
+        ti->bucket_mask = num_buckets - 1;
+    }
+
+    /*---------------------------------
+    Add the binding and its name
+    ---------------------------------*/
+    b       = &ti->bindings[ ti->num_bindings ];
+    b->name = (char *)arena_alloc( &ti->arena, 2 * len + __MAX_MANGLE_LEN + 2 );
+    if( NULL == b->name )
+    {
+        return( TYPE_NO_MEMORY );
+    }
+    memcpy( b->name, name, len );
+    b->name[ len ] = '\0';
+    b->len         = (uint16)len;
+    b->type        = type;
+    b->out_name    = b->name + len + 1;
+    b->out_len     = (uint16)sprintf( b->out_name, "v%u-%.*s", ti->num_bindings, (int)len, name );
+
+    idx = __hash_name( name, len ) & ti->bucket_mask;
+    while( TYPE_NO_BINDING != ti->buckets[ idx ] )
+    {
+        idx = ( idx + 1 ) & ti->bucket_mask;
+    }
+    *binding           = ti->num_bindings;
+    ti->buckets[ idx ] = ti->num_bindings++;
+
+    return( TYPE_NO_ERROR );
+
+}   /* add_binding() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __binary_type - "Binary Type"
+*
+*   DESCRIPTION:
+*       Types a binary operation from the types
+*       of its operands. Arithmetic on an int
+*       and a real is real; "+" also joins two
+*       strings. An int may be assigned to a
+*       real variable.
+*
+*   RETURNS:
+*       Returns the type of the operation, or
+*       TYPE_ERROR if the operands don't fit.
+*
+**************************************************/
+static type_class_t8 __binary_type
+(
+    bin_opp_class_t8        opp,    /* operator                 */
+    type_class_t8           a,      /* left operand             */
+    type_class_t8           b       /* right operand            */
+)
+{
+    if( !__is_value( a )
+     || !__is_value( b ) )
+    {
+        return( TYPE_ERROR );
+    }
+
+    switch( opp )
+    {
+        case TOK_ADD_OPP:
+            if( ( TOK_STRING_TYPE == a )
+             && ( TOK_STRING_TYPE == b ) )
+            {
+                return( TOK_STRING_TYPE );
+            }
+            /* fall through */
+
+        case TOK_SUB_OPP:
+        case TOK_MUL_OPP:
+        case TOK_DIV_OPP:
+        case TOK_EXP_OPP:
+            if( __is_numeric( a )
+             && __is_numeric( b ) )
+            {
+                return( ( ( TOK_INT_TYPE == a ) && ( TOK_INT_TYPE == b ) ) ? TOK_INT_TYPE : TOK_REAL_TYPE );
+            }
+            return( TYPE_ERROR );
+
+        case TOK_MOD_OPP:
+            return( ( ( TOK_INT_TYPE == a ) && ( TOK_INT_TYPE == b ) ) ? TOK_INT_TYPE : TYPE_ERROR );
+
+        case TOK_AND_OPP:
+        case TOK_OR_OPP:
+            return( ( ( TOK_BOOL_TYPE == a ) && ( TOK_BOOL_TYPE == b ) ) ? TOK_BOOL_TYPE : TYPE_ERROR );
+
+        case TOK_EQ_OPP:
+        case TOK_NE_OPP:
+            if( ( a == b )
+             || ( __is_numeric( a ) && __is_numeric( b ) ) )
+            {
+                return( TOK_BOOL_TYPE );
+            }
+            return( TYPE_ERROR );
+
+        case TOK_LT_OPP:
+        case TOK_GT_OPP:
+        case TOK_LE_OPP:
+        case TOK_GE_OPP:
+            if( ( ( TOK_STRING_TYPE == a ) && ( TOK_STRING_TYPE == b ) )
+             || ( __is_numeric( a ) && __is_numeric( b ) ) )
+            {
+                return( TOK_BOOL_TYPE );
+            }
+            return( TYPE_ERROR );
+
+        case TOK_ASSN_OPP:
+            if( ( a == b )
+             || ( ( TOK_REAL_TYPE == a ) && ( TOK_INT_TYPE == b ) ) )
+            {
+                return( TYPE_NONE );
+            }
+            return( TYPE_ERROR );
+
+        default:
+            return( TYPE_ERROR );
+    }
+
+}   /* __binary_type() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __unary_type - "Unary Type"
+*
+*   DESCRIPTION:
+*       Types a unary operation from the type of
+*       its operand. The trigonometric operators
+*       take either number and give a real.
+*
+*   RETURNS:
+*       Returns the type of the operation, or
+*       TYPE_ERROR if the operand doesn't fit.
+*
+**************************************************/
+static type_class_t8 __unary_type
+(
+    unary_opp_class_t8      opp,    /* operator                 */
+    type_class_t8           a       /* operand                  */
+)
+{
+    switch( opp )
+    {
+        case TOK_NOT_OPP:
+            return( ( TOK_BOOL_TYPE == a ) ? TOK_BOOL_TYPE : TYPE_ERROR );
+
+        case TOK_NEG_OPP:
+        case TOK_POS_OPP:
+            return( __is_numeric( a ) ? a : TYPE_ERROR );
+
+        case TOK_SIN_OPP:
+        case TOK_COS_OPP:
+        case TOK_TAN_OPP:
+            return( __is_numeric( a ) ? TOK_REAL_TYPE : TYPE_ERROR );
+
+        default:
+            return( TYPE_ERROR );
+    }
+
+}   /* __unary_type() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __bind_let - "Bind Let"
+*
+*   DESCRIPTION:
+*       Declares the variables of a let once
+*       the whole let has been read. Its pairs
+*       have already been checked. Each name is
+*       resolved to the binding it declares,
+*       as a use would be.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * See add_binding(). error_offset is
+*         set to the offending pair.
+*
+**************************************************/
+static type_error_t8 __bind_let
+(
+    struct type_info_type  *ti,     /* results                  */
+    const struct ast_type  *ast,    /* tree                     */
+    uint                    list    /* let's list of bindings   */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *name;   /* variable's name      */
+    const struct ast_node_type *type;   /* its type keyword     */
+    type_error_t8               error;  /* error code           */
+    type_class_t8               cls;    /* declared type        */
+    uint                        pair;   /* [name type] pair     */
+
+    for( pair = ast->nodes[ list ].first_child; AST_NO_NODE != pair; pair = ast->nodes[ pair ].next_sibling )
+    {
+        name = &ast->nodes[ ast->nodes[ pair ].first_child ];
+        type = &ast->nodes[ name->next_sibling ];
+        switch( type->subclass )
+        {
+            case TOK_INT:
+                cls = TOK_INT_TYPE;
+                break;
+
+            case TOK_REAL:
+                cls = TOK_REAL_TYPE;
+                break;
+
+            case TOK_STRING:
+                cls = TOK_STRING_TYPE;
+                break;
+
+            default:
+                cls = TOK_BOOL_TYPE;
+                break;
+        }
+
+        error = add_binding( ti, &ast->src[ name->offset ], name->len, cls, &ti->syms[ ast->nodes[ pair ].first_child ] );
+        if( TYPE_NO_ERROR != error )
+        {
+            ti->error_offset = ast->nodes[ pair ].offset;
+            return( error );
+        }
+    }
+
+    return( TYPE_NO_ERROR );
+
+}   /* __bind_let() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __type_leaf - "Type Leaf"
+*
+*   DESCRIPTION:
+*       Types a leaf. Literals and the boolean
+*       constants type themselves, and a use of
+*       a variable is resolved to its binding.
+*       The name in a [name type] pair isn't a
+*       use.
+*
+*   ERRORS:
+*       * Sets TYPE_UNDECLARED for a variable
+*         with no binding yet, and TYPE_BAD_FORM
+*         for a let whose bindings aren't pairs.
+*
+**************************************************/
+static void __type_leaf
+(
+    struct type_info_type  *ti,     /* results                  */
+    const struct ast_type  *ast,    /* tree                     */
+    uint                    node,   /* leaf to type             */
+    __frame_kind_t8         kind    /* kind of its list         */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *leaf;   /* leaf                 */
+    uint                        b;      /* binding              */
+
+    leaf = &ast->nodes[ node ];
+    ti->types[ node ] = TYPE_NONE;
+    if( __FRAME_BINDINGS == kind )
+    {
+        ti->types[ node ] = TYPE_ERROR;
+        ti->error         = TYPE_BAD_FORM;
+        ti->error_offset  = leaf->offset;
+        return;
+    }
+
+    switch( leaf->token_class )
+    {
+        case TOK_LITERAL:
+            ti->types[ node ] = leaf->subclass;
+            break;
+
+        case TOK_RESERVED_WORD:
+            if( ( TOK_TRUE == leaf->subclass )
+             || ( TOK_FALSE == leaf->subclass ) )
+            {
+                ti->types[ node ] = TOK_BOOL_TYPE;
+            }
+            break;
+
+        case TOK_IDENT:
+            if( __FRAME_BINDING == kind )
+            {
+                break;
+            }
+
+            b = find_binding( ti, &ast->src[ leaf->offset ], leaf->len );
+            if( TYPE_NO_BINDING == b )
+            {
+                ti->types[ node ] = TYPE_ERROR;
+                ti->error         = TYPE_UNDECLARED;
+                ti->error_offset  = leaf->offset;
+                break;
+            }
+            ti->types[ node ] = ti->bindings[ b ].type;
+            ti->syms[ node ]  = b;
+            break;
+
+        default:
+            break;
+    }
+
+}   /* __type_leaf() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __type_list - "Type List"
+*
+*   DESCRIPTION:
+*       Types a list once all of its elements
+*       have been typed. The first element
+*       decides what the list is:
+*
+*           [opp a b] / [opp a] - operation
+*           [if c t e?]         - valued if
+*                                 both branches
+*                                 agree
+*           [while c body...]   - loop
+*           [stdout e]          - print
+*           [let [[x type]...]] - declarations
+*           [[...] ...]         - sequence
+*
+*       Only operations and a valued if have a
+*       type; everything else is TYPE_NONE.
+*
+*   ERRORS:
+*       * Sets TYPE_BAD_FORM, TYPE_BAD_ARITY,
+*         TYPE_MISMATCH or an error from binding
+*         a let; error_offset is set to the
+*         list unless noted otherwise.
+*
+**************************************************/
+static void __type_list
+(
+    struct type_info_type  *ti,     /* results                  */
+    const struct ast_type  *ast,    /* tree                     */
+    const struct __type_frame_type
+                           *frame   /* closed list              */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *nodes;      /* node array           */
+    const struct ast_node_type *head;       /* first element        */
+    type_class_t8              *types;      /* node types           */
+    type_class_t8               type;       /* type of the list     */
+    type_error_t8               error;      /* error code           */
+    uint                        list;       /* list node            */
+    uint                        elem[ 4 ];  /* first elements       */
+    uint                        count;      /* elements             */
+    uint                        child;      /* element              */
+
+    nodes = ast->nodes;
+    types = ti->types;
+    list  = frame->list;
+    error = TYPE_NO_ERROR;
+    type  = TYPE_NONE;
+
+    count = 0;
+    for( child = nodes[ list ].first_child; AST_NO_NODE != child; child = nodes[ child ].next_sibling )
+    {
+        if( count < 4 )
+        {
+            elem[ count ] = child;
+        }
+        ++count;
+    }
+
+    /*---------------------------------
+    Bindings and sequences
+    ---------------------------------*/
+    if( __FRAME_BINDING == frame->kind )
+    {
+        if( ( 2 != count )
+         || ( TOK_IDENT != nodes[ elem[ 0 ] ].token_class )
+         || ( TOK_RESERVED_WORD != nodes[ elem[ 1 ] ].token_class )
+         || ( nodes[ elem[ 1 ] ].subclass < TOK_BOOL )
+         || ( nodes[ elem[ 1 ] ].subclass > TOK_STRING ) )
+        {
+            error = TYPE_BAD_FORM;
+        }
+    }
+    else if( ( __FRAME_BINDINGS == frame->kind )
+          || ( AST_ROOT == list )
+          || ( 0 == count )
+          || ( TOK_LIST_TYPE == nodes[ elem[ 0 ] ].token_class ) )
+    {
+        for( child = nodes[ list ].first_child; AST_NO_NODE != child; child = nodes[ child ].next_sibling )
+        {
+            if( TOK_LIST_TYPE != nodes[ child ].token_class )
+            {
+                ti->error        = TYPE_BAD_FORM;
+                ti->error_offset = nodes[ child ].offset;
+                types[ list ]    = TYPE_ERROR;
+                return;
+            }
+        }
+    }
+
+    /*---------------------------------
+    Operations
+    ---------------------------------*/
+    else
+    {
+        head = &nodes[ elem[ 0 ] ];
+        switch( head->token_class )
+        {
+            case TOK_BINARY_OPP:
+                if( 3 != count )
+                {
+                    error = TYPE_BAD_ARITY;
+                }
+                else if( ( TOK_ASSN_OPP == head->subclass )
+                      && ( TOK_IDENT != nodes[ elem[ 1 ] ].token_class ) )
+                {
+                    error = TYPE_BAD_FORM;
+                }
+                else
+                {
+                    type = __binary_type( head->subclass, types[ elem[ 1 ] ], types[ elem[ 2 ] ] );
+                }
+                break;
+
+            case TOK_UNARY_OPP:
+                if( 2 != count )
+                {
+                    error = TYPE_BAD_ARITY;
+                }
+                else
+                {
+                    type = __unary_type( head->subclass, types[ elem[ 1 ] ] );
+                }
+                break;
+
+            case TOK_RESERVED_WORD:
+                switch( head->subclass )
+                {
+                    case TOK_IF:
+                        if( ( 3 != count ) && ( 4 != count ) )
+                        {
+                            error = TYPE_BAD_ARITY;
+                        }
+                        else if( TOK_BOOL_TYPE != types[ elem[ 1 ] ] )
+                        {
+                            type = TYPE_ERROR;
+                        }
+                        else if( ( 4 == count )
+                              && __is_value( types[ elem[ 2 ] ] )
+                              && ( types[ elem[ 2 ] ] == types[ elem[ 3 ] ] ) )
+                        {
+                            type = types[ elem[ 2 ] ];
+                        }
+                        break;
+
+                    case TOK_WHILE:
+                        if( count < 2 )
+                        {
+                            error = TYPE_BAD_ARITY;
+                        }
+                        else if( TOK_BOOL_TYPE != types[ elem[ 1 ] ] )
+                        {
+                            type = TYPE_ERROR;
+                        }
+                        break;
+
+                    case TOK_STDOUT:
+                        if( 2 != count )
+                        {
+                            error = TYPE_BAD_ARITY;
+                        }
+                        else if( !__is_value( types[ elem[ 1 ] ] ) )
+                        {
+                            type = TYPE_ERROR;
+                        }
+                        break;
+
+                    case TOK_LET:
+                        if( ( 2 != count )
+                         || ( TOK_LIST_TYPE != nodes[ elem[ 1 ] ].token_class ) )
+                        {
+                            error = TYPE_BAD_FORM;
+                        }
+                        else
+                        {
+                            error = __bind_let( ti, ast, elem[ 1 ] );
+                            if( TYPE_NO_ERROR != error )
+                            {
+                                ti->error     = error;
+                                types[ list ] = TYPE_ERROR;
+                                return;
+                            }
+                        }
+                        break;
+
+                    default:
+                        error = TYPE_BAD_FORM;
+                        break;
+                }
+                break;
+
+            default:
+                error = TYPE_BAD_FORM;
+                break;
+        }
+
+        if( ( TYPE_NO_ERROR == error )
+         && ( TYPE_ERROR == type ) )
+        {
+            error = TYPE_MISMATCH;
+        }
+    }
+
+    if( TYPE_NO_ERROR != error )
+    {
+        ti->error        = error;
+        ti->error_offset = nodes[ list ].offset;
+        type             = TYPE_ERROR;
+    }
+    types[ list ] = type;
+
+}   /* __type_list() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       init_type_info - "Initialize Type Info"
+*
+*   DESCRIPTION:
+*       Prepares to check trees, with no
+*       variables declared yet.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * TYPE_NO_MEMORY if the arrays couldn't
+*         be allocated. The results must still
+*         be freed with free_type_info().
+*
+**************************************************/
+type_error_t8 init_type_info
+(
+    struct type_info_type  *ti      /* results to initialize    */
+)
+{
+    memset( ti, 0, sizeof( *ti ) );
+    ti->num_bindings = 1;
+    ti->node_cap     = __INITIAL_NODES;
+    ti->binding_cap  = __INITIAL_BINDINGS;
+    ti->stack_cap    = __INITIAL_STACK;
+    ti->bucket_mask  = __INITIAL_BUCKETS - 1;
+
+    ti->types    = (type_class_t8 *)stats_malloc( ti->node_cap * sizeof( *ti->types ) );
+    ti->syms     = (uint *)stats_malloc( ti->node_cap * sizeof( *ti->syms ) );
+    ti->bindings = (struct binding_type *)stats_malloc( ti->binding_cap * sizeof( *ti->bindings ) );
+    ti->stack    = (struct __type_frame_type *)stats_malloc( ti->stack_cap * sizeof( *ti->stack ) );
+    ti->buckets  = (uint *)stats_calloc( __INITIAL_BUCKETS, sizeof( *ti->buckets ) );
+    init_arena( &ti->arena );
+    if( ( NULL == ti->types )
+     || ( NULL == ti->syms )
+     || ( NULL == ti->bindings )
+     || ( NULL == ti->stack )
+     || ( NULL == ti->buckets ) )
+    {
+        return( TYPE_NO_MEMORY );
+    }
+
+    return( TYPE_NO_ERROR );
+
+}   /* init_type_info() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       check_types - "Check Types"
+*
+*   DESCRIPTION:
+*       Types every node of a tree. The nodes
+*       are visited once, in order. A stack of
+*       open lists, each with the index just
+*       past its subtree, tells the sweep when
+*       it has left a list so the list can be
+*       typed from its elements.
+*
+*       Variables declared by earlier calls stay
+*       declared, so the forms of a program may
+*       be checked a batch at a time.
+*
+*   RETURNS:
+*       Returns an error code
+*
+*   ERRORS:
+*       * Stops at the first error and sets
+*         error_offset to the offending node.
+*         The types of nodes after it are
+*         undefined.
+*
+**************************************************/
+type_error_t8 check_types
+(
+    struct type_info_type  *ti,     /* results                  */
+    const struct ast_type  *ast     /* tree to check            */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const struct ast_node_type *nodes;      /* node array           */
+    const struct __type_frame_type
+                               *top;        /* innermost open list  */
+    struct __type_frame_type   *frame;      /* new frame            */
+    __frame_kind_t8             kind;       /* kind of a new list   */
+    uint                        depth;      /* open lists           */
+    uint                        node;       /* node being visited   */
+    uint                        end;        /* past a new subtree   */
+    uint                        head;       /* parent's first elem  */
+    uint                        types_cap;  /* grown types[]        */
+    uint                        syms_cap;   /* grown syms[]         */
+
+    ti->error        = TYPE_NO_ERROR;
+    ti->error_offset = 0;
+    ti->num_nodes    = 0;
+    types_cap = ti->node_cap;
+    syms_cap  = ti->node_cap;
+    if( !__grow_array( (void **)&ti->types, &types_cap, ast->num_nodes, sizeof( *ti->types ) )
+     || !__grow_array( (void **)&ti->syms,  &syms_cap,  ast->num_nodes, sizeof( *ti->syms  ) ) )
+    {
+        ti->node_cap = ( types_cap < syms_cap ) ? types_cap : syms_cap;
+        return( ti->error = TYPE_NO_MEMORY );
+    }
+    ti->node_cap = types_cap;
+
+    nodes = ast->nodes;
+    ti->syms[ AST_ROOT ]  = TYPE_NO_BINDING;
+    ti->stack[ 0 ].list   = AST_ROOT;
+    ti->stack[ 0 ].end    = ast->num_nodes;
+    ti->stack[ 0 ].kind   = __FRAME_FORM;
+    depth                 = 1;
+
+    for( node = 1; ; ++node )
+    {
+        /*-----------------------------
+        Type the lists just left
+        -----------------------------*/
+        while( ( depth > 0 )
+            && ( ti->stack[ depth - 1 ].end == node ) )
+        {
+            __type_list( ti, ast, &ti->stack[ --depth ] );
+            if( TYPE_NO_ERROR != ti->error )
+            {
+                return( ti->error );
+            }
+        }
+
+        if( node == ast->num_nodes )
+        {
+            break;
+        }
+
+        top = &ti->stack[ depth - 1 ];
+        ti->syms[ node ] = TYPE_NO_BINDING;
+        if( TOK_LIST_TYPE != nodes[ node ].token_class )
+        {
+            __type_leaf( ti, ast, node, top->kind );
+            if( TYPE_NO_ERROR != ti->error )
+            {
+                return( ti->error );
+            }
+            continue;
+        }
+
+        /*-----------------------------
+        Enter a list
+        -----------------------------*/
+        end  = ( AST_NO_NODE != nodes[ node ].next_sibling ) ? nodes[ node ].next_sibling : top->end;
+        head = nodes[ top->list ].first_child;
+        if( __FRAME_BINDINGS == top->kind )
+        {
+            kind = __FRAME_BINDING;
+        }
+        else if( ( AST_ROOT != top->list )
+              && ( TOK_RESERVED_WORD == nodes[ head ].token_class )
+              && ( TOK_LET == nodes[ head ].subclass )
+              && ( nodes[ head ].next_sibling == node ) )
+        {
+            kind = __FRAME_BINDINGS;
+        }
+        else
+        {
+            kind = __FRAME_FORM;
+        }
+
+        if( !__grow_array( (void **)&ti->stack, &ti->stack_cap, depth + 1, sizeof( *ti->stack ) ) )
+        {
+            return( ti->error = TYPE_NO_MEMORY );
+        }
+
+        frame       = &ti->stack[ depth++ ];
+        frame->list = node;
+        frame->end  = end;
+        frame->kind = kind;
+    }
+
+    ti->num_nodes = ast->num_nodes;
+
+    return( TYPE_NO_ERROR );
+
+}   /* check_types() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       free_type_info - "Free Type Info"
+*
+*   DESCRIPTION:
+*       Frees the results and the bindings,
+*       along with their names.
+*
+**************************************************/
+void free_type_info
+(
+    struct type_info_type  *ti      /* results to free          */
+)
+{
+    free_arena( &ti->arena );
+    free( ti->types );
+    free( ti->syms );
+    free( ti->bindings );
+    free( ti->buckets );
+    free( ti->stack );
+    memset( ti, 0, sizeof( *ti ) );
+
+}   /* free_type_info() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       type_error_str - "Type Error String"
+*
+*   DESCRIPTION:
+*       Returns a description of a type error.
+*
+**************************************************/
+const char *type_error_str
+(
+    type_error_t8           error   /* error code               */
+)
+{
+    switch( error )
+    {
+        case TYPE_NO_ERROR:
+            return( "no error" );
+
+        case TYPE_NO_MEMORY:
+            return( "out of memory" );
+
+        case TYPE_MISMATCH:
+            return( "operand has the wrong type" );
+
+        case TYPE_UNDECLARED:
+            return( "variable used before it was declared" );
+
+        case TYPE_REDECLARED:
+            return( "variable redeclared with another type" );
+
+        case TYPE_BAD_FORM:
+            return( "not a valid form" );
+
+        case TYPE_BAD_ARITY:
+            return( "wrong number of operands" );
+
+        default:
+            return( "unknown error" );
+    }
+
+}   /* type_error_str() */
@@ -0,0 +1,153 @@
+/**************************************************
+*
+*   NAME:
+*       typecheck.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for type
+*       inference and checking
+*
+**************************************************/
+
+#ifndef __TYPECHECK_H__
+#define __TYPECHECK_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "arena.h"
+#include "ast.h"
+#include "tokens.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define TYPE_NONE       ( TOK_NUM_TYPES )       /* node has no value    */
+#define TYPE_ERROR      ( TOK_NUM_TYPES + 1 )   /* node didn't check    */
+
+#define TYPE_NO_BINDING 0   /* binding of a node that isn't a use   */
+                            /*  of a variable                       */
+
+/*-------------------------------------
+Error types
+-------------------------------------*/
+typedef sint8 type_error_t8;
+enum
+{
+    TYPE_NO_ERROR         =  0,     /* no error                         */
+    TYPE_NO_MEMORY        = -1,     /* out of memory                    */
+    TYPE_MISMATCH         = -2,     /* operand of the wrong type        */
+    TYPE_UNDECLARED       = -3,     /* variable used before its let     */
+    TYPE_REDECLARED       = -4,     /* variable redeclared as another   */
+                                    /*  type                            */
+    TYPE_BAD_FORM         = -5,     /* list isn't a valid form          */
+    TYPE_BAD_ARITY        = -6      /* wrong number of operands         */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+A variable declared by a let. Uses
+are resolved to the binding's index
+through the compilation's table of
+binding names. The
+binding's index is part of its Gforth
+name, so no variable can clash with a
+Gforth word or with another variable
+that differs only in case.
+-------------------------------------*/
+struct binding_type
+{
+    char               *name;       /* variable's name                  */
+    uint16              len;        /* length of the name               */
+    type_class_t8       type;       /* declared type                    */
+    char               *out_name;   /* Gforth name, "v<index>-<name>"   */
+    uint16              out_len;    /* length of the Gforth name        */
+};
+
+/*-------------------------------------
+Results of checking a tree, kept out
+of the nodes in parallel arrays that
+are indexed by node. types[] holds a
+type class, TYPE_NONE or TYPE_ERROR;
+syms[] holds the binding of every use
+of a variable and of every name a let
+declares, or TYPE_NO_BINDING.
+
+Bindings outlive a single tree, so a
+program that arrives in batches of
+forms can be checked one batch at a
+time. They and the table of their
+names belong to this compilation
+alone, so programs can be checked on
+several threads at once.
+-------------------------------------*/
+struct type_info_type
+{
+    type_class_t8          *types;          /* type of each node        */
+    uint                   *syms;           /* binding of each node     */
+    uint                    num_nodes;      /* nodes checked            */
+    uint                    node_cap;       /* nodes allocated          */
+
+    struct binding_type    *bindings;       /* bindings; 0 is unused    */
+    uint                    num_bindings;   /* bindings in use          */
+    uint                    binding_cap;    /* bindings allocated       */
+    uint                   *buckets;        /* binding by name hash     */
+    uint                    bucket_mask;    /* buckets - 1              */
+    struct arena_type       arena;          /* binding names            */
+
+    struct __type_frame_type
+                           *stack;          /* open lists               */
+    uint                    stack_cap;      /* frames allocated         */
+
+    type_error_t8           error;          /* first error              */
+    uint                    error_offset;   /* offset of the error      */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+type_error_t8 init_type_info
+(
+    struct type_info_type  *ti      /* results to initialize    */
+);
+
+type_error_t8 check_types
+(
+    struct type_info_type  *ti,     /* results                  */
+    const struct ast_type  *ast     /* tree to check            */
+);
+
+uint find_binding
+(
+    const struct type_info_type
+                           *ti,     /* results                  */
+    const char             *name,   /* name to find             */
+    uint                    len     /* length of the name       */
+);
+
+type_error_t8 add_binding
+(
+    struct type_info_type  *ti,     /* results                  */
+    const char             *name,   /* variable's name          */
+    uint                    len,    /* length of the name       */
+    type_class_t8           type,   /* declared type            */
+    uint                   *binding /* its binding              */
+);
+
+void free_type_info
+(
+    struct type_info_type  *ti      /* results to free          */
+);
+
+const char *type_error_str
+(
+    type_error_t8           error   /* error code               */
+);
+
+#endif /* __TYPECHECK_H__ */
@@ -0,0 +1,1835 @@
+/**************************************************
+*
+*   MODULE NAME:
+*       vm.c
+*
+*   DESCRIPTION:
+*       Runs programs in-process, so they need
+*       no Gforth. The whole program is checked
+*       and lowered to bytecode by bytecode.c
+*       first, as it would be compiled before
+*       Gforth ran any of it, then interpreted.
+*
+*       The interpreter is a stack machine
+*       with Gforth's data and float stacks
+*       and Gforth's semantics: ints are cells
+*       that wrap around, "/" and "%" floor,
+*       flags are -1 and 0, a string is an
+*       address and a length, and output is
+*       formatted as ".", "f.", "type" and the
+*       prelude's ".bool" format it. Strings
+*       that are joined are never freed, as
+*       Gforth's "allocate" in s+ never frees
+*       them, but they go with the run. As the
+*       prelude's s+ does, a join onto the end
+*       of the last string joined is made in
+*       place, so building a string piece by
+*       piece takes linear time and memory.
+*
+*       With GCC the code is direct-threaded:
+*       before running, each opcode is replaced
+*       by the address of its handler, and each
+*       handler jumps straight to the next.
+*       Otherwise it is a switch in a loop.
+*
+*       A loop taken often enough is compiled
+*       to machine code by jit.c, and run from
+*       its branch back. The stacks' tops are
+*       put in memory for it, a slot past the
+*       deepest each stack goes, and taken
+*       back out where it leaves off.
+*
+*       A program lowered to be profiled
+*       counts and times each statement it
+*       runs, with the monotonic clock, for
+*       profile.c to report.
+*
+*       The top of each stack is cached in a
+*       local, which the compiler keeps in a
+*       register, so most handlers touch only
+*       one stack slot in memory, or none. The
+*       program is lowered with the stack depth
+*       known at every opcode, so the cache is
+*       always full and no handler has to check
+*       it: the slot under an empty stack is a
+*       spare.
+*
+**************************************************/
+
+/*-------------------------------------------------
+                PROJECT INCLUDES
+-------------------------------------------------*/
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "ast.h"
+#include "bytecode.h"
+#include "compiler.h"
+#include "eval.h"
+#include "fold.h"
+#include "jit.h"
+#include "parser.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "stats.h"
+#include "typecheck.h"
+#include "types.h"
+#include "vm.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define __INT_MIN       ( (sint64)( (uint64)1 << 63 ) )
+                                        /* most negative cell       */
+#define __MAX_INT_LEN   24              /* "-9223372036854775808 \n" */
+#define __MAX_REAL_LEN  400             /* f. of the widest double  */
+#define __MIN_JOIN      16              /* least room made by s+    */
+
+#if defined( __GNUC__ )
+#define __THREADED                      /* labels as values?        */
+#endif
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+Buffered output
+-------------------------------------*/
+struct __vm_out_type
+{
+    int                 fd;             /* file or pipe written to  */
+    char               *buf;            /* output not yet written   */
+    uint                len;            /* bytes of it              */
+    uint64              bytes;          /* bytes written            */
+};
+
+/*-------------------------------------
+Strings made by s+. The last one made
+has room after it, twice its length,
+and a join onto its end fills that
+room in place instead of copying it:
+no string ever points past its own
+end, so the bytes there are unused. A
+chain of joins onto one string, as
+[:= s [+ s x]] in a loop makes, then
+copies each byte a constant number of
+times on average.
+-------------------------------------*/
+struct __vm_strings_type
+{
+    struct arena_type   arena;          /* every string made        */
+    char               *end;            /* end of the last one      */
+    size_t              room;           /* bytes free after it      */
+};
+
+/*-------------------------------------
+A threaded code word: a handler's
+address where the opcode was, or an
+operand
+-------------------------------------*/
+#if defined( __THREADED )
+union __vm_word_type
+{
+    const void         *label;          /* handler                  */
+    size_t              k;              /* operand                  */
+};
+#endif
+
+/*-------------------------------------
+State of one run, shared by the
+batches of forms as they are lowered
+-------------------------------------*/
+struct __runner_type
+{
+    const struct compile_options_type
+                           *opts;       /* options                  */
+    struct type_info_type   ti;         /* types and bindings       */
+    struct bc_program_type  prog;       /* lowered program          */
+    uint                    num_folded; /* lists folded             */
+};
+
+/*-------------------------------------------------
+                        MACROS
+-------------------------------------------------*/
+
+/**************************************************
+*
+*   FUNCTION:
+*       __flag - "Flag"
+*
+*   DESCRIPTION:
+*       Turns a C condition into a Forth flag.
+*
+**************************************************/
+#define __flag( c ) ( (c) ? (sint64)-1 : (sint64)0 )
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __OP, __NEXT, __ARG, __JUMP, __PC,
+*       __HERE, __SKIP - "Dispatch"
+*
+*   DESCRIPTION:
+*       Start a handler, go to the next one,
+*       take an operand, branch to a code
+*       index, give the code index of the
+*       handler's own opcode or of the next
+*       one, and skip a word, either as
+*       threaded code or as a switch. __BEGIN
+*       and __END go around the handlers.
+*
+**************************************************/
+#if defined( __THREADED )
+#define __OP( op )      __L_##op:
+#define __NEXT()        goto *( ip++ )->label
+#define __ARG()         ( (uint)( ip++ )->k )
+#define __JUMP( k )     ip = &words[ k ]
+#define __PC()          ( (uint)( ip - words ) - 1u )
+#define __HERE()        ( (uint)( ip - words ) )
+#define __BEGIN()       __NEXT();
+#define __END()
+#else
+#define __OP( op )      case op:
+#define __NEXT()        continue
+#define __ARG()         ( code[ ip++ ] )
+#define __JUMP( k )     ip = ( k )
+#define __PC()          ( ip - 1u )
+#define __HERE()        ( ip )
+#define __BEGIN()       for( ;; ) switch( code[ ip++ ] ) {
+#define __END()         default: goto done; }
+#endif
+
+#define __SKIP()        ( ++ip )
+
+/*-------------------------------------------------
+              FUNCTION PROTOTYPES
+-------------------------------------------------*/
+
+static boolean __flush
+(
+    struct __vm_out_type   *out     /* output                   */
+);
+
+static boolean __put
+(
+    struct __vm_out_type   *out,    /* output                   */
+    const char             *str,    /* text                     */
+    size_t                  len     /* its length               */
+);
+
+static boolean __print_int
+(
+    struct __vm_out_type   *out,    /* output                   */
+    sint64                  n       /* value                    */
+);
+
+static boolean __print_real
+(
+    struct __vm_out_type   *out,    /* output                   */
+    double                  r       /* value                    */
+);
+
+static int __compare
+(
+    sint64                  a1,     /* first string             */
+    sint64                  u1,     /* its length               */
+    sint64                  a2,     /* second string            */
+    sint64                  u2      /* its length               */
+);
+
+static char *__join
+(
+    struct __vm_strings_type
+                           *strings,/* joined strings           */
+    sint64                  a1,     /* first string             */
+    sint64                  u1,     /* its length               */
+    sint64                  a2,     /* second string            */
+    sint64                  u2      /* its length               */
+);
+
+static sint64 __floor_divide
+(
+    sint64                  x,      /* dividend                 */
+    sint64                  y,      /* divisor, not 0           */
+    boolean                 mod     /* remainder, not quotient? */
+);
+
+static uint64 __now
+(
+    void
+);
+
+static void __count_runs
+(
+    const struct bc_program_type
+                           *prog,   /* ended program            */
+    uint                   *runs    /* opcodes run from each    */
+                                    /*  code index              */
+);
+
+static boolean __lower_batch
+(
+    void                   *user,   /* runner                   */
+    struct ast_type        *forms   /* batch of forms           */
+);
+
+/*-------------------------------------------------
+                    PROCEDURES
+-------------------------------------------------*/
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __flush - "Flush"
+*
+*   DESCRIPTION:
+*       Writes out the buffered output,
+*       retrying partial writes and
+*       interrupted calls.
+*
+*   RETURNS:
+*       Returns FALSE if it couldn't be
+*       written.
+*
+**************************************************/
+static boolean __flush
+(
+    struct __vm_out_type   *out     /* output                   */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    ssize_t     written;        /* bytes written by a call  */
+    uint        done;           /* bytes written so far     */
+
+    done = 0;
+    while( done < out->len )
+    {
+        written = write( out->fd, &out->buf[ done ], out->len - done );
+        if( written < 0 )
+        {
+            if( EINTR == errno )
+            {
+                continue;
+            }
+            return( FALSE );
+        }
+        done       += (uint)written;
+        out->bytes += (uint64)written;
+    }
+    out->len = 0;
+
+    return( TRUE );
+
+}   /* __flush() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __put - "Put"
+*
+*   DESCRIPTION:
+*       Appends text to the output, flushing
+*       whenever the buffer fills.
+*
+*   RETURNS:
+*       Returns FALSE if a flush failed.
+*
+**************************************************/
+static boolean __put
+(
+    struct __vm_out_type   *out,    /* output                   */
+    const char             *str,    /* text                     */
+    size_t                  len     /* its length               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    size_t      n;              /* bytes that fit           */
+
+    while( len > 0 )
+    {
+        if( VM_OUT_SIZE == out->len )
+        {
+            if( !__flush( out ) )
+            {
+                return( FALSE );
+            }
+        }
+
+        n = VM_OUT_SIZE - out->len;
+        n = ( len < n ) ? len : n;
+        memcpy( &out->buf[ out->len ], str, n );
+        out->len += (uint)n;
+        str      += n;
+        len      -= n;
+    }
+
+    return( TRUE );
+
+}   /* __put() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __print_int - "Print Int"
+*
+*   DESCRIPTION:
+*       Prints an int as ". cr" does: signed
+*       decimal, a space and a line break.
+*
+*   RETURNS:
+*       Returns FALSE if a flush failed.
+*
+**************************************************/
+static boolean __print_int
+(
+    struct __vm_out_type   *out,    /* output                   */
+    sint64                  n       /* value                    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char        buf[ __MAX_INT_LEN ];   /* formatted value      */
+    char       *p;                      /* digit being written  */
+    uint64      mag;                    /* magnitude            */
+
+    p      = &buf[ sizeof( buf ) ];
+    *--p   = '\n';
+    *--p   = ' ';
+    mag    = ( n < 0 ) ? 0 - (uint64)n : (uint64)n;
+    do
+    {
+        *--p = (char)( '0' + mag % 10 );
+        mag /= 10;
+    } while( 0 != mag );
+
+    if( n < 0 )
+    {
+        *--p = '-';
+    }
+
+    return( __put( out, p, (size_t)( &buf[ sizeof( buf ) ] - p ) ) );
+
+}   /* __print_int() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __print_real - "Print Real"
+*
+*   DESCRIPTION:
+*       Prints a real as "f. cr" does: the
+*       value rounded to VM_PRECISION
+*       significant digits, in positional
+*       notation however large or small, with
+*       trailing zeros after the point dropped
+*       and a space after it. An infinity is
+*       "inf " or "-inf " and a NaN "nan ",
+*       with the same space.
+*
+*   RETURNS:
+*       Returns FALSE if a flush failed.
+*
+*   NOTES:
+*       * Follows Gforth's f., which lays out
+*         the digits and exponent REPRESENT
+*         gives it. printf's %e rounds the same
+*         way.
+*
+**************************************************/
+static boolean __print_real
+(
+    struct __vm_out_type   *out,    /* output                   */
+    double                  r       /* value                    */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char        sci[ 32 ];                  /* %e of the value      */
+    char        digits[ VM_PRECISION ];     /* significant digits   */
+    char        buf[ __MAX_REAL_LEN ];      /* formatted value      */
+    const char *p;                          /* read position        */
+    uint        len;                        /* bytes of buf in use  */
+    uint        last;                       /* past the last digit  */
+                                            /*  that isn't zero     */
+    int         exp;                        /* digits before point  */
+    int         i;                          /* digit index          */
+
+    if( isnan( r ) )
+    {
+        return( __put( out, "nan \n", 5 ) );
+    }
+    if( isinf( r ) )
+    {
+        return( ( r < 0 ) ? __put( out, "-inf \n", 6 ) : __put( out, "inf \n", 5 ) );
+    }
+
+    snprintf( sci, sizeof( sci ), "%.*e", VM_PRECISION - 1, r );
+    p   = sci;
+    len = 0;
+    if( '-' == *p )
+    {
+        buf[ len++ ] = '-';
+        ++p;
+    }
+
+    digits[ 0 ] = *p;
+    p += 2;
+    for( i = 1; i < VM_PRECISION; ++i )
+    {
+        digits[ i ] = *p++;
+    }
+    exp = atoi( p + 1 ) + 1;
+
+    /*---------------------------------
+    Digits before the point, padded
+    with zeros past the precision
+    ---------------------------------*/
+    if( exp <= 0 )
+    {
+        buf[ len++ ] = '0';
+    }
+    for( i = 0; i < exp; ++i )
+    {
+        buf[ len++ ] = ( i < VM_PRECISION ) ? digits[ i ] : '0';
+    }
+    buf[ len++ ] = '.';
+
+    /*---------------------------------
+    Then zeros and digits after it
+    ---------------------------------*/
+    for( i = exp; i < 0; ++i )
+    {
+        buf[ len++ ] = '0';
+    }
+    last = VM_PRECISION;
+    while( ( last > 0 )
+        && ( '0' == digits[ last - 1 ] ) )
+    {
+        --last;
+    }
+    for( i = ( exp > 0 ) ? exp : 0; i < (int)last; ++i )
+    {
+        buf[ len++ ] = digits[ i ];
+    }
+    buf[ len++ ] = ' ';
+    buf[ len++ ] = '\n';
+
+    return( __put( out, buf, len ) );
+
+}   /* __print_real() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __compare - "Compare"
+*
+*   DESCRIPTION:
+*       Compares two strings as Forth's compare
+*       does: byte by byte, unsigned, and then
+*       by length.
+*
+*   RETURNS:
+*       Returns -1, 0 or 1.
+*
+**************************************************/
+static int __compare
+(
+    sint64                  a1,     /* first string             */
+    sint64                  u1,     /* its length               */
+    sint64                  a2,     /* second string            */
+    sint64                  u2      /* its length               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    int         c;              /* result of memcmp()       */
+
+    c = memcmp( (const void *)(size_t)a1, (const void *)(size_t)a2, (size_t)( ( u1 < u2 ) ? u1 : u2 ) );
+    if( 0 != c )
+    {
+        return( ( c < 0 ) ? -1 : 1 );
+    }
+
+    return( ( u1 < u2 ) ? -1 : ( u1 > u2 ) ? 1 : 0 );
+
+}   /* __compare() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __join - "Join"
+*
+*   DESCRIPTION:
+*       Joins two strings as s+ does, into a
+*       string of the run's own. The first is
+*       extended in place if it is the last
+*       string joined and has room; otherwise
+*       both are copied into a new string with
+*       room for more.
+*
+*   RETURNS:
+*       Returns the joined string, or NULL if
+*       out of memory.
+*
+**************************************************/
+static char *__join
+(
+    struct __vm_strings_type
+                           *strings,/* joined strings           */
+    sint64                  a1,     /* first string             */
+    sint64                  u1,     /* its length               */
+    sint64                  a2,     /* second string            */
+    sint64                  u2      /* its length               */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    char       *joined;         /* joined string            */
+    size_t      size;           /* bytes of a new string    */
+
+    if( ( NULL != strings->end )
+     && ( (size_t)( a1 + u1 ) == (size_t)strings->end )
+     && ( (size_t)u2 <= strings->room ) )
+    {
+        joined = (char *)(size_t)a1;
+    }
+    else
+    {
+        size = 2 * (size_t)( u1 + u2 );
+        if( size < __MIN_JOIN )
+        {
+            size = __MIN_JOIN;
+        }
+
+        joined = (char *)arena_alloc( &strings->arena, size );
+        if( NULL == joined )
+        {
+            return( NULL );
+        }
+
+        memcpy( joined, (const void *)(size_t)a1, (size_t)u1 );
+        strings->end  = &joined[ u1 ];
+        strings->room = size - (size_t)u1;
+    }
+
+    memcpy( strings->end, (const void *)(size_t)a2, (size_t)u2 );
+    strings->end  += u2;
+    strings->room -= (size_t)u2;
+
+    return( joined );
+
+}   /* __join() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __floor_divide - "Floor Divide"
+*
+*   DESCRIPTION:
+*       Divides as fm/mod does: the quotient
+*       rounds down, and the remainder takes
+*       the sign of the divisor. The quotient
+*       must fit in a cell.
+*
+*   RETURNS:
+*       Returns the quotient or the remainder.
+*
+**************************************************/
+static sint64 __floor_divide
+(
+    sint64                  x,      /* dividend                 */
+    sint64                  y,      /* divisor, not 0           */
+    boolean                 mod     /* remainder, not quotient? */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    sint64      quot;           /* truncated quotient       */
+    sint64      rem;            /* its remainder            */
+
+    quot = x / y;
+    rem  = x % y;
+    if( ( 0 != rem )
+     && ( ( rem < 0 ) != ( y < 0 ) ) )
+    {
+        quot -= 1;
+        rem  += y;
+    }
+
+    return( mod ? rem : quot );
+
+}   /* __floor_divide() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __now - "Now"
+*
+*   DESCRIPTION:
+*       Reads the monotonic clock, for timing
+*       profiled lists.
+*
+*   RETURNS:
+*       Returns the time in nanoseconds.
+*
+**************************************************/
+static uint64 __now
+(
+    void
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct timespec     ts;     /* clock reading            */
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( (uint64)ts.tv_sec * 1000000000u + (uint64)ts.tv_nsec );
+
+}   /* __now() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __count_runs - "Count Runs"
+*
+*   DESCRIPTION:
+*       Counts, for each opcode, the opcodes
+*       that run from it to the next branch or
+*       the end, that one included. Once
+*       control reaches an opcode it runs them
+*       all, so the interpreter counts its
+*       dispatches a run at a time, only as it
+*       branches, instead of one by one.
+*
+**************************************************/
+static void __count_runs
+(
+    const struct bc_program_type
+                           *prog,   /* ended program            */
+    uint                   *runs    /* opcodes run from each    */
+                                    /*  code index              */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    const uint *code;           /* opcodes and operands     */
+    uint        count;          /* opcodes to the branch    */
+    uint        pc;             /* code index               */
+
+    code = prog->code;
+    memset( runs, 0, ( prog->len + 1 ) * sizeof( *runs ) );
+    for( pc = 0; pc < prog->len; pc += bc_op_length( (bc_op_t8)code[ pc ] ) )
+    {
+        runs[ pc ] = 1;
+    }
+
+    /*---------------------------------
+    Operand words stay 0
+    ---------------------------------*/
+    count = 0;
+    for( pc = prog->len; pc-- > 0; )
+    {
+        if( 0 == runs[ pc ] )
+        {
+            continue;
+        }
+
+        switch( code[ pc ] )
+        {
+            case BC_HALT:
+            case BC_BRANCH:
+            case BC_ZBRANCH:
+            case BC_EQ_ZBRANCH:
+            case BC_LT_ZBRANCH:
+            case BC_GT_ZBRANCH:
+            case BC_LE_ZBRANCH:
+            case BC_GE_ZBRANCH:
+            case BC_NE_ZBRANCH:
+                count = 1;
+                break;
+
+            default:
+                ++count;
+                break;
+        }
+        runs[ pc ] = count;
+    }
+
+}   /* __count_runs() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       __lower_batch - "Lower Batch"
+*
+*   DESCRIPTION:
+*       The pipeline's sink: checks, folds and
+*       lowers a batch of forms.
+*
+*   RETURNS:
+*       Returns FALSE to stop at the first
+*       error.
+*
+**************************************************/
+static boolean __lower_batch
+(
+    void                   *user,   /* runner                   */
+    struct ast_type        *forms   /* batch of forms           */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __runner_type   *r;      /* runner                   */
+    struct stats_clock_type clock;  /* times a phase            */
+    boolean                 ok;     /* checked?                 */
+
+    r = (struct __runner_type *)user;
+    stats_start( r->opts->stats, STATS_CHECK, &clock );
+    ok = ( TYPE_NO_ERROR == check_types( &r->ti, forms ) );
+    stats_stop( r->opts->stats, STATS_CHECK, &clock );
+    if( !ok )
+    {
+        return( FALSE );
+    }
+
+    if( r->opts->fold )
+    {
+        stats_start( r->opts->stats, STATS_OPTIMIZE, &clock );
+        r->num_folded += fold_constants( forms, &r->ti );
+        stats_stop( r->opts->stats, STATS_OPTIMIZE, &clock );
+    }
+
+    stats_start( r->opts->stats, STATS_LOWER, &clock );
+    ok = ( BC_NO_ERROR == lower_forms( &r->prog, forms, &r->ti ) );
+    stats_stop( r->opts->stats, STATS_LOWER, &clock );
+
+    return( ok );
+
+}   /* __lower_batch() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       run_program - "Run Program"
+*
+*   DESCRIPTION:
+*       Runs a lowered program, writing what it
+*       prints to a file or pipe. Stacks and
+*       variables are sized once, from the
+*       program.
+*
+*   ERRORS:
+*       * Sets VM_DIVIDE_BY_ZERO or
+*         VM_OUT_OF_RANGE, with the offset of
+*         the list that failed, and stops. What
+*         was printed before is written.
+*       * Sets VM_NO_MEMORY or VM_WRITE_ERROR
+*         otherwise.
+*
+*   NOTES:
+*       * dispatches counts the opcodes run, a
+*         superinstruction being one. A run
+*         that stops on an error counts the
+*         rest of the opcodes up to its next
+*         branch too. Opcodes run as machine
+*         code aren't counted.
+*       * A loop is compiled once it has been
+*         taken jit_trips times, or never if
+*         jit_trips is 0 or the program is
+*         profiled, so its profile is of the
+*         interpreter.
+*       * A profiled list's count and time are
+*         added to as it runs.
+*
+**************************************************/
+void run_program
+(
+    const struct bc_program_type
+                           *prog,   /* ended program            */
+    uint                    jit_trips,
+                                    /* trips before a loop is   */
+                                    /*  compiled, 0 for never   */
+    int                     fd,     /* file or pipe to write    */
+    struct vm_result_type  *result  /* outcome                  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+#if defined( __THREADED )
+    static const void * const labels[ BC_NUM_OPS ] =
+    {
+        &&__L_BC_HALT,      &&__L_BC_LIT,       &&__L_BC_FLIT,      &&__L_BC_SLIT,
+        &&__L_BC_FETCH,     &&__L_BC_FFETCH,    &&__L_BC_SFETCH,    &&__L_BC_STORE,
+        &&__L_BC_FSTORE,    &&__L_BC_SSTORE,    &&__L_BC_ADD,       &&__L_BC_SUB,
+        &&__L_BC_MUL,       &&__L_BC_DIV,       &&__L_BC_MOD,       &&__L_BC_AND,
+        &&__L_BC_OR,        &&__L_BC_LSHIFT,    &&__L_BC_ARSHIFT,   &&__L_BC_POW,
+        &&__L_BC_EQ,        &&__L_BC_LT,        &&__L_BC_GT,        &&__L_BC_LE,
+        &&__L_BC_GE,        &&__L_BC_NE,        &&__L_BC_FADD,      &&__L_BC_FSUB,
+        &&__L_BC_FMUL,      &&__L_BC_FDIV,      &&__L_BC_FPOW,      &&__L_BC_FEQ,
+        &&__L_BC_FLT,       &&__L_BC_FGT,       &&__L_BC_FLE,       &&__L_BC_FGE,
+        &&__L_BC_FNE,       &&__L_BC_SCAT,      &&__L_BC_SEQ,       &&__L_BC_SLT,
+        &&__L_BC_SGT,       &&__L_BC_SLE,       &&__L_BC_SGE,       &&__L_BC_SNE,
+        &&__L_BC_NOT,       &&__L_BC_NEGATE,    &&__L_BC_FNEGATE,   &&__L_BC_FSIN,
+        &&__L_BC_FCOS,      &&__L_BC_FTAN,      &&__L_BC_TO_REAL,   &&__L_BC_DROP,
+        &&__L_BC_FDROP,     &&__L_BC_SDROP,     &&__L_BC_DUP,       &&__L_BC_FDUP,
+        &&__L_BC_PRINT,     &&__L_BC_FPRINT,    &&__L_BC_SPRINT,    &&__L_BC_BPRINT,
+        &&__L_BC_PROF_ENTER,&&__L_BC_PROF_EXIT, &&__L_BC_BRANCH,    &&__L_BC_ZBRANCH,
+        &&__L_BC_LIT_ADD,   &&__L_BC_LIT_SUB,   &&__L_BC_LIT_MUL,   &&__L_BC_LIT_DIV,
+        &&__L_BC_LIT_MOD,   &&__L_BC_LIT_AND,   &&__L_BC_LIT_LSHIFT,&&__L_BC_LIT_ARSHIFT,
+        &&__L_BC_LIT_EQ,    &&__L_BC_LIT_LT,    &&__L_BC_LIT_GT,    &&__L_BC_LIT_LE,
+        &&__L_BC_LIT_GE,    &&__L_BC_LIT_NE,    &&__L_BC_FETCH_ADD, &&__L_BC_FETCH_SUB,
+        &&__L_BC_FETCH_MUL, &&__L_BC_FETCH_LIT, &&__L_BC_ADD_STORE, &&__L_BC_SUB_STORE,
+        &&__L_BC_EQ_ZBRANCH,&&__L_BC_LT_ZBRANCH,&&__L_BC_GT_ZBRANCH,&&__L_BC_LE_ZBRANCH,
+        &&__L_BC_GE_ZBRANCH,&&__L_BC_NE_ZBRANCH,&&__L_BC_SLIT_SCAT, &&__L_BC_SFETCH_SCAT
+    };                                      /* handler of each opcode   */
+    union __vm_word_type       *words;      /* threaded code            */
+    const union __vm_word_type *ip;         /* next word                */
+    uint                        n;          /* words of an instruction  */
+    uint                        j;          /* operand index            */
+#else
+    const uint                 *code;       /* bytecode                 */
+    uint                        ip;         /* next word                */
+#endif
+    struct __vm_out_type        out;        /* buffered output          */
+    struct __vm_strings_type    strings;    /* joined strings           */
+    union bc_var_type          *vars;       /* variables                */
+    union bc_var_type          *v;          /* variable in use          */
+    sint64                     *stack;      /* data stack               */
+    double                     *fstack;     /* real stack               */
+    sint64                     *sp;         /* under the data stack top */
+    double                     *fp;         /* under the real stack top */
+    sint64                      tos;        /* top of the data stack    */
+    double                      ftos;       /* top of the real stack    */
+    char                       *joined;     /* string made by s+        */
+    sint64                      x;          /* left int operand         */
+    sint64                      y;          /* right int operand        */
+    double                      f;          /* real printed             */
+    struct jit_type             jit;        /* compiled loops           */
+    struct jit_state_type       state;      /* stacks for a loop        */
+    jit_func                    loop;       /* compiled loop            */
+    uint                       *runs;       /* opcodes run from each    */
+                                            /*  code index              */
+    uint64                     *starts;     /* when each profiled list  */
+                                            /*  last started            */
+    uint64                      dispatches; /* opcodes run              */
+    uint                        i;          /* code index               */
+
+    memset( result, 0, sizeof( *result ) );
+    memset( &out, 0, sizeof( out ) );
+    memset( &jit, 0, sizeof( jit ) );
+    dispatches = 0;
+    memset( &strings, 0, sizeof( strings ) );
+    init_arena( &strings.arena );
+    out.fd = fd;
+    out.buf = (char *)stats_malloc( VM_OUT_SIZE );
+    vars    = (union bc_var_type *)stats_calloc( prog->num_vars, sizeof( *vars ) );
+    stack   = (sint64 *)stats_malloc( ( prog->max_depth + 2 ) * sizeof( *stack ) );
+    fstack  = (double *)stats_malloc( ( prog->max_fdepth + 2 ) * sizeof( *fstack ) );
+    runs    = (uint *)stats_malloc( ( prog->len + 1 ) * sizeof( *runs ) );
+    starts  = (uint64 *)stats_malloc( ( prog->num_profs + 1 ) * sizeof( *starts ) );
+#if defined( __THREADED )
+    words   = (union __vm_word_type *)stats_malloc( ( prog->len + 1 ) * sizeof( *words ) );
+#endif
+
+#if defined( __THREADED )
+    if( ( NULL == out.buf ) || ( NULL == vars ) || ( NULL == stack ) || ( NULL == fstack ) || ( NULL == runs ) || ( NULL == starts ) || ( NULL == words ) )
+#else
+    if( ( NULL == out.buf ) || ( NULL == vars ) || ( NULL == stack ) || ( NULL == fstack ) || ( NULL == runs ) || ( NULL == starts ) )
+#endif
+    {
+        result->error = VM_NO_MEMORY;
+        goto done;
+    }
+
+    /*---------------------------------
+    Thread the code
+    ---------------------------------*/
+#if defined( __THREADED )
+    for( i = 0; i < prog->len; i += n )
+    {
+        n                = bc_op_length( (bc_op_t8)prog->code[ i ] );
+        words[ i ].label = labels[ prog->code[ i ] ];
+        for( j = 1; j < n; ++j )
+        {
+            words[ i + j ].k = prog->code[ i + j ];
+        }
+    }
+    words[ prog->len ].label = labels[ BC_HALT ];
+    ip = words;
+#else
+    code = prog->code;
+    ip   = 0;
+#endif
+
+    if( JIT_NO_ERROR != init_jit( &jit, prog, ( 0 == prog->num_profs ) ? jit_trips : 0 ) )
+    {
+        result->error = VM_NO_MEMORY;
+        goto done;
+    }
+    state.vars = vars;
+
+    __count_runs( prog, runs );
+    dispatches = runs[ 0 ];
+    sp         = stack;
+    fp         = fstack;
+    tos        = 0;
+    ftos       = 0.0;
+    __BEGIN()
+
+    /*---------------------------------
+    Constants and variables
+    ---------------------------------*/
+    __OP( BC_LIT )
+        *++sp = tos;
+        tos   = prog->ints[ __ARG() ];
+        __NEXT();
+
+    __OP( BC_FLIT )
+        *++fp = ftos;
+        ftos  = prog->reals[ __ARG() ];
+        __NEXT();
+
+    __OP( BC_SLIT )
+        i = __ARG();
+        sp[ 1 ] = tos;
+        sp[ 2 ] = (sint64)(size_t)prog->strings[ i ].str;
+        sp     += 2;
+        tos     = prog->strings[ i ].len;
+        __NEXT();
+
+    __OP( BC_FETCH )
+        *++sp = tos;
+        tos   = vars[ __ARG() ].cell;
+        __NEXT();
+
+    __OP( BC_FFETCH )
+        *++fp = ftos;
+        ftos  = vars[ __ARG() ].real;
+        __NEXT();
+
+    __OP( BC_SFETCH )
+        v = &vars[ __ARG() ];
+        sp[ 1 ] = tos;
+        sp[ 2 ] = v->str[ 0 ];
+        sp     += 2;
+        tos     = v->str[ 1 ];
+        __NEXT();
+
+    __OP( BC_STORE )
+        vars[ __ARG() ].cell = tos;
+        tos = *sp--;
+        __NEXT();
+
+    __OP( BC_FSTORE )
+        vars[ __ARG() ].real = ftos;
+        ftos = *fp--;
+        __NEXT();
+
+    __OP( BC_SSTORE )
+        v = &vars[ __ARG() ];
+        v->str[ 0 ] = sp[ 0 ];
+        v->str[ 1 ] = tos;
+        tos = sp[ -1 ];
+        sp -= 2;
+        __NEXT();
+
+    /*---------------------------------
+    Ints and flags
+    ---------------------------------*/
+    __OP( BC_ADD )
+        tos = (sint64)( (uint64)*sp-- + (uint64)tos );
+        __NEXT();
+
+    __OP( BC_SUB )
+        tos = (sint64)( (uint64)*sp-- - (uint64)tos );
+        __NEXT();
+
+    __OP( BC_MUL )
+        tos = (sint64)( (uint64)*sp-- * (uint64)tos );
+        __NEXT();
+
+    __OP( BC_DIV )
+    __OP( BC_MOD )
+        x = *sp;
+        if( ( 0 == tos )
+         || ( ( __INT_MIN == x ) && ( -1 == tos ) ) )
+        {
+            result->error        = ( 0 == tos ) ? VM_DIVIDE_BY_ZERO : VM_OUT_OF_RANGE;
+            result->error_offset = bc_find_site( prog, __PC() );
+            goto done;
+        }
+
+        tos = __floor_divide( x, tos, BC_MOD == prog->code[ __PC() ] );
+        --sp;
+        __NEXT();
+
+    __OP( BC_AND )
+        tos &= *sp--;
+        __NEXT();
+
+    __OP( BC_OR )
+        tos |= *sp--;
+        __NEXT();
+
+    __OP( BC_LSHIFT )
+        tos = (sint64)( (uint64)*sp-- << tos );
+        __NEXT();
+
+    __OP( BC_ARSHIFT )
+        tos = *sp-- >> tos;
+        __NEXT();
+
+    __OP( BC_POW )
+        x   = *sp--;
+        tos = eval_int_pow( x, tos );
+        __NEXT();
+
+    __OP( BC_EQ )
+        tos = __flag( *sp-- == tos );
+        __NEXT();
+
+    __OP( BC_LT )
+        tos = __flag( *sp-- < tos );
+        __NEXT();
+
+    __OP( BC_GT )
+        tos = __flag( *sp-- > tos );
+        __NEXT();
+
+    __OP( BC_LE )
+        tos = __flag( *sp-- <= tos );
+        __NEXT();
+
+    __OP( BC_GE )
+        tos = __flag( *sp-- >= tos );
+        __NEXT();
+
+    __OP( BC_NE )
+        tos = __flag( *sp-- != tos );
+        __NEXT();
+
+    __OP( BC_NOT )
+        tos = __flag( 0 == tos );
+        __NEXT();
+
+    __OP( BC_NEGATE )
+        tos = (sint64)( 0 - (uint64)tos );
+        __NEXT();
+
+    /*---------------------------------
+    Reals
+    ---------------------------------*/
+    __OP( BC_FADD )
+        ftos = *fp-- + ftos;
+        __NEXT();
+
+    __OP( BC_FSUB )
+        ftos = *fp-- - ftos;
+        __NEXT();
+
+    __OP( BC_FMUL )
+        ftos = *fp-- * ftos;
+        __NEXT();
+
+    __OP( BC_FDIV )
+        ftos = *fp-- / ftos;
+        __NEXT();
+
+    __OP( BC_FPOW )
+        ftos = pow( *fp, ftos );
+        --fp;
+        __NEXT();
+
+    __OP( BC_FEQ )
+        *++sp = tos;
+        tos   = __flag( *fp == ftos );
+        ftos  = fp[ -1 ];
+        fp   -= 2;
+        __NEXT();
+
+    __OP( BC_FLT )
+        *++sp = tos;
+        tos   = __flag( *fp < ftos );
+        ftos  = fp[ -1 ];
+        fp   -= 2;
+        __NEXT();
+
+    __OP( BC_FGT )
+        *++sp = tos;
+        tos   = __flag( *fp > ftos );
+        ftos  = fp[ -1 ];
+        fp   -= 2;
+        __NEXT();
+
+    __OP( BC_FLE )
+        *++sp = tos;
+        tos   = __flag( *fp <= ftos );
+        ftos  = fp[ -1 ];
+        fp   -= 2;
+        __NEXT();
+
+    __OP( BC_FGE )
+        *++sp = tos;
+        tos   = __flag( *fp >= ftos );
+        ftos  = fp[ -1 ];
+        fp   -= 2;
+        __NEXT();
+
+    __OP( BC_FNE )
+        *++sp = tos;
+        tos   = __flag( *fp != ftos );
+        ftos  = fp[ -1 ];
+        fp   -= 2;
+        __NEXT();
+
+    __OP( BC_FNEGATE )
+        ftos = -ftos;
+        __NEXT();
+
+    __OP( BC_FSIN )
+        ftos = sin( ftos );
+        __NEXT();
+
+    __OP( BC_FCOS )
+        ftos = cos( ftos );
+        __NEXT();
+
+    __OP( BC_FTAN )
+        ftos = tan( ftos );
+        __NEXT();
+
+    __OP( BC_TO_REAL )
+        *++fp = ftos;
+        ftos  = (double)tos;
+        tos   = *sp--;
+        __NEXT();
+
+    /*---------------------------------
+    Strings: ( a1 u1 a2 u2 -- ... )
+    ---------------------------------*/
+    __OP( BC_SCAT )
+        joined = __join( &strings, sp[ -2 ], sp[ -1 ], sp[ 0 ], tos );
+        if( NULL == joined )
+        {
+            goto no_memory;
+        }
+        sp[ -2 ] = (sint64)(size_t)joined;
+        tos     += sp[ -1 ];
+        sp      -= 2;
+        __NEXT();
+
+    __OP( BC_SEQ )
+        tos = __flag( 0 == __compare( sp[ -2 ], sp[ -1 ], sp[ 0 ], tos ) );
+        sp -= 3;
+        __NEXT();
+
+    __OP( BC_SLT )
+        tos = __flag( __compare( sp[ -2 ], sp[ -1 ], sp[ 0 ], tos ) < 0 );
+        sp -= 3;
+        __NEXT();
+
+    __OP( BC_SGT )
+        tos = __flag( __compare( sp[ -2 ], sp[ -1 ], sp[ 0 ], tos ) > 0 );
+        sp -= 3;
+        __NEXT();
+
+    __OP( BC_SLE )
+        tos = __flag( __compare( sp[ -2 ], sp[ -1 ], sp[ 0 ], tos ) <= 0 );
+        sp -= 3;
+        __NEXT();
+
+    __OP( BC_SGE )
+        tos = __flag( __compare( sp[ -2 ], sp[ -1 ], sp[ 0 ], tos ) >= 0 );
+        sp -= 3;
+        __NEXT();
+
+    __OP( BC_SNE )
+        tos = __flag( 0 != __compare( sp[ -2 ], sp[ -1 ], sp[ 0 ], tos ) );
+        sp -= 3;
+        __NEXT();
+
+    /*---------------------------------
+    Drops and dups
+    ---------------------------------*/
+    __OP( BC_DROP )
+        tos = *sp--;
+        __NEXT();
+
+    __OP( BC_FDROP )
+        ftos = *fp--;
+        __NEXT();
+
+    __OP( BC_SDROP )
+        tos = sp[ -1 ];
+        sp -= 2;
+        __NEXT();
+
+    __OP( BC_DUP )
+        *++sp = tos;
+        __NEXT();
+
+    __OP( BC_FDUP )
+        *++fp = ftos;
+        __NEXT();
+
+    /*---------------------------------
+    stdout
+    ---------------------------------*/
+    __OP( BC_PRINT )
+        x   = tos;
+        tos = *sp--;
+        if( !__print_int( &out, x ) )
+        {
+            goto write_error;
+        }
+        __NEXT();
+
+    __OP( BC_FPRINT )
+        f    = ftos;
+        ftos = *fp--;
+        if( !__print_real( &out, f ) )
+        {
+            goto write_error;
+        }
+        __NEXT();
+
+    __OP( BC_SPRINT )
+        if( !__put( &out, (const char *)(size_t)sp[ 0 ], (size_t)tos )
+         || !__put( &out, "\n", 1 ) )
+        {
+            goto write_error;
+        }
+        tos = sp[ -1 ];
+        sp -= 2;
+        __NEXT();
+
+    __OP( BC_BPRINT )
+        if( !__put( &out, ( 0 != tos ) ? "true \n" : "false \n", ( 0 != tos ) ? 6 : 7 ) )
+        {
+            goto write_error;
+        }
+        tos = *sp--;
+        __NEXT();
+
+    /*---------------------------------
+    Profiled lists
+    ---------------------------------*/
+    __OP( BC_PROF_ENTER )
+        i = __ARG();
+        ++prog->profs[ i ].count;
+        starts[ i ] = __now();
+        __NEXT();
+
+    __OP( BC_PROF_EXIT )
+        i = __ARG();
+        prog->profs[ i ].ns += __now() - starts[ i ];
+        __NEXT();
+
+    /*---------------------------------
+    if and while
+    ---------------------------------*/
+    __OP( BC_BRANCH )
+        i = __ARG();
+        if( ( i < __HERE() )
+         && ( 0 != jit.trips )
+         && ( NULL != ( loop = jit_find_loop( &jit, i, __HERE() ) ) ) )
+        {
+            *++sp    = tos;
+            *++fp    = ftos;
+            state.sp = sp;
+            state.fp = fp;
+            i        = loop( &state );
+            sp       = state.sp;
+            fp       = state.fp;
+            tos      = *sp--;
+            ftos     = *fp--;
+        }
+        __JUMP( i );
+        dispatches += runs[ i ];
+        __NEXT();
+
+    __OP( BC_ZBRANCH )
+        i   = __ARG();
+        x   = tos;
+        tos = *sp--;
+        if( 0 == x )
+        {
+            __JUMP( i );
+        }
+        dispatches += runs[ __HERE() ];
+        __NEXT();
+
+    /*---------------------------------
+    Superinstructions. Each takes its
+    first opcode's operand, then skips
+    the second opcode's word.
+    ---------------------------------*/
+    __OP( BC_LIT_ADD )
+        tos = (sint64)( (uint64)tos + (uint64)prog->ints[ __ARG() ] );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_SUB )
+        tos = (sint64)( (uint64)tos - (uint64)prog->ints[ __ARG() ] );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_MUL )
+        tos = (sint64)( (uint64)tos * (uint64)prog->ints[ __ARG() ] );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_DIV )
+        tos = __floor_divide( tos, prog->ints[ __ARG() ], FALSE );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_MOD )
+        tos = __floor_divide( tos, prog->ints[ __ARG() ], TRUE );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_AND )
+        tos &= prog->ints[ __ARG() ];
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_LSHIFT )
+        tos = (sint64)( (uint64)tos << prog->ints[ __ARG() ] );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_ARSHIFT )
+        tos >>= prog->ints[ __ARG() ];
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_EQ )
+        tos = __flag( tos == prog->ints[ __ARG() ] );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_LT )
+        tos = __flag( tos < prog->ints[ __ARG() ] );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_GT )
+        tos = __flag( tos > prog->ints[ __ARG() ] );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_LE )
+        tos = __flag( tos <= prog->ints[ __ARG() ] );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_GE )
+        tos = __flag( tos >= prog->ints[ __ARG() ] );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_LIT_NE )
+        tos = __flag( tos != prog->ints[ __ARG() ] );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_FETCH_ADD )
+        tos = (sint64)( (uint64)tos + (uint64)vars[ __ARG() ].cell );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_FETCH_SUB )
+        tos = (sint64)( (uint64)tos - (uint64)vars[ __ARG() ].cell );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_FETCH_MUL )
+        tos = (sint64)( (uint64)tos * (uint64)vars[ __ARG() ].cell );
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_FETCH_LIT )
+        sp[ 1 ] = tos;
+        sp[ 2 ] = vars[ __ARG() ].cell;
+        sp     += 2;
+        __SKIP();
+        tos     = prog->ints[ __ARG() ];
+        __NEXT();
+
+    __OP( BC_ADD_STORE )
+        __SKIP();
+        vars[ __ARG() ].cell = (sint64)( (uint64)sp[ 0 ] + (uint64)tos );
+        tos = sp[ -1 ];
+        sp -= 2;
+        __NEXT();
+
+    __OP( BC_SUB_STORE )
+        __SKIP();
+        vars[ __ARG() ].cell = (sint64)( (uint64)sp[ 0 ] - (uint64)tos );
+        tos = sp[ -1 ];
+        sp -= 2;
+        __NEXT();
+
+    __OP( BC_EQ_ZBRANCH )
+        __SKIP();
+        i   = __ARG();
+        x   = *sp;
+        y   = tos;
+        tos = sp[ -1 ];
+        sp -= 2;
+        if( x != y )
+        {
+            __JUMP( i );
+        }
+        dispatches += runs[ __HERE() ];
+        __NEXT();
+
+    __OP( BC_LT_ZBRANCH )
+        __SKIP();
+        i   = __ARG();
+        x   = *sp;
+        y   = tos;
+        tos = sp[ -1 ];
+        sp -= 2;
+        if( !( x < y ) )
+        {
+            __JUMP( i );
+        }
+        dispatches += runs[ __HERE() ];
+        __NEXT();
+
+    __OP( BC_GT_ZBRANCH )
+        __SKIP();
+        i   = __ARG();
+        x   = *sp;
+        y   = tos;
+        tos = sp[ -1 ];
+        sp -= 2;
+        if( !( x > y ) )
+        {
+            __JUMP( i );
+        }
+        dispatches += runs[ __HERE() ];
+        __NEXT();
+
+    __OP( BC_LE_ZBRANCH )
+        __SKIP();
+        i   = __ARG();
+        x   = *sp;
+        y   = tos;
+        tos = sp[ -1 ];
+        sp -= 2;
+        if( !( x <= y ) )
+        {
+            __JUMP( i );
+        }
+        dispatches += runs[ __HERE() ];
+        __NEXT();
+
+    __OP( BC_GE_ZBRANCH )
+        __SKIP();
+        i   = __ARG();
+        x   = *sp;
+        y   = tos;
+        tos = sp[ -1 ];
+        sp -= 2;
+        if( !( x >= y ) )
+        {
+            __JUMP( i );
+        }
+        dispatches += runs[ __HERE() ];
+        __NEXT();
+
+    __OP( BC_NE_ZBRANCH )
+        __SKIP();
+        i   = __ARG();
+        x   = *sp;
+        y   = tos;
+        tos = sp[ -1 ];
+        sp -= 2;
+        if( x == y )
+        {
+            __JUMP( i );
+        }
+        dispatches += runs[ __HERE() ];
+        __NEXT();
+
+    __OP( BC_SLIT_SCAT )
+        i      = __ARG();
+        joined = __join( &strings, *sp, tos, (sint64)(size_t)prog->strings[ i ].str, prog->strings[ i ].len );
+        if( NULL == joined )
+        {
+            goto no_memory;
+        }
+        *sp  = (sint64)(size_t)joined;
+        tos += prog->strings[ i ].len;
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_SFETCH_SCAT )
+        v      = &vars[ __ARG() ];
+        joined = __join( &strings, *sp, tos, v->str[ 0 ], v->str[ 1 ] );
+        if( NULL == joined )
+        {
+            goto no_memory;
+        }
+        *sp  = (sint64)(size_t)joined;
+        tos += v->str[ 1 ];
+        __SKIP();
+        __NEXT();
+
+    __OP( BC_HALT )
+        goto done;
+
+    __END()
+
+no_memory:
+    result->error = VM_NO_MEMORY;
+    goto done;
+
+write_error:
+    result->error = VM_WRITE_ERROR;
+
+done:
+    if( ( NULL != out.buf )
+     && !__flush( &out )
+     && ( VM_NO_ERROR == result->error ) )
+    {
+        result->error = VM_WRITE_ERROR;
+    }
+    result->bytes_out  = out.bytes;
+    result->dispatches = dispatches;
+    result->jit_loops  = jit.num_loops;
+
+    free_arena( &strings.arena );
+    free( out.buf );
+    free( vars );
+    free( stack );
+    free( fstack );
+    free( runs );
+    free( starts );
+#if defined( __THREADED )
+    free( words );
+#endif
+    free_jit( &jit );
+
+}   /* run_program() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       run_buffer - "Run Buffer"
+*
+*   DESCRIPTION:
+*       Runs a program in-process, writing what
+*       it prints to a file or pipe. It prints
+*       what the Gforth compile_buffter() writes
+*       for it would. Nothing runs unless the
+*       whole program checks, as Gforth never
+*       sees a program that doesn't compile.
+*       The symbol table must be initialized.
+*
+*   ERRORS:
+*       * As compile_buffer(), for the
+*         program's parse and type errors.
+*       * Sets COMPILE_RUN_ERROR, with the
+*         source offset of the list that
+*         failed, if the program fails as it
+*         runs.
+*
+*   NOTES:
+*       * bytes_out counts the bytes the
+*         program printed, and dispatches the
+*         opcodes it ran.
+*       * Superinstructions are used unless
+*         the peephole optimizer is off.
+*       * Loops are compiled to machine code
+*         once taken jit_trips times.
+*       * Each phase is timed if there are
+*         statistics to add to.
+*       * With a profile file, each statement
+*         is counted and timed as it runs, and
+*         the profile is written even if the
+*         run fails. Nothing is compiled to
+*         machine code, and a run that isn't
+*         profiled has no profiling code.
+*
+**************************************************/
+void run_buffer
+(
+    const char             *src,    /* source buffer            */
+    uint                    len,    /* length of the source     */
+    int                     fd,     /* file or pipe to write    */
+    const struct compile_options_type
+                           *opts,   /* options                  */
+    struct compile_result_type
+                           *result  /* outcome                  */
+)
+{
+    /*---------------------------------
+    Local variables
+    ---------------------------------*/
+    struct __runner_type    r;      /* runner                   */
+    struct pipe_result_type pr;     /* front end's outcome      */
+    struct vm_result_type   vr;     /* run's outcome            */
+    struct stats_clock_type clock;  /* times the run            */
+
+    memset( result, 0, sizeof( *result ) );
+    memset( &r, 0, sizeof( r ) );
+    r.opts = opts;
+    if( ( TYPE_NO_ERROR != init_type_info( &r.ti ) )
+     || ( BC_NO_ERROR != init_program( &r.prog ) ) )
+    {
+        free_type_info( &r.ti );
+        result->error   = COMPILE_NO_MEMORY;
+        result->message = compile_error_str( COMPILE_NO_MEMORY );
+        return;
+    }
+    r.prog.profile = ( NULL != opts->profile );
+
+    run_pipeline( src, len, __lower_batch, &r, opts->threaded, opts->stats, &pr );
+
+    /*---------------------------------
+    Run only a program that compiled
+    ---------------------------------*/
+    if( PIPE_PARSE_ERROR == pr.error )
+    {
+        result->error        = COMPILE_PARSE_ERROR;
+        result->message      = parse_error_str( pr.parse_error );
+        result->error_offset = pr.error_offset;
+    }
+    else if( ( PIPE_NO_MEMORY == pr.error )
+          || ( TYPE_NO_MEMORY == r.ti.error )
+          || ( BC_NO_ERROR != r.prog.error ) )
+    {
+        result->error = COMPILE_NO_MEMORY;
+    }
+    else if( PIPE_NO_THREAD == pr.error )
+    {
+        result->error = COMPILE_NO_THREAD;
+    }
+    else if( TYPE_NO_ERROR != r.ti.error )
+    {
+        result->error        = COMPILE_TYPE_ERROR;
+        result->message      = type_error_str( r.ti.error );
+        result->error_offset = r.ti.error_offset;
+    }
+    else if( BC_NO_ERROR != end_program( &r.prog, opts->peephole ) )
+    {
+        result->error = COMPILE_NO_MEMORY;
+    }
+    else
+    {
+        stats_start( opts->stats, STATS_RUN, &clock );
+        run_program( &r.prog, opts->jit_trips, fd, &vr );
+        stats_stop( opts->stats, STATS_RUN, &clock );
+        result->bytes_out  = vr.bytes_out;
+        result->dispatches = vr.dispatches;
+        result->jit_loops  = vr.jit_loops;
+        if( VM_NO_MEMORY == vr.error )
+        {
+            result->error = COMPILE_NO_MEMORY;
+        }
+        else if( VM_WRITE_ERROR == vr.error )
+        {
+            result->error = COMPILE_WRITE_ERROR;
+        }
+        else if( VM_NO_ERROR != vr.error )
+        {
+            result->error        = COMPILE_RUN_ERROR;
+            result->message      = vm_error_str( vr.error );
+            result->error_offset = vr.error_offset;
+        }
+
+        if( ( NULL != opts->profile )
+         && !write_profile( &r.prog, src, len, opts->profile )
+         && ( COMPILE_NO_ERROR == result->error ) )
+        {
+            result->error = COMPILE_WRITE_ERROR;
+        }
+    }
+
+    if( NULL == result->message )
+    {
+        result->message = compile_error_str( result->error );
+    }
+    result->num_forms  = pr.num_forms;
+    result->num_folded = r.num_folded;
+
+    free_program( &r.prog );
+    free_type_info( &r.ti );
+
+}   /* run_buffer() */
+
+
+/**************************************************
+*
+*   FUNCTION:
+*       vm_error_str - "VM Error String"
+*
+*   DESCRIPTION:
+*       Describes a run-time error code.
+*
+**************************************************/
+const char *vm_error_str
+(
+    vm_error_t8             error   /* error code               */
+)
+{
+    switch( error )
+    {
+        case VM_NO_ERROR:
+            return( "no error" );
+
+        case VM_NO_MEMORY:
+            return( "out of memory" );
+
+        case VM_WRITE_ERROR:
+            return( "unable to write the output" );
+
+        case VM_DIVIDE_BY_ZERO:
+            return( "division by zero" );
+
+        case VM_OUT_OF_RANGE:
+            return( "result out of range" );
+
+        default:
+            return( "unknown error" );
+    }
+
+}   /* vm_error_str() */
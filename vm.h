@@ -0,0 +1,92 @@
+/**************************************************
+*
+*   NAME:
+*       vm.h
+*
+*   DESCRIPTION:
+*       Provides the public interface for
+*       running programs in-process, on the
+*       bytecode interpreter
+*
+**************************************************/
+
+#ifndef __VM_H__
+#define __VM_H__
+
+/*-------------------------------------------------
+                 PROJECT INCLUDES
+-------------------------------------------------*/
+#include "bytecode.h"
+#include "compiler.h"
+#include "types.h"
+
+/*-------------------------------------------------
+                LITERAL CONSTANTS
+-------------------------------------------------*/
+
+#define VM_OUT_SIZE         65536   /* bytes of output per write()     */
+#define VM_PRECISION        15      /* significant digits of f.,       */
+                                    /*  Gforth's default precision     */
+
+/*-------------------------------------
+Error types
+-------------------------------------*/
+typedef sint8 vm_error_t8;
+enum
+{
+    VM_NO_ERROR           =  0,     /* no error                         */
+    VM_NO_MEMORY          = -1,     /* out of memory                    */
+    VM_WRITE_ERROR        = -2,     /* the output couldn't be written   */
+    VM_DIVIDE_BY_ZERO     = -3,     /* integer "/" or "%" by zero       */
+    VM_OUT_OF_RANGE       = -4      /* quotient doesn't fit in a cell   */
+};
+
+/*-------------------------------------------------
+                        TYPES
+-------------------------------------------------*/
+
+/*-------------------------------------
+Outcome of a run
+-------------------------------------*/
+struct vm_result_type
+{
+    vm_error_t8         error;          /* error code               */
+    uint                error_offset;   /* offset of the list that  */
+                                        /*  failed                  */
+    uint64              bytes_out;      /* bytes the program wrote  */
+    uint64              dispatches;     /* opcodes run              */
+    uint                jit_loops;      /* loops compiled           */
+};
+
+/*-------------------------------------------------
+                 FUNCION PROTOTYPES
+-------------------------------------------------*/
+
+void run_program
+(
+    const struct bc_program_type
+                           *prog,   /* ended program            */
+    uint                    jit_trips,
+                                    /* trips before a loop is   */
+                                    /*  compiled, 0 for never   */
+    int                     fd,     /* file or pipe to write    */
+    struct vm_result_type  *result  /* outcome                  */
+);
+
+void run_buffer
+(
+    const char             *src,    /* source buffer            */
+    uint                    len,    /* length of the source     */
+    int                     fd,     /* file or pipe to write    */
+    const struct compile_options_type
+                           *opts,   /* options                  */
+    struct compile_result_type
+                           *result  /* outcome                  */
+);
+
+const char *vm_error_str
+(
+    vm_error_t8             error   /* error code               */
+);
+
+#endif /* __VM_H__ */